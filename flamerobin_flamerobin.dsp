@@ -328,6 +328,18 @@ SOURCE=.\src\gui\controls\DataGrid.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\controls\DataGridAggregates.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\gui\controls\DataGridFetchQueue.cpp
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\gui\controls\DataGridGroups.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\gui\controls\DataGridRowBuffer.cpp
 # End Source File
 # Begin Source File
@@ -336,10 +348,18 @@ SOURCE=.\src\gui\controls\DataGridRows.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\controls\DataGridSelection.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\gui\controls\DataGridTable.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\controls\DataGridTextMatcher.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\config\DatabaseConfig.cpp
 # End Source File
 # Begin Source File
@@ -388,6 +408,10 @@ SOURCE=.\src\gui\GUIURIHandlerHelper.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\GroupRowsDialog.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\gui\HtmlHeaderMetadataItemVisitor.cpp
 # End Source File
 # Begin Source File
@@ -448,6 +472,10 @@ SOURCE=.\src\engine\MetadataLoader.cpp
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\engine\StatementCache.cpp
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\metadata\MetadataTemplateCmdHandler.cpp
 # End Source File
 # Begin Source File
@@ -766,6 +794,18 @@ SOURCE=.\src\gui\controls\DataGrid.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\controls\DataGridAggregates.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\gui\controls\DataGridFetchQueue.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\gui\controls\DataGridGroups.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\gui\controls\DataGridRowBuffer.h
 # End Source File
 # Begin Source File
@@ -774,10 +814,22 @@ SOURCE=.\src\gui\controls\DataGridRows.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\controls\DataGridSelection.h
+# End Source File
+# Begin Source File
+
+SOURCE=.\src\gui\controls\DataGridSort.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\gui\controls\DataGridTable.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\controls\DataGridTextMatcher.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\config\DatabaseConfig.h
 # End Source File
 # Begin Source File
@@ -826,6 +878,10 @@ SOURCE=.\src\gui\GUIURIHandlerHelper.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\gui\GroupRowsDialog.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\gui\HtmlHeaderMetadataItemVisitor.h
 # End Source File
 # Begin Source File
@@ -894,6 +950,10 @@ SOURCE=.\src\engine\MetadataLoader.h
 # End Source File
 # Begin Source File
 
+SOURCE=.\src\engine\StatementCache.h
+# End Source File
+# Begin Source File
+
 SOURCE=.\src\metadata\MetadataTemplateManager.h
 # End Source File
 # Begin Source File
@@ -33,12 +33,20 @@
 #include "engine/MetadataLoader.h"
 #include "metadata/database.h"
 
-MetadataLoader::MetadataLoader(Database& database, unsigned maxStatements)
+// MetadataLoader class
+MetadataLoader::MetadataLoader(Database& database)
     : databaseM(database.getIBPPDatabase()), transactionM(),
-        transactionLevelM(0), statementsM(), maxStatementsM(maxStatements)
+        transactionLevelM(0),
+        statementCacheM(database.getStatementCache())
 {
 }
 
+MetadataLoader::~MetadataLoader()
+{
+    if (transactionM != 0)
+        statementCacheM->releaseStatements(transactionM);
+}
+
 void MetadataLoader::transactionStart()
 {
     ++transactionLevelM;
@@ -54,6 +62,7 @@ void MetadataLoader::transactionStart()
         }
         catch (IBPP::LogicException&)
         {
+            statementCacheM->releaseStatements(transactionM);
             transactionM = 0;
         }
     }
@@ -67,11 +76,7 @@ void MetadataLoader::transactionStart()
 void MetadataLoader::transactionCommit()
 {
     if (--transactionLevelM == 0 && transactionM != 0)
-    {
-        statementsM.clear();
         transactionM->Commit();
-        transactionM = 0;
-    }
 }
 
 bool MetadataLoader::transactionStarted()
@@ -86,50 +91,17 @@ IBPP::Statement MetadataLoader::createStatement(const std::string& sql)
     return IBPP::StatementFactory(databaseM, transactionM, sql);
 }
 
-MetadataLoader::IBPPStatementListIterator MetadataLoader::findStatement(
-    const std::string& sql)
-{
-    for (IBPPStatementListIterator it = statementsM.begin();
-        it != statementsM.end(); ++it)
-    {
-        if ((*it)->Sql() == sql)
-            return it;
-    }
-    return statementsM.end();
-}
-
 IBPP::Statement& MetadataLoader::getStatement(const std::string& sql)
 {
     wxASSERT(transactionStarted());
 
-    IBPP::Statement stmt;
-    IBPPStatementListIterator it = findStatement(sql);
-    if (it != statementsM.end())
-    {
-        stmt = (*it);
-        statementsM.erase(it);
-    }
-    else
-    {
-        stmt = IBPP::StatementFactory(databaseM, transactionM, sql);
-    }
-    statementsM.push_front(stmt);
-    limitListSize();
-    return statementsM.front();
-}
-
-void MetadataLoader::limitListSize()
-{
-    if (maxStatementsM)
-    {
-        while (statementsM.size() > maxStatementsM)
-            statementsM.remove(statementsM.back());
-    }
+    return statementCacheM->getStatement(transactionM, sql);
 }
 
 void MetadataLoader::releaseStatements()
 {
-    statementsM.clear();
+    if (transactionM != 0)
+        statementCacheM->releaseStatements(transactionM);
     if (transactionM != 0 && transactionM->Started())
     {
         transactionM->Commit();
@@ -137,15 +109,6 @@ void MetadataLoader::releaseStatements()
     }
 }
 
-void MetadataLoader::setMaximumConcurrentStatements(unsigned count)
-{
-    if (maxStatementsM != count)
-    {
-        maxStatementsM = count;
-        limitListSize();
-    }
-}
-
 IBPP::Blob MetadataLoader::createBlob()
 {
     wxASSERT(transactionStarted());
@@ -24,39 +24,29 @@
 #ifndef FR_METADATALOADER_H
 #define FR_METADATALOADER_H
 
-#include <list>
-#include <string>
-
 #include <ibpp.h>
 
+#include "engine/StatementCache.h"
+
 class Database;
 class MetadataLoaderTransaction;
 
 class MetadataLoader
 {
 private:
-    typedef std::list<IBPP::Statement> IBPPStatementList;
-    typedef std::list<IBPP::Statement>::iterator IBPPStatementListIterator;
-
     friend class MetadataLoaderTransaction;
 
     IBPP::Database databaseM;
     IBPP::Transaction transactionM;
     unsigned transactionLevelM;
-
-    std::list<IBPP::Statement> statementsM;
-    unsigned maxStatementsM;
-    // Returns an iterator to the prepared IBPP::Statement object
-    // for the sql statement if available, else returns statementsM.end().
-    IBPPStatementListIterator findStatement(const std::string& sql);
-    // Releases any assigned statement objects beyond the list size limit.
-    void limitListSize();
+    StatementCache* statementCacheM;
 
     // A read-only transaction is used to read metadata from the database.
     // The first call of transactionStart() starts the transaction, further
     // calls only increment transactionLevelM.  Calls to transactionCommit()
     // decrease transactionLevelM, when it reaches 0 the transaction itself
-    // is committed.
+    // is committed.  The transaction object is kept for the next start, so
+    // that its statements stay prepared in the statement cache.
     // Methods are private, use of MetadataLoaderTransaction class is
     // exception-safe and allows for proper synchronization with locks
     // on metadata items (first unlock the object, then commit transaction)
@@ -65,13 +55,11 @@ private:
     bool transactionStarted();
 
 public:
-    // Creates MetadataLoader object for the database, which will use
-    // a maximum of maxStatements assigned IBPP::Statement objects to
-    // improve load times of metadata items.
-    // Setting the parameter maxStatements to 0 will disable the size limit
-    // of the statementsM list, and could possibly consume a lot of the
-    // available server ressources!
-    MetadataLoader(Database& database, unsigned maxStatements = 1);
+    // Creates MetadataLoader object for the database, which will use the
+    // statement cache of the database to improve load times of metadata
+    // items.
+    MetadataLoader(Database& database);
+    ~MetadataLoader();
 
     // Creates a prepared IBPP::Statement object for the sql statement.
     // Should be used in cases where sql is unique and can not be reused,
@@ -79,18 +67,11 @@ public:
     // statements will not be replaced.
     IBPP::Statement createStatement(const std::string& sql);
     // returns a reference to a prepared IBPP::Statement object for the
-    // sql statement, either recycled, newly created, or newly prepared
-    // using the least recently used IBPP::Statement in statementsM
+    // sql statement, either from the statement cache or newly prepared
     IBPP::Statement& getStatement(const std::string& sql);
-    // releases any assigned IBPP::Statement objects while keeping the maximum
-    // number of objects untouched
+    // releases the cached IBPP::Statement objects of the transaction and
+    // commits it
     void releaseStatements();
-    // readjusts maximum number of IBPP::Statement objects in statementsM,
-    // releasing any assigned statement objects beyond the new limit
-    // setting the parameter count to 0 will disable the size limit of the
-    // statementsM list, and could possibly consume a lot of the available
-    // server ressources!
-    void setMaximumConcurrentStatements(unsigned count);
 
     // Creates an IBPP::Blob object using the database and transaction
     IBPP::Blob createBlob();
@@ -0,0 +1,156 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include "engine/StatementCache.h"
+
+// StatementCache class
+size_t StatementCache::KeyHash::operator()(const Key& key) const
+{
+    return std::hash<std::string>()(key.sql)
+        ^ (std::hash<void*>()(key.transaction) * 31);
+}
+
+StatementCache::StatementCache(const IBPP::Database& database,
+        unsigned maxSize)
+    : databaseM(database), maxSizeM(maxSize), hitsM(0), missesM(0),
+        evictionsM(0)
+{
+}
+
+StatementCache::~StatementCache()
+{
+}
+
+IBPP::Statement& StatementCache::getStatement(
+    const IBPP::Transaction& transaction, const std::string& sql)
+{
+    Key key;
+    key.transaction = transaction.intf();
+    key.sql = sql;
+
+    EntryIndex::iterator it = indexM.find(key);
+    if (it != indexM.end())
+    {
+        IBPP::Statement& stmt = it->second->second;
+        // statements of a deleted transaction were detached from it, and
+        // another transaction can have been created at the same address
+        if (transaction == stmt->TransactionPtr()
+            && stmt->DatabasePtr() != 0)
+        {
+            ++hitsM;
+            entriesM.splice(entriesM.begin(), entriesM, it->second);
+            return entriesM.front().second;
+        }
+        entriesM.erase(it->second);
+        indexM.erase(it);
+    }
+
+    ++missesM;
+    IBPP::Statement stmt = prepareStatement(transaction, sql);
+    entriesM.push_front(Entry(key, stmt));
+    indexM[key] = entriesM.begin();
+    limitSize();
+    return entriesM.front().second;
+}
+
+IBPP::Statement StatementCache::prepareStatement(
+    const IBPP::Transaction& transaction, const std::string& sql)
+{
+    return IBPP::StatementFactory(databaseM, transaction, sql);
+}
+
+void StatementCache::limitSize()
+{
+    if (maxSizeM)
+    {
+        while (entriesM.size() > maxSizeM)
+        {
+            indexM.erase(entriesM.back().first);
+            entriesM.pop_back();
+            ++evictionsM;
+        }
+    }
+}
+
+void StatementCache::releaseStatements(const IBPP::Transaction& transaction)
+{
+    for (EntryList::iterator it = entriesM.begin(); it != entriesM.end(); )
+    {
+        if (it->first.transaction == transaction.intf())
+        {
+            indexM.erase(it->first);
+            it = entriesM.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+void StatementCache::clear()
+{
+    indexM.clear();
+    entriesM.clear();
+}
+
+void StatementCache::setMaximumSize(unsigned size)
+{
+    if (maxSizeM != size)
+    {
+        maxSizeM = size;
+        limitSize();
+    }
+}
+
+unsigned StatementCache::getMaximumSize() const
+{
+    return maxSizeM;
+}
+
+unsigned StatementCache::getSize() const
+{
+    return entriesM.size();
+}
+
+unsigned StatementCache::getHits() const
+{
+    return hitsM;
+}
+
+unsigned StatementCache::getMisses() const
+{
+    return missesM;
+}
+
+unsigned StatementCache::getEvictions() const
+{
+    return evictionsM;
+}
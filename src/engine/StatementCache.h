@@ -0,0 +1,97 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_STATEMENTCACHE_H
+#define FR_STATEMENTCACHE_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <ibpp.h>
+
+// Cache of prepared IBPP::Statement objects of one attachment.  Statements
+// are looked up by transaction and sql text through a hash map, and the
+// least recently used statement is released when the cache is full, so
+// that repeated statements don't need to be prepared again.
+class StatementCache
+{
+private:
+    struct Key
+    {
+        IBPP::ITransaction* transaction;
+        std::string sql;
+        bool operator==(const Key& other) const
+        {
+            return transaction == other.transaction && sql == other.sql;
+        }
+    };
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+    typedef std::pair<Key, IBPP::Statement> Entry;
+    // most recently used statement first
+    typedef std::list<Entry> EntryList;
+    typedef std::unordered_map<Key, EntryList::iterator, KeyHash> EntryIndex;
+
+    IBPP::Database databaseM;
+    EntryList entriesM;
+    EntryIndex indexM;
+    unsigned maxSizeM;
+    unsigned hitsM;
+    unsigned missesM;
+    unsigned evictionsM;
+
+    // Releases the least recently used statements beyond the size limit.
+    void limitSize();
+protected:
+    // prepares a statement that isn't in the cache
+    virtual IBPP::Statement prepareStatement(
+        const IBPP::Transaction& transaction, const std::string& sql);
+public:
+    // Creates the cache for the database, which will keep a maximum of
+    // maxSize prepared statements.  Setting the parameter maxSize to 0
+    // disables the size limit, and could possibly consume a lot of the
+    // available server ressources!
+    StatementCache(const IBPP::Database& database, unsigned maxSize);
+    virtual ~StatementCache();
+
+    // returns a reference to a prepared IBPP::Statement object for the
+    // sql statement in the transaction, either from the cache or newly
+    // prepared. The reference is valid until the next call.
+    IBPP::Statement& getStatement(const IBPP::Transaction& transaction,
+        const std::string& sql);
+    // releases the cached statements of the transaction
+    void releaseStatements(const IBPP::Transaction& transaction);
+    void clear();
+
+    void setMaximumSize(unsigned size);
+    unsigned getMaximumSize() const;
+    unsigned getSize() const;
+    unsigned getHits() const;
+    unsigned getMisses() const;
+    unsigned getEvictions() const;
+};
+
+#endif
@@ -44,6 +44,8 @@ namespace Cmds
         Query_Show_plan,
         Query_Execute_selection,
         Query_Execute_from_cursor,
+        Query_Cancel,
+        Query_Compare_profiles,
         Query_Commit,
         Query_Rollback,
         // next 4: order is important, because EVT_MENU_RANGE is used
@@ -69,6 +71,7 @@ namespace Cmds
         DataGrid_Copy_as_update,
         DataGrid_Save_as_html,
         DataGrid_Save_as_csv,
+        DataGrid_Group_rows,
         DataGrid_Set_header_font,
         DataGrid_Set_cell_font,
         DataGrid_Log_changes,
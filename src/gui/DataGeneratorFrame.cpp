@@ -1210,17 +1210,25 @@ void setFromOther(IBPP::Statement st, int param,
     st2->Prepare(wx2std(sql));
     st2->Execute();
     std::vector<T> values;
-    while (st2->Fetch())
+    // random values are picked from the first 100 rows
+    const int batchRows = 100;
+    IBPP::ColumnBatch batch;
+    bool more = true;
+    while (more)
     {
-        T value;
-        st2->Get(1, value);
-        values.push_back(value);
-        if (values.size() > recNo && !gs->randomValues)
+        more = st2->FetchBatch(batchRows, batch) == batchRows;
+        for (int row = 0; row < batch.Rows(); ++row)
         {
-            st->Set(param, value);
-            return;
+            T value;
+            batch.Get(row, 1, value);
+            values.push_back(value);
+            if (values.size() > recNo && !gs->randomValues)
+            {
+                st->Set(param, value);
+                return;
+            }
         }
-        if (values.size() > 99 && gs->randomValues)
+        if (gs->randomValues)
             break;
     }
     if (values.size() == 0)
@@ -1588,6 +1596,9 @@ void DataGeneratorFrame::generateData(std::list<Table *>& order)
             IBPP::StatementFactory(databaseM->getIBPPDatabase(), tr);
         st->Prepare(wx2std(ins + params + ")"));
 
+        // rows are sent to the server in batches, an error in any of them
+        // stops the generation like it did when executed one by one
+        IBPP::BatchErrors errors;
         for (int i = 0; i < records; i++)
         {
             if (pd.isCanceled())
@@ -1595,7 +1606,19 @@ void DataGeneratorFrame::generateData(std::list<Table *>& order)
             pd.stepProgress(1, 2);
             for (int p = 0; p < st->Parameters(); ++p)
                 setParam(st, p+1, colSet[p], i);
-            st->Execute();
+            st->AddBatch();
+            if (st->BatchRows() >= 1000 || i + 1 == records)
+            {
+                int first = i + 1 - st->BatchRows();
+                st->ExecuteBatch(errors);
+                if (!errors.empty())
+                {
+                    throw FRError(wxString::Format(_("Record %d: %s"),
+                        first + errors[0].row + 1,
+                        wxString(errors[0].message.c_str(),
+                            *databaseM->getCharsetConverter())));
+                }
+            }
         }
     }
 
@@ -34,6 +34,7 @@
 #include <wx/gbsizer.h>
 
 #include "config/Config.h"
+#include "config/DatabaseConfig.h"
 #include "core/StringUtils.h"
 #include "gui/controls/DndTextControls.h"
 #include "gui/DatabaseRegistrationDialog.h"
@@ -106,6 +107,20 @@ void DatabaseRegistrationDialog::createControls()
             wxDefaultPosition, wxDefaultSize, getDatabaseDialectChoices());
     }
 
+    // connection profile, stored in the database preferences
+    label_wirecrypt = new wxStaticText(getControlsPanel(), -1,
+        _("Wire encryption:"));
+    choice_wirecrypt = new wxChoice(getControlsPanel(), -1,
+        wxDefaultPosition, wxDefaultSize, getWireCryptChoices());
+    checkbox_compression = new wxCheckBox(getControlsPanel(), -1,
+        _("Wire compression"));
+    label_pagebuffers = new wxStaticText(getControlsPanel(), -1,
+        _("Page buffers:"));
+    spinctrl_pagebuffers = new wxSpinCtrl(getControlsPanel(), -1,
+        wxEmptyString, wxDefaultPosition, wxDefaultSize, wxSP_ARROW_KEYS,
+        0, 1048576, 0);
+    spinctrl_pagebuffers->SetToolTip(_("0 for the database default"));
+
     button_ok = new wxButton(getControlsPanel(), wxID_SAVE,
         (createM ? _("Create") : _("Save")));
     button_cancel = new wxButton(getControlsPanel(), wxID_CANCEL, _("Cancel"));
@@ -181,6 +196,18 @@ wxArrayString DatabaseRegistrationDialog::getDatabasePagesizeChoices() const
     return choices;
 }
 
+wxArrayString DatabaseRegistrationDialog::getWireCryptChoices() const
+{
+    // same order as IBPP::WCL
+    wxArrayString choices;
+    choices.Alloc(4);
+    choices.Add(_("Default"));
+    choices.Add(_("Disabled"));
+    choices.Add(_("Enabled"));
+    choices.Add(_("Required"));
+    return choices;
+}
+
 void DatabaseRegistrationDialog::doReadConfigSettings(const wxString& prefix)
 {
     BaseDialog::doReadConfigSettings(prefix);
@@ -293,6 +320,13 @@ void DatabaseRegistrationDialog::layoutControls()
         sizerControls->Add(choice_dialect, wxGBPosition(5, 3), wxDefaultSpan, wxALIGN_CENTER_VERTICAL | wxEXPAND);
     }
 
+    int row = createM ? 6 : 5;
+    sizerControls->Add(label_wirecrypt, wxGBPosition(row, 0), wxDefaultSpan, wxALIGN_CENTER_VERTICAL);
+    sizerControls->Add(choice_wirecrypt, wxGBPosition(row, 1), wxDefaultSpan, wxALIGN_CENTER_VERTICAL | wxEXPAND);
+    sizerControls->Add(label_pagebuffers, wxGBPosition(row, 2), wxDefaultSpan, wxLEFT | wxALIGN_CENTER_VERTICAL, dx);
+    sizerControls->Add(spinctrl_pagebuffers, wxGBPosition(row, 3), wxDefaultSpan, wxALIGN_CENTER_VERTICAL | wxEXPAND);
+    sizerControls->Add(checkbox_compression, wxGBPosition(row + 1, 1), wxGBSpan(1, 3), wxALIGN_CENTER_VERTICAL);
+
     sizerControls->AddGrowableCol(1);
     sizerControls->AddGrowableCol(3);
 
@@ -309,6 +343,7 @@ void DatabaseRegistrationDialog::setControlsProperties()
 
     choice_authentication->SetSelection(0);
     combobox_charset->SetStringSelection("NONE");
+    choice_wirecrypt->SetSelection(IBPP::wcDefault);
     if (createM)
     {
         choice_pagesize->SetStringSelection("4096");
@@ -335,6 +370,10 @@ void DatabaseRegistrationDialog::setDatabase(DatabasePtr db)
     if (charset.empty())
         charset = "NONE";
     combobox_charset->SetValue(charset);
+    IBPP::ConnectionProfile profile(databaseM->getConnectionProfile());
+    choice_wirecrypt->SetSelection(profile.wireCrypt);
+    checkbox_compression->SetValue(profile.wireCompression);
+    spinctrl_pagebuffers->SetValue(profile.pageBuffers);
     // see whether the database has an empty or default name; knowing that will be
     // useful to keep the name in sync when other attributes change.
     updateIsDefaultDatabaseName();
@@ -348,6 +387,9 @@ void DatabaseRegistrationDialog::setDatabase(DatabasePtr db)
     choice_authentication->Enable(!connectAsM && !isConnected);
     combobox_charset->Enable(!isConnected);
     text_ctrl_role->SetEditable(!isConnected);
+    choice_wirecrypt->Enable(!isConnected);
+    checkbox_compression->Enable(!isConnected);
+    spinctrl_pagebuffers->Enable(!isConnected);
     if (connectAsM)
         button_ok->SetLabel(_("Connect"));
     else
@@ -439,6 +481,13 @@ void DatabaseRegistrationDialog::OnOkButtonClick(wxCommandEvent& WXUNUSED(event)
     wxBusyCursor wait;
     databaseM->setConnectionCharset(combobox_charset->GetValue());
     databaseM->setRole(text_ctrl_role->GetValue());
+    if (!databaseM->isConnected())
+    {
+        DatabaseConfig dc(databaseM.get(), config());
+        dc.setValue("WireCrypt", choice_wirecrypt->GetSelection());
+        dc.setValue("WireCompression", checkbox_compression->GetValue());
+        dc.setValue("PageBuffers", spinctrl_pagebuffers->GetValue());
+    }
 
     try
     {
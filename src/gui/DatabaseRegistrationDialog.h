@@ -25,6 +25,7 @@
 #define DATABASEREGISTRATIONDIALOG_H
 
 #include <wx/wx.h>
+#include <wx/spinctrl.h>
 
 #include "gui/BaseDialog.h"
 #include "metadata/MetadataClasses.h"
@@ -57,6 +58,11 @@ private:
     wxChoice* choice_pagesize;
     wxStaticText* label_dialect;
     wxChoice* choice_dialect;
+    wxStaticText* label_wirecrypt;
+    wxChoice* choice_wirecrypt;
+    wxCheckBox* checkbox_compression;
+    wxStaticText* label_pagebuffers;
+    wxSpinCtrl* spinctrl_pagebuffers;
     wxButton* button_ok;
     wxButton* button_cancel;
 
@@ -72,6 +78,7 @@ private:
     wxArrayString getDatabaseCharsetChoices() const;
     wxArrayString getDatabaseDialectChoices() const;
     wxArrayString getDatabasePagesizeChoices() const;
+    wxArrayString getWireCryptChoices() const;
 protected:
     virtual void doReadConfigSettings(const wxString& prefix);
     virtual void doWriteConfigSettings(const wxString& prefix) const;
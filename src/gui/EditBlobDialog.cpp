@@ -30,9 +30,12 @@
     #include "wx/wx.h"
 #endif
 
+#include <wx/stopwatch.h>
 #include <wx/stream.h>
 #include <wx/wfstream.h>
 
+#include <vector>
+
 #include "AdvancedMessageDialog.h"
 #include "core/FRError.h"
 #include "core/StringUtils.h"
@@ -44,6 +47,10 @@
 #include "gui/FRLayoutConfig.h"
 #include "gui/StyleGuide.h"
 
+// size of the blocks read from and written to blobs, large enough for
+// the segments of IBPP::Blob::ReadBlock() / WriteBlock() to be of 64 KB
+static const int blobStreamBlockSize = 256 * 1024;
+
 // Static members
 /* maybe later needed if plugin will be implemented
 int EditBlobDialog::m_libEditBlobUseCount = 0;
@@ -286,6 +293,9 @@ private:
     bool canCancelM;
     int posM;
     int rangeM;
+    wxString titleM;
+    wxStopWatch watchM;
+    long lastRateUpdateM;
 
     wxButton* buttonCancelM;
     wxWindow* parentM;
@@ -345,6 +355,9 @@ void EditBlobDialogProgressSizer::initProgress(const wxString& progressTitle,
     canceledM = false;
     canCancelM = canCancel;
     activeM = true;
+    titleM = progressTitle;
+    watchM.Start();
+    lastRateUpdateM = 0;
 
     progressTextM->SetLabel(progressTitle);
     progressGaugeM->SetRange(rangeM);
@@ -372,6 +385,16 @@ void EditBlobDialogProgressSizer::stepProgress(int stepAmount)
 { 
     posM += stepAmount;
     progressGaugeM->SetValue(posM);
+    // show the transfer rate, but don't relayout for every block
+    long now = watchM.Time();
+    if (now - lastRateUpdateM >= 250)
+    {
+        lastRateUpdateM = now;
+        double mbPerSec = posM / 1048.576 / now;
+        progressTextM->SetLabel(wxString::Format(_("%s (%.1f MB/s)"),
+            titleM.c_str(), mbPerSec));
+        Layout();
+    }
     wxYieldIfNeeded();
 }
 
@@ -678,7 +701,7 @@ bool EditBlobDialog::loadFromStreamAsText(wxInputStream& stream, bool isNull, co
     // So we can give the user the ability to cancel.
     while ((!progress->isCanceled()) && (readed < toread))
     {
-        int nextread = std::min(32767, toread - readed);
+        int nextread = std::min(blobStreamBlockSize, toread - readed);
         stream.Read((void*)bufptr, nextread);
         int lastread = stream.LastRead();
         if (lastread < 1)
@@ -733,19 +756,24 @@ bool EditBlobDialog::loadFromStreamAsBinary(wxInputStream& stream, bool isNull,
     int line = 0;
     wxString txtLine;
 
+    static const char hexDigits[] = "0123456789ABCDEF";
+    std::vector<char> buffer(blobStreamBlockSize);
+    wxString txtBlock;
     while (!progress->isCanceled())
     {
-        char buffer[32768];
-        stream.Read((void*)buffer, 32767);
+        stream.Read((void*)&buffer[0], blobStreamBlockSize);
         int size = stream.LastRead();
         if (size < 1)
             break;
-        buffer[size] = '\0';
 
+        // the text of all complete lines of a block is added at once
+        txtBlock.clear();
         int bufpos = 0;
         while (bufpos < size)
         {
-            txtLine += wxString::Format( "%02X", (unsigned char)(buffer[bufpos]) );
+            unsigned char c = (unsigned char)(buffer[bufpos]);
+            txtLine += hexDigits[c >> 4];
+            txtLine += hexDigits[c & 0x0F];
             bufpos++;
             col++;
 
@@ -753,12 +781,13 @@ bool EditBlobDialog::loadFromStreamAsBinary(wxInputStream& stream, bool isNull,
                 txtLine += " ";
             if (col >= 32)
             {
-                blob_binary->AddText(txtLine + "\n");
+                txtBlock += txtLine + "\n";
                 txtLine = "";
                 col = 0;
                 line++;
             }
         }
+        blob_binary->AddText(txtBlock);
         progress->stepProgress(size);
     }
     // add the last line if col > 0
@@ -812,8 +841,8 @@ bool EditBlobDialog::saveToStream(wxOutputStream& stream, bool* isNull, const wx
                 if (*isNull)
                   break;
 
-                const int maxBufSize = 32768;
-                char buffer[maxBufSize];
+                const int maxBufSize = blobStreamBlockSize;
+                std::vector<char> buffer(maxBufSize);
                 int bufSize = 0;
                 wxString txt = blob_binary->GetText();
                 wxString::const_iterator txtIt;
@@ -858,7 +887,7 @@ bool EditBlobDialog::saveToStream(wxOutputStream& stream, bool* isNull, const wx
 
                     if (bufSize >= maxBufSize-1)
                     {
-                        stream.Write(buffer, bufSize);
+                        stream.Write(&buffer[0], bufSize);
                         progress->stepProgress(bufSize);
                         bufSize = 0;
                     }
@@ -866,7 +895,7 @@ bool EditBlobDialog::saveToStream(wxOutputStream& stream, bool* isNull, const wx
                 };
                 if (bufSize > 0)
                 {
-                    stream.Write(buffer, bufSize);
+                    stream.Write(&buffer[0], bufSize);
                     progress->stepProgress(bufSize);
                 }
             }
@@ -995,7 +1024,7 @@ void EditBlobDialog::saveBlob()
     DataGridRowsBlob b = dataGridTableM->setBlobPrepare(rowM, colM);
     // if nothing was modified and the cache is created we can
     // directly write the cache to the blob. This saves time.
-    char buffer[32768];
+    std::vector<char> buffer(blobStreamBlockSize);
     bool ok = false;
     wxString progressTitle = _("Saving editor-data.");
     if ((!dataModifiedM) && (cacheM))
@@ -1011,13 +1040,13 @@ void EditBlobDialog::saveBlob()
         {
             wxMemoryInputStream inBuf(*cacheM);
 
-            inBuf.Read((void*)buffer, 32767);
+            inBuf.Read((void*)&buffer[0], blobStreamBlockSize);
             int bufLen = inBuf.LastRead();
             b.blob->Create();
             while ((bufLen > 0) && (!progress->isCanceled()))
             {
-                b.blob->Write(buffer, bufLen);
-                inBuf.Read((void*)buffer, 32767);
+                b.blob->WriteBlock(&buffer[0], bufLen);
+                inBuf.Read((void*)&buffer[0], blobStreamBlockSize);
                 bufLen = inBuf.LastRead();
             }
             b.blob->Close();
@@ -1348,6 +1377,8 @@ FRInputBlobStream::FRInputBlobStream(IBPP::Blob blob)
     if (blobM != 0)
     {
         blobM->Close();
+        // the editor processes a block while the next one is fetched
+        blobM->SetReadAhead(true);
         blobM->Open();
         blobM->Info(&sizeM, 0, 0);
     }
@@ -1364,7 +1395,7 @@ FRInputBlobStream::~FRInputBlobStream()
 size_t FRInputBlobStream::OnSysRead(void* buffer, size_t size)
 {
     if ((blobM != 0) && (sizeM > 0))
-        return blobM->Read(buffer, size);
+        return blobM->ReadBlock(buffer, (int)size);
     else
         return 0;
 }
@@ -1393,7 +1424,7 @@ size_t FROutputBlobStream::OnSysWrite(const void* buffer, size_t bufsize)
     if (bufsize == 0)
         return 0;
 
-    blobM->Write(buffer, bufsize);
+    blobM->WriteBlock(buffer, (int)bufsize);
     return bufsize;
 }
 
@@ -75,7 +75,6 @@ EventWatcherFrame::EventWatcherFrame(wxWindow* parent, DatabasePtr db)
     : BaseFrame(parent, -1, wxEmptyString), databaseM(db), eventsM(0)
 {
     wxASSERT(db);
-    timerM.SetOwner(this, ID_timer);
 
     setIdString(this, getFrameId(db));
     // observe database object to close on disconnect / destruction
@@ -96,6 +95,12 @@ EventWatcherFrame::EventWatcherFrame(wxWindow* parent, DatabasePtr db)
     SetIcon(icon);
 }
 
+EventWatcherFrame::~EventWatcherFrame()
+{
+    // the delivery thread must not call into a destroyed frame
+    stopMonitoring();
+}
+
 void EventWatcherFrame::createControls()
 {
     panel_controls = new wxPanel(this, -1, wxDefaultPosition, wxDefaultSize,
@@ -177,7 +182,7 @@ void EventWatcherFrame::updateControls()
     }
     button_remove->Enable(isSelected);
     button_save->Enable(hasEvents);
-    button_monitor->Enable(hasEvents || timerM.IsRunning());
+    button_monitor->Enable(hasEvents || eventsM != 0);
 }
 
 void EventWatcherFrame::addEvents(wxString& s)
@@ -212,27 +217,18 @@ void EventWatcherFrame::defineMonitoredEvents()
 {
     if (eventsM != 0)
     {
-        // prevent timer from messing our business
-        bool timerRunning = timerM.IsRunning();
-        setTimerActive(false);
-
         // get a list of events to be monitored
         std::vector<std::string> events;
         for (int i = 0; i < (int)listbox_monitored->GetCount(); i++)
             events.push_back(wx2std(listbox_monitored->GetString(i)));
 
+        // the initial event counts are picked up by the delivery thread
         eventsM->Clear();
         std::vector<std::string>::const_iterator it;
         for (it = events.begin(); it != events.end(); it++)
-        {
             eventsM->Add(*it, this);
-            // make IBPP::Events pick up the initial event count
-            eventsM->Dispatch();
-        }
 
         updateControls();
-        if (timerRunning)
-            setTimerActive(true);
     }
 }
 
@@ -241,30 +237,28 @@ DatabasePtr EventWatcherFrame::getDatabase() const
     return databaseM.lock();
 }
 
-bool EventWatcherFrame::setTimerActive(bool active)
+void EventWatcherFrame::stopMonitoring()
 {
-    if (active && !timerM.Start(100))
-        wxMessageBox(_("Can not start timer"), _("Error"), wxOK | wxICON_ERROR);
-        
-    if (!active && timerM.IsRunning())
+    if (eventsM != 0)
     {
-        timerM.Stop();
-        wxSafeYield();
+        // waits for a delivery in progress to finish
+        eventsM->StopDelivery();
+        eventsM.clear();
     }
-    return active == timerM.IsRunning();
+    wxCriticalSectionLocker locker(critsectM);
+    receivedEventsM.clear();
 }
 
 void EventWatcherFrame::updateMonitoringActive()
 {
     if (eventsM != 0)
     {
-        setTimerActive(true);
+        eventsM->StartDelivery();
         button_monitor->SetLabel(_("Stop &Monitoring"));
         eventlog_received->logAction(_("Monitoring started"));
     }
     else
     {
-        timerM.Stop();
         button_monitor->SetLabel(_("Start &Monitoring"));
         eventlog_received->logAction(_("Monitoring stopped"));
     }
@@ -277,6 +271,35 @@ void EventWatcherFrame::ibppEventHandler(IBPP::Events events,
     eventlog_received->logEvent(name, count);
 }
 
+// called on the delivery thread of eventsM
+void EventWatcherFrame::ibppEventsHandler(IBPP::Events WXUNUSED(events),
+    const IBPP::EventCounts& counts)
+{
+    bool doPostMsg;
+    {
+        wxCriticalSectionLocker locker(critsectM);
+        // only the first delivery after the last update of the log posts a
+        // message, later ones are added up until the frame gets to it
+        doPostMsg = receivedEventsM.empty();
+        IBPP::EventCounts::const_iterator it;
+        for (it = counts.begin(); it != counts.end(); ++it)
+        {
+            IBPP::EventCounts::iterator itRec = receivedEventsM.begin();
+            while (itRec != receivedEventsM.end() && itRec->first != it->first)
+                ++itRec;
+            if (itRec != receivedEventsM.end())
+                itRec->second += it->second;
+            else
+                receivedEventsM.push_back(*it);
+        }
+    }
+    if (doPostMsg)
+    {
+        wxCommandEvent event(wxEVT_COMMAND_MENU_SELECTED, ID_events_received);
+        wxPostEvent(this, event);
+    }
+}
+
 //! closes window if database is removed (unregistered)
 void EventWatcherFrame::subjectRemoved(Subject* subject)
 {
@@ -336,7 +359,7 @@ BEGIN_EVENT_TABLE(EventWatcherFrame, wxFrame)
     EVT_BUTTON(EventWatcherFrame::ID_button_save, EventWatcherFrame::OnButtonSaveClick)
     EVT_BUTTON(EventWatcherFrame::ID_button_monitor, EventWatcherFrame::OnButtonStartStopClick)
     EVT_LISTBOX(EventWatcherFrame::ID_listbox_monitored, EventWatcherFrame::OnListBoxSelected)
-    EVT_TIMER(EventWatcherFrame::ID_timer, EventWatcherFrame::OnTimer)
+    EVT_MENU(EventWatcherFrame::ID_events_received, EventWatcherFrame::OnEventsReceived)
 END_EVENT_TABLE()
 
 void EventWatcherFrame::OnButtonLoadClick(wxCommandEvent& WXUNUSED(event))
@@ -413,7 +436,7 @@ void EventWatcherFrame::OnButtonRemoveClick(wxCommandEvent& WXUNUSED(event))
 void EventWatcherFrame::OnButtonStartStopClick(wxCommandEvent& WXUNUSED(event))
 {
     if (eventsM != 0)
-        eventsM.clear();
+        stopMonitoring();
     else
     {
         DatabasePtr database = getDatabase();
@@ -434,11 +457,20 @@ void EventWatcherFrame::OnListBoxSelected(wxCommandEvent& WXUNUSED(event))
     updateControls();
 }
 
-void EventWatcherFrame::OnTimer(wxTimerEvent& WXUNUSED(event))
+void EventWatcherFrame::OnEventsReceived(wxCommandEvent& WXUNUSED(event))
 {
-    if (eventsM != 0)
-        eventsM->Dispatch();
-    else // stop timer, update UI
-        updateMonitoringActive();
+    IBPP::EventCounts counts;
+    {
+        wxCriticalSectionLocker locker(critsectM);
+        counts.swap(receivedEventsM);
+    }
+    if (eventsM == 0)
+        return;
+
+    eventlog_received->Freeze();
+    IBPP::EventCounts::const_iterator it;
+    for (it = counts.begin(); it != counts.end(); ++it)
+        eventlog_received->logEvent(it->first, it->second);
+    eventlog_received->Thaw();
 }
 
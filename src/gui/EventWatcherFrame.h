@@ -29,6 +29,7 @@
 #include <wx/button.h>
 #include <wx/listbox.h>
 #include <wx/panel.h>
+#include <wx/thread.h>
 
 #include <string>
 
@@ -47,7 +48,9 @@ class EventWatcherFrame : public BaseFrame, public Observer,
 {
 private:
     DatabaseWeakPtr databaseM;
-    wxTimer timerM;
+    // counts delivered by the IBPP::Events thread, not yet logged
+    wxCriticalSection critsectM;
+    IBPP::EventCounts receivedEventsM;
     IBPP::Events eventsM;
 
     wxPanel* panel_controls;
@@ -69,11 +72,13 @@ private:
     void addEvents(wxString& s);    // multiline allowed
     void defineMonitoredEvents();
     DatabasePtr getDatabase() const;
-    bool setTimerActive(bool active);
+    void stopMonitoring();
     void updateMonitoringActive();
 
     virtual void ibppEventHandler(IBPP::Events events,
         const std::string& name, int count);
+    virtual void ibppEventsHandler(IBPP::Events events,
+        const IBPP::EventCounts& counts);
 
     // observer stuff
     virtual void subjectRemoved(Subject* subject);
@@ -85,6 +90,7 @@ protected:
     virtual const wxString getName() const;
 public:
     EventWatcherFrame(wxWindow* parent, DatabasePtr db);
+    ~EventWatcherFrame();
 
     static EventWatcherFrame* findFrameFor(DatabasePtr db);
 private:
@@ -98,7 +104,7 @@ private:
         ID_button_load,
         ID_button_save,
         ID_button_monitor,
-        ID_timer
+        ID_events_received
     };
 
     void OnButtonAddClick(wxCommandEvent& event);
@@ -107,7 +113,7 @@ private:
     void OnButtonSaveClick(wxCommandEvent& event);
     void OnButtonStartStopClick(wxCommandEvent& event);
     void OnListBoxSelected(wxCommandEvent& event);
-    void OnTimer(wxTimerEvent& event);
+    void OnEventsReceived(wxCommandEvent& event);
 
     DECLARE_EVENT_TABLE()
 };
@@ -35,9 +35,12 @@
 #include <wx/file.h>
 #include <wx/fontdlg.h>
 #include <wx/stopwatch.h>
+#include <wx/thread.h>
 #include <wx/tokenzr.h>
 
 #include <algorithm>
+#include <exception>
+#include <functional>
 #include <map>
 #include <vector>
 
@@ -61,6 +64,7 @@
 #include "gui/ExecuteSql.h"
 #include "gui/ExecuteSqlFrame.h"
 #include "gui/FRLayoutConfig.h"
+#include "gui/GroupRowsDialog.h"
 #include "gui/InsertDialog.h"
 #include "gui/StatementHistoryDialog.h"
 #include "gui/StyleGuide.h"
@@ -498,6 +502,52 @@ public:
     }
 };
 
+// ExecuteSqlThread: makes the calls to the server which can take long, an
+// exception thrown by them is passed to the main thread. The frame is sent
+// a wxThreadEvent when they are done
+class ExecuteSqlThread: public wxThread
+{
+private:
+    wxEvtHandler* handlerM;
+    int idM;
+    std::function<void ()> workM;
+    std::exception_ptr errorM;
+protected:
+    virtual ExitCode Entry();
+public:
+    ExecuteSqlThread(wxEvtHandler* handler, int id,
+        const std::function<void ()>& work);
+
+    // only valid after the thread has finished
+    void rethrowError();
+};
+
+ExecuteSqlThread::ExecuteSqlThread(wxEvtHandler* handler, int id,
+        const std::function<void ()>& work)
+    : wxThread(wxTHREAD_JOINABLE), handlerM(handler), idM(id), workM(work)
+{
+}
+
+wxThread::ExitCode ExecuteSqlThread::Entry()
+{
+    try
+    {
+        workM();
+    }
+    catch (...)
+    {
+        errorM = std::current_exception();
+    }
+    wxQueueEvent(handlerM, new wxThreadEvent(wxEVT_THREAD, idM));
+    return 0;
+}
+
+void ExecuteSqlThread::rethrowError()
+{
+    if (errorM)
+        std::rethrow_exception(errorM);
+}
+
 // MB: we don't use the 'parent' parameter here, because of some ugly bugs.
 //     For example, if user clicks the 'drop trigger' link on the trigger
 //     property page, it creates new ExecuteSqlFrame with trigger property
@@ -525,6 +575,14 @@ ExecuteSqlFrame::ExecuteSqlFrame(wxWindow* WXUNUSED(parent), int id,
     updateEditorCaretPosM = true;
     updateFrameTitleM = true;
 
+    executingM = false;
+    cancelRequestedM = false;
+    threadM = 0;
+    nextStepM = 0;
+    scriptCloseWhenDoneM = false;
+    scriptPrepareOnlyM = false;
+    scriptSelectionOffsetM = 0;
+    fetchMetricsPendingM = false;
     transactionIsolationLevelM = IBPP::ilConcurrency;
     transactionLockResolutionM = IBPP::lrWait;
     transactionAccessModeM = IBPP::amWrite;
@@ -551,6 +609,15 @@ ExecuteSqlFrame::ExecuteSqlFrame(wxWindow* WXUNUSED(parent), int id,
     notebook_1->AddPage(notebook_pane_1, _("Statistics"));
 
     notebook_pane_2 = new wxPanel(notebook_1, -1);
+    label_filter = new wxStaticText(notebook_pane_2, -1, _("Filter:"));
+    choice_filter_column = new wxChoice(notebook_pane_2, ID_filter_column);
+    // same order as DataGridFilter::Operator
+    const wxString filterOperators[] = { _("contains"), "=", "<>", "<", "<=",
+        ">", ">=", _("is null"), _("is not null") };
+    choice_filter_operator = new wxChoice(notebook_pane_2, ID_filter_operator,
+        wxDefaultPosition, wxDefaultSize,
+        sizeof(filterOperators) / sizeof(wxString), filterOperators);
+    text_ctrl_filter = new wxTextCtrl(notebook_pane_2, ID_filter_text);
     grid_data = new DataGrid(notebook_pane_2, ID_grid_data);
     notebook_1->AddPage(notebook_pane_2, _("Data"));
 
@@ -627,6 +694,9 @@ void ExecuteSqlFrame::buildToolbar(CommandManager& cm)
     toolBarM->AddTool( Cmds::Query_Show_plan, _("Show plan"),
         wxArtProvider::GetBitmap(ART_ShowExecutionPlan, wxART_TOOLBAR, bmpSize), wxNullBitmap,
         wxITEM_NORMAL, cm.getToolbarHint(_("Show query execution plan"), Cmds::Query_Show_plan));
+    toolBarM->AddTool( Cmds::Query_Cancel, _("Cancel"),
+        wxArtProvider::GetBitmap(wxART_CROSS_MARK, wxART_TOOLBAR, bmpSize), wxNullBitmap,
+        wxITEM_NORMAL, cm.getToolbarHint(_("Cancel execution"), Cmds::Query_Cancel));
     toolBarM->AddTool( Cmds::Query_Commit, _("Commit"),
         wxArtProvider::GetBitmap(ART_CommitTransaction, wxART_TOOLBAR, bmpSize), wxNullBitmap,
         wxITEM_NORMAL, cm.getToolbarHint(_("Commit transaction"), Cmds::Query_Commit));
@@ -726,6 +796,10 @@ void ExecuteSqlFrame::buildMainMenu(CommandManager& cm)
         cm.getMainMenuItemText(_("Execute &selection"), Cmds::Query_Execute_selection));
     statementMenu->Append(Cmds::Query_Execute_from_cursor,
         cm.getMainMenuItemText(_("Exec&ute from cursor"), Cmds::Query_Execute_from_cursor));
+    statementMenu->Append(Cmds::Query_Cancel,
+        cm.getMainMenuItemText(_("C&ancel execution"), Cmds::Query_Cancel));
+    statementMenu->Append(Cmds::Query_Compare_profiles,
+        cm.getMainMenuItemText(_("C&ompare connection profiles"), Cmds::Query_Compare_profiles));
     statementMenu->AppendSeparator();
 
     wxMenu* stmtPropMenu = new wxMenu();
@@ -772,6 +846,8 @@ void ExecuteSqlFrame::buildMainMenu(CommandManager& cm)
     gridMenu->Append(Cmds::DataGrid_Save_as_html,    _("Save as &html"));
     gridMenu->Append(Cmds::DataGrid_Save_as_csv,     _("Save as cs&v"));
     gridMenu->AppendSeparator();
+    gridMenu->Append(Cmds::DataGrid_Group_rows,      _("&Group fetched rows..."));
+    gridMenu->AppendSeparator();
     gridMenu->Append(Cmds::DataGrid_Set_header_font, _("Set h&eader font"));
     gridMenu->Append(Cmds::DataGrid_Set_cell_font,   _("Set cell f&ont"));
     gridMenu->AppendSeparator();
@@ -797,6 +873,7 @@ void ExecuteSqlFrame::set_properties()
     statusbar_1->SetStatusText("Transaction status", 3);
 
     grid_data->SetTable(new DataGridTable(statementM, databaseM), true);
+    resetFilter();
     splitter_window_1->Initialize(styled_text_ctrl_sql);
     viewModeM = vmEditor;
 
@@ -813,8 +890,21 @@ void ExecuteSqlFrame::do_layout()
     sizerPane1->Add(styled_text_ctrl_stats, 1, wxEXPAND);
     notebook_pane_1->SetSizer(sizerPane1);
 
-    // data grid notebook pane
-    wxBoxSizer* sizerPane2 = new wxBoxSizer(wxHORIZONTAL);
+    // data grid notebook pane, with the filter bar above the grid
+    wxBoxSizer* sizerFilter = new wxBoxSizer(wxHORIZONTAL);
+    sizerFilter->Add(label_filter, 0, wxALIGN_CENTER_VERTICAL);
+    sizerFilter->AddSpacer(styleguide().getControlLabelMargin());
+    sizerFilter->Add(choice_filter_column, 0, wxALIGN_CENTER_VERTICAL);
+    sizerFilter->AddSpacer(
+        styleguide().getRelatedControlMargin(wxHORIZONTAL));
+    sizerFilter->Add(choice_filter_operator, 0, wxALIGN_CENTER_VERTICAL);
+    sizerFilter->AddSpacer(
+        styleguide().getRelatedControlMargin(wxHORIZONTAL));
+    sizerFilter->Add(text_ctrl_filter, 1, wxALIGN_CENTER_VERTICAL);
+
+    wxBoxSizer* sizerPane2 = new wxBoxSizer(wxVERTICAL);
+    sizerPane2->Add(sizerFilter, 0, wxEXPAND | wxALL,
+        styleguide().getRelatedControlMargin(wxVERTICAL));
     sizerPane2->Add(grid_data, 1, wxEXPAND);
     notebook_pane_2->SetSizer(sizerPane2);
 
@@ -828,6 +918,14 @@ void ExecuteSqlFrame::do_layout()
 
 bool ExecuteSqlFrame::doCanClose()
 {
+    if (executingM)
+    {
+        Raise();
+        ::wxMessageBox(_("A statement is being executed.\nCancel the execution before closing the window."),
+            _("Warning"), wxOK | wxICON_WARNING);
+        return false;
+    }
+
     bool saveFile = false;
     if (filenameM.IsOk() && styled_text_ctrl_sql->GetModify())
     {
@@ -864,6 +962,15 @@ void ExecuteSqlFrame::doBeforeDestroy()
     // prevent editor from updating the invalid dataset
     if (grid_data->IsCellEditControlEnabled())
         grid_data->EnableCellEditControl(false);
+    // the thread sends its event to the frame, so it can't outlive it
+    if (threadM)
+    {
+        threadM->Wait();
+        delete threadM;
+        threadM = 0;
+        databaseM->endExecution();
+        executingM = false;
+    }
     // make sure that further calls to update() will not call Close() again
     databaseM = 0;
 }
@@ -946,6 +1053,10 @@ BEGIN_EVENT_TABLE(ExecuteSqlFrame, wxFrame)
     EVT_UPDATE_UI(Cmds::Query_Show_plan,           ExecuteSqlFrame::OnMenuUpdateWhenExecutePossible)
     EVT_UPDATE_UI(Cmds::Query_Execute_selection,   ExecuteSqlFrame::OnMenuUpdateWhenExecutePossible)
     EVT_UPDATE_UI(Cmds::Query_Execute_from_cursor, ExecuteSqlFrame::OnMenuUpdateWhenExecutePossible)
+    EVT_MENU(Cmds::Query_Cancel,              ExecuteSqlFrame::OnMenuCancelExecution)
+    EVT_UPDATE_UI(Cmds::Query_Cancel,         ExecuteSqlFrame::OnMenuUpdateCancelExecution)
+    EVT_MENU(Cmds::Query_Compare_profiles,    ExecuteSqlFrame::OnMenuCompareProfiles)
+    EVT_UPDATE_UI(Cmds::Query_Compare_profiles, ExecuteSqlFrame::OnMenuUpdateWhenExecutePossible)
     EVT_MENU(Cmds::Query_Commit,              ExecuteSqlFrame::OnMenuCommit)
     EVT_MENU(Cmds::Query_Rollback,            ExecuteSqlFrame::OnMenuRollback)
     EVT_UPDATE_UI(Cmds::Query_Commit,         ExecuteSqlFrame::OnMenuUpdateWhenInTransaction)
@@ -968,6 +1079,7 @@ BEGIN_EVENT_TABLE(ExecuteSqlFrame, wxFrame)
     EVT_MENU(Cmds::DataGrid_ExportBlob,      ExecuteSqlFrame::OnMenuGridExportBlob)
     EVT_MENU(Cmds::DataGrid_Save_as_html,    ExecuteSqlFrame::OnMenuGridSaveAsHtml)
     EVT_MENU(Cmds::DataGrid_Save_as_csv,     ExecuteSqlFrame::OnMenuGridSaveAsCsv)
+    EVT_MENU(Cmds::DataGrid_Group_rows,      ExecuteSqlFrame::OnMenuGridGroupRows)
     EVT_MENU(Cmds::DataGrid_Set_header_font, ExecuteSqlFrame::OnMenuGridGridHeaderFont)
     EVT_MENU(Cmds::DataGrid_Set_cell_font,   ExecuteSqlFrame::OnMenuGridGridCellFont)
     EVT_MENU(Cmds::DataGrid_FetchAll,        ExecuteSqlFrame::OnMenuGridFetchAll)
@@ -983,6 +1095,7 @@ BEGIN_EVENT_TABLE(ExecuteSqlFrame, wxFrame)
     EVT_UPDATE_UI(Cmds::DataGrid_ExportBlob,     ExecuteSqlFrame::OnMenuUpdateGridCellIsBlob)
     EVT_UPDATE_UI(Cmds::DataGrid_Save_as_html,   ExecuteSqlFrame::OnMenuUpdateGridHasSelection)
     EVT_UPDATE_UI(Cmds::DataGrid_Save_as_csv,    ExecuteSqlFrame::OnMenuUpdateGridHasSelection)
+    EVT_UPDATE_UI(Cmds::DataGrid_Group_rows,     ExecuteSqlFrame::OnMenuUpdateGridHasData)
     EVT_UPDATE_UI(Cmds::DataGrid_FetchAll,       ExecuteSqlFrame::OnMenuUpdateGridFetchAll)
     EVT_UPDATE_UI(Cmds::DataGrid_CancelFetchAll, ExecuteSqlFrame::OnMenuUpdateGridCancelFetchAll)
 
@@ -998,8 +1111,12 @@ BEGIN_EVENT_TABLE(ExecuteSqlFrame, wxFrame)
 
     EVT_GRID_CMD_SELECT_CELL(ExecuteSqlFrame::ID_grid_data, ExecuteSqlFrame::OnGridCellChange)
     EVT_GRID_CMD_LABEL_LEFT_DCLICK(ExecuteSqlFrame::ID_grid_data, ExecuteSqlFrame::OnGridLabelLeftDClick)
+    EVT_CHOICE(ExecuteSqlFrame::ID_filter_column, ExecuteSqlFrame::OnFilterChanged)
+    EVT_CHOICE(ExecuteSqlFrame::ID_filter_operator, ExecuteSqlFrame::OnFilterChanged)
+    EVT_TEXT(ExecuteSqlFrame::ID_filter_text, ExecuteSqlFrame::OnFilterChanged)
 
     EVT_TIMER(ExecuteSqlFrame::TIMER_ID_UPDATE_BLOB, ExecuteSqlFrame::OnBlobEditorUpdate)
+    EVT_THREAD(ExecuteSqlFrame::ID_execute_thread, ExecuteSqlFrame::OnExecuteThreadFinished)
 END_EVENT_TABLE()
 
 // Avoiding the annoying thing that you cannot click inside the selection and have it deselected and have caret there
@@ -1454,7 +1571,8 @@ void ExecuteSqlFrame::OnMenuReplace(wxCommandEvent &WXUNUSED(event))
 
 void ExecuteSqlFrame::OnMenuUpdateWhenInTransaction(wxUpdateUIEvent& event)
 {
-    event.Enable(inTransactionM && !grid_data->IsCellEditControlEnabled());
+    event.Enable(inTransactionM && !executingM
+        && !grid_data->IsCellEditControlEnabled());
 }
 
 void ExecuteSqlFrame::OnMenuSelectView(wxCommandEvent& event)
@@ -1562,6 +1680,8 @@ void ExecuteSqlFrame::OnMenuShowPlan(wxCommandEvent& WXUNUSED(event))
 
 void ExecuteSqlFrame::OnMenuExecuteFromCursor(wxCommandEvent& WXUNUSED(event))
 {
+    if (executingM)
+        return;
     clearLogBeforeExecution();
 
     wxString sql(
@@ -1575,9 +1695,11 @@ void ExecuteSqlFrame::OnMenuExecuteFromCursor(wxCommandEvent& WXUNUSED(event))
 
 void ExecuteSqlFrame::OnMenuExecuteSelection(wxCommandEvent& WXUNUSED(event))
 {
+    if (executingM)
+        return;
     clearLogBeforeExecution();
     if (config().get("TreatAsSingleStatement", false))
-        execute(styled_text_ctrl_sql->GetSelectedText(), ";");
+        executeSingleStatement(styled_text_ctrl_sql->GetSelectedText());
     else
         parseStatements(styled_text_ctrl_sql->GetSelectedText(),
             false,
@@ -1909,6 +2031,15 @@ void ExecuteSqlFrame::OnMenuGridSaveAsCsv(wxCommandEvent& WXUNUSED(event))
     grid_data->saveAsCSV(fileName, fieldDelimiter, textDelimiter);
 }
 
+void ExecuteSqlFrame::OnMenuGridGroupRows(wxCommandEvent& WXUNUSED(event))
+{
+    DataGridTable* table = grid_data->getDataGridTable();
+    if (!table)
+        return;
+    GroupRowsDialog dlg(this, table);
+    dlg.ShowModal();
+}
+
 void ExecuteSqlFrame::OnMenuGridGridHeaderFont(wxCommandEvent& WXUNUSED(event))
 {
     grid_data->setHeaderFont();
@@ -2029,69 +2160,100 @@ void ExecuteSqlFrame::clearLogBeforeExecution()
 
 void ExecuteSqlFrame::prepareAndExecute(bool prepareOnly)
 {
+    if (executingM)
+        return;
+    // the history gets the text which has been executed, the editor can be
+    // changed while the statements are executed
+    wxString text(styled_text_ctrl_sql->GetText());
+    std::function<void (bool)> done = [this, text](bool ok) {
+        if (ok || config().get("historyStoreUnsuccessful", true))
+        {
+            // add to history
+            StatementHistory& sh = StatementHistory::get(databaseM);
+            sh.add(text);
+            historyPositionM = sh.size();
+        }
+
+        if (!inTransactionM)
+            setViewMode(false, vmEditor);
+    };
+
     bool hasSelection = styled_text_ctrl_sql->GetSelectionStart()
         != styled_text_ctrl_sql->GetSelectionEnd();
-    bool ok;
     if (hasSelection && config().get("OnlyExecuteSelected", false))
     {
         if (config().get("TreatAsSingleStatement", false))
         {
-            ok = execute(styled_text_ctrl_sql->GetSelectedText(), ";",
-                prepareOnly);
+            executeSingleStatement(styled_text_ctrl_sql->GetSelectedText(),
+                prepareOnly, done);
         }
         else
         {
-            ok = parseStatements(styled_text_ctrl_sql->GetSelectedText(),
-                false, prepareOnly, styled_text_ctrl_sql->GetSelectionStart());
+            parseStatements(styled_text_ctrl_sql->GetSelectedText(),
+                false, prepareOnly, styled_text_ctrl_sql->GetSelectionStart(),
+                done);
         }
     }
     else
-    {
-        ok = parseStatements(styled_text_ctrl_sql->GetText(), false,
-            prepareOnly);
-    }
-
-    if (ok || config().get("historyStoreUnsuccessful", true))
-    {
-        // add to history
-        StatementHistory& sh = StatementHistory::get(databaseM);
-        sh.add(styled_text_ctrl_sql->GetText());
-        historyPositionM = sh.size();
-    }
-
-    if (!inTransactionM)
-        setViewMode(false, vmEditor);
+        parseStatements(text, false, prepareOnly, 0, done);
 }
 
 //! adapted so we don't have to change all the other code that utilizes SQL editor
 void ExecuteSqlFrame::executeAllStatements(bool closeWhenDone)
 {
+    if (executingM)
+        return;
     clearLogBeforeExecution();
-    bool ok = parseStatements(styled_text_ctrl_sql->GetText(), closeWhenDone);
-    if (config().get("historyStoreGenerated", true) &&
-        (ok || config().get("historyStoreUnsuccessful", true)))
-    {
-        // add buffer to history
-        StatementHistory& sh = StatementHistory::get(databaseM);
-        sh.add(styled_text_ctrl_sql->GetText());
-        historyPositionM = sh.size();
-    }
+    wxString text(styled_text_ctrl_sql->GetText());
+    parseStatements(text, closeWhenDone, false, 0,
+        [this, text, closeWhenDone](bool ok) {
+            if (config().get("historyStoreGenerated", true) &&
+                (ok || config().get("historyStoreUnsuccessful", true)))
+            {
+                // add buffer to history
+                StatementHistory& sh = StatementHistory::get(databaseM);
+                sh.add(text);
+                historyPositionM = sh.size();
+            }
 
-    if (closeWhenDone && autoCommitM && !inTransactionM)
-        Close();
+            if (closeWhenDone && autoCommitM && !inTransactionM)
+                Close();
+        });
 }
 
 //! Parses all sql statements in STC
 //! when autoexecute is TRUE, program just waits user to click Commit/Rollback and closes window
 //! when autocommit DDL is also set then frame is closed at once if commit was successful
-bool ExecuteSqlFrame::parseStatements(const wxString& statements,
-    bool closeWhenDone, bool prepareOnly, int selectionOffset)
+//! done is called with the result when the script has been executed
+void ExecuteSqlFrame::parseStatements(const wxString& statements,
+    bool closeWhenDone, bool prepareOnly, int selectionOffset,
+    const std::function<void (bool)>& done)
+{
+    scriptM.reset(new MultiStatement(statements));
+    scriptCloseWhenDoneM = closeWhenDone;
+    scriptPrepareOnlyM = prepareOnly;
+    scriptSelectionOffsetM = selectionOffset;
+    executionDoneM = done;
+    executeScript();
+}
+
+void ExecuteSqlFrame::executeSingleStatement(const wxString& sql,
+    bool prepareOnly, const std::function<void (bool)>& done)
+{
+    scriptM.reset();
+    executionDoneM = done;
+    ExecutionState state = execute(sql, ";", prepareOnly);
+    if (state != esRunning)
+        executionDone(state == esSucceeded);
+}
+
+// executes the statements of the script up to the one executed by the thread,
+// statementDone() goes on with the next ones when it has finished
+void ExecuteSqlFrame::executeScript()
 {
-    wxBusyCursor cr;
-    MultiStatement ms(statements);
     while (true)
     {
-        SingleStatement ss = ms.getNextStatement();
+        SingleStatement ss = scriptM->getNextStatement();
         if (!ss.isValid())
             break;
 
@@ -2099,7 +2261,10 @@ bool ExecuteSqlFrame::parseStatements(const wxString& statements,
         if (ss.isCommitStatement())
         {
             if (!commitTransaction())
-                return false;
+            {
+                executionDone(false);
+                return;
+            }
         }
         else if (ss.isRollbackStatement())
             rollbackTransaction();
@@ -2109,7 +2274,8 @@ bool ExecuteSqlFrame::parseStatements(const wxString& statements,
             {
                 ::wxMessageBox(_("SET TERM command found without terminator.\nStopping further execution."),
                     _("Warning"), wxOK | wxICON_WARNING);
-                return false;
+                executionDone(false);
+                return;
             }
         }
         else if (ss.isSetAutoDDLStatement(autoDDLSetting))
@@ -2124,25 +2290,26 @@ bool ExecuteSqlFrame::parseStatements(const wxString& statements,
             {
                 ::wxMessageBox(_("SET AUTODDL command found with invalid parameter (has to be \"ON\" or \"OFF\").\nStopping further execution."),
                     _("Warning"), wxOK | wxICON_WARNING);
-                return false;
+                executionDone(false);
+                return;
             }
         }
-        else if (!ss.isEmptyStatement()
-            && !execute(ss.getSql(), ms.getTerminator(), prepareOnly))
+        else if (!ss.isEmptyStatement())
         {
-            int stmtStart = selectionOffset + ms.getStart();
-            // STC uses UTF-8 internally in Unicode build
-            // account for possible differences in string length
-            // if system charset != UTF-8
-            std::string stmt(wx2std(ss.getSql(), &wxConvUTF8));
-            int stmtEnd = stmtStart + stmt.size();
-            styled_text_ctrl_sql->markText(stmtStart, stmtEnd);
-            styled_text_ctrl_sql->SetFocus();
-            return false;
+            ExecutionState state = execute(ss.getSql(),
+                scriptM->getTerminator(), scriptPrepareOnlyM);
+            if (state == esRunning)
+                return;
+            if (state == esFailed)
+            {
+                markFailedStatement();
+                executionDone(false);
+                return;
+            }
         }
     }
 
-    if (closeWhenDone)
+    if (scriptCloseWhenDoneM)
     {
         closeWhenTransactionDoneM = true;
         // TODO: HOWTO focus toolbar button? button_commit->SetFocus();
@@ -2150,12 +2317,71 @@ bool ExecuteSqlFrame::parseStatements(const wxString& statements,
 
     ScrollAtEnd sae(styled_text_ctrl_stats);
     log(_("Script execution finished."));
-    return true;
+    executionDone(true);
+}
+
+// called when the execution of a statement by the thread has ended
+void ExecuteSqlFrame::statementDone(bool ok)
+{
+    if (!scriptM.get())
+        executionDone(ok);
+    else if (ok)
+        executeScript();
+    else
+    {
+        markFailedStatement();
+        executionDone(false);
+    }
+}
+
+void ExecuteSqlFrame::markFailedStatement()
+{
+    int stmtStart = scriptSelectionOffsetM + scriptM->getStart();
+    // STC uses UTF-8 internally in Unicode build
+    // account for possible differences in string length
+    // if system charset != UTF-8
+    std::string stmt(wx2std(executionM.sql, &wxConvUTF8));
+    int stmtEnd = stmtStart + stmt.size();
+    styled_text_ctrl_sql->markText(stmtStart, stmtEnd);
+    styled_text_ctrl_sql->SetFocus();
+}
+
+void ExecuteSqlFrame::executionDone(bool ok)
+{
+    scriptM.reset();
+    std::function<void (bool)> done;
+    done.swap(executionDoneM);
+    if (done)
+        done(ok);
 }
 
 void ExecuteSqlFrame::OnMenuUpdateWhenExecutePossible(wxUpdateUIEvent& event)
 {
-    event.Enable(!closeWhenTransactionDoneM);
+    event.Enable(!closeWhenTransactionDoneM && !executingM);
+}
+
+void ExecuteSqlFrame::OnMenuCancelExecution(wxCommandEvent& WXUNUSED(event))
+{
+    if (!executingM)
+        return;
+
+    ScrollAtEnd sae(styled_text_ctrl_stats);
+    log(_("Cancelling execution..."));
+    cancelRequestedM = true;
+    try
+    {
+        databaseM->getIBPPDatabase()->CancelOperation();
+    }
+    catch (IBPP::Exception& e)
+    {
+        wxString msg(e.what(), *databaseM->getCharsetConverter());
+        log(_("Error: ") + msg + "\n", ttError);
+    }
+}
+
+void ExecuteSqlFrame::OnMenuUpdateCancelExecution(wxUpdateUIEvent& event)
+{
+    event.Enable(executingM);
 }
 
 wxString IBPPtype2string(Database *db, IBPP::SDT t, int subtype, int size,
@@ -2185,54 +2411,6 @@ wxString IBPPtype2string(Database *db, IBPP::SDT t, int subtype, int size,
     }
 }
 
-void ExecuteSqlFrame::compareCounts(IBPP::DatabaseCounts& one,
-    IBPP::DatabaseCounts& two)
-{
-    for (IBPP::DatabaseCounts::iterator it = two.begin(); it != two.end();
-        ++it)
-    {
-        wxString s;
-        IBPP::DatabaseCounts::iterator i2 = one.find((*it).first);
-        IBPP::CountInfo c;
-        IBPP::CountInfo& r1 = (*it).second;
-        IBPP::CountInfo& r2 = c;
-        if (i2 != one.end())
-            r2 = (*i2).second;
-        if (r1.inserts > r2.inserts)
-            s += wxString::Format(_("%d inserts. "), r1.inserts - r2.inserts);
-        if (r1.updates > r2.updates)
-            s += wxString::Format(_("%d updates. "), r1.updates - r2.updates);
-        if (r1.deletes > r2.deletes)
-            s += wxString::Format(_("%d deletes. "), r1.deletes - r2.deletes);
-        if (!s.IsEmpty())
-        {
-            wxString relName;
-            try
-            {
-                IBPP::Statement st = IBPP::StatementFactory(
-                    databaseM->getIBPPDatabase(), transactionM);
-                st->Prepare(
-                    "select rdb$relation_name "
-                    "from rdb$relations where rdb$relation_id = ?");
-                st->Set(1, (*it).first);
-                st->Execute();
-                if (st->Fetch())
-                {
-                    std::string s;
-                    st->Get(1, s);
-                    relName = std2wxIdentifier(s, databaseM->getCharsetConverter());
-                }
-            }
-            catch (...)
-            {
-            }
-            if (relName.IsEmpty())
-                relName.Format(_("Relation #%d"), (*it).first);
-            log(relName + ": " + s, ttSql);
-        }
-    }
-}
-
 wxString millisToTimeString(long millis)
 {
     if (millis >= 60 * 1000)
@@ -2250,8 +2428,171 @@ wxString millisToTimeString(long millis)
         return wxString::Format("%.3fs", 0.001 * millis);
 }
 
-bool ExecuteSqlFrame::execute(wxString sql, const wxString& terminator,
-    bool prepareOnly)
+wxString microsToTimeString(int64_t micros)
+{
+    return millisToTimeString(long((micros + 500) / 1000));
+}
+
+void ExecuteSqlFrame::OnMenuCompareProfiles(wxCommandEvent& WXUNUSED(event))
+{
+    if (executingM)
+        return;
+
+    // runs the selected statement, or the whole editor text
+    wxString sql(styled_text_ctrl_sql->GetSelectedText());
+    if (sql.IsEmpty())
+        sql = styled_text_ctrl_sql->GetText();
+    sql.Trim(true).Trim(false);
+    if (sql.EndsWith(";"))
+        sql.RemoveLast().Trim(true);
+    if (sql.IsEmpty())
+        return;
+
+    // the profile of the database preferences, with and without wire
+    // compression, with its own and with disabled wire encryption
+    IBPP::ConnectionProfile current(databaseM->getConnectionProfile());
+    const IBPP::WCL cryptLevels[] = { current.wireCrypt, IBPP::wcDisabled };
+    std::vector<ConnectionProfileTiming> timings;
+    for (int compression = 0; compression < 2; ++compression)
+    {
+        for (size_t i = 0; i < sizeof(cryptLevels) / sizeof(IBPP::WCL); ++i)
+        {
+            ConnectionProfileTiming t;
+            t.profile = current;
+            t.profile.wireCompression = (compression != 0);
+            t.profile.wireCrypt = cryptLevels[i];
+            bool found = false;
+            for (size_t j = 0; j < timings.size() && !found; ++j)
+                found = timings[j].profile == t.profile;
+            if (!found)
+                timings.push_back(t);
+        }
+    }
+
+    {
+        ProgressDialog pd(this, _("Comparing connection profiles"));
+        try
+        {
+            databaseM->compareConnectionProfiles(sql, timings, &pd);
+        }
+        catch (CancelProgressException&)
+        {
+            return;
+        }
+    }
+
+    size_t fastest = timings.size();
+    for (size_t i = 0; i < timings.size(); ++i)
+    {
+        if (timings[i].error.empty() && (fastest == timings.size()
+            || timings[i].fetchMillis < timings[fastest].fetchMillis))
+        {
+            fastest = i;
+        }
+    }
+
+    ScrollAtEnd sae(styled_text_ctrl_stats);
+    log(_("Connection profiles compared (best of two runs):"));
+    for (size_t i = 0; i < timings.size(); ++i)
+    {
+        const ConnectionProfileTiming& t = timings[i];
+        wxString desc(Database::getConnectionProfileDescription(t.profile));
+        if (t.profile == current)
+            desc += _(" [current]");
+        if (!t.error.empty())
+        {
+            wxString msg(t.error, *databaseM->getCharsetConverter());
+            log(desc + ": " + msg, ttError);
+            continue;
+        }
+        wxString s(wxString::Format(
+            _("%s: connected in %s, %d rows fetched in %s"), desc.c_str(),
+            millisToTimeString(t.connectMillis).c_str(), t.rows,
+            millisToTimeString(t.fetchMillis).c_str()));
+        if (i == fastest)
+            s += _(" (fastest)");
+        log(s);
+    }
+}
+
+// the grid goes on fetching after the statement has been executed, the
+// totals include the rows fetched with the execution, and the pages are
+// counted from the execution on
+void ExecuteSqlFrame::logFetchMetrics()
+{
+    fetchMetricsPendingM = false;
+    if (statementM == 0)
+        return;
+    IBPP::StatementMetrics metrics;
+    try
+    {
+        statementM->ServerMetrics(metrics);
+    }
+    catch (IBPP::Exception&)
+    {
+        // the record counts are lost with the transaction of the statement
+        statementM->Metrics(metrics);
+    }
+    log(wxString::Format(_("%d rows fetched (fetch time: %s), %d records selected."),
+        metrics.rowsFetched, microsToTimeString(metrics.fetchTime).c_str(),
+        metrics.selects));
+    if (metrics.fetches >= 0)
+    {
+        log(wxString::Format(
+            _("%d fetches, %d marks, %d reads, %d writes up to the last row fetched."),
+            metrics.fetches, metrics.marks, metrics.reads, metrics.writes));
+    }
+}
+
+// the editor and the other frames stay usable while the thread runs, and the
+// execution can be cancelled. The database is marked as executing, so it
+// can't be disconnected or dropped meanwhile (and doCanClose() vetoes closing
+// the frame). The next step is run by OnExecuteThreadFinished()
+ExecuteSqlFrame::ExecutionState ExecuteSqlFrame::executeInThread(
+    const std::function<void ()>& work, ExecutionStep nextStep)
+{
+    std::unique_ptr<ExecuteSqlThread> thread(
+        new ExecuteSqlThread(this, ID_execute_thread, work));
+    if (thread->Create() != wxTHREAD_NO_ERROR
+        || thread->Run() != wxTHREAD_NO_ERROR)
+    {
+        work();
+        return (this->*nextStep)();
+    }
+
+    threadM = thread.release();
+    nextStepM = nextStep;
+    executingM = true;
+    databaseM->beginExecution();
+    cancelRequestedM = false;
+    statusbar_1->SetStatusText(_("Executing..."), 1);
+    return esRunning;
+}
+
+void ExecuteSqlFrame::OnExecuteThreadFinished(wxThreadEvent& WXUNUSED(event))
+{
+    std::unique_ptr<ExecuteSqlThread> thread(threadM);
+    threadM = 0;
+    if (!thread.get())
+        return;
+    thread->Wait();
+    databaseM->endExecution();
+    executingM = false;
+    statusbar_1->SetStatusText(wxEmptyString, 1);
+
+    ExecutionStep step = nextStepM;
+    ExecutionState state = runExecutionStep([&]() {
+        thread->rethrowError();
+        return (this->*step)();
+    });
+    if (state != esRunning)
+        statementDone(state == esSucceeded);
+}
+
+// the statement is prepared and executed in steps run when the thread making
+// the calls to the server has finished, esRunning is returned meanwhile
+ExecuteSqlFrame::ExecutionState ExecuteSqlFrame::execute(wxString sql,
+    const wxString& terminator, bool prepareOnly)
 {
     ScrollAtEnd sae(styled_text_ctrl_stats);
 
@@ -2272,216 +2613,371 @@ bool ExecuteSqlFrame::execute(wxString sql, const wxString& terminator,
     {
         log(_("Parsed statement: " + sql), ttSql);
         log(_("Empty statement detected, bailing out..."));
-        return true;
+        return esSucceeded;
     }
 
     if (styled_text_ctrl_sql->AutoCompActive())
         styled_text_ctrl_sql->AutoCompCancel();    // remove the list if needed
     notebook_1->SetSelection(0);
-    wxStopWatch swTotal;
-    bool retval = true;
 
+    executionM.sql = sql;
+    executionM.terminator = terminator;
+    executionM.prepareOnly = prepareOnly;
+    executionM.browseInPages = false;
+    executionM.showStats = config().get("SQLEditorShowStats", true);
+    executionM.hasColumns = false;
+    executionM.selecting = false;
+    executionM.firstRows.Clear();
+    executionM.stopWatch.Start();
+    return runExecutionStep([this]() { return prepareStatement(); });
+}
+
+// errors are handled the same way for each step of the execution
+ExecuteSqlFrame::ExecutionState ExecuteSqlFrame::runExecutionStep(
+    const std::function<ExecutionState ()>& step)
+{
+    ScrollAtEnd sae(styled_text_ctrl_stats);
+    ExecutionState state = esFailed;
     try
     {
-        if (transactionM == 0 || !transactionM->Started())
+        state = step();
+        if (state == esRunning)
+            return state;
+        // the time of a statement which is only prepared isn't logged
+        if (state == esSucceeded && executionM.prepareOnly)
+            return state;
+    }
+    catch (IBPP::SQLException& e)
+    {
+        splitScreen();
+        wxString msg(e.what(),
+            *databaseM->getCharsetConverter());
+        log(_("Error: ") + msg + "\n", ttError);
+        // Firebird 4 tells the timeouts apart from the cancellations, older
+        // servers only report them as cancelled
+        unsigned timeout = statementM != 0 ? statementM->Timeout() : 0;
+        if (timeout == 0)
+            timeout = databaseM->getIBPPDatabase()->StatementTimeout();
+        bool timedOut =
+            e.HasEngineCode(IBPP::SQLException::ecReqStmtTimeout)
+            || e.HasEngineCode(IBPP::SQLException::ecAttStmtTimeout)
+            || e.HasEngineCode(IBPP::SQLException::ecCfgStmtTimeout);
+        if (!timedOut && timeout && !cancelRequestedM)
+            timedOut = e.EngineCode() == IBPP::SQLException::ecCancelled;
+        if (timedOut && timeout)
+        {
+            log(wxString::Format(
+                _("The statement has been cancelled by the server after the timeout of %s."),
+                millisToTimeString(timeout).c_str()), ttError);
+        }
+        else if (timedOut)
         {
-            log(_("Starting transaction..."));
+            log(_("The statement has been cancelled by the server after the timeout configured on the server."),
+                ttError);
+        }
+    }
+    catch(IBPP::Exception& e)
+    {
+        splitScreen();
+        wxString msg(e.what(),
+            *databaseM->getCharsetConverter());
+        log(_("Error: ") + msg + "\n", ttError);
+    }
+    catch (std::exception& e)
+    {
+        splitScreen();
+        log(_("Error: ") + e.what() + "\n", ttError);
+    }
+    catch (...)
+    {
+        splitScreen();
+        log(_("SYSTEM ERROR!"), ttError);
+    }
+
+    log(wxString::Format(_("Total execution time: %s"),
+        millisToTimeString(executionM.stopWatch.Time()).c_str()));
+    return state;
+}
+
+ExecuteSqlFrame::ExecutionState ExecuteSqlFrame::prepareStatement()
+{
+    ScrollAtEnd sae(styled_text_ctrl_stats);
+    wxString& sql = executionM.sql;
+
+    // SELECTs from a single table can be browsed without keeping the
+    // transaction of the frame open, the rows are read in pages then
+    bool browseInPages = !executionM.prepareOnly
+        && config().get("DataGridBrowseInPages", false)
+        && (transactionM == 0 || !transactionM->Started());
+    if (browseInPages)
+    {
+        bool hasOrderBy;
+        browseInPages = SelectStatement(sql).canFetchInPages(hasOrderBy);
+    }
+    executionM.browseInPages = browseInPages;
+
+    IBPP::Transaction statementTransaction;
+    if (browseInPages)
+    {
+        log(_("Starting read-only transaction to browse data..."));
+        statementTransaction = IBPP::TransactionFactory(
+            databaseM->getIBPPDatabase(), IBPP::amRead,
+            IBPP::ilReadCommitted, IBPP::lrWait);
+        statementTransaction->Start();
+        grid_data->EnableEditing(false);
+    }
+    else if (transactionM == 0 || !transactionM->Started())
+    {
+        log(_("Starting transaction..."));
 
-            // fix the IBPP::LogicException "No Database is attached."
-            // which happens after a database reconnect
-            // (this action detaches the database from all its transactions)
-            if (transactionM != 0 && !transactionM->Started())
+        // fix the IBPP::LogicException "No Database is attached."
+        // which happens after a database reconnect
+        // (this action detaches the database from all its transactions)
+        if (transactionM != 0 && !transactionM->Started())
+        {
+            try
             {
-                try
-                {
-                    transactionM->Start();
-                }
-                catch (IBPP::LogicException&)
-                {
-                    transactionM = 0;
-                }
+                transactionM->Start();
             }
-
-            if (transactionM == 0)
+            catch (IBPP::LogicException&)
             {
-                transactionM = IBPP::TransactionFactory(
-                    databaseM->getIBPPDatabase(), transactionAccessModeM,
-                    transactionIsolationLevelM, transactionLockResolutionM);
+                transactionM = 0;
             }
-            transactionM->Start();
-            inTransaction(true);
-
-            grid_data->EnableEditing(transactionAccessModeM == IBPP::amWrite);
         }
 
-        int fetch1 = 0, mark1 = 0, read1 = 0, write1 = 0, ins1 = 0, upd1 = 0,
-            del1 = 0, ridx1 = 0, rseq1 = 0, mem1 = 0;
-        int fetch2, mark2, read2, write2, ins2, upd2, del2, ridx2, rseq2, mem2;
-        IBPP::DatabaseCounts counts1, counts2;
-        bool doShowStats = config().get("SQLEditorShowStats", true);
-        if (!prepareOnly && doShowStats)
+        if (transactionM == 0)
         {
-            databaseM->getIBPPDatabase()->
-                Statistics(&fetch1, &mark1, &read1, &write1, &mem1);
-            databaseM->getIBPPDatabase()->
-                Counts(&ins1, &upd1, &del1, &ridx1, &rseq1);
-            databaseM->getIBPPDatabase()->DetailedCounts(counts1);
-        }
-        grid_data->ClearGrid(); // statement object will be invalidated, so clear the grid
-        statementM = IBPP::StatementFactory(databaseM->getIBPPDatabase(), transactionM);
-        log(_("Preparing statement: " + sql), ttSql);
-        sae.scroll();
-        {
-            wxStopWatch sw;
-            statementM->Prepare(wx2std(sql, databaseM->getCharsetConverter()));
-            log(wxString::Format(_("Statement prepared (elapsed time: %s)."),
-                millisToTimeString(sw.Time()).c_str()));
+            transactionM = IBPP::TransactionFactory(
+                databaseM->getIBPPDatabase(), transactionAccessModeM,
+                transactionIsolationLevelM, transactionLockResolutionM);
         }
+        transactionM->Start();
+        inTransaction(true);
 
-        // we don't check IBPP::Select since Firebird 2.0 has a new feature
-        // INSERT ... RETURNING which isn't detected as stSelect by IBPP
-        bool hasColumns = false;
-        try
+        grid_data->EnableEditing(transactionAccessModeM == IBPP::amWrite);
+    }
+    if (!browseInPages)
+        statementTransaction = transactionM;
+
+    grid_data->ClearGrid(); // statement object will be invalidated, so clear the grid
+    // fetching the rows of the previous statement has been stopped
+    if (fetchMetricsPendingM)
+        logFetchMetrics();
+    statementM = IBPP::StatementFactory(databaseM->getIBPPDatabase(),
+        statementTransaction);
+    // the pages used by the attachment while the grid fetches the rows
+    // are only counted for the details
+    statementM->CountPages(executionM.showStats);
+    log(_("Preparing statement: " + sql), ttSql);
+    sae.scroll();
+    std::string stmtSql(wx2std(sql, databaseM->getCharsetConverter()));
+    IBPP::Statement statement(statementM);
+    return executeInThread([statement, stmtSql]() {
+        statement->Prepare(stmtSql);
+    }, &ExecuteSqlFrame::statementPrepared);
+}
+
+ExecuteSqlFrame::ExecutionState ExecuteSqlFrame::statementPrepared()
+{
+    ScrollAtEnd sae(styled_text_ctrl_stats);
+    IBPP::StatementMetrics metrics;
+    statementM->Metrics(metrics);
+    log(wxString::Format(_("Statement prepared (elapsed time: %s)."),
+        microsToTimeString(metrics.prepareTime).c_str()));
+
+    // we don't check IBPP::Select since Firebird 2.0 has a new feature
+    // INSERT ... RETURNING which isn't detected as stSelect by IBPP
+    bool hasColumns = false;
+    try
+    {
+        int cols = statementM->Columns();
+        hasColumns = cols > 0;
+        if (executionM.showStats)
         {
-            int cols = statementM->Columns();
-            hasColumns = cols > 0;
-            if (doShowStats)
+            for (int i = 1; i <= cols; i++)
             {
-                for (int i = 1; i <= cols; i++)
-                {
-                    wxString tablename(std2wxIdentifier(statementM->ColumnTable(i),
-                        databaseM->getCharsetConverter()));
-                    wxString colname(std2wxIdentifier(statementM->ColumnName(i),
-                        databaseM->getCharsetConverter()));
-                    wxString aliasname(std2wxIdentifier(statementM->ColumnAlias(i),
-                        databaseM->getCharsetConverter()));
-                    log(wxString::Format(_("Field #%02d: %s.%s Alias:%s Type:%s"),
-                        i, tablename.c_str(), colname.c_str(), aliasname.c_str(),
-                        IBPPtype2string(
-                            databaseM,
-                            statementM->ColumnType(i),
-                            statementM->ColumnSubtype(i),
-                            statementM->ColumnSize(i),
-                            statementM->ColumnScale(i)).c_str()
-                        ), ttSql);
-                }
+                wxString tablename(std2wxIdentifier(statementM->ColumnTable(i),
+                    databaseM->getCharsetConverter()));
+                wxString colname(std2wxIdentifier(statementM->ColumnName(i),
+                    databaseM->getCharsetConverter()));
+                wxString aliasname(std2wxIdentifier(statementM->ColumnAlias(i),
+                    databaseM->getCharsetConverter()));
+                log(wxString::Format(_("Field #%02d: %s.%s Alias:%s Type:%s"),
+                    i, tablename.c_str(), colname.c_str(), aliasname.c_str(),
+                    IBPPtype2string(
+                        databaseM,
+                        statementM->ColumnType(i),
+                        statementM->ColumnSubtype(i),
+                        statementM->ColumnSize(i),
+                        statementM->ColumnScale(i)).c_str()
+                    ), ttSql);
             }
         }
-        catch(IBPP::Exception&)    // reading column info might fail,
-        {                          // but we still want to show the plan
-        }                          // so we have separate exception handlers
+    }
+    catch(IBPP::Exception&)    // reading column info might fail,
+    {                          // but we still want to show the plan
+    }                          // so we have separate exception handlers
+    executionM.hasColumns = hasColumns;
+
+    // for some statements (DDL) it is never available
+    // for INSERTs, it is available sometimes (insert into ... select ... )
+    // but if it not, IBPP throws an exception
+    try
+    {
+        std::string plan;
+        statementM->Plan(plan);
+        log(wxString(plan.c_str(), *databaseM->getCharsetConverter()));
+    }
+    catch(IBPP::Exception&)
+    {
+        log(_("Plan not available."));
+    }
 
-        // for some statements (DDL) it is never available
-        // for INSERTs, it is available sometimes (insert into ... select ... )
-        // but if it not, IBPP throws an exception
-        try
+    if (executionM.prepareOnly)
+        return esSucceeded;
+
+    log(wxEmptyString);
+    log(wxEmptyString);
+    log(_("Executing statement..."));
+    sae.scroll();
+    // when browsing in pages the grid executes the statements for them
+    bool selecting = hasColumns && statementM->Type() == IBPP::stSelect;
+    executionM.selecting = selecting;
+    if (executionM.browseInPages)
+        return statementExecuted();
+
+    // a scrollable cursor lets the grid show the last rows without
+    // fetching all rows before them, Firebird 5 is needed for that
+    bool scrollable = selecting
+        && config().get("DataGridScrollableCursors", true);
+    // the first rows of a SELECT can take as long as the execution
+    // itself, so they are fetched by the thread too
+    IBPP::Statement statement(statementM);
+    IBPP::ColumnBatch* firstRows = &executionM.firstRows;
+    return executeInThread([statement, scrollable, selecting, firstRows]() {
+        bool executed = false;
+        if (scrollable)
         {
-            std::string plan;
-            statementM->Plan(plan);
-            log(wxString(plan.c_str(), *databaseM->getCharsetConverter()));
+            try
+            {
+                statement->ExecuteScrollable();
+                executed = true;
+            }
+            catch (IBPP::Exception&)
+            {
+                // not supported by the client library or the server
+            }
         }
-        catch(IBPP::Exception&)
+        if (!executed)
+            statement->Execute();
+        if (selecting)
         {
-            log(_("Plan not available."));
+            statement->FetchBatch(
+                DataGridTable::getInitialRowCount(), *firstRows);
         }
+    }, &ExecuteSqlFrame::statementExecuted);
+}
 
-        if (prepareOnly)
-            return true;
-
-        log(wxEmptyString);
-        log(wxEmptyString);
-        log(_("Executing statement..."));
-        sae.scroll();
+ExecuteSqlFrame::ExecutionState ExecuteSqlFrame::statementExecuted()
+{
+    ScrollAtEnd sae(styled_text_ctrl_stats);
+    bool browseInPages = executionM.browseInPages;
+    bool hasColumns = executionM.hasColumns;
+    bool doShowStats = executionM.showStats;
+    IBPP::StatementMetrics metrics;
+    if (!browseInPages)
+    {
+        statementM->Metrics(metrics);
+        log(wxString::Format(_("Statement executed (elapsed time: %s)."),
+            microsToTimeString(metrics.executeTime).c_str()));
+    }
+    // logged before the fetch thread of the grid owns the statement, the
+    // pages of a SELECT go on being counted until the rows are fetched
+    if (doShowStats && !browseInPages)
+    {
+        try
         {
-            wxStopWatch sw;
-            statementM->Execute();
-            log(wxString::Format(_("Statement executed (elapsed time: %s)."),
-                millisToTimeString(sw.Time()).c_str()));
+            statementM->ServerMetrics(metrics);
+            log(wxString::Format(
+                _("%d records selected, %d inserted, %d updated, %d deleted."),
+                metrics.selects, metrics.inserts, metrics.updates,
+                metrics.deletes));
+            if (metrics.fetches >= 0)
+            {
+                log(wxString::Format(
+                    _("%d fetches, %d marks, %d reads, %d writes."),
+                    metrics.fetches, metrics.marks, metrics.reads,
+                    metrics.writes));
+            }
         }
-        IBPP::STT type = statementM->Type();
-        if (hasColumns)            // for select statements: show data
+        catch (IBPP::Exception&)
         {
-            grid_data->fetchData(transactionAccessModeM == IBPP::amRead);
-            setViewMode(vmGrid);
         }
+    }
 
-        if (doShowStats)
+    IBPP::STT type = statementM->Type();
+    if (hasColumns)            // for select statements: show data
+    {
+        if (browseInPages)
+            grid_data->fetchData(true, executionM.sql);
+        else
         {
-            databaseM->getIBPPDatabase()->Statistics(
-                &fetch2, &mark2, &read2, &write2, &mem2);
-            databaseM->getIBPPDatabase()->
-                Counts(&ins2, &upd2, &del2, &ridx2, &rseq2);
-            log(wxString::Format(
-                _("%d fetches, %d marks, %d reads, %d writes."),
-                fetch2-fetch1, mark2-mark1, read2-read1, write2-write1));
-            log(wxString::Format(
-                _("%d inserts, %d updates, %d deletes, %d index, %d seq."),
-                ins2-ins1, upd2-upd1, del2-del1, ridx2-ridx1, rseq2-rseq1));
-            log(wxString::Format(_("Delta memory: %d bytes."), mem2-mem1));
-            databaseM->getIBPPDatabase()->DetailedCounts(counts2);
-            compareCounts(counts1, counts2);
+            grid_data->fetchData(transactionAccessModeM == IBPP::amRead,
+                wxEmptyString,
+                executionM.selecting ? &executionM.firstRows : 0);
         }
+        resetFilter();
+        setViewMode(vmGrid);
+    }
 
-        if (type != IBPP::stSelect) // for other statements: show rows affected
-        {   // left trim
-            wxString::size_type p = sql.find_first_not_of(" \n\t\r");
-            if (p != wxString::npos && p > 0)
-                sql.erase(0, p);
-            if (type == IBPP::stInsert || type == IBPP::stDelete
-                || type == IBPP::stExecProcedure || type == IBPP::stUpdate)
+    if (doShowStats && hasColumns && !browseInPages)
+    {
+        // the fetch thread of the grid owns the statement until it has
+        // fetched the rows
+        DataGridTable* table = grid_data->getDataGridTable();
+        fetchMetricsPendingM = true;
+        if (!table || !table->isFetching())
+            logFetchMetrics();
+    }
+
+    ExecutionState state = esSucceeded;
+    if (type != IBPP::stSelect) // for other statements: show rows affected
+    {   // left trim
+        wxString sql(executionM.sql);
+        wxString::size_type p = sql.find_first_not_of(" \n\t\r");
+        if (p != wxString::npos && p > 0)
+            sql.erase(0, p);
+        if (type == IBPP::stInsert || type == IBPP::stDelete
+            || type == IBPP::stExecProcedure || type == IBPP::stUpdate)
+        {
+            // INSERT INTO..RETURNING and EXECUTE PROCEDURE may throw
+            // when they return a single record
+            try
             {
-                // INSERT INTO..RETURNING and EXECUTE PROCEDURE may throw
-                // when they return a single record
-                try
-                {
-                    wxString addon;
-                    if (statementM->AffectedRows() % 10 != 1)
-                        addon = "s";
-                    wxString s = wxString::Format(_("%d row%s affected directly."),
-                        statementM->AffectedRows(), addon.c_str());
-                    log("" + s);
-                    statusbar_1->SetStatusText(s, 1);
-                }
-                catch (IBPP::Exception&)
-                {
-                }
+                wxString addon;
+                if (statementM->AffectedRows() % 10 != 1)
+                    addon = "s";
+                wxString s = wxString::Format(_("%d row%s affected directly."),
+                    statementM->AffectedRows(), addon.c_str());
+                log("" + s);
+                statusbar_1->SetStatusText(s, 1);
             }
-            SqlStatement stm(sql, databaseM, terminator);
-            if (stm.isDDL())
-                type = IBPP::stDDL;
-            executedStatementsM.push_back(stm);
-            setViewMode(vmEditor);
-            if (type == IBPP::stDDL && autoCommitM)
+            catch (IBPP::Exception&)
             {
-                if (!commitTransaction())
-                    retval = false;
             }
         }
+        SqlStatement stm(sql, databaseM, executionM.terminator);
+        if (stm.isDDL())
+            type = IBPP::stDDL;
+        executedStatementsM.push_back(stm);
+        setViewMode(vmEditor);
+        if (type == IBPP::stDDL && autoCommitM)
+        {
+            if (!commitTransaction())
+                state = esFailed;
+        }
     }
-    catch(IBPP::Exception& e)
-    {
-        splitScreen();
-        wxString msg(e.what(),
-            *databaseM->getCharsetConverter());
-        log(_("Error: ") + msg + "\n", ttError);
-        retval = false;
-    }
-    catch (std::exception& e)
-    {
-        splitScreen();
-        log(_("Error: ") + e.what() + "\n", ttError);
-        retval = false;
-    }
-    catch (...)
-    {
-        splitScreen();
-        log(_("SYSTEM ERROR!"), ttError);
-        retval = false;
-    }
-
-    log(wxString::Format(_("Total execution time: %s"),
-        millisToTimeString(swTotal.Time()).c_str()));
-    return retval;
+    return state;
 }
 
 void ExecuteSqlFrame::splitScreen()
@@ -2568,6 +3064,8 @@ void ExecuteSqlFrame::OnMenuCommit(wxCommandEvent& WXUNUSED(event))
 
 bool ExecuteSqlFrame::commitTransaction()
 {
+    if (executingM)
+        return false;
     if (transactionM == 0 || !transactionM->Started())    // check
     {
         inTransaction(false);
@@ -2585,6 +3083,11 @@ bool ExecuteSqlFrame::commitTransaction()
         sae.scroll();
         {
             wxStopWatch sw;
+            // the result set must not be fetched from in the background
+            if (DataGridTable* dgt = grid_data->getDataGridTable())
+                dgt->stopFetching();
+            if (fetchMetricsPendingM)
+                logFetchMetrics();
             statementM->Close();
             transactionM->Commit();
             log(wxString::Format(_("Transaction committed (elapsed time: %s)."),
@@ -2663,6 +3166,8 @@ void ExecuteSqlFrame::OnMenuRollback(wxCommandEvent& WXUNUSED(event))
 
 bool ExecuteSqlFrame::rollbackTransaction()
 {
+    if (executingM)
+        return false;
     if (transactionM == 0 || !transactionM->Started())    // check
     {
         executedStatementsM.clear();
@@ -2680,6 +3185,11 @@ bool ExecuteSqlFrame::rollbackTransaction()
         sae.scroll();
         {
             wxStopWatch sw;
+            // the result set must not be fetched from in the background
+            if (DataGridTable* dgt = grid_data->getDataGridTable())
+                dgt->stopFetching();
+            if (fetchMetricsPendingM)
+                logFetchMetrics();
             statementM->Close();
             transactionM->Rollback();
             log(wxString::Format(_("Transaction rolled back (elapsed time: %s)."),
@@ -2718,7 +3228,7 @@ bool ExecuteSqlFrame::rollbackTransaction()
 void ExecuteSqlFrame::OnMenuUpdateGridInsertRow(wxUpdateUIEvent& event)
 {
     DataGridTable* tb = grid_data->getDataGridTable();
-    event.Enable(inTransactionM && tb && tb->canInsertRows());
+    event.Enable(inTransactionM && !executingM && tb && tb->canInsertRows());
 }
 
 void ExecuteSqlFrame::OnMenuUpdateGridHasData(wxUpdateUIEvent& event)
@@ -2775,6 +3285,22 @@ void ExecuteSqlFrame::OnGridRowCountChanged(wxCommandEvent& event)
     wxString s;
     long rowsFetched = event.GetExtraLong();
     s.Printf(_("%ld row(s) fetched"), rowsFetched);
+    DataGridTable* table = grid_data->getDataGridTable();
+    if (table && table->isFiltered())
+        s += wxString::Format(_(", %d shown"), table->GetNumberRows());
+    if (statementM != 0 && table && !table->isFetching())
+    {
+        IBPP::StatementMetrics metrics;
+        statementM->Metrics(metrics);
+        // rows read in pages are fetched by other statements
+        if (metrics.rowsFetched > 0)
+        {
+            s += wxString::Format(_(" (fetch time: %s)"),
+                microsToTimeString(metrics.fetchTime).c_str());
+        }
+        if (fetchMetricsPendingM)
+            logFetchMetrics();
+    }
     statusbar_1->SetStatusText(s, 1);
 
     // TODO: we could make some bool flag, so that this happens only once per execute()
@@ -2818,16 +3344,93 @@ void ExecuteSqlFrame::OnGridLabelLeftDClick(wxGridEvent& event)
     if (!table)
         return;
 
-    int column = 1 + event.GetCol();
-    if (column < 1 || column > table->GetNumberCols())
+    int col = event.GetCol();
+    if (col < 0 || col >= table->GetNumberCols())
+        return;
+
+    // sort the fetched rows locally, another double-click on the same
+    // column reverses the order
+    bool ascending = table->getSortColumn() != col
+        || !table->isSortedAscending();
+    {
+        wxBusyCursor cr;
+        if (table->sortRows(col, ascending))
+            return;
+    }
+
+    // BLOB columns, strings with a collation the server doesn't order by
+    // their bytes, or rows not fetched yet with a scrollable cursor
+    if (executingM)
         return;
     SelectStatement sstm(wxString(statementM->Sql().c_str(),
         *databaseM->getCharsetConverter()));
 
     // rebuild SQL statement with different ORDER BY clause
-    sstm.orderBy(column);
+    sstm.orderBy(col + 1);
+
+    executeSingleStatement(sstm.getStatement());
+}
+
+void ExecuteSqlFrame::resetFilter()
+{
+    choice_filter_column->Clear();
+    choice_filter_column->Append(_("All columns"));
+    DataGridTable* table = grid_data->getDataGridTable();
+    for (int i = 0; table && i < table->GetNumberCols(); ++i)
+        choice_filter_column->Append(table->GetColLabelValue(i));
+    choice_filter_column->SetSelection(0);
+    choice_filter_operator->SetSelection(0);
+    text_ctrl_filter->ChangeValue(wxEmptyString);
+    text_ctrl_filter->Enable(true);
+    text_ctrl_filter->SetForegroundColour(
+        wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT));
+    text_ctrl_filter->UnsetToolTip();
+}
+
+// the rows are filtered while the value is typed
+void ExecuteSqlFrame::OnFilterChanged(wxCommandEvent& WXUNUSED(event))
+{
+    DataGridTable* table = grid_data->getDataGridTable();
+    if (!table || choice_filter_column->GetSelection() == wxNOT_FOUND
+        || choice_filter_operator->GetSelection() == wxNOT_FOUND)
+    {
+        return;
+    }
 
-    execute(sstm.getStatement(), wxEmptyString);
+    DataGridFilter filter;
+    // "All columns" is the first item
+    filter.column = choice_filter_column->GetSelection() - 1;
+    filter.op = DataGridFilter::Operator(
+        choice_filter_operator->GetSelection());
+    filter.value = text_ctrl_filter->GetValue();
+    bool needsValue = filter.op != DataGridFilter::foIsNull
+        && filter.op != DataGridFilter::foIsNotNull;
+    text_ctrl_filter->Enable(needsValue);
+
+    wxString error;
+    if (needsValue && filter.value.IsEmpty())
+        table->clearFilter();
+    else
+    {
+        try
+        {
+            if (!table->setFilter(filter))
+                error = _("The rows can't be filtered while rows before the last ones are missing.");
+        }
+        catch (const FRError& e)
+        {
+            error = e.what();
+        }
+    }
+
+    // invalid values for the column are shown in red, with the reason
+    text_ctrl_filter->SetForegroundColour(error.IsEmpty()
+        ? wxSystemSettings::GetColour(wxSYS_COLOUR_WINDOWTEXT) : *wxRED);
+    if (error.IsEmpty())
+        text_ctrl_filter->UnsetToolTip();
+    else
+        text_ctrl_filter->SetToolTip(error);
+    text_ctrl_filter->Refresh();
 }
 
 void ExecuteSqlFrame::OnSplitterUnsplit(wxSplitterEvent& WXUNUSED(event))
@@ -31,6 +31,11 @@
 #include <wx/notebook.h>
 #include <wx/splitter.h>
 #include <wx/stc/stc.h>
+#include <wx/stopwatch.h>
+#include <wx/thread.h>
+
+#include <functional>
+#include <memory>
 
 #include <ibpp.h>
 
@@ -40,6 +45,7 @@
 #include "gui/BaseFrame.h"
 #include "gui/EditBlobDialog.h"
 #include "gui/FindDialog.h"
+#include "sql/MultiStatement.h"
 #include "sql/SqlStatement.h"
 #include "statementHistory.h"
 
@@ -47,6 +53,7 @@ class CommandManager;
 class Database;
 class DataGrid;
 class ExecuteSqlFrame;
+class ExecuteSqlThread;
 
 class SqlEditor: public SearchableEditor
 {
@@ -85,18 +92,66 @@ private:
     virtual bool doCanClose();
     virtual void doBeforeDestroy();
 
-    // query parsing and execution
+    // query parsing and execution, done is called with the result when all
+    // statements have been executed
     void prepareAndExecute(bool prepareOnly = false);
-    bool parseStatements(const wxString& statements, bool autoExecute = false,
-        bool prepareOnly = false, int selectionOffset = 0);
-    bool execute(wxString sql, const wxString& terminator,
+    void parseStatements(const wxString& statements, bool autoExecute = false,
+        bool prepareOnly = false, int selectionOffset = 0,
+        const std::function<void (bool)>& done = std::function<void (bool)>());
+    void executeSingleStatement(const wxString& sql, bool prepareOnly = false,
+        const std::function<void (bool)>& done = std::function<void (bool)>());
+    // the script goes on with the next statement when the thread has
+    // executed the current one
+    std::unique_ptr<MultiStatement> scriptM;
+    bool scriptCloseWhenDoneM;
+    bool scriptPrepareOnlyM;
+    int scriptSelectionOffsetM;
+    std::function<void (bool)> executionDoneM;
+    void executeScript();
+    void statementDone(bool ok);
+    void markFailedStatement();
+    void executionDone(bool ok);
+
+    // the calls to the server are made by a thread, and can be cancelled.
+    // The steps of the execution of a statement return esRunning while the
+    // thread runs, the next step is run when it has finished
+    enum ExecutionState { esRunning, esSucceeded, esFailed };
+    typedef ExecutionState (ExecuteSqlFrame::*ExecutionStep)();
+    struct Execution
+    {
+        wxString sql;
+        wxString terminator;
+        bool prepareOnly;
+        bool browseInPages;
+        bool showStats;
+        bool hasColumns;
+        bool selecting;
+        IBPP::ColumnBatch firstRows;
+        wxStopWatch stopWatch;
+    };
+    Execution executionM;
+    bool executingM;
+    bool cancelRequestedM;
+    ExecuteSqlThread* threadM;
+    ExecutionStep nextStepM;
+    ExecutionState execute(wxString sql, const wxString& terminator,
         bool prepareOnly = false);
+    ExecutionState runExecutionStep(
+        const std::function<ExecutionState ()>& step);
+    ExecutionState prepareStatement();
+    ExecutionState statementPrepared();
+    ExecutionState statementExecuted();
+    ExecutionState executeInThread(const std::function<void ()>& work,
+        ExecutionStep nextStep);
 
     std::vector<SqlStatement> executedStatementsM;
     wxFileName filenameM;
     wxDateTime filenameModificationTimeM;
 
-    void compareCounts(IBPP::DatabaseCounts& one, IBPP::DatabaseCounts& two);
+    // the metrics of a statement are logged when it has been executed, the
+    // rows fetched by the grid when the fetching has ended or is stopped
+    bool fetchMetricsPendingM;
+    void logFetchMetrics();
 
     void showProperties(wxString objectName);
 
@@ -166,7 +221,9 @@ private:
     void OnGridStatementExecuted(wxCommandEvent& event);
     void OnGridSum(wxCommandEvent& event);
     void OnGridLabelLeftDClick(wxGridEvent& event);
+    void OnFilterChanged(wxCommandEvent& event);
     void OnSplitterUnsplit(wxSplitterEvent& event);
+    void OnExecuteThreadFinished(wxThreadEvent& event);
     void OnIdle(wxIdleEvent& event);
 
     // menu events
@@ -211,6 +268,9 @@ private:
     void OnMenuRollback(wxCommandEvent& event);
     void OnMenuUpdateWhenInTransaction(wxUpdateUIEvent& event);
     void OnMenuUpdateWhenExecutePossible(wxUpdateUIEvent& event);
+    void OnMenuCancelExecution(wxCommandEvent& event);
+    void OnMenuUpdateCancelExecution(wxUpdateUIEvent& event);
+    void OnMenuCompareProfiles(wxCommandEvent& event);
     void OnMenuTransactionIsolationLevel(wxCommandEvent& event);
     void OnMenuUpdateTransactionIsolationLevel(wxUpdateUIEvent& event);
     void OnMenuTransactionLockResolution(wxCommandEvent& event);
@@ -232,6 +292,7 @@ private:
     void OnMenuGridCopyAsUpdate(wxCommandEvent& event);
     void OnMenuGridSaveAsHtml(wxCommandEvent& event);
     void OnMenuGridSaveAsCsv(wxCommandEvent& event);
+    void OnMenuGridGroupRows(wxCommandEvent& event);
     void OnMenuGridGridHeaderFont(wxCommandEvent& event);
     void OnMenuGridGridCellFont(wxCommandEvent& event);
     void OnMenuGridFetchAll(wxCommandEvent& event);
@@ -246,6 +307,8 @@ private:
 
     void set_properties();
     void do_layout();
+    // the filter bar is reset for the columns of a new result set
+    void resetFilter();
 
 private:
     // observer stuff
@@ -255,7 +318,11 @@ private:
 protected:
     enum {
         ID_grid_data = 101,
-        ID_stc_sql
+        ID_stc_sql,
+        ID_filter_column,
+        ID_filter_operator,
+        ID_filter_text,
+        ID_execute_thread
     };
 
     bool closeWhenTransactionDoneM;
@@ -268,6 +335,10 @@ protected:
     wxNotebook* notebook_1;
     wxPanel* notebook_pane_1;
     wxPanel* notebook_pane_2;
+    wxStaticText* label_filter;
+    wxChoice* choice_filter_column;
+    wxChoice* choice_filter_operator;
+    wxTextCtrl* text_ctrl_filter;
     DataGrid* grid_data;
     wxStyledTextCtrl* styled_text_ctrl_stats;
 
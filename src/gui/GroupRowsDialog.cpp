@@ -0,0 +1,228 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include "core/FRError.h"
+#include "gui/AdvancedMessageDialog.h"
+#include "gui/controls/DataGridTable.h"
+#include "gui/GroupRowsDialog.h"
+#include "gui/StyleGuide.h"
+
+namespace
+{
+    // make sure you keep these two in sync if you add/remove items
+    const wxString functionStrings[] = {
+        wxTRANSLATE("Sum"),
+        wxTRANSLATE("Average"),
+        wxTRANSLATE("Minimum"),
+        wxTRANSLATE("Maximum"),
+        wxTRANSLATE("Count")
+    };
+    const DataGridGrouping::Function functions[] = {
+        DataGridGrouping::gfSum,
+        DataGridGrouping::gfAverage,
+        DataGridGrouping::gfMinimum,
+        DataGridGrouping::gfMaximum,
+        DataGridGrouping::gfCount
+    };
+}
+
+GroupRowsDialog::GroupRowsDialog(wxWindow* parent, DataGridTable* table)
+    : BaseDialog(parent, -1, _("Group Fetched Rows")), tableM(table),
+        groupTableM(0)
+{
+    createControls();
+    layoutControls();
+    button_group->SetDefault();
+}
+
+void GroupRowsDialog::createControls()
+{
+    wxArrayString columns, numericColumns;
+    for (int col = 0; col < tableM->GetNumberCols(); ++col)
+    {
+        columns.Add(tableM->GetColLabelValue(col));
+        if (tableM->isNumericColumn(col))
+        {
+            numericColumns.Add(tableM->GetColLabelValue(col));
+            aggregateColumnsM.push_back(col);
+        }
+    }
+
+    label_group = new wxStaticText(getControlsPanel(), -1,
+        _("Group by columns:"));
+    checklist_group = new wxCheckListBox(getControlsPanel(), -1,
+        wxDefaultPosition, wxDefaultSize, columns);
+    label_pivot = new wxStaticText(getControlsPanel(), -1,
+        _("Columns for the values of:"));
+    choice_pivot = new wxChoice(getControlsPanel(), -1);
+    choice_pivot->Append(_("(none)"));
+    choice_pivot->Append(columns);
+    choice_pivot->SetSelection(0);
+
+    label_function = new wxStaticText(getControlsPanel(), -1,
+        _("Aggregate:"));
+    choice_function = new wxChoice(getControlsPanel(), -1);
+    for (size_t i = 0; i < sizeof(functionStrings) / sizeof(wxString); ++i)
+        choice_function->Append(wxGetTranslation(functionStrings[i]));
+    choice_function->SetSelection(0);
+    label_aggregate = new wxStaticText(getControlsPanel(), -1,
+        _("Of columns:"));
+    checklist_aggregate = new wxCheckListBox(getControlsPanel(), -1,
+        wxDefaultPosition, wxDefaultSize, numericColumns);
+
+    grid_groups = new wxGrid(getControlsPanel(), -1, wxDefaultPosition,
+        wxSize(400, 300));
+    groupTableM = new DataGridGroupTable();
+    grid_groups->SetTable(groupTableM, true);
+    grid_groups->EnableEditing(false);
+    grid_groups->SetRowLabelSize(50);
+    grid_groups->DisableDragRowSize();
+    grid_groups->SetColLabelAlignment(wxALIGN_LEFT, wxALIGN_CENTRE);
+    grid_groups->SetRowLabelAlignment(wxALIGN_RIGHT, wxALIGN_CENTRE);
+
+    button_group = new wxButton(getControlsPanel(), ID_button_group,
+        _("&Group"));
+    button_close = new wxButton(getControlsPanel(), wxID_CANCEL,
+        _("Close"));
+}
+
+void GroupRowsDialog::layoutControls()
+{
+    wxBoxSizer* sizerSettings = new wxBoxSizer(wxVERTICAL);
+    sizerSettings->Add(label_group);
+    sizerSettings->Add(0, styleguide().getRelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(checklist_group, 1, wxEXPAND);
+    sizerSettings->Add(0, styleguide().getRelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(label_pivot);
+    sizerSettings->Add(0, styleguide().getRelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(choice_pivot, 0, wxEXPAND);
+    sizerSettings->Add(0, styleguide().getUnrelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(label_function);
+    sizerSettings->Add(0, styleguide().getRelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(choice_function, 0, wxEXPAND);
+    sizerSettings->Add(0, styleguide().getRelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(label_aggregate);
+    sizerSettings->Add(0, styleguide().getRelatedControlMargin(wxVERTICAL));
+    sizerSettings->Add(checklist_aggregate, 1, wxEXPAND);
+
+    wxBoxSizer* sizerControls = new wxBoxSizer(wxHORIZONTAL);
+    sizerControls->Add(sizerSettings, 0, wxEXPAND);
+    sizerControls->Add(styleguide().getUnrelatedControlMargin(wxHORIZONTAL), 0);
+    sizerControls->Add(grid_groups, 1, wxEXPAND);
+
+    // create sizer for buttons -> styleguide class will align it correctly
+    wxSizer* sizerButtons = styleguide().createButtonSizer(button_group,
+        button_close);
+
+    // use method in base class to set everything up
+    layoutSizers(sizerControls, sizerButtons, true);
+}
+
+const wxString GroupRowsDialog::getName() const
+{
+    return "GroupRowsDialog";
+}
+
+const wxRect GroupRowsDialog::getDefaultRect() const
+{
+    return wxRect(-1, -1, 700, 450);
+}
+
+// the rows are always counted, the aggregate is computed for the columns
+// checked
+void GroupRowsDialog::groupRows()
+{
+    DataGridGrouping grouping;
+    for (unsigned i = 0; i < checklist_group->GetCount(); ++i)
+    {
+        if (checklist_group->IsChecked(i))
+            grouping.groupColumns.push_back(i);
+    }
+    grouping.pivotColumn = choice_pivot->GetSelection() - 1;
+    DataGridGrouping::Aggregate count = { -1, DataGridGrouping::gfCount };
+    grouping.aggregates.push_back(count);
+    int function = choice_function->GetSelection();
+    if (function < 0)
+        function = 0;
+    for (unsigned i = 0; i < checklist_aggregate->GetCount(); ++i)
+    {
+        if (checklist_aggregate->IsChecked(i))
+        {
+            DataGridGrouping::Aggregate aggregate = {
+                aggregateColumnsM[i], functions[function] };
+            grouping.aggregates.push_back(aggregate);
+        }
+    }
+
+    DataGridGroupResult result;
+    {
+        wxBusyCursor cr;
+        if (!tableM->groupRows(grouping, result))
+        {
+            showInformationDialog(this, _("Rows not fetched"),
+                _("Some rows have not been fetched yet, they need to be fetched before the rows can be grouped."),
+                AdvancedMessageDialogButtonsOk());
+            return;
+        }
+    }
+
+    grid_groups->BeginBatch();
+    groupTableM->setResult(result);
+    for (int col = 0; col < groupTableM->GetNumberCols(); ++col)
+    {
+        wxGridCellAttr* attr = new wxGridCellAttr;
+        attr->SetAlignment(groupTableM->isNumericColumn(col)
+            ? wxALIGN_RIGHT : wxALIGN_LEFT, wxALIGN_TOP);
+        attr->SetOverflow(false);
+        grid_groups->SetColAttr(col, attr);
+    }
+    grid_groups->AutoSizeColumns(false);
+    grid_groups->EndBatch();
+}
+
+//! event handling
+BEGIN_EVENT_TABLE(GroupRowsDialog, BaseDialog)
+    EVT_BUTTON(GroupRowsDialog::ID_button_group, GroupRowsDialog::OnGroupButtonClick)
+END_EVENT_TABLE()
+
+void GroupRowsDialog::OnGroupButtonClick(wxCommandEvent& WXUNUSED(event))
+{
+    try
+    {
+        groupRows();
+    }
+    catch (const FRError& e)
+    {
+        showErrorDialog(this, _("Rows can't be grouped"), e.what(),
+            AdvancedMessageDialogButtonsOk());
+    }
+}
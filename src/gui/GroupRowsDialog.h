@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_GROUPROWSDIALOG_H
+#define FR_GROUPROWSDIALOG_H
+
+#include <wx/wx.h>
+#include <wx/grid.h>
+
+#include <vector>
+
+#include "gui/BaseDialog.h"
+
+class DataGridGroupTable;
+class DataGridTable;
+
+// shows the fetched rows of a result set grouped by the values of some
+// columns, with aggregates of the other ones, without executing the
+// statement again
+class GroupRowsDialog: public BaseDialog
+{
+private:
+    DataGridTable* tableM;
+    DataGridGroupTable* groupTableM;
+    // columns listed in checklist_aggregate
+    std::vector<int> aggregateColumnsM;
+
+    wxStaticText* label_group;
+    wxCheckListBox* checklist_group;
+    wxStaticText* label_pivot;
+    wxChoice* choice_pivot;
+    wxStaticText* label_function;
+    wxChoice* choice_function;
+    wxStaticText* label_aggregate;
+    wxCheckListBox* checklist_aggregate;
+    wxGrid* grid_groups;
+    wxButton* button_group;
+    wxButton* button_close;
+
+    void createControls();
+    void layoutControls();
+    void groupRows();
+protected:
+    virtual const wxString getName() const;
+    virtual const wxRect getDefaultRect() const;
+public:
+    GroupRowsDialog(wxWindow* parent, DataGridTable* table);
+private:
+    // event handling
+    enum {
+        ID_button_group = 100
+    };
+    void OnGroupButtonClick(wxCommandEvent& event);
+
+    DECLARE_EVENT_TABLE()
+};
+
+#endif // FR_GROUPROWSDIALOG_H
@@ -56,7 +56,7 @@
     and filled with values as the user types them.
 
     When all values are entered, we try to INSERT into database, and if all
-    goes well, the prepared row buffer is simply added to the grid.
+    goes well, the values of the prepared row buffer are added to the grid.
 */
 
 namespace InsertOptions
@@ -595,17 +595,12 @@ void InsertDialog::OnOkButtonClick(wxCommandEvent& WXUNUSED(event))
 
     st1->Execute();
 
-    // add buffer to the table and set internal buffer marker to zero
-    // (to prevent deletion in destructor)
+    // add a copy of the buffer to the table, the values stay in the buffer
+    // in case another row is to be inserted
     gridTableM->addRow(bufferM, stm);
 
-    if (checkboxInsertAnother->IsChecked())
+    if (!checkboxInsertAnother->IsChecked())
     {
-        bufferM = new InsertedGridRowBuffer(bufferM);
-    }
-    else
-    {
-        bufferM = 0;
         databaseM = 0;  // prevent other event handlers from making problems
         Close();
     }
@@ -775,7 +775,19 @@ void MainFrame::OnMenuDatabasePreferences(wxCommandEvent& WXUNUSED(event))
     if (pd.isOk() && pd.loadFromTargetConfig())
     {
         pd.selectPage(0);
-        pd.ShowModal();
+        if (pd.ShowModal() == wxID_OK && d->isConnected())
+        {
+            d->applyStatementCacheSize();
+            d->applyClientInterface();
+            try
+            {
+                d->applyTimeouts();
+            }
+            catch (IBPP::Exception& e)
+            {
+                wxMessageBox(e.what(), _("Error"), wxOK | wxICON_ERROR);
+            }
+        }
     }
 }
 
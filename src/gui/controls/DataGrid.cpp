@@ -37,19 +37,234 @@
 #include <wx/txtstrm.h>
 #include <wx/wfstream.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
 #include "config/Config.h"
 #include "core/FRError.h"
 #include "core/StringUtils.h"
 #include "gui/AdvancedMessageDialog.h"
 #include "gui/CommandIds.h"
 #include "gui/controls/DataGrid.h"
+#include "gui/controls/DataGridAggregates.h"
+#include "gui/controls/DataGridSelection.h"
 #include "gui/controls/DataGridTable.h"
 #include "gui/FRLayoutConfig.h"
 #include "metadata/database.h"
 #include "metadata/table.h"
 
+namespace
+{
+
+wxString formatAggregate(double value)
+{
+    wxString s = wxString::Format("%f", value);
+    // strip trailing zeroes
+    s.Truncate(1 + s.find_last_not_of("0"));
+    s.Truncate(1 + s.find_last_not_of("."));
+    return s;
+}
+
+} // namespace
+
+// DataGridAggregator: computes sum, average, minimum, maximum, count and
+// count of distinct values of the selected numeric cells, and sends them
+// to the grid as wxEVT_FRDG_SUM. The rows can only be accessed by the main
+// thread, so it reads the values, but only for the chunks of the selection
+// it hasn't read before. The aggregates are computed by the thread
+class DataGridAggregator
+{
+private:
+    typedef std::pair<int, std::pair<int, int> > ChunkKey;
+    typedef std::map<ChunkKey, DataGridSelectionChunkPtr> ChunkMap;
+
+    wxEvtHandler* handlerM;
+    int idM;
+    // these are only used by the main thread
+    ChunkMap chunksM;
+    unsigned changeCountM;
+    bool runningM;
+    std::thread threadM;
+    // the chunks of the latest selection, guarded by mutexM
+    std::mutex mutexM;
+    std::condition_variable conditionM;
+    std::vector<DataGridSelectionChunkPtr> jobM;
+    bool jobPendingM;
+    bool stopM;
+
+    void aggregate(const std::vector<DataGridSelectionChunkPtr>& job);
+    // true if the aggregates being computed are no longer needed
+    bool isCancelled();
+    bool waitForJob(std::vector<DataGridSelectionChunkPtr>& job);
+    void run();
+public:
+    DataGridAggregator(wxEvtHandler* handler, int id);
+
+    // computes the aggregates in the calling thread if the thread can't be
+    // started
+    void start();
+    void stop();
+    void update(DataGridTable* table, const DataGridSelection& selection);
+};
+
+DataGridAggregator::DataGridAggregator(wxEvtHandler* handler, int id)
+    : handlerM(handler), idM(id), changeCountM(0), runningM(false),
+        jobPendingM(false), stopM(false)
+{
+}
+
+void DataGridAggregator::start()
+{
+    // set before the thread starts, as the thread reads it
+    runningM = true;
+    try
+    {
+        threadM = std::thread(&DataGridAggregator::run, this);
+    }
+    catch (std::system_error&)
+    {
+        runningM = false;
+    }
+}
+
+void DataGridAggregator::stop()
+{
+    if (!runningM)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutexM);
+        stopM = true;
+    }
+    conditionM.notify_one();
+    threadM.join();
+    runningM = false;
+}
+
+void DataGridAggregator::update(DataGridTable* table,
+    const DataGridSelection& selection)
+{
+    if (table->getChangeCount() != changeCountM)
+    {
+        chunksM.clear();
+        changeCountM = table->getChangeCount();
+    }
+
+    // chunks no longer selected are dropped
+    ChunkMap chunks;
+    std::vector<DataGridSelectionChunkPtr> job;
+    for (int col = 0; col < selection.getColCount(); ++col)
+    {
+        const DataGridSelection::RowRanges& ranges(
+            selection.getColumnRanges(col));
+        if (ranges.empty() || !table->isNumericColumn(col))
+            continue;
+        for (DataGridSelection::RowRanges::const_iterator it = ranges.begin();
+            it != ranges.end(); ++it)
+        {
+            for (int first = (*it).first; first <= (*it).second; )
+            {
+                int last = std::min((*it).second,
+                    (first / DataGridSelectionChunk::chunkRows + 1)
+                        * DataGridSelectionChunk::chunkRows - 1);
+                ChunkKey key(col, std::make_pair(first, last));
+                DataGridSelectionChunkPtr chunk;
+                ChunkMap::iterator found = chunksM.find(key);
+                if (found != chunksM.end())
+                    chunk = (*found).second;
+                else
+                {
+                    chunk.reset(new DataGridSelectionChunk());
+                    table->getNumericValues(col, first, last + 1,
+                        chunk->values);
+                }
+                chunks[key] = chunk;
+                job.push_back(chunk);
+                first = last + 1;
+            }
+        }
+    }
+    chunksM.swap(chunks);
+
+    if (!runningM)
+    {
+        aggregate(job);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutexM);
+        jobM.swap(job);
+        jobPendingM = true;
+    }
+    conditionM.notify_one();
+}
+
+void DataGridAggregator::run()
+{
+    std::vector<DataGridSelectionChunkPtr> job;
+    while (waitForJob(job))
+        aggregate(job);
+}
+
+bool DataGridAggregator::waitForJob(
+    std::vector<DataGridSelectionChunkPtr>& job)
+{
+    std::unique_lock<std::mutex> lock(mutexM);
+    conditionM.wait(lock, [this]() { return jobPendingM || stopM; });
+    if (stopM)
+        return false;
+    job.swap(jobM);
+    jobM.clear();
+    jobPendingM = false;
+    return true;
+}
+
+bool DataGridAggregator::isCancelled()
+{
+    if (!runningM)
+        return false;
+    std::lock_guard<std::mutex> lock(mutexM);
+    return jobPendingM || stopM;
+}
+
+void DataGridAggregator::aggregate(
+    const std::vector<DataGridSelectionChunkPtr>& job)
+{
+    DataGridAggregates aggregates;
+    for (std::vector<DataGridSelectionChunkPtr>::const_iterator it =
+        job.begin(); it != job.end(); ++it)
+    {
+        if (isCancelled())
+            return;
+        if (!(*it)->computed)
+            (*it)->compute();
+        aggregates.add(*it);
+    }
+    unsigned count = aggregates.getCount();
+    if (!count)
+        return;
+    size_t distinct = aggregates.countDistinct();
+    if (isCancelled())
+        return;
+
+    // used in frame to update status bar
+    wxCommandEvent evt(wxEVT_FRDG_SUM, idM);
+    evt.SetString(wxString::Format(
+        _("Sum: %s, Avg: %s, Min: %s, Max: %s, Count: %u, Distinct: %u"),
+        formatAggregate(aggregates.getSum()).c_str(),
+        formatAggregate(aggregates.getSum() / count).c_str(),
+        formatAggregate(aggregates.getMin()).c_str(),
+        formatAggregate(aggregates.getMax()).c_str(),
+        count, unsigned(distinct)));
+    wxPostEvent(handlerM, evt);
+}
+
 DataGrid::DataGrid(wxWindow* parent, wxWindowID id)
-    : wxGrid(parent, id), timerM(this, TIMER_ID), calculateSumM(true)
+    : wxGrid(parent, id), timerM(this, TIMER_ID),
+        fetchTimerM(this, FETCH_TIMER_ID), aggregatorM(0)
 {
     // this is necessary for wxWidgets 3.0, otherwise grid will be as wide
     // as the sum of column widths
@@ -78,10 +293,15 @@ DataGrid::DataGrid(wxWindow* parent, wxWindowID id)
             SetLabelFont(f);
     }
     updateRowHeights();
+
+    aggregatorM = new DataGridAggregator(this, GetId());
+    aggregatorM->start();
 }
 
 DataGrid::~DataGrid()
 {
+    aggregatorM->stop();
+    delete aggregatorM;
 }
 
 void DataGrid::copyToClipboard(const wxString cbText)
@@ -134,7 +354,8 @@ void DataGrid::extendSelection(int direction)
     }
 }
 
-void DataGrid::fetchData(bool readonly)
+void DataGrid::fetchData(bool readonly, const wxString& browseSql,
+    const IBPP::ColumnBatch* firstRows)
 {
     DataGridTable* table = getDataGridTable();
     if (!table)
@@ -142,7 +363,7 @@ void DataGrid::fetchData(bool readonly)
 
     wxBusyCursor bc;
     BeginBatch();
-    table->initialFetch(readonly);
+    table->initialFetch(readonly, browseSql, firstRows);
 
     for (int i = 0; i < table->GetNumberCols(); i++)
     {
@@ -161,10 +382,11 @@ void DataGrid::fetchData(bool readonly)
     AutoSizeColumns(false);
     EndBatch();
 
-    // event handler is only needed if not all rows have already been
-    // fetched
+    // timer is only needed if not all rows have already been fetched, the
+    // fetched rows are added in fixed intervals so the grid isn't updated
+    // for every single row
     if (table->canFetchMoreRows())
-        Connect(wxID_ANY, wxEVT_IDLE, wxIdleEventHandler(DataGrid::OnIdle));
+        fetchTimerM.Start(100);
 
 #ifdef __WXGTK__
     // needed to make scrollbars show on large datasets
@@ -209,6 +431,9 @@ void DataGrid::showPopupMenu(wxPoint cursorPos)
     m.Append(Cmds::DataGrid_Save_as_csv, _("Save as CSV file..."));
     m.AppendSeparator();
 
+    m.Append(Cmds::DataGrid_Group_rows, _("Group fetched rows..."));
+    m.AppendSeparator();
+
     m.Append(Cmds::DataGrid_EditBlob, _("Edit BLOB..."));
     m.Append(Cmds::DataGrid_ImportBlob, _("Import BLOB from file..."));
     m.Append(Cmds::DataGrid_ExportBlob, _("Save BLOB to file..."));
@@ -269,32 +494,30 @@ void DataGrid::copyToClipboard()
     if (!table)
         return;
 
-    bool all = true;
-    bool any = false;
+    DataGridSelection selection(this);
+    bool all = selection.isAllSelected();
+    bool any = !selection.isEmpty();
     {
         wxBusyCursor cr;
         wxString sRows;
-        for (int i = 0; i < GetNumberRows(); i++)
+        const std::vector<DataGridSelection::RowSpan>& spans =
+            selection.getRowSpans();
+        for (size_t s = 0; s < spans.size(); s++)
         {
-            wxString sRow;
-            bool first = true;
-            for (int j = 0; j < GetNumberCols(); j++)
+            const std::vector<int>& cols = spans[s].columns;
+            for (int i = spans[s].firstRow; i <= spans[s].lastRow; i++)
             {
-                if (IsInSelection(i, j))
+                wxString sRow;
+                for (size_t c = 0; c < cols.size(); c++)
                 {
                     // TODO: - align fields in columns ?
                     //       - fields with multiline strings don't really work...
-                    if (!first)
+                    if (c > 0)
                         sRow += "\t";
-                    first = false;
-                    sRow += table->getCellValue(i, j);
-                    any = true;
+                    sRow += table->getCellValue(i, cols[c]);
                 }
-                else
-                    all = false;
-            }
-            if (!first)
                 sRows += sRow + wxTextBuffer::GetEOL();
+            }
         }
         if (!sRows.IsEmpty())
             copyToClipboard(sRows);
@@ -321,7 +544,8 @@ void DataGrid::copyToClipboardAsInsert()
             GetGridCursorRow(), GetGridCursorCol());
     }
 
-    bool all = true;
+    DataGridSelection selection(this);
+    bool all = selection.isAllSelected();
     {   // begin busy cursor
         wxBusyCursor cr;
         int sqlDialect = table->getDatabase()->getSqlDialect();
@@ -344,26 +568,28 @@ void DataGrid::copyToClipboardAsInsert()
         // NOTE: this has been reworked (compared to myDataGrid), because
         //       not all rows have necessarily the same fields selected
         wxString sRows;
-        for (int i = 0; i < GetNumberRows(); i++)
+        const std::vector<DataGridSelection::RowSpan>& spans =
+            selection.getRowSpans();
+        for (size_t s = 0; s < spans.size(); s++)
         {
+            // the column list is the same for all rows of the span
+            const std::vector<int>& cols = spans[s].columns;
             wxString sCols;
-            wxString sValues;
-            for (int j = 0; j < GetNumberCols(); j++)
+            for (size_t c = 0; c < cols.size(); c++)
+            {
+                if (c > 0)
+                    sCols += ", ";
+                sCols += columnNames[cols[c]];
+            }
+            for (int i = spans[s].firstRow; i <= spans[s].lastRow; i++)
             {
-                if (IsInSelection(i, j))
+                wxString sValues;
+                for (size_t c = 0; c < cols.size(); c++)
                 {
-                    if (!sCols.IsEmpty())
-                        sCols += ", ";
-                    sCols += columnNames[j];
-                    if (!sValues.IsEmpty())
+                    if (c > 0)
                         sValues += ", ";
-                    sValues += table->getCellValueForInsert(i, j);
+                    sValues += table->getCellValueForInsert(i, cols[c]);
                 }
-                else
-                    all = false;
-            }
-            if (!sCols.IsEmpty())
-            {
                 sRows += "INSERT INTO " + tableId.getQuoted() + " (";
                 sRows += sCols;
                 sRows += ") VALUES (";
@@ -391,20 +617,24 @@ void DataGrid::copyToClipboardAsInList()
             GetGridCursorRow(), GetGridCursorCol());
     }
 
-    bool all = true;
+    DataGridSelection selection(this);
+    bool all = selection.isAllSelected();
     {   // begin busy cursor
         wxBusyCursor cr;
 
         wxString s, sLine;
-        for (int i = 0; i < GetNumberRows(); i++)
+        const std::vector<DataGridSelection::RowSpan>& spans =
+            selection.getRowSpans();
+        for (size_t k = 0; k < spans.size(); k++)
         {
-            for (int j = 0; j < GetNumberCols(); j++)
+            const std::vector<int>& cols = spans[k].columns;
+            for (int i = spans[k].firstRow; i <= spans[k].lastRow; i++)
             {
-                if (IsInSelection(i, j))
+                for (size_t c = 0; c < cols.size(); c++)
                 {
                     if (!sLine.IsEmpty())
                         sLine += ", ";
-                    wxString v(table->getCellValueForInsert(i, j));
+                    wxString v(table->getCellValueForInsert(i, cols[c]));
                     if (sLine.Length() + v.Length() > 80)   // new line
                     {
                         s += sLine + wxTextBuffer::GetEOL();
@@ -413,8 +643,6 @@ void DataGrid::copyToClipboardAsInList()
                     else
                         sLine += v;
                 }
-                else
-                    all = false;
             }
         }
         s += sLine;   // add the last line
@@ -437,7 +665,8 @@ void DataGrid::copyToClipboardAsUpdate()
             GetGridCursorRow(), GetGridCursorCol());
     }
 
-    bool all = true;
+    DataGridSelection selection(this);
+    bool all = selection.isAllSelected();
     {   // begin busy cursor
         wxBusyCursor cr;
         int sqlDialect = table->getDatabase()->getSqlDialect();
@@ -457,23 +686,22 @@ void DataGrid::copyToClipboardAsUpdate()
         }
 
         wxString sRows;
-        for (int i = 0; i < GetNumberRows(); i++)
+        const std::vector<DataGridSelection::RowSpan>& spans =
+            selection.getRowSpans();
+        for (size_t s = 0; s < spans.size(); s++)
         {
-            wxString str;
-            for (int j = 0; j < GetNumberCols(); j++)
+            const std::vector<int>& cols = spans[s].columns;
+            for (int i = spans[s].firstRow; i <= spans[s].lastRow; i++)
             {
-                if (IsInSelection(i, j))
+                wxString str;
+                for (size_t c = 0; c < cols.size(); c++)
                 {
-                    if (!str.IsEmpty())
+                    if (c > 0)
                         str += ", ";
-                    str += wxTextBuffer::GetEOL() + columnNames[j]
-                        + " = " + table->getCellValueForInsert(i, j);
+                    str += wxTextBuffer::GetEOL() + columnNames[cols[c]]
+                        + " = " + table->getCellValueForInsert(i, cols[c]);
                 }
-                else
-                    all = false;
-            }
-            if (!str.IsEmpty())
-            {
+
                 wxString where;
                 // find primary key (otherwise use all values)
                 Table *t = 0;
@@ -559,10 +787,15 @@ void DataGrid::saveAsCSV(const wxString& fileName,
     bool all = true;
     {
         wxBusyCursor cr;
+        DataGridSelection selection(this);
         // find all columns that have at least one cell selected
-        std::vector<bool> selCols(getColumnsWithSelectedCells());
-        if (std::find(selCols.begin(), selCols.end(), false) != selCols.end())
-            all = false;
+        std::vector<bool> selCols(selection.getColCount(), false);
+        for (int col = 0; col < selection.getColCount(); col++)
+        {
+            selCols[col] = !selection.getColumnRanges(col).empty();
+            if (!selCols[col])
+                all = false;
+        }
 
         // write CSV file
         wxFileOutputStream fos(fileName);
@@ -587,28 +820,31 @@ void DataGrid::saveAsCSV(const wxString& fileName,
         if (!sHeader.empty())
             outStr.WriteString(sHeader + sEOL);
 
-        // find all rows that have at least one cell selected
-        std::vector<bool> selRows(getRowsWithSelectedCells());
-        if (std::find(selRows.begin(), selRows.end(), false) != selRows.end())
-            all = false;
-        for (size_t row = 0; row < selRows.size(); row++)
+        // export only rows that have at least one cell selected
+        int selRowCount = 0;
+        const std::vector<DataGridSelection::RowSpan>& spans =
+            selection.getRowSpans();
+        for (size_t s = 0; s < spans.size(); s++)
         {
-            // export only selected rows
-            if (!selRows[row])
-                continue;
-            wxString sRow;
-            for (size_t col = 0; col < selCols.size(); col++)
+            for (int row = spans[s].firstRow; row <= spans[s].lastRow; row++)
             {
-                if (selCols[col])
+                wxString sRow;
+                for (size_t col = 0; col < selCols.size(); col++)
                 {
-                    if (!sRow.empty())
-                        sRow += sFieldDelim;
-                    sRow += table->getCellValueForCSV(row, col, textDelimiter);
+                    if (selCols[col])
+                    {
+                        if (!sRow.empty())
+                            sRow += sFieldDelim;
+                        sRow += table->getCellValueForCSV(row, col,
+                            textDelimiter);
+                    }
                 }
-            }
-            if (!sRow.empty())
                 outStr.WriteString(sRow + sEOL);
+                ++selRowCount;
+            }
         }
+        if (selRowCount < selection.getRowCount())
+            all = false;
     }
     if (all)
         notifyIfUnfetchedData();
@@ -623,8 +859,11 @@ void DataGrid::saveAsHTML()
     if (fname.empty())
         return;
 
+    DataGridSelection selection(this);
     // find all columns that have at least one cell selected
-    std::vector<bool> selCols(getColumnsWithSelectedCells());
+    std::vector<bool> selCols(selection.getColCount(), false);
+    for (int col = 0; col < selection.getColCount(); col++)
+        selCols[col] = !selection.getColumnRanges(col).empty();
 
     // write HTML file
     wxFileOutputStream fos(fname);
@@ -655,37 +894,43 @@ void DataGrid::saveAsHTML()
     outStr.WriteString("</tr>\n");
 
     DataGridTable* table = getDataGridTable();
-    // write table data
-    int rows = GetNumberRows();
-    for (int i = 0; i < rows; i++)
+    // write table data, only rows with at least one cell selected
+    const std::vector<DataGridSelection::RowSpan>& spans =
+        selection.getRowSpans();
+    for (size_t s = 0; s < spans.size(); s++)
     {
-        std::vector<bool> selCells(getSelectedCellsInRow(i));
-        if (std::count(selCells.begin(), selCells.end(), true) == 0)
-            continue;
+        // all rows of the span have the same cells selected
+        std::vector<bool> selCells(cols, false);
+        for (size_t c = 0; c < spans[s].columns.size(); c++)
+            selCells[spans[s].columns[c]] = true;
 
-        outStr.WriteString("<tr bgcolor=white>");
-        // write data for selected grid cells only
-        for (int j = 0; j < cols; j++)
+        for (int i = spans[s].firstRow; i <= spans[s].lastRow; i++)
         {
-            if (!selCols[j])
-                continue;
-            if (!selCells[j])
-                outStr.WriteString("<td bgcolor=silver>");
-            else if (table->isNullCell(i, j))
-                outStr.WriteString("<td><font color=red>NULL</font>");
-            else
+            outStr.WriteString("<tr bgcolor=white>");
+            // write data for selected grid cells only
+            for (int j = 0; j < cols; j++)
             {
-                outStr.WriteString("<td");
-                int halign, valign;
-                GetCellAlignment(i, j, &halign, &valign);
-                if (halign == wxALIGN_RIGHT)
-                    outStr.WriteString(" align=right");
-                outStr.WriteString(" nowrap>");
-                outStr.WriteString(escapeHtmlChars(table->getCellValue(i, j)));
+                if (!selCols[j])
+                    continue;
+                if (!selCells[j])
+                    outStr.WriteString("<td bgcolor=silver>");
+                else if (table->isNullCell(i, j))
+                    outStr.WriteString("<td><font color=red>NULL</font>");
+                else
+                {
+                    outStr.WriteString("<td");
+                    int halign, valign;
+                    GetCellAlignment(i, j, &halign, &valign);
+                    if (halign == wxALIGN_RIGHT)
+                        outStr.WriteString(" align=right");
+                    outStr.WriteString(" nowrap>");
+                    outStr.WriteString(
+                        escapeHtmlChars(table->getCellValue(i, j)));
+                }
+                outStr.WriteString("</td>");
             }
-            outStr.WriteString("</td>");
+            outStr.WriteString("</tr>\n");
         }
-        outStr.WriteString("</tr>\n");
     }
     outStr.WriteString("</table></body></html>\n");
 }
@@ -706,138 +951,107 @@ void DataGrid::cancelFetchAll()
 
 std::vector<bool> DataGrid::getColumnsWithSelectedCells()
 {
-    // fully selected rows cause all columns to have selected cells
-    if (GetSelectedRows().size() > 0)
-        return std::vector<bool>(GetNumberCols(), true);
-
+    DataGridSelection selection(this);
     std::vector<bool> ret(GetNumberCols(), false);
-    // first mark all completely selected columns
-    wxArrayInt cols(GetSelectedCols());
-    for (size_t i = 0; i < cols.size(); i++)
-        ret[cols[i]] = true;
-
-    // now mark all columns contained in selected blocks
-    wxGridCellCoordsArray blocksTL(GetSelectionBlockTopLeft());
-    wxGridCellCoordsArray blocksBR(GetSelectionBlockBottomRight());
-    for (size_t i = 0; i < blocksTL.size(); i++)
-    {
-        const wxGridCellCoords& tl = blocksTL[i];
-        const wxGridCellCoords& br = blocksBR[i];
-        for (int c = tl.GetCol(); c <= br.GetCol(); c++)
-            ret[c] = true;
-    }
-
-    // now mark all columns of selected single cells
-    wxGridCellCoordsArray cells(GetSelectedCells());
-    for (size_t i = 0; i < cells.size(); i++)
-    {
-        const wxGridCellCoords& c = cells[i];
-        ret[c.GetCol()] = true;
-    }
-
+    for (int col = 0; col < selection.getColCount(); col++)
+        ret[col] = !selection.getColumnRanges(col).empty();
     return ret;
 }
 
 std::vector<bool> DataGrid::getRowsWithSelectedCells()
 {
-    // fully selected columns cause all rows to have selected cells
-    if (GetSelectedCols().size() > 0)
-        return std::vector<bool>(GetNumberRows(), true);
-
+    DataGridSelection selection(this);
     std::vector<bool> ret(GetNumberRows(), false);
-    // first mark all completely selected rows
-    wxArrayInt rows(GetSelectedRows());
-    for (size_t i = 0; i < rows.size(); i++)
-        ret[rows[i]] = true;
-
-    // now mark all rows contained in selected blocks
-    wxGridCellCoordsArray blocksTL(GetSelectionBlockTopLeft());
-    wxGridCellCoordsArray blocksBR(GetSelectionBlockBottomRight());
-    for (size_t i = 0; i < blocksTL.size(); i++)
+    const std::vector<DataGridSelection::RowSpan>& spans =
+        selection.getRowSpans();
+    for (size_t i = 0; i < spans.size(); i++)
     {
-        const wxGridCellCoords& tl = blocksTL[i];
-        const wxGridCellCoords& br = blocksBR[i];
-        for (int r = tl.GetRow(); r <= br.GetRow(); r++)
-            ret[r] = true;
+        std::fill(ret.begin() + spans[i].firstRow,
+            ret.begin() + spans[i].lastRow + 1, true);
     }
+    return ret;
+}
 
-    // now mark all columns of selected single cells
-    wxGridCellCoordsArray cells(GetSelectedCells());
-    for (size_t i = 0; i < cells.size(); i++)
+std::vector<bool> DataGrid::getSelectedCellsInRow(int row)
+{
+    DataGridSelection selection(this);
+    std::vector<bool> ret(GetNumberCols(), false);
+    for (int col = 0; col < selection.getColCount(); col++)
+        ret[col] = selection.isSelected(row, col);
+    return ret;
+}
+
+wxGridCellCoordsArray DataGrid::getSelectedCells()
+{
+    DataGridSelection selection(this);
+    wxGridCellCoordsArray result;
+    result.Alloc(selection.getCellCount());
+    const std::vector<DataGridSelection::RowSpan>& spans =
+        selection.getRowSpans();
+    for (size_t i = 0; i < spans.size(); i++)
     {
-        const wxGridCellCoords& c = cells[i];
-        ret[c.GetRow()] = true;
+        const DataGridSelection::RowSpan& span = spans[i];
+        for (int row = span.firstRow; row <= span.lastRow; row++)
+        {
+            for (size_t c = 0; c < span.columns.size(); c++)
+                result.Add(wxGridCellCoords(row, span.columns[c]));
+        }
     }
 
-    return ret;
+    if (result.size() == 0)
+        result.Add(wxGridCellCoords(wxGrid::GetGridCursorRow(),wxGrid::GetGridCursorCol()));
+
+    return result;
 }
 
-std::vector<bool> DataGrid::getSelectedCellsInRow(int row)
+// DataGridSelection: the ranges are built from the selected rows, columns,
+// blocks and cells, so this is proportional to their number and not to the
+// number of cells
+DataGridSelection::DataGridSelection(wxGrid* grid)
+    : DataGridSelection(grid->GetNumberRows(), grid->GetNumberCols())
 {
-    // check whether row is fully selected
-    wxArrayInt rows(GetSelectedRows());
-    for (size_t i = 0; i < rows.size(); i++)
+    if (getRowCount() == 0 || getColCount() == 0)
+        return;
+
+    // selected rows are added as runs of consecutive rows
+    wxArrayInt selRows(grid->GetSelectedRows());
+    std::vector<int> rows;
+    rows.reserve(selRows.size());
+    for (size_t i = 0; i < selRows.size(); i++)
+        rows.push_back(selRows[i]);
+    std::sort(rows.begin(), rows.end());
+    for (size_t i = 0; i < rows.size(); )
     {
-        if (rows[i] == row)
-            return std::vector<bool>(GetNumberCols(), true);
+        size_t j = i + 1;
+        while (j < rows.size() && rows[j] <= rows[j - 1] + 1)
+            ++j;
+        addRows(rows[i], rows[j - 1]);
+        i = j;
     }
 
-    std::vector<bool> ret(GetNumberCols(), false);
-    // first mark cells of all completely selected columns
-    wxArrayInt cols(GetSelectedCols());
+    wxArrayInt cols(grid->GetSelectedCols());
     for (size_t i = 0; i < cols.size(); i++)
-        ret[cols[i]] = true;
+        addRange(cols[i], 0, rowCountM - 1);
 
-    // now mark all columns contained in selected blocks
-    wxGridCellCoordsArray blocksTL(GetSelectionBlockTopLeft());
-    wxGridCellCoordsArray blocksBR(GetSelectionBlockBottomRight());
+    wxGridCellCoordsArray blocksTL(grid->GetSelectionBlockTopLeft());
+    wxGridCellCoordsArray blocksBR(grid->GetSelectionBlockBottomRight());
+    wxASSERT(blocksTL.size() == blocksBR.size());
     for (size_t i = 0; i < blocksTL.size(); i++)
     {
         const wxGridCellCoords& tl = blocksTL[i];
         const wxGridCellCoords& br = blocksBR[i];
-        if (tl.GetRow() <= row && row <= br.GetRow())
-        {
-            for (int c = tl.GetCol(); c <= br.GetCol(); c++)
-                ret[c] = true;
-        }
+        for (int col = tl.GetCol(); col <= br.GetCol(); col++)
+            addRange(col, tl.GetRow(), br.GetRow());
     }
 
-    // now mark all selected single cells
-    wxGridCellCoordsArray cells(GetSelectedCells());
+    wxGridCellCoordsArray cells(grid->GetSelectedCells());
     for (size_t i = 0; i < cells.size(); i++)
     {
         const wxGridCellCoords& c = cells[i];
-        if (c.GetRow() == row)
-            ret[c.GetCol()] = true;
-    }
-
-    return ret;
-}
-
-wxGridCellCoordsArray DataGrid::getSelectedCells()
-{
-    wxGridCellCoordsArray result;
-    result = wxGrid::GetSelectedCells();
-
-    // add rows in selection blocks that span all columns
-    wxGridCellCoordsArray tlCells(wxGrid::GetSelectionBlockTopLeft());
-    wxGridCellCoordsArray brCells(wxGrid::GetSelectionBlockBottomRight());
-    wxASSERT(tlCells.GetCount() == brCells.GetCount());
-    for (size_t i = 0; i < tlCells.GetCount(); ++i)
-    {
-        wxGridCellCoords tl = tlCells[i];
-        wxGridCellCoords br = brCells[i];
-        for (int iCol = tl.GetCol(); iCol <= br.GetCol(); iCol++)
-        for (int iRow = tl.GetRow(); iRow <= br.GetRow(); iRow++)
-        {
-            result.Add(wxGridCellCoords(iRow,iCol));
-        }
+        addRange(c.GetCol(), c.GetRow(), c.GetRow());
     }
 
-    if (result.size() == 0)
-        result.Add(wxGridCellCoords(wxGrid::GetGridCursorRow(),wxGrid::GetGridCursorCol()));
-
-    return result;
+    finish();
 }
 
 BEGIN_EVENT_TABLE(DataGrid, wxGrid)
@@ -850,6 +1064,7 @@ BEGIN_EVENT_TABLE(DataGrid, wxGrid)
     //  EVT_GRID_EDITOR_HIDDEN( DataGrid::OnEditorHidden )
     EVT_KEY_DOWN(DataGrid::OnKeyDown)
     EVT_TIMER(DataGrid::TIMER_ID, DataGrid::OnTimer)
+    EVT_TIMER(DataGrid::FETCH_TIMER_ID, DataGrid::OnFetchTimer)
 #ifdef __WXGTK__
     EVT_MOUSEWHEEL(DataGrid::OnMouseWheel)
     EVT_SCROLLWIN_THUMBRELEASE(DataGrid::OnThumbRelease)
@@ -858,73 +1073,26 @@ END_EVENT_TABLE()
 
 void DataGrid::OnGridCellSelected(wxGridEvent& event)
 {
-    timerM.Start(500, wxTIMER_ONE_SHOT);
+    timerM.Start(100, wxTIMER_ONE_SHOT);
     event.Skip();
 }
 
 void DataGrid::OnGridRangeSelected(wxGridRangeSelectEvent& event)
 {
-    timerM.Start(500, wxTIMER_ONE_SHOT);
+    timerM.Start(100, wxTIMER_ONE_SHOT);
     event.Skip();
 }
 
 DEFINE_EVENT_TYPE(wxEVT_FRDG_SUM)
 void DataGrid::OnTimer(wxTimerEvent& WXUNUSED(event))
 {
-    // calculate sum for all selected fields and show in status bar
+    // aggregates of all selected fields are shown in status bar
     DataGridTable* table = getDataGridTable();
-    if (!table || !calculateSumM)
+    if (!table)
         return;
 
-    double sum = 0;
-    bool any = false;
-    bool alert = true;
-    wxStopWatch sw;;
-    for (int j = 0; j < GetNumberCols(); j++)
-    {
-        if (!table->isNumericColumn(j))
-            continue;
-        for (int i = 0; i < GetNumberRows(); i++)
-        {
-            if (IsInSelection(i, j))
-            {
-                double d;
-                wxString val = table->getCellValue(i, j);
-                if (val.ToDouble(&d))
-                {
-                    sum += d;
-                    any = true;
-                }
-            }
-            if (alert && sw.Time() > 4000)
-            {
-                AdvancedMessageDialogButtonsYesNoCancel amb(_("&Abort"),
-                    _("&Disable for this grid"), _("&Continue"));
-                int res = showQuestionDialog(this,
-                    _("Calculating the sum takes too long"),
-                    _("FlameRobin automatically calculates the sum of selected numeric values. However, the current calculation seems to be taking too long. Would you like to abort it?"),
-                    amb, config(), "DIALOG_DisableGridSum",
-                    _("Do not ask this question again"));
-                if (res == wxNO)
-                    calculateSumM = false;
-                if (res == wxYES || res == wxNO)
-                    return;
-                alert = false;
-            }
-        }
-    }
-
-    if (any)
-    {
-        // used in frame to update status bar
-        wxCommandEvent evt(wxEVT_FRDG_SUM, GetId());
-        wxString ss = wxString::Format("Sum: %f", sum);
-        // strip trailing zeroes
-        ss.Truncate(1 + ss.find_last_not_of("0"));
-        ss.Truncate(1 + ss.find_last_not_of("."));
-        evt.SetString(ss);
-        wxPostEvent(this, evt);
-    }
+    DataGridSelection selection(this);
+    aggregatorM->update(table, selection);
 }
 
 void DataGrid::OnEditorCreated(wxGridEditorCreatedEvent& event)
@@ -993,25 +1161,25 @@ void DataGrid::OnGridSelectCell(wxGridEvent& event)
     event.Skip();
 }*/
 
-void DataGrid::OnIdle(wxIdleEvent& event)
+void DataGrid::OnFetchTimer(wxTimerEvent& WXUNUSED(event))
+{
+    updateFetchedRows();
+}
+
+void DataGrid::updateFetchedRows()
 {
     DataGridTable* table = getDataGridTable();
-    // disconnect event handler if nothing more to be done, will be
-    // re-registered on next successfull execution of select statement
+    // stop the timer if nothing more to be done, will be restarted on next
+    // successfull execution of select statement
     if (!table || !table->canFetchMoreRows())
     {
-        Disconnect(wxID_ANY, wxEVT_IDLE);
+        fetchTimerM.Stop();
         return;
     }
-    // fetch more rows until row cache is filled or timeslice is spent, and
-    // request another wxEVT_IDLE event if row cache has not been filled
-    if (table->needsMoreRowsFetched())
-    {
-        table->fetch();
-        if (table->needsMoreRowsFetched())
-            event.RequestMore();
+    int oldRows = table->GetNumberRows();
+    table->fetch();
+    if (table->GetNumberRows() != oldRows)
         AdjustScrollbars();
-    }
 }
 
 void DataGrid::OnKeyDown(wxKeyEvent& event)
@@ -1030,6 +1198,19 @@ void DataGrid::OnKeyDown(wxKeyEvent& event)
         }
     }
 
+    // with a scrollable cursor the last rows are fetched without the rows
+    // before them, the grid then moves to the last row as usual
+    if (event.GetKeyCode() == WXK_END && event.ControlDown())
+    {
+        DataGridTable* table = getDataGridTable();
+        if (table && table->canFetchLastRows())
+        {
+            wxBusyCursor bc;
+            table->fetchLastRows();
+            AdjustScrollbars();
+        }
+    }
+
     if ((event.GetKeyCode() == WXK_HOME || event.GetKeyCode() == WXK_END)
         && !event.ControlDown())
     {
@@ -1058,7 +1239,28 @@ void DataGrid::OnMouseWheel(wxMouseEvent& event)
 
 void DataGrid::OnThumbRelease(wxScrollWinEvent& event)
 {
-    wxIdleEvent dummy;
-    OnIdle(dummy);
+    DataGridTable* table = getDataGridTable();
+    if (table && event.GetOrientation() == wxVERTICAL)
+    {
+        // releasing the thumb at the end of the scrollbar works like Ctrl+End
+        if (table->canFetchLastRows() && event.GetPosition()
+            + GetScrollThumb(wxVERTICAL) >= GetScrollRange(wxVERTICAL))
+        {
+            wxBusyCursor bc;
+            table->fetchLastRows();
+            AdjustScrollbars();
+            if (GetNumberRows() > 0)
+            {
+                MakeCellVisible(GetNumberRows() - 1,
+                    wxMax(GetGridCursorCol(), 0));
+            }
+            return;
+        }
+        // otherwise fetch the missing rows that are going to be shown
+        int row = YToRow(event.GetPosition() * GetScrollLineY(), true);
+        if (row != wxNOT_FOUND)
+            table->fetchRowsAround(row);
+    }
+    updateFetchedRows();
     event.Skip();
 }
@@ -30,6 +30,8 @@
 
 #include <vector>
 
+namespace IBPP { class ColumnBatch; }
+class DataGridAggregator;
 class DataGridTable;
 
 BEGIN_DECLARE_EVENT_TYPES()
@@ -41,33 +43,41 @@ class DataGrid: public wxGrid
 {
 private:
     wxTimer timerM;
-    enum { TIMER_ID = 3333 };
-    bool calculateSumM;
+    // rows fetched in the background are added to the grid on this timer
+    wxTimer fetchTimerM;
+    enum { TIMER_ID = 3333, FETCH_TIMER_ID };
+    // computes the aggregates of the selected numeric cells in the
+    // background
+    DataGridAggregator* aggregatorM;
 
     void copyToClipboard(const wxString cbText);
     void extendSelection(int direction);
     void notifyIfUnfetchedData();
     void showPopupMenu(wxPoint cursorPos);
+    void updateFetchedRows();
     void updateRowHeights();
 public:
     DataGrid(wxWindow* parent, wxWindowID id);
     ~DataGrid();
 
     DataGridTable* getDataGridTable();
-    void fetchData(bool readonly);
+    // firstRows are the rows already fetched after the statement has been
+    // executed, if any
+    void fetchData(bool readonly, const wxString& browseSql = wxEmptyString,
+        const IBPP::ColumnBatch* firstRows = 0);
 private:
     void OnContextMenu(wxContextMenuEvent& event);
     void OnGridCellRightClick(wxGridEvent& event);
     void OnGridCellSelected(wxGridEvent& event);
     void OnGridLabelRightClick(wxGridEvent& event);
     void OnGridRangeSelected(wxGridRangeSelectEvent& event);
-    void OnIdle(wxIdleEvent& event);
     void OnKeyDown(wxKeyEvent& event);
     void OnMouseWheel(wxMouseEvent& event);
     void OnThumbRelease(wxScrollWinEvent& event);
     void OnEditorCreated(wxGridEditorCreatedEvent& event);
     void OnEditorKeyDown(wxKeyEvent& event);
     void OnTimer(wxTimerEvent& event);
+    void OnFetchTimer(wxTimerEvent& event);
     DECLARE_EVENT_TABLE()
 public:
     void copyToClipboard();
@@ -0,0 +1,141 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <algorithm>
+#include <iterator>
+
+#include "gui/controls/DataGridAggregates.h"
+
+// DataGridSelectionChunk struct
+DataGridSelectionChunk::DataGridSelectionChunk()
+    : computed(false), count(0), sum(0), min(0), max(0)
+{
+}
+
+void DataGridSelectionChunk::compute()
+{
+    count = values.size();
+    if (count)
+    {
+        min = max = values[0];
+        for (std::vector<double>::const_iterator it = values.begin();
+            it != values.end(); ++it)
+        {
+            sum += *it;
+            if (*it < min)
+                min = *it;
+            if (*it > max)
+                max = *it;
+        }
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()),
+            values.end());
+        distinct.assign(values.begin(), values.end());
+    }
+    std::vector<double>().swap(values);
+    computed = true;
+}
+
+// DataGridAggregates class
+DataGridAggregates::DataGridAggregates()
+    : countM(0), sumM(0), minM(0), maxM(0)
+{
+}
+
+void DataGridAggregates::add(const DataGridSelectionChunkPtr& chunk)
+{
+    if (!chunk->count)
+        return;
+    if (!countM || chunk->min < minM)
+        minM = chunk->min;
+    if (!countM || chunk->max > maxM)
+        maxM = chunk->max;
+    countM += chunk->count;
+    sumM += chunk->sum;
+    chunksM.push_back(chunk);
+}
+
+unsigned DataGridAggregates::getCount() const
+{
+    return countM;
+}
+
+double DataGridAggregates::getSum() const
+{
+    return sumM;
+}
+
+double DataGridAggregates::getMin() const
+{
+    return minM;
+}
+
+double DataGridAggregates::getMax() const
+{
+    return maxM;
+}
+
+size_t DataGridAggregates::countDistinct() const
+{
+    std::vector<std::vector<double> > merged;
+    for (size_t i = 0; i < chunksM.size(); i += 2)
+    {
+        const std::vector<double>& first = chunksM[i]->distinct;
+        merged.push_back(std::vector<double>());
+        if (i + 1 < chunksM.size())
+        {
+            const std::vector<double>& second = chunksM[i + 1]->distinct;
+            std::set_union(first.begin(), first.end(), second.begin(),
+                second.end(), std::back_inserter(merged.back()));
+        }
+        else
+            merged.back() = first;
+    }
+    while (merged.size() > 1)
+    {
+        std::vector<std::vector<double> > next;
+        for (size_t i = 0; i < merged.size(); i += 2)
+        {
+            next.push_back(std::vector<double>());
+            if (i + 1 < merged.size())
+            {
+                std::set_union(merged[i].begin(), merged[i].end(),
+                    merged[i + 1].begin(), merged[i + 1].end(),
+                    std::back_inserter(next.back()));
+            }
+            else
+                next.back().swap(merged[i]);
+        }
+        merged.swap(next);
+    }
+    return merged.empty() ? 0 : merged[0].size();
+}
@@ -0,0 +1,77 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_DATAGRIDAGGREGATES_H
+#define FR_DATAGRIDAGGREGATES_H
+
+#include <memory>
+#include <vector>
+
+// values of the selected cells of a numeric column, in a part of a range of
+// selected rows. The ranges are split at multiples of chunkRows, so that
+// most chunks are unchanged when the selection is changed or extended
+struct DataGridSelectionChunk
+{
+    enum { chunkRows = 4096 };
+    // the non-null values, read by the main thread
+    std::vector<double> values;
+    // computed by the aggregate thread, which releases the values then
+    bool computed;
+    unsigned count;
+    double sum;
+    double min;
+    double max;
+    // sorted, without duplicates
+    std::vector<double> distinct;
+
+    DataGridSelectionChunk();
+    void compute();
+};
+
+typedef std::shared_ptr<DataGridSelectionChunk> DataGridSelectionChunkPtr;
+
+// DataGridAggregates class: the aggregates of all selected cells, merged
+// from those of the computed chunks of the selection
+class DataGridAggregates
+{
+private:
+    unsigned countM;
+    double sumM;
+    double minM;
+    double maxM;
+    // the chunks with values, for countDistinct()
+    std::vector<DataGridSelectionChunkPtr> chunksM;
+public:
+    DataGridAggregates();
+
+    void add(const DataGridSelectionChunkPtr& chunk);
+    unsigned getCount() const;
+    double getSum() const;
+    double getMin() const;
+    double getMax() const;
+    // merges the distinct values of the chunks pairwise, so that the values
+    // are compared O(log(chunks)) times instead of sorting all of them again
+    size_t countDistinct() const;
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include "gui/controls/DataGridFetchQueue.h"
+#include "gui/controls/DataGridRowBuffer.h"
+
+DataGridFetchQueue::DataGridFetchQueue()
+    : headM(0), tailM(0)
+{
+}
+
+DataGridFetchQueue::~DataGridFetchQueue()
+{
+    while (DataGridColumnStore* rows = pop())
+        delete rows;
+}
+
+bool DataGridFetchQueue::push(DataGridColumnStore* rows)
+{
+    unsigned tail = tailM.load(std::memory_order_relaxed);
+    if (tail - headM.load(std::memory_order_acquire) == capacity)
+        return false;
+    rowsM[tail % capacity] = rows;
+    tailM.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+DataGridColumnStore* DataGridFetchQueue::pop()
+{
+    unsigned head = headM.load(std::memory_order_relaxed);
+    if (head == tailM.load(std::memory_order_acquire))
+        return 0;
+    DataGridColumnStore* rows = rowsM[head % capacity];
+    headM.store(head + 1, std::memory_order_release);
+    return rows;
+}
+
+bool DataGridFetchQueue::canPop()
+{
+    return headM.load(std::memory_order_relaxed)
+        != tailM.load(std::memory_order_acquire);
+}
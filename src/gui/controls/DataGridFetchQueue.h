@@ -0,0 +1,52 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_DATAGRIDFETCHQUEUE_H
+#define FR_DATAGRIDFETCHQUEUE_H
+
+#include <atomic>
+
+class DataGridColumnStore;
+
+// DataGridFetchQueue: bounded single-producer single-consumer queue that
+// passes blocks of fetched rows from the fetch thread to the main thread
+// without locking
+class DataGridFetchQueue
+{
+private:
+    enum { capacity = 16 };
+    DataGridColumnStore* rowsM[capacity];
+    std::atomic<unsigned> headM;
+    std::atomic<unsigned> tailM;
+public:
+    DataGridFetchQueue();
+    ~DataGridFetchQueue();
+
+    // returns false if the queue is full, ownership is transferred otherwise
+    bool push(DataGridColumnStore* rows);
+    // returns 0 if the queue is empty, caller takes ownership otherwise
+    DataGridColumnStore* pop();
+    bool canPop();
+};
+
+#endif
@@ -0,0 +1,249 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "gui/controls/DataGridGroups.h"
+#include "gui/controls/DataGridSort.h"
+
+namespace
+{
+
+struct GroupKey
+{
+    const char* data;
+    size_t length;
+};
+
+struct GroupKeyHash
+{
+    size_t operator()(const GroupKey& key) const
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < key.length; ++i)
+        {
+            hash ^= (unsigned char)key.data[i];
+            hash *= 1099511628211ULL;
+        }
+        return size_t(hash);
+    }
+};
+
+struct GroupKeyEqual
+{
+    bool operator()(const GroupKey& left, const GroupKey& right) const
+    {
+        return left.length == right.length
+            && memcmp(left.data, right.data, left.length) == 0;
+    }
+};
+
+typedef std::unordered_map<GroupKey, DataGridGroups::Group, GroupKeyHash,
+    GroupKeyEqual> GroupMap;
+
+void aggregateGroups(const DataGridGroupInput* input, size_t first,
+    size_t last, GroupMap* groups)
+{
+    const unsigned aggregateCount = input->aggregateCount;
+    for (size_t i = first; i < last; ++i)
+    {
+        GroupKey key;
+        key.data = &input->keys[0] + input->keyOffsets[i];
+        key.length = input->keyOffsets[i + 1] - input->keyOffsets[i];
+        std::pair<GroupMap::iterator, bool> inserted =
+            groups->insert(std::make_pair(key, DataGridGroups::Group()));
+        DataGridGroups::Group& group = (*inserted.first).second;
+        if (inserted.second)
+        {
+            group.row = i;
+            group.position = input->positions[i];
+            group.rowCount = 0;
+            group.aggregates.resize(aggregateCount);
+        }
+        else if (input->positions[i] < group.position)
+        {
+            group.row = i;
+            group.position = input->positions[i];
+        }
+        ++group.rowCount;
+        for (unsigned a = 0; a < aggregateCount; ++a)
+        {
+            size_t index = i * aggregateCount + a;
+            if (!input->nulls[index])
+                group.aggregates[a].add(input->values[index]);
+        }
+    }
+}
+
+void mergeGroups(GroupMap& groups, const GroupMap& other)
+{
+    for (GroupMap::const_iterator it = other.begin(); it != other.end(); ++it)
+    {
+        std::pair<GroupMap::iterator, bool> inserted =
+            groups.insert(*it);
+        if (inserted.second)
+            continue;
+        DataGridGroups::Group& group = (*inserted.first).second;
+        const DataGridGroups::Group& otherGroup = (*it).second;
+        if (otherGroup.position < group.position)
+        {
+            group.row = otherGroup.row;
+            group.position = otherGroup.position;
+        }
+        group.rowCount += otherGroup.rowCount;
+        for (size_t a = 0; a < group.aggregates.size(); ++a)
+            group.aggregates[a].add(otherGroup.aggregates[a]);
+    }
+}
+
+bool compareGroupPositions(const DataGridGroups::Group& left,
+    const DataGridGroups::Group& right)
+{
+    return left.position < right.position;
+}
+
+} // namespace
+
+// DataGridGroupInput struct
+size_t DataGridGroupInput::getRowCount() const
+{
+    return storeRows.size();
+}
+
+// DataGridGroups class
+DataGridGroups::Aggregate::Aggregate()
+    : count(0), sum(0), min(0), max(0)
+{
+}
+
+void DataGridGroups::Aggregate::add(double value)
+{
+    if (!count || value < min)
+        min = value;
+    if (!count || value > max)
+        max = value;
+    sum += value;
+    ++count;
+}
+
+void DataGridGroups::Aggregate::add(const Aggregate& other)
+{
+    if (!other.count)
+        return;
+    if (!count || other.min < min)
+        min = other.min;
+    if (!count || other.max > max)
+        max = other.max;
+    sum += other.sum;
+    count += other.count;
+}
+
+void DataGridGroups::compute(const DataGridGroupInput& input,
+    size_t threadCount)
+{
+    // for fewer rows per thread starting the threads doesn't pay off
+    const size_t minRowsPerThread = 64 * 1024;
+    const size_t inputRows = input.getRowCount();
+    size_t parts = std::max(size_t(1),
+        std::min(threadCount, inputRows / minRowsPerThread));
+    std::vector<GroupMap> partGroups(parts);
+    std::vector<std::thread> threads;
+    for (size_t part = 1; part < parts; ++part)
+    {
+        threads.push_back(std::thread(aggregateGroups, &input,
+            inputRows * part / parts, inputRows * (part + 1) / parts,
+            &partGroups[part]));
+    }
+    aggregateGroups(&input, 0, inputRows / parts, &partGroups[0]);
+    joinThreads(threads);
+    for (size_t part = 1; part < parts; ++part)
+        mergeGroups(partGroups[0], partGroups[part]);
+
+    groupsM.clear();
+    groupsM.reserve(partGroups[0].size());
+    for (GroupMap::iterator it = partGroups[0].begin();
+        it != partGroups[0].end(); ++it)
+    {
+        groupsM.push_back(Group());
+        groupsM.back().row = (*it).second.row;
+        groupsM.back().position = (*it).second.position;
+        groupsM.back().rowCount = (*it).second.rowCount;
+        groupsM.back().aggregates.swap((*it).second.aggregates);
+    }
+    std::sort(groupsM.begin(), groupsM.end(), compareGroupPositions);
+
+    // the result rows and the pivot values, in the order first shown
+    std::map<std::string, size_t> resultRows, pivotValues;
+    resultRowsM.clear();
+    pivotRowsM.clear();
+    for (std::vector<Group>::iterator it = groupsM.begin();
+        it != groupsM.end(); ++it)
+    {
+        size_t row = (*it).row;
+        const char* key = &input.keys[0];
+        std::string groupKey(key + input.keyOffsets[row],
+            key + input.pivotOffsets[row]);
+        std::string pivotKey(key + input.pivotOffsets[row],
+            key + input.keyOffsets[row + 1]);
+        std::pair<std::map<std::string, size_t>::iterator, bool> inserted =
+            resultRows.insert(std::make_pair(groupKey, resultRowsM.size()));
+        if (inserted.second)
+            resultRowsM.push_back(row);
+        (*it).resultRow = (*inserted.first).second;
+        inserted = pivotValues.insert(
+            std::make_pair(pivotKey, pivotRowsM.size()));
+        if (inserted.second)
+            pivotRowsM.push_back(row);
+        (*it).pivot = (*inserted.first).second;
+    }
+}
+
+const std::vector<DataGridGroups::Group>& DataGridGroups::getGroups() const
+{
+    return groupsM;
+}
+
+const std::vector<size_t>& DataGridGroups::getResultRows() const
+{
+    return resultRowsM;
+}
+
+const std::vector<size_t>& DataGridGroups::getPivotRows() const
+{
+    return pivotRowsM;
+}
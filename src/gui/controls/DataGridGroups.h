@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_DATAGRIDGROUPS_H
+#define FR_DATAGRIDGROUPS_H
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// the grouped rows are read once by the main thread, the keys of a row are
+// the raw values of its group columns followed by those of the pivot column
+struct DataGridGroupInput
+{
+    unsigned aggregateCount;
+    std::vector<char> keys;
+    // rows + 1 offsets into keys, and the offsets of the pivot values
+    std::vector<size_t> keyOffsets;
+    std::vector<size_t> pivotOffsets;
+    std::vector<unsigned> storeRows;
+    std::vector<unsigned> positions;
+    // aggregateCount values for every row
+    std::vector<double> values;
+    std::vector<char> nulls;
+
+    size_t getRowCount() const;
+};
+
+// DataGridGroups class: aggregates the input rows by their keys, on all
+// processors (or the given number of threads) into separate hash maps which
+// are merged. The groups are laid out as the rows and the pivot columns of
+// the result, both in the order they are first shown
+class DataGridGroups
+{
+public:
+    struct Aggregate
+    {
+        unsigned count;
+        double sum;
+        double min;
+        double max;
+
+        Aggregate();
+        void add(double value);
+        void add(const Aggregate& other);
+    };
+    struct Group
+    {
+        // the input row shown first
+        size_t row;
+        unsigned position;
+        unsigned rowCount;
+        std::vector<Aggregate> aggregates;
+        // the result row and the pivot value of the group
+        size_t resultRow;
+        size_t pivot;
+    };
+private:
+    std::vector<Group> groupsM;
+    // the input rows shown first of the result rows and pivot values
+    std::vector<size_t> resultRowsM;
+    std::vector<size_t> pivotRowsM;
+public:
+    // input must have at least one byte of keys after the last row
+    void compute(const DataGridGroupInput& input,
+        size_t threadCount = std::thread::hardware_concurrency());
+
+    // in the order they are first shown
+    const std::vector<Group>& getGroups() const;
+    const std::vector<size_t>& getResultRows() const;
+    const std::vector<size_t>& getPivotRows() const;
+};
+
+#endif
@@ -30,265 +30,1379 @@
     #include "wx/wx.h"
 #endif
 
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#ifdef __WINDOWS__
+    #include <io.h>
+    #include <wx/msw/wrapwin.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+#include "core/FRError.h"
 #include "gui/controls/DataGridRowBuffer.h"
 
-DataGridRowBuffer::DataGridRowBuffer(unsigned fieldCount)
+// size of the arena blocks for variable-length data, larger values get
+// a block of their own; the first blocks are smaller, so that stores with
+// few rows don't waste memory
+static const unsigned arenaBlockSize = 256 * 1024;
+static const unsigned arenaMinBlockSize = 16 * 1024;
+
+// number of rows in a page of DataGridPagedStore
+static const unsigned pageRows = 4096;
+// number of pages kept in memory regardless of the memory limit
+static const unsigned minResidentPages = 4;
+
+// helper functions to save and load the field data of a store
+static void writeData(std::vector<char>& data, const void* value,
+    size_t length)
 {
-    isModifiedM = 0;
-    isDeletedM = 0;
-    isDeletableIsSetM = 0;
-    isDeletableM = 0;
-    // initialize with field count, all fields initially NULL
-    // there's no need to preallocate the uint8 buffer or string array
-    DataGridRowBufferFieldAttr initValue;
-    initValue.isStringLoaded = false;
-    initValue.isNull = true;
-    fieldAttrM.resize(fieldCount, initValue);
+    const char* p = static_cast<const char*>(value);
+    data.insert(data.end(), p, p + length);
 }
 
-DataGridRowBuffer::DataGridRowBuffer(const DataGridRowBuffer* other)
+static void writeUInt(std::vector<char>& data, uint32_t value)
 {
-    fieldAttrM = other->fieldAttrM;
-    dataM = other->dataM;
-    stringsM = other->stringsM;
-    blobsM = other->blobsM;
+    writeData(data, &value, sizeof(value));
+}
 
-    isModifiedM = other->isModifiedM;
-    isDeletedM = other->isDeletedM;
-    isDeletableIsSetM = other->isDeletableIsSetM;
-    isDeletableM = other->isDeletableM;
+static void writeBits(std::vector<char>& data, const std::vector<bool>& bits)
+{
+    writeUInt(data, bits.size());
+    uint8_t b = 0;
+    for (size_t i = 0; i < bits.size(); ++i)
+    {
+        if (bits[i])
+            b |= uint8_t(1 << (i % 8));
+        if (i % 8 == 7)
+        {
+            data.push_back(b);
+            b = 0;
+        }
+    }
+    if (bits.size() % 8)
+        data.push_back(b);
 }
 
-wxString DataGridRowBuffer::getString(unsigned index)
+class DataReader
 {
-    if (index >= stringsM.size())
-        return wxEmptyString;
-    return stringsM[index];
+private:
+    const char* posM;
+    const char* endM;
+public:
+    DataReader(const char* data, size_t length)
+        : posM(data), endM(data + length) {}
+
+    const char* read(size_t length)
+    {
+        if (length > size_t(endM - posM))
+            throw FRError(_("Invalid data in temporary file of data grid."));
+        const char* p = posM;
+        posM += length;
+        return p;
+    }
+
+    uint32_t readUInt()
+    {
+        uint32_t value;
+        memcpy(&value, read(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    void readBits(std::vector<bool>& bits)
+    {
+        unsigned count = readUInt();
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(
+            read((count + 7) / 8));
+        bits.resize(count);
+        for (unsigned i = 0; i < count; ++i)
+            bits[i] = (p[i / 8] & (1 << (i % 8))) != 0;
+    }
+};
+
+// DataGridSpillFile class: temporary file for the pages of a paged store
+// that have been released from memory, the pages are only ever appended
+class DataGridSpillFile
+{
+private:
+    wxString fileNameM;
+    wxFile fileM;
+    wxFileOffset sizeM;
+public:
+    DataGridSpillFile();
+    ~DataGridSpillFile();
+
+    bool write(const std::vector<char>& data, wxFileOffset& offset);
+    void read(wxFileOffset offset, size_t length, DataGridColumnStore& store);
+};
+
+DataGridSpillFile::DataGridSpillFile()
+    : sizeM(0)
+{
+    fileNameM = wxFileName::CreateTempFileName("frgrid");
+    if (!fileNameM.empty())
+        fileM.Open(fileNameM, wxFile::read_write);
 }
 
-IBPP::Blob* DataGridRowBuffer::getBlob(unsigned index)
+DataGridSpillFile::~DataGridSpillFile()
 {
-    if (index >= blobsM.size())
-        return 0;
-    return &(blobsM[index]);
+    if (fileM.IsOpened())
+        fileM.Close();
+    if (!fileNameM.empty())
+        wxRemoveFile(fileNameM);
 }
 
-bool DataGridRowBuffer::getValue(unsigned offset, double& value)
+// returns false if the data couldn't be written (disk full...)
+bool DataGridSpillFile::write(const std::vector<char>& data,
+    wxFileOffset& offset)
 {
-    if (offset + sizeof(double) > dataM.size())
+    if (!fileM.IsOpened() || data.empty())
         return false;
-    value = *((double*)&dataM[offset]);
+    if (fileM.Seek(sizeM) == wxInvalidOffset
+        || fileM.Write(&data[0], data.size()) != data.size())
+    {
+        return false;
+    }
+    offset = sizeM;
+    sizeM += data.size();
     return true;
 }
 
-bool DataGridRowBuffer::getValue(unsigned offset, float& value)
+// maps the page into memory to load it into the store, reads it if that
+// isn't possible
+void DataGridSpillFile::read(wxFileOffset offset, size_t length,
+    DataGridColumnStore& store)
+{
+    wxASSERT(fileM.IsOpened() && offset + wxFileOffset(length) <= sizeM);
+#ifdef __WINDOWS__
+    SYSTEM_INFO si;
+    ::GetSystemInfo(&si);
+    wxFileOffset start = offset - offset % si.dwAllocationGranularity;
+    size_t delta = size_t(offset - start);
+    HANDLE mapping = ::CreateFileMapping(
+        (HANDLE)_get_osfhandle(fileM.fd()), 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping)
+    {
+        void* view = ::MapViewOfFile(mapping, FILE_MAP_READ,
+            DWORD(start >> 32), DWORD(start & 0xFFFFFFFF), length + delta);
+        ::CloseHandle(mapping);
+        if (view)
+        {
+            try
+            {
+                store.loadData(static_cast<char*>(view) + delta, length);
+            }
+            catch (...)
+            {
+                ::UnmapViewOfFile(view);
+                throw;
+            }
+            ::UnmapViewOfFile(view);
+            return;
+        }
+    }
+#else
+    wxFileOffset start = offset - offset % sysconf(_SC_PAGESIZE);
+    size_t delta = size_t(offset - start);
+    void* view = mmap(0, length + delta, PROT_READ, MAP_PRIVATE, fileM.fd(),
+        start);
+    if (view != MAP_FAILED)
+    {
+        try
+        {
+            store.loadData(static_cast<char*>(view) + delta, length);
+        }
+        catch (...)
+        {
+            munmap(view, length + delta);
+            throw;
+        }
+        munmap(view, length + delta);
+        return;
+    }
+#endif
+    std::vector<char> data(length);
+    if (fileM.Seek(offset) == wxInvalidOffset
+        || fileM.Read(&data[0], length) != ssize_t(length))
+    {
+        throw FRError(_("Could not read temporary file of data grid."));
+    }
+    store.loadData(&data[0], length);
+}
+
+// DataGridColumnStore class
+DataGridColumnStore::DataGridColumnStore()
+    : currentBlockM(unsigned(-1)), blockUsedM(0), blockSizeM(0),
+        blockBytesM(0), changeCountM(0)
+{
+}
+
+DataGridColumnStore::~DataGridColumnStore()
+{
+    clear();
+}
+
+void DataGridColumnStore::addColumn(unsigned fixedSize)
+{
+    columnsM.push_back(ColumnData());
+    ColumnData& cd = columnsM.back();
+    cd.fixedSize = fixedSize;
+    cd.nullM.resize(rowFlagsM.size(), true);
+    ++changeCountM;
+}
+
+void DataGridColumnStore::freeBlocks()
+{
+    for (std::vector<char*>::iterator it = blocksM.begin();
+        it != blocksM.end(); ++it)
+    {
+        delete[] *it;
+    }
+    blocksM.clear();
+    currentBlockM = unsigned(-1);
+    blockUsedM = 0;
+    blockSizeM = 0;
+    blockBytesM = 0;
+}
+
+void DataGridColumnStore::clear()
+{
+    freeBlocks();
+    columnsM.clear();
+    rowFlagsM.clear();
+    ++changeCountM;
+}
+
+unsigned DataGridColumnStore::getColumnCount() const
+{
+    return columnsM.size();
+}
+
+unsigned DataGridColumnStore::getRowCount() const
+{
+    return rowFlagsM.size();
+}
+
+unsigned DataGridColumnStore::appendRow()
+{
+    // only the flags are stored for every row, all other data is added
+    // when the fields are set
+    for (std::vector<ColumnData>::iterator it = columnsM.begin();
+        it != columnsM.end(); ++it)
+    {
+        (*it).nullM.push_back(true);
+    }
+    rowFlagsM.push_back(0);
+    ++changeCountM;
+    return rowFlagsM.size() - 1;
+}
+
+void DataGridColumnStore::removeLastRow()
+{
+    if (rowFlagsM.empty())
+        return;
+    unsigned row = rowFlagsM.size() - 1;
+    for (std::vector<ColumnData>::iterator it = columnsM.begin();
+        it != columnsM.end(); ++it)
+    {
+        ColumnData& cd = *it;
+        if (cd.fixedM.size() > row * cd.fixedSize)
+            cd.fixedM.resize(row * cd.fixedSize);
+        if (cd.varM.size() > row)
+            cd.varM.resize(row);
+        if (cd.blobsM.size() > row)
+            cd.blobsM.resize(row);
+        if (cd.nullM.size() > row)
+            cd.nullM.resize(row);
+        if (cd.naM.size() > row)
+            cd.naM.resize(row);
+        if (cd.loadedM.size() > row)
+            cd.loadedM.resize(row);
+    }
+    rowFlagsM.pop_back();
+    ++changeCountM;
+}
+
+void DataGridColumnStore::copyRow(const DataGridColumnStore& source,
+    unsigned sourceRow, unsigned row)
+{
+    wxASSERT(sourceRow < source.getRowCount() && row < getRowCount());
+    while (columnsM.size() < source.columnsM.size())
+        addColumn(0);
+
+    for (unsigned col = 0; col < source.columnsM.size(); ++col)
+    {
+        const ColumnData& src = source.columnsM[col];
+        ColumnData& dest = columnsM[col];
+
+        if (src.fixedSize
+            && src.fixedM.size() >= (sourceRow + 1) * src.fixedSize)
+        {
+            if (!dest.fixedSize)
+                dest.fixedSize = src.fixedSize;
+            wxASSERT(dest.fixedSize == src.fixedSize);
+            if (dest.fixedM.size() < (row + 1) * dest.fixedSize)
+                dest.fixedM.resize((row + 1) * dest.fixedSize, 0);
+            memcpy(&dest.fixedM[row * dest.fixedSize],
+                &src.fixedM[sourceRow * src.fixedSize], src.fixedSize);
+        }
+
+        const char* data;
+        unsigned length;
+        if (source.getBytes(sourceRow, col, data, length))
+            setBytes(row, col, data, length);
+        else if (row < dest.varM.size())
+            dest.varM[row].block = uint32_t(-1);
+
+        if (sourceRow < src.blobsM.size())
+            setBlob(row, col, src.blobsM[sourceRow]);
+        else if (row < dest.blobsM.size())
+            dest.blobsM[row].clear();
+
+        setFieldNull(row, col, source.isFieldNull(sourceRow, col));
+        setFieldNA(row, col, source.isFieldNA(sourceRow, col));
+        setLoaded(row, col, source.isLoaded(sourceRow, col));
+    }
+    rowFlagsM[row] = source.rowFlagsM[sourceRow];
+    ++changeCountM;
+}
+
+unsigned DataGridColumnStore::getChangeCount() const
+{
+    return changeCountM;
+}
+
+size_t DataGridColumnStore::getMemoryUsage() const
+{
+    // BLOB handles are not counted, as they can't be released anyway
+    size_t usage = blockBytesM + rowFlagsM.capacity();
+    for (std::vector<ColumnData>::const_iterator it = columnsM.begin();
+        it != columnsM.end(); ++it)
+    {
+        const ColumnData& cd = *it;
+        usage += cd.fixedM.capacity() + cd.varM.capacity() * sizeof(VarData)
+            + (cd.nullM.capacity() + cd.naM.capacity()
+                + cd.loadedM.capacity()) / 8;
+    }
+    return usage;
+}
+
+void DataGridColumnStore::saveData(std::vector<char>& data) const
+{
+    data.clear();
+    data.reserve(getMemoryUsage() + 64);
+    writeUInt(data, rowFlagsM.size());
+    writeUInt(data, columnsM.size());
+    if (!rowFlagsM.empty())
+        writeData(data, &rowFlagsM[0], rowFlagsM.size());
+    for (std::vector<ColumnData>::const_iterator it = columnsM.begin();
+        it != columnsM.end(); ++it)
+    {
+        const ColumnData& cd = *it;
+        writeUInt(data, cd.fixedSize);
+        writeUInt(data, cd.fixedM.size());
+        if (!cd.fixedM.empty())
+            writeData(data, &cd.fixedM[0], cd.fixedM.size());
+        writeUInt(data, cd.varM.size());
+        for (std::vector<VarData>::const_iterator itv = cd.varM.begin();
+            itv != cd.varM.end(); ++itv)
+        {
+            if ((*itv).block >= blocksM.size())
+                writeUInt(data, uint32_t(-1));
+            else
+            {
+                writeUInt(data, (*itv).length);
+                writeData(data, blocksM[(*itv).block] + (*itv).offset,
+                    (*itv).length);
+            }
+        }
+        writeBits(data, cd.nullM);
+        writeBits(data, cd.naM);
+        writeBits(data, cd.loadedM);
+    }
+}
+
+// restores the data written by saveData(), the BLOB handles are kept
+void DataGridColumnStore::loadData(const char* data, size_t length)
+{
+    DataReader reader(data, length);
+    unsigned rows = reader.readUInt();
+    if (reader.readUInt() != columnsM.size())
+        throw FRError(_("Invalid data in temporary file of data grid."));
+
+    freeBlocks();
+    const char* flags = reader.read(rows);
+    rowFlagsM.assign(flags, flags + rows);
+    for (std::vector<ColumnData>::iterator it = columnsM.begin();
+        it != columnsM.end(); ++it)
+    {
+        ColumnData& cd = *it;
+        cd.fixedSize = reader.readUInt();
+        unsigned size = reader.readUInt();
+        const char* fixed = reader.read(size);
+        cd.fixedM.assign(fixed, fixed + size);
+        cd.varM.resize(reader.readUInt());
+        for (std::vector<VarData>::iterator itv = cd.varM.begin();
+            itv != cd.varM.end(); ++itv)
+        {
+            uint32_t len = reader.readUInt();
+            if (len == uint32_t(-1))
+            {
+                VarData none = { uint32_t(-1), 0, 0 };
+                *itv = none;
+            }
+            else
+                *itv = storeBytes(reader.read(len), len);
+        }
+        reader.readBits(cd.nullM);
+        reader.readBits(cd.naM);
+        reader.readBits(cd.loadedM);
+    }
+}
+
+void DataGridColumnStore::releaseData()
+{
+    freeBlocks();
+    for (std::vector<ColumnData>::iterator it = columnsM.begin();
+        it != columnsM.end(); ++it)
+    {
+        ColumnData& cd = *it;
+        std::vector<uint8_t>().swap(cd.fixedM);
+        std::vector<VarData>().swap(cd.varM);
+        std::vector<bool>().swap(cd.nullM);
+        std::vector<bool>().swap(cd.naM);
+        std::vector<bool>().swap(cd.loadedM);
+    }
+    std::vector<uint8_t>().swap(rowFlagsM);
+}
+
+template<typename T>
+bool DataGridColumnStore::getFixed(unsigned row, unsigned col, T& value) const
 {
-    if (offset + sizeof(float) > dataM.size())
+    if (col >= columnsM.size())
         return false;
-    value = *((float*)&dataM[offset]);
+    const ColumnData& cd = columnsM[col];
+    if (cd.fixedSize != sizeof(T)
+        || (row + 1) * sizeof(T) > cd.fixedM.size())
+    {
+        return false;
+    }
+    memcpy(&value, &cd.fixedM[row * sizeof(T)], sizeof(T));
     return true;
 }
 
-bool DataGridRowBuffer::getValue(unsigned offset, int& value)
+template<typename T>
+void DataGridColumnStore::setFixed(unsigned row, unsigned col, T value)
+{
+    if (col >= columnsM.size())
+        return;
+    ColumnData& cd = columnsM[col];
+    if (!cd.fixedSize)
+        cd.fixedSize = sizeof(T);
+    wxASSERT(cd.fixedSize == sizeof(T));
+    if ((row + 1) * sizeof(T) > cd.fixedM.size())
+    {
+        // grow in steps to avoid reallocating for every fetched row
+        if (cd.fixedM.size() == cd.fixedM.capacity())
+            cd.fixedM.reserve(2 * cd.fixedM.size() + 1024 * sizeof(T));
+        cd.fixedM.resize((row + 1) * sizeof(T), 0);
+    }
+    memcpy(&cd.fixedM[row * sizeof(T)], &value, sizeof(T));
+    ++changeCountM;
+}
+
+bool DataGridColumnStore::getValue(unsigned row, unsigned col,
+    double& value) const
+{
+    return getFixed(row, col, value);
+}
+
+bool DataGridColumnStore::getValue(unsigned row, unsigned col,
+    float& value) const
+{
+    return getFixed(row, col, value);
+}
+
+bool DataGridColumnStore::getValue(unsigned row, unsigned col,
+    int& value) const
+{
+    return getFixed(row, col, value);
+}
+
+bool DataGridColumnStore::getValue(unsigned row, unsigned col,
+    int64_t& value) const
+{
+    return getFixed(row, col, value);
+}
+
+void DataGridColumnStore::setValue(unsigned row, unsigned col, double value)
+{
+    setFixed(row, col, value);
+}
+
+void DataGridColumnStore::setValue(unsigned row, unsigned col, float value)
+{
+    setFixed(row, col, value);
+}
+
+void DataGridColumnStore::setValue(unsigned row, unsigned col, int value)
+{
+    setFixed(row, col, value);
+}
+
+void DataGridColumnStore::setValue(unsigned row, unsigned col, int64_t value)
+{
+    setFixed(row, col, value);
+}
+
+DataGridColumnStore::VarData DataGridColumnStore::storeBytes(
+    const char* data, unsigned length)
 {
-    if (offset + sizeof(int) > dataM.size())
+    VarData vd;
+    vd.length = length;
+    if (length > arenaBlockSize / 4)
+    {
+        // large values get a block of their own
+        blocksM.push_back(new char[length]);
+        memcpy(blocksM.back(), data, length);
+        blockBytesM += length;
+        vd.block = blocksM.size() - 1;
+        vd.offset = 0;
+        return vd;
+    }
+    if (currentBlockM >= blocksM.size() || blockUsedM + length > blockSizeM)
+    {
+        // block size doubles with the amount of data stored
+        blockSizeM = std::max(length, std::min(arenaBlockSize,
+            std::max(arenaMinBlockSize, unsigned(blockBytesM))));
+        blocksM.push_back(new char[blockSizeM]);
+        currentBlockM = blocksM.size() - 1;
+        blockUsedM = 0;
+        blockBytesM += blockSizeM;
+    }
+    vd.block = currentBlockM;
+    vd.offset = blockUsedM;
+    if (length)
+        memcpy(blocksM[currentBlockM] + blockUsedM, data, length);
+    blockUsedM += length;
+    return vd;
+}
+
+bool DataGridColumnStore::getBytes(unsigned row, unsigned col,
+    const char*& data, unsigned& length) const
+{
+    if (col >= columnsM.size() || row >= columnsM[col].varM.size())
+        return false;
+    const VarData& vd = columnsM[col].varM[row];
+    if (vd.block >= blocksM.size())
         return false;
-    value = *((int*)&dataM[offset]);
+    data = blocksM[vd.block] + vd.offset;
+    length = vd.length;
     return true;
 }
 
-bool DataGridRowBuffer::getValue(unsigned offset, int64_t& value)
+void DataGridColumnStore::setBytes(unsigned row, unsigned col,
+    const char* data, unsigned length)
+{
+    if (col >= columnsM.size())
+        return;
+    ColumnData& cd = columnsM[col];
+    if (row >= cd.varM.size())
+    {
+        VarData none = { uint32_t(-1), 0, 0 };
+        if (cd.varM.size() == cd.varM.capacity())
+            cd.varM.reserve(2 * cd.varM.size() + 1024);
+        cd.varM.resize(row + 1, none);
+    }
+    cd.varM[row] = storeBytes(data, length);
+    ++changeCountM;
+}
+
+wxString DataGridColumnStore::getString(unsigned row, unsigned col) const
+{
+    const char* data;
+    unsigned length;
+    if (!getBytes(row, col, data, length))
+        return wxEmptyString;
+    return wxString::FromUTF8(data, length);
+}
+
+void DataGridColumnStore::setString(unsigned row, unsigned col,
+    const wxString& value)
+{
+    wxScopedCharBuffer utf8(value.utf8_str());
+    setBytes(row, col, utf8.data(), utf8.length());
+}
+
+IBPP::Blob* DataGridColumnStore::getBlob(unsigned row, unsigned col)
+{
+    if (col >= columnsM.size() || row >= columnsM[col].blobsM.size())
+        return 0;
+    return &(columnsM[col].blobsM[row]);
+}
+
+void DataGridColumnStore::setBlob(unsigned row, unsigned col,
+    IBPP::Blob value)
+{
+    if (col >= columnsM.size())
+        return;
+    ColumnData& cd = columnsM[col];
+    if (row >= cd.blobsM.size())
+        cd.blobsM.resize(row + 1);
+    cd.blobsM[row] = value;
+    ++changeCountM;
+}
+
+bool DataGridColumnStore::isFieldNull(unsigned row, unsigned col) const
+{
+    return (col < columnsM.size() && row < columnsM[col].nullM.size()
+        && columnsM[col].nullM[row]);
+}
+
+void DataGridColumnStore::setFieldNull(unsigned row, unsigned col,
+    bool isNull)
+{
+    if (col < columnsM.size() && row < columnsM[col].nullM.size())
+    {
+        columnsM[col].nullM[row] = isNull;
+        ++changeCountM;
+    }
+}
+
+bool DataGridColumnStore::isFieldNA(unsigned row, unsigned col) const
+{
+    return (col < columnsM.size() && row < columnsM[col].naM.size()
+        && columnsM[col].naM[row]);
+}
+
+void DataGridColumnStore::setFieldNA(unsigned row, unsigned col, bool isNA)
+{
+    if (col >= columnsM.size())
+        return;
+    // N/A is only used for rows inserted by the user, so only allocate
+    // the bitmap when needed
+    std::vector<bool>& na = columnsM[col].naM;
+    if (row < na.size())
+        na[row] = isNA;
+    else if (isNA)
+    {
+        na.resize(row + 1, false);
+        na[row] = true;
+    }
+    ++changeCountM;
+}
+
+bool DataGridColumnStore::isLoaded(unsigned row, unsigned col) const
+{
+    return (col < columnsM.size() && row < columnsM[col].loadedM.size()
+        && columnsM[col].loadedM[row]);
+}
+
+void DataGridColumnStore::setLoaded(unsigned row, unsigned col,
+    bool isLoaded)
 {
-    if (offset + sizeof(int64_t) > dataM.size())
+    if (col >= columnsM.size())
+        return;
+    std::vector<bool>& loaded = columnsM[col].loadedM;
+    if (row < loaded.size())
+        loaded[row] = isLoaded;
+    else if (isLoaded)
+    {
+        loaded.resize(row + 1, false);
+        loaded[row] = true;
+    }
+    ++changeCountM;
+}
+
+void DataGridColumnStore::setRowFlag(unsigned row, uint8_t flag, bool value)
+{
+    if (row >= rowFlagsM.size())
+        return;
+    if (value)
+        rowFlagsM[row] |= flag;
+    else
+        rowFlagsM[row] &= ~flag;
+    ++changeCountM;
+}
+
+bool DataGridColumnStore::isRowInserted(unsigned row) const
+{
+    return row < rowFlagsM.size() && (rowFlagsM[row] & rfInserted);
+}
+
+void DataGridColumnStore::setRowInserted(unsigned row, bool value)
+{
+    setRowFlag(row, rfInserted, value);
+}
+
+bool DataGridColumnStore::isRowModified(unsigned row) const
+{
+    return row < rowFlagsM.size() && (rowFlagsM[row] & rfModified);
+}
+
+void DataGridColumnStore::setRowModified(unsigned row, bool value)
+{
+    setRowFlag(row, rfModified, value);
+}
+
+bool DataGridColumnStore::isRowDeleted(unsigned row) const
+{
+    return row < rowFlagsM.size() && (rowFlagsM[row] & rfDeleted);
+}
+
+void DataGridColumnStore::setRowDeleted(unsigned row, bool value)
+{
+    setRowFlag(row, rfDeleted, value);
+}
+
+bool DataGridColumnStore::isRowDeletableIsSet(unsigned row) const
+{
+    return row < rowFlagsM.size() && (rowFlagsM[row] & rfDeletableIsSet);
+}
+
+bool DataGridColumnStore::isRowDeletable(unsigned row) const
+{
+    return row < rowFlagsM.size() && (rowFlagsM[row] & rfDeletable);
+}
+
+void DataGridColumnStore::setRowDeletable(unsigned row, bool value)
+{
+    setRowFlag(row, rfDeletableIsSet, true);
+    setRowFlag(row, rfDeletable, value);
+}
+
+void DataGridColumnStore::invalidateRowDeletable(unsigned row)
+{
+    setRowFlag(row, rfDeletableIsSet | rfDeletable, false);
+}
+
+// DataGridPagedStore class
+DataGridPagedStore::DataGridPagedStore()
+    : rowCountM(0), memoryLimitM(0), useCounterM(0), spillFileM(0)
+{
+}
+
+DataGridPagedStore::~DataGridPagedStore()
+{
+    clear();
+}
+
+void DataGridPagedStore::setMemoryLimit(size_t bytes)
+{
+    memoryLimitM = bytes;
+    enforceMemoryLimit();
+}
+
+void DataGridPagedStore::addColumn(unsigned fixedSize)
+{
+    fixedSizesM.push_back(fixedSize);
+    for (std::vector<Page>::iterator it = pagesM.begin();
+        it != pagesM.end(); ++it)
+    {
+        (*it).store->addColumn(fixedSize);
+    }
+}
+
+void DataGridPagedStore::clear()
+{
+    for (std::vector<Page>::iterator it = pagesM.begin();
+        it != pagesM.end(); ++it)
+    {
+        delete (*it).store;
+    }
+    pagesM.clear();
+    fixedSizesM.clear();
+    rowCountM = 0;
+    delete spillFileM;
+    spillFileM = 0;
+}
+
+unsigned DataGridPagedStore::getColumnCount() const
+{
+    return fixedSizesM.size();
+}
+
+unsigned DataGridPagedStore::getRowCount() const
+{
+    return rowCountM;
+}
+
+void DataGridPagedStore::addPage()
+{
+    Page page;
+    page.store = new DataGridColumnStore();
+    for (std::vector<unsigned>::iterator it = fixedSizesM.begin();
+        it != fixedSizesM.end(); ++it)
+    {
+        page.store->addColumn(*it);
+    }
+    page.rowCount = 0;
+    page.missingCount = 0;
+    page.resident = true;
+    page.lastUse = ++useCounterM;
+    page.fileOffset = 0;
+    page.fileLength = 0;
+    page.savedChangeCount = 0;
+    page.pinCount = 0;
+    pagesM.push_back(page);
+    // the previous page is complete now and may be released
+    enforceMemoryLimit();
+}
+
+unsigned DataGridPagedStore::appendRow()
+{
+    if (pagesM.empty() || pagesM.back().rowCount == pageRows)
+        addPage();
+    Page& page = pagesM.back();
+    if (!page.resident)
+        loadPage(page);
+    fillPage(page);
+    page.store->appendRow();
+    ++page.rowCount;
+    if (!page.missing.empty())
+        page.missing.push_back(false);
+    return rowCountM++;
+}
+
+void DataGridPagedStore::removeLastRow()
+{
+    if (!rowCountM)
+        return;
+    unsigned pageRow;
+    Page& page = usePage(rowCountM - 1, pageRow);
+    page.store->removeLastRow();
+    --rowCountM;
+    if (!page.missing.empty())
+    {
+        if (page.missing.back())
+            --page.missingCount;
+        page.missing.pop_back();
+    }
+    if (--page.rowCount == 0)
+    {
+        delete page.store;
+        pagesM.pop_back();
+    }
+}
+
+void DataGridPagedStore::setRowCount(unsigned count)
+{
+    while (rowCountM < count)
+    {
+        if (pagesM.empty() || pagesM.back().rowCount == pageRows)
+            addPage();
+        Page& page = pagesM.back();
+        if (page.missing.empty())
+            page.missing.assign(page.rowCount, false);
+        unsigned rows = std::min(pageRows - page.rowCount, count - rowCountM);
+        page.missing.resize(page.rowCount + rows, true);
+        page.missingCount += rows;
+        page.rowCount += rows;
+        rowCountM += rows;
+    }
+}
+
+bool DataGridPagedStore::isRowMissing(unsigned row) const
+{
+    if (row >= rowCountM)
         return false;
-    value = *((int64_t*)&dataM[offset]);
+    const Page& page = pagesM[row / pageRows];
+    return !page.missing.empty() && page.missing[row % pageRows];
+}
+
+void DataGridPagedStore::setRowPresent(unsigned row)
+{
+    if (!isRowMissing(row))
+        return;
+    Page& page = pagesM[row / pageRows];
+    page.missing[row % pageRows] = false;
+    if (--page.missingCount == 0)
+        page.missing.clear();
+}
+
+bool DataGridPagedStore::findMissingRow(unsigned from, unsigned& row) const
+{
+    for (unsigned i = from / pageRows; i < pagesM.size(); ++i)
+    {
+        const Page& page = pagesM[i];
+        if (page.missing.empty())
+            continue;
+        unsigned pageRow = (i == from / pageRows) ? from % pageRows : 0;
+        for (; pageRow < page.rowCount; ++pageRow)
+        {
+            if (page.missing[pageRow])
+            {
+                row = i * pageRows + pageRow;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// the missing rows are only stored when the page is accessed
+void DataGridPagedStore::fillPage(Page& page)
+{
+    while (page.store->getRowCount() < page.rowCount)
+        page.store->appendRow();
+}
+
+DataGridPagedStore::Page& DataGridPagedStore::usePage(unsigned row,
+    unsigned& pageRow)
+{
+    wxASSERT(row < rowCountM);
+    Page& page = pagesM[row / pageRows];
+    pageRow = row % pageRows;
+    page.lastUse = ++useCounterM;
+    if (!page.resident)
+    {
+        loadPage(page);
+        enforceMemoryLimit();
+    }
+    fillPage(page);
+    return page;
+}
+
+DataGridColumnStore* DataGridPagedStore::getPage(unsigned row,
+    unsigned& pageRow)
+{
+    return usePage(row, pageRow).store;
+}
+
+DataGridColumnStore* DataGridPagedStore::pinPage(unsigned row,
+    unsigned& pageRow)
+{
+    Page& page = usePage(row, pageRow);
+    ++page.pinCount;
+    return page.store;
+}
+
+// the page may have been removed by removeLastRow() or clear() meanwhile
+void DataGridPagedStore::unpinPage(unsigned row)
+{
+    unsigned index = row / pageRows;
+    if (index < pagesM.size() && pagesM[index].pinCount)
+        --pagesM[index].pinCount;
+}
+
+unsigned DataGridPagedStore::getPageCount() const
+{
+    return pagesM.size();
+}
+
+unsigned DataGridPagedStore::getPageIndex(unsigned row) const
+{
+    return row / pageRows;
+}
+
+DataGridColumnStore* DataGridPagedStore::getPageByIndex(unsigned index,
+    unsigned& firstRow)
+{
+    wxASSERT(index < pagesM.size());
+    firstRow = index * pageRows;
+    unsigned pageRow;
+    return usePage(firstRow, pageRow).store;
+}
+
+// pages are released least recently used first, the minResidentPages
+// pages used last are never released
+unsigned DataGridPagedStore::getScanPageCount() const
+{
+    return memoryLimitM ? minResidentPages : pagesM.size();
+}
+
+void DataGridPagedStore::loadPage(Page& page)
+{
+    wxASSERT(!page.resident && spillFileM);
+    spillFileM->read(page.fileOffset, page.fileLength, *page.store);
+    page.resident = true;
+}
+
+// writes the page to the temporary file unless it is unchanged since it
+// was last written, returns false if that isn't possible
+bool DataGridPagedStore::releasePage(Page& page)
+{
+    wxASSERT(page.resident);
+    if (!page.fileLength
+        || page.store->getChangeCount() != page.savedChangeCount)
+    {
+        if (!spillFileM)
+            spillFileM = new DataGridSpillFile();
+        std::vector<char> data;
+        page.store->saveData(data);
+        if (!spillFileM->write(data, page.fileOffset))
+            return false;
+        page.fileLength = data.size();
+        page.savedChangeCount = page.store->getChangeCount();
+    }
+    page.store->releaseData();
+    page.resident = false;
     return true;
 }
 
-bool DataGridRowBuffer::getValue(unsigned offset, IBPP::DBKey& value,
-    unsigned size)
+// releases the least recently used pages until the memory used by the
+// remaining complete pages is below the limit, pinned pages and the last
+// getScanPageCount() pages used are skipped
+void DataGridPagedStore::enforceMemoryLimit()
 {
-    if (offset + size > dataM.size())
+    if (!memoryLimitM || pagesM.size() < 2)
+        return;
+    // pages used before the scan group can be released, pinned pages don't
+    // reduce its size
+    std::vector<uint64_t> uses;
+    for (size_t i = 0; i < pagesM.size(); ++i)
+    {
+        if (pagesM[i].resident && !pagesM[i].pinCount)
+            uses.push_back(pagesM[i].lastUse);
+    }
+    unsigned scanPages = getScanPageCount();
+    if (uses.size() <= scanPages)
+        return;
+    std::nth_element(uses.begin(), uses.begin() + (scanPages - 1),
+        uses.end(), std::greater<uint64_t>());
+    uint64_t scanStart = uses[scanPages - 1];
+
+    // the last page is still being filled and is never released
+    size_t completePages = pagesM.size() - 1;
+    size_t usage = 0;
+    for (size_t i = 0; i < completePages; ++i)
+    {
+        if (pagesM[i].resident)
+            usage += pagesM[i].store->getMemoryUsage();
+    }
+    while (usage > memoryLimitM)
+    {
+        Page* lru = 0;
+        for (size_t i = 0; i < completePages; ++i)
+        {
+            if (pagesM[i].resident && !pagesM[i].pinCount
+                && pagesM[i].lastUse < scanStart
+                && (!lru || pagesM[i].lastUse < lru->lastUse))
+            {
+                lru = &pagesM[i];
+            }
+        }
+        if (!lru)
+            return;
+        size_t pageUsage = lru->store->getMemoryUsage();
+        if (!releasePage(*lru))
+        {
+            // no temporary file can be used, so keep everything in memory
+            memoryLimitM = 0;
+            return;
+        }
+        usage -= pageUsage;
+    }
+}
+
+IBPP::Blob* DataGridPagedStore::getBlob(unsigned row, unsigned col)
+{
+    if (row >= rowCountM)
+        return 0;
+    unsigned pageRow;
+    return usePage(row, pageRow).store->getBlob(pageRow, col);
+}
+
+bool DataGridPagedStore::isFieldNull(unsigned row, unsigned col)
+{
+    if (row >= rowCountM)
         return false;
-    value.SetKey(&dataM[offset], size);
+    unsigned pageRow;
+    return usePage(row, pageRow).store->isFieldNull(pageRow, col);
+}
+
+bool DataGridPagedStore::isFieldNA(unsigned row, unsigned col)
+{
+    if (row >= rowCountM)
+        return false;
+    unsigned pageRow;
+    return usePage(row, pageRow).store->isFieldNA(pageRow, col);
+}
+
+bool DataGridPagedStore::isRowInserted(unsigned row)
+{
+    if (row >= rowCountM)
+        return false;
+    unsigned pageRow;
+    return usePage(row, pageRow).store->isRowInserted(pageRow);
+}
+
+bool DataGridPagedStore::isRowModified(unsigned row)
+{
+    if (row >= rowCountM)
+        return false;
+    unsigned pageRow;
+    return usePage(row, pageRow).store->isRowModified(pageRow);
+}
+
+bool DataGridPagedStore::isRowDeleted(unsigned row)
+{
+    if (row >= rowCountM)
+        return false;
+    unsigned pageRow;
+    return usePage(row, pageRow).store->isRowDeleted(pageRow);
+}
+
+void DataGridPagedStore::setRowDeleted(unsigned row, bool value)
+{
+    if (row >= rowCountM)
+        return;
+    unsigned pageRow;
+    usePage(row, pageRow).store->setRowDeleted(pageRow, value);
+}
+
+// DataGridRowBuffer class
+DataGridRowBuffer::DataGridRowBuffer(unsigned fieldCount)
+    : storeM(new DataGridColumnStore()), rowM(0), ownsStoreM(true),
+        pagedStoreM(0), pagedRowM(0)
+{
+    // initialize with field count, all fields initially NULL
+    // there's no need to preallocate the values
+    for (unsigned i = 0; i < fieldCount; ++i)
+        storeM->addColumn(0);
+    storeM->appendRow();
+}
+
+DataGridRowBuffer::DataGridRowBuffer(const DataGridRowBuffer* other)
+    : storeM(new DataGridColumnStore()), rowM(0), ownsStoreM(true),
+        pagedStoreM(0), pagedRowM(0)
+{
+    storeM->appendRow();
+    storeM->copyRow(*other->storeM, other->rowM, rowM);
+}
+
+DataGridRowBuffer::DataGridRowBuffer(DataGridColumnStore* store,
+        unsigned row)
+    : storeM(store), rowM(row), ownsStoreM(false), pagedStoreM(0),
+        pagedRowM(0)
+{
+    wxASSERT(store);
+}
+
+DataGridRowBuffer::DataGridRowBuffer(DataGridPagedStore* store,
+        unsigned row)
+    : storeM(0), rowM(0), ownsStoreM(false), pagedStoreM(store),
+        pagedRowM(row)
+{
+    wxASSERT(store);
+    storeM = store->pinPage(row, rowM);
+}
+
+DataGridRowBuffer::~DataGridRowBuffer()
+{
+    if (ownsStoreM)
+        delete storeM;
+    if (pagedStoreM)
+        pagedStoreM->unpinPage(pagedRowM);
+}
+
+void DataGridRowBuffer::copyFrom(const DataGridRowBuffer* other)
+{
+    wxASSERT(other);
+    storeM->copyRow(*other->storeM, other->rowM, rowM);
+}
+
+DataGridColumnStore* DataGridRowBuffer::getStore() const
+{
+    return storeM;
+}
+
+unsigned DataGridRowBuffer::getRow() const
+{
+    return rowM;
+}
+
+bool DataGridRowBuffer::getBytes(unsigned index, const char*& data,
+    unsigned& length)
+{
+    return storeM->getBytes(rowM, index, data, length);
+}
+
+wxString DataGridRowBuffer::getString(unsigned index)
+{
+    return storeM->getString(rowM, index);
+}
+
+IBPP::Blob* DataGridRowBuffer::getBlob(unsigned index)
+{
+    return storeM->getBlob(rowM, index);
+}
+
+bool DataGridRowBuffer::getValue(unsigned index, double& value)
+{
+    return storeM->getValue(rowM, index, value);
+}
+
+bool DataGridRowBuffer::getValue(unsigned index, float& value)
+{
+    return storeM->getValue(rowM, index, value);
+}
+
+bool DataGridRowBuffer::getValue(unsigned index, int& value)
+{
+    return storeM->getValue(rowM, index, value);
+}
+
+bool DataGridRowBuffer::getValue(unsigned index, int64_t& value)
+{
+    return storeM->getValue(rowM, index, value);
+}
+
+bool DataGridRowBuffer::getValue(unsigned index, IBPP::DBKey& value)
+{
+    const char* data;
+    unsigned length;
+    if (!storeM->getBytes(rowM, index, data, length) || !length)
+        return false;
+    value.SetKey(data, length);
     return true;
 }
 
-bool DataGridRowBuffer::isFieldNA(unsigned /*num*/)
+bool DataGridRowBuffer::isFieldNA(unsigned num)
 {
-    return false;
+    return storeM->isFieldNA(rowM, num);
 }
 
-void DataGridRowBuffer::setFieldNA(unsigned /* num */, bool /* isNA */)
+void DataGridRowBuffer::setFieldNA(unsigned num, bool isNA)
 {
-    // should never happen
+    storeM->setFieldNA(rowM, num, isNA);
     invalidateIsDeletable();
 }
 
 bool DataGridRowBuffer::isFieldNull(unsigned num)
 {
-    return (num < fieldAttrM.size() && fieldAttrM[num].isNull);
+    return storeM->isFieldNull(rowM, num);
 }
 
 void DataGridRowBuffer::setFieldNull(unsigned num, bool isNull)
 {
-    if (num < fieldAttrM.size())
-    {
-        fieldAttrM[num].isNull = isNull;
-        invalidateIsDeletable();
-    }
+    storeM->setFieldNull(rowM, num, isNull);
+    invalidateIsDeletable();
 }
 
 bool DataGridRowBuffer::isStringLoaded(unsigned num)
 {
-    return (num < fieldAttrM.size() && fieldAttrM[num].isStringLoaded);
+    return storeM->isLoaded(rowM, num);
 }
 
 void DataGridRowBuffer::setStringLoaded(unsigned num, bool isLoaded)
 {
-    if (num < fieldAttrM.size())
-    {
-        fieldAttrM[num].isStringLoaded = isLoaded;
-        invalidateIsDeletable();
-    }
+    storeM->setLoaded(rowM, num, isLoaded);
+    invalidateIsDeletable();
+}
+
+void DataGridRowBuffer::setBytes(unsigned num, const char* data,
+    unsigned length)
+{
+    storeM->setBytes(rowM, num, data, length);
+    invalidateIsDeletable();
 }
 
 void DataGridRowBuffer::setString(unsigned num, const wxString& value)
 {
-    if (num >= stringsM.size())
-        stringsM.resize(num + 1, wxEmptyString);
-    stringsM[num] = value;
-    fieldAttrM[num].isStringLoaded = true;
+    storeM->setString(rowM, num, value);
     invalidateIsDeletable();
 }
 
 void DataGridRowBuffer::setBlob(unsigned num, IBPP::Blob value)
 {
-    if (num >= blobsM.size())
-        blobsM.resize(num + 1);
-    blobsM[num] = value;
+    storeM->setBlob(rowM, num, value);
     invalidateIsDeletable();
 }
 
-void DataGridRowBuffer::setValue(unsigned offset, double value)
+void DataGridRowBuffer::setValue(unsigned index, double value)
 {
-    if (offset + sizeof(double) > dataM.size())
-        dataM.resize(offset + sizeof(double), 0);
-    *((double*)&dataM[offset]) = value;
+    storeM->setValue(rowM, index, value);
     invalidateIsDeletable();
 }
 
-void DataGridRowBuffer::setValue(unsigned offset, float value)
+void DataGridRowBuffer::setValue(unsigned index, float value)
 {
-    if (offset + sizeof(float) > dataM.size())
-        dataM.resize(offset + sizeof(float), 0);
-    *((float*)&dataM[offset]) = value;
+    storeM->setValue(rowM, index, value);
     invalidateIsDeletable();
 }
 
-void DataGridRowBuffer::setValue(unsigned offset, int value)
+void DataGridRowBuffer::setValue(unsigned index, int value)
 {
-    if (offset + sizeof(int) > dataM.size())
-        dataM.resize(offset + sizeof(int), 0);
-    *((int*)&dataM[offset]) = value;
+    storeM->setValue(rowM, index, value);
     invalidateIsDeletable();
 }
 
-void DataGridRowBuffer::setValue(unsigned offset, int64_t value)
+void DataGridRowBuffer::setValue(unsigned index, int64_t value)
 {
-    if (offset + sizeof(int64_t) > dataM.size())
-        dataM.resize(offset + sizeof(int64_t), 0);
-    *((int64_t*)&dataM[offset]) = value;
+    storeM->setValue(rowM, index, value);
     invalidateIsDeletable();
 }
 
-void DataGridRowBuffer::setValue(unsigned offset, IBPP::DBKey value)
+void DataGridRowBuffer::setValue(unsigned index, IBPP::DBKey value)
 {
-    if (offset + value.Size() > dataM.size())
-        dataM.resize(offset + value.Size(), 0);
-    value.GetKey(&dataM[offset], value.Size());
+    std::vector<char> key(value.Size());
+    if (!key.empty())
+        value.GetKey(&key[0], key.size());
+    storeM->setBytes(rowM, index, key.empty() ? 0 : &key[0], key.size());
     invalidateIsDeletable();
 }
 
 bool DataGridRowBuffer::isInserted()
 {
-    return false;
+    return storeM->isRowInserted(rowM);
 }
 
 bool DataGridRowBuffer::isFieldModified(unsigned /*num*/)
 {
     // TODO: maintain on a per-field basis
-    return isModifiedM != 0;
+    return storeM->isRowModified(rowM);
 }
 
 void DataGridRowBuffer::setIsModified(bool value)
 {
-    isModifiedM = (value) ? 1 : 0;
+    storeM->setRowModified(rowM, value);
 }
 
 void DataGridRowBuffer::invalidateIsDeletable()
 {
-    isDeletableIsSetM = 0;
-    isDeletableM = 0;
+    storeM->invalidateRowDeletable(rowM);
 }
 
 bool DataGridRowBuffer::isDeletable()
 {
-    wxASSERT(isDeletableIsSetM);
-    return isDeletableM != 0;
+    wxASSERT(storeM->isRowDeletableIsSet(rowM));
+    return storeM->isRowDeletable(rowM);
 }
 
 bool DataGridRowBuffer::isDeletableIsSet()
 {
-    return isDeletableIsSetM != 0;
+    return storeM->isRowDeletableIsSet(rowM);
 }
 
 void DataGridRowBuffer::setIsDeletable(bool value)
 {
-    isDeletableIsSetM = 1;
-    isDeletableM = value;
+    storeM->setRowDeletable(rowM, value);
 }
 
 bool DataGridRowBuffer::isDeleted()
 {
-    return isDeletedM != 0;
+    return storeM->isRowDeleted(rowM);
 }
 
 void DataGridRowBuffer::setIsDeleted(bool value)
 {
-    isDeletedM = (value) ? 1 : 0;
+    storeM->setRowDeleted(rowM, value);
 }
 
 InsertedGridRowBuffer::InsertedGridRowBuffer(unsigned fieldCount)
     :DataGridRowBuffer(fieldCount)
 {
+    getStore()->setRowInserted(getRow(), true);
 }
 
 InsertedGridRowBuffer::InsertedGridRowBuffer(const InsertedGridRowBuffer* b2)
     :DataGridRowBuffer(b2)
 {
-    naFieldsM = b2->naFieldsM;
-}
-
-bool InsertedGridRowBuffer::isInserted()
-{
-    return true;
 }
-
-bool InsertedGridRowBuffer::isFieldNA(unsigned num)
-{
-    return (num < naFieldsM.size() && naFieldsM[num]);
-}
-
-void InsertedGridRowBuffer::setFieldNA(unsigned num, bool isNA)
-{
-    if (num < naFieldsM.size())
-        naFieldsM[num] = isNA;
-    else if (isNA)  // we need to resize and set
-    {
-        naFieldsM.resize(num + 1, false);
-        naFieldsM[num] = true;
-    }
-    invalidateIsDeletable();
-}
-
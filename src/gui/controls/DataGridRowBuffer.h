@@ -24,64 +24,270 @@
 #ifndef FR_DATAGRIDROWBUFFER_H
 #define FR_DATAGRIDROWBUFFER_H
 
+#include <deque>
+#include <vector>
+
 #include <ibpp.h>
 
+// DataGridColumnStore class: keeps the field data of all rows of a result
+// set, one contiguous vector of fixed-size values per column, null and N/A
+// flags in bitmaps, and variable-length data (strings, DB keys) in an arena
+// of large memory blocks. No heap allocations are needed per row.
+class DataGridColumnStore
+{
+private:
+    // reference to variable-length data in the arena
+    struct VarData
+    {
+        uint32_t block;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct ColumnData
+    {
+        // size of a single value in fixedM, set on first use
+        unsigned fixedSize;
+        std::vector<uint8_t> fixedM;
+        std::vector<VarData> varM;
+        // deque since references to handles are passed out, and they
+        // must stay valid when more rows are added
+        std::deque<IBPP::Blob> blobsM;
+        std::vector<bool> nullM;
+        std::vector<bool> naM;
+        // variable-length data valid (used to cache BLOB contents)
+        std::vector<bool> loadedM;
+
+        ColumnData() : fixedSize(0) {}
+    };
+
+    enum RowFlags { rfInserted = 1, rfModified = 2, rfDeleted = 4,
+        rfDeletableIsSet = 8, rfDeletable = 16 };
+
+    std::vector<ColumnData> columnsM;
+    std::vector<uint8_t> rowFlagsM;
+    std::vector<char*> blocksM;
+    // arena block for small values, with its size and the bytes used
+    unsigned currentBlockM;
+    unsigned blockUsedM;
+    unsigned blockSizeM;
+    size_t blockBytesM;
+    unsigned changeCountM;
+
+    template<typename T>
+    bool getFixed(unsigned row, unsigned col, T& value) const;
+    template<typename T>
+    void setFixed(unsigned row, unsigned col, T value);
+    void setRowFlag(unsigned row, uint8_t flag, bool value);
+    VarData storeBytes(const char* data, unsigned length);
+    void freeBlocks();
+
+    // no copies, the arena blocks are owned by the store
+    DataGridColumnStore(const DataGridColumnStore&);
+    DataGridColumnStore& operator=(const DataGridColumnStore&);
+public:
+    DataGridColumnStore();
+    ~DataGridColumnStore();
+
+    // fixedSize can be 0 if unknown or for variable-length data
+    void addColumn(unsigned fixedSize);
+    void clear();
+    unsigned getColumnCount() const;
+    unsigned getRowCount() const;
+    // appends a row with all fields NULL, returns its index
+    unsigned appendRow();
+    void removeLastRow();
+    void copyRow(const DataGridColumnStore& source, unsigned sourceRow,
+        unsigned row);
+
+    // incremented by every modification, used to detect changed pages
+    unsigned getChangeCount() const;
+    // approximate memory used by the field data
+    size_t getMemoryUsage() const;
+    // all field data except the BLOB handles, which can't be saved and
+    // are therefore kept by releaseData()
+    void saveData(std::vector<char>& data) const;
+    void loadData(const char* data, size_t length);
+    void releaseData();
+
+    bool getValue(unsigned row, unsigned col, double& value) const;
+    bool getValue(unsigned row, unsigned col, float& value) const;
+    bool getValue(unsigned row, unsigned col, int& value) const;
+    bool getValue(unsigned row, unsigned col, int64_t& value) const;
+    void setValue(unsigned row, unsigned col, double value);
+    void setValue(unsigned row, unsigned col, float value);
+    void setValue(unsigned row, unsigned col, int value);
+    void setValue(unsigned row, unsigned col, int64_t value);
+
+    bool getBytes(unsigned row, unsigned col, const char*& data,
+        unsigned& length) const;
+    // the previous data is not freed before the store is cleared
+    void setBytes(unsigned row, unsigned col, const char* data,
+        unsigned length);
+    wxString getString(unsigned row, unsigned col) const;
+    void setString(unsigned row, unsigned col, const wxString& value);
+    IBPP::Blob* getBlob(unsigned row, unsigned col);
+    void setBlob(unsigned row, unsigned col, IBPP::Blob value);
+
+    bool isFieldNull(unsigned row, unsigned col) const;
+    void setFieldNull(unsigned row, unsigned col, bool isNull);
+    bool isFieldNA(unsigned row, unsigned col) const;
+    void setFieldNA(unsigned row, unsigned col, bool isNA);
+    bool isLoaded(unsigned row, unsigned col) const;
+    void setLoaded(unsigned row, unsigned col, bool isLoaded);
 
-struct DataGridRowBufferFieldAttr
-// use bits instead of bool here to save memory
+    bool isRowInserted(unsigned row) const;
+    void setRowInserted(unsigned row, bool value);
+    bool isRowModified(unsigned row) const;
+    void setRowModified(unsigned row, bool value);
+    bool isRowDeleted(unsigned row) const;
+    void setRowDeleted(unsigned row, bool value);
+    bool isRowDeletableIsSet(unsigned row) const;
+    bool isRowDeletable(unsigned row) const;
+    void setRowDeletable(unsigned row, bool value);
+    void invalidateRowDeletable(unsigned row);
+};
+
+class DataGridSpillFile;
+
+// DataGridPagedStore class: keeps the rows of a grid in pages with a fixed
+// number of rows each. When the memory limit is exceeded, the least
+// recently used pages are written to a temporary file and released, and
+// they are mapped back into memory when they are accessed again.
+// Rows can be added as missing (not yet fetched), they are stored when the
+// page is first accessed and are marked as present when set.
+class DataGridPagedStore
 {
-    // Field is null or not
-    int isNull:1; // accesed by indexM
-    // The buffer (stringsM) is loaded or not 
-    // ATT: isStringLoaded is used with stringsM (see below)
-    //      the size of stringsM can be less than fieldCount.
-    //      It is accesed by stringIndexM.
-    int isStringLoaded:1;  // accessed by stringIndexM !!
+private:
+    struct Page
+    {
+        DataGridColumnStore* store;
+        unsigned rowCount;
+        // empty if no rows of the page are missing
+        std::vector<bool> missing;
+        unsigned missingCount;
+        bool resident;
+        uint64_t lastUse;
+        // location in the temporary file, fileLength is 0 if not written
+        wxFileOffset fileOffset;
+        size_t fileLength;
+        unsigned savedChangeCount;
+        // pinned pages are kept in memory
+        unsigned pinCount;
+    };
+
+    std::vector<Page> pagesM;
+    std::vector<unsigned> fixedSizesM;
+    unsigned rowCountM;
+    size_t memoryLimitM;
+    uint64_t useCounterM;
+    DataGridSpillFile* spillFileM;
+
+    void addPage();
+    void fillPage(Page& page);
+    void loadPage(Page& page);
+    bool releasePage(Page& page);
+    void enforceMemoryLimit();
+    Page& usePage(unsigned row, unsigned& pageRow);
+
+    DataGridPagedStore(const DataGridPagedStore&);
+    DataGridPagedStore& operator=(const DataGridPagedStore&);
+public:
+    DataGridPagedStore();
+    ~DataGridPagedStore();
+
+    // limit for the memory used by all pages, 0 for no limit
+    void setMemoryLimit(size_t bytes);
+    void addColumn(unsigned fixedSize);
+    void clear();
+    unsigned getColumnCount() const;
+    unsigned getRowCount() const;
+    // appends a row with all fields NULL, returns its index
+    unsigned appendRow();
+    void removeLastRow();
+    // returns the page containing the row, and the index of the row in it
+    DataGridColumnStore* getPage(unsigned row, unsigned& pageRow);
+    // like getPage(), but the page isn't released before it is unpinned,
+    // for pointers to the page that are kept while other pages are used
+    DataGridColumnStore* pinPage(unsigned row, unsigned& pageRow);
+    void unpinPage(unsigned row);
+    // for scans over all rows the pages are used by their index, the last
+    // getScanPageCount() pages used stay in memory together
+    unsigned getPageCount() const;
+    unsigned getPageIndex(unsigned row) const;
+    DataGridColumnStore* getPageByIndex(unsigned index, unsigned& firstRow);
+    unsigned getScanPageCount() const;
+
+    // appends missing rows up to the given row count
+    void setRowCount(unsigned count);
+    bool isRowMissing(unsigned row) const;
+    void setRowPresent(unsigned row);
+    // returns false if no row from the given one on is missing
+    bool findMissingRow(unsigned from, unsigned& row) const;
+
+    IBPP::Blob* getBlob(unsigned row, unsigned col);
+    bool isFieldNull(unsigned row, unsigned col);
+    bool isFieldNA(unsigned row, unsigned col);
+    bool isRowInserted(unsigned row);
+    bool isRowModified(unsigned row);
+    bool isRowDeleted(unsigned row);
+    void setRowDeleted(unsigned row, bool value);
 };
 
-// DataGridRowBuffer class
+// DataGridRowBuffer class: access to the fields of a single row. The row
+// either lives in the column store of a grid, or in a private single-row
+// store (for rows being edited or inserted by the user).
 class DataGridRowBuffer
 {
 private:
-    // use bits instead of bool here to use less memory
-    int isModifiedM:1;
-    int isDeletedM:1;
-    int isDeletableIsSetM:1;
-    int isDeletableM:1;
+    DataGridColumnStore* storeM;
+    unsigned rowM;
+    bool ownsStoreM;
+    // the page of a paged store is pinned while the buffer exists
+    DataGridPagedStore* pagedStoreM;
+    unsigned pagedRowM;
+
+    // no assignment, use copyFrom() to copy field data
+    DataGridRowBuffer(const DataGridRowBuffer&);
+    DataGridRowBuffer& operator=(const DataGridRowBuffer&);
 protected:
-    std::vector<DataGridRowBufferFieldAttr> fieldAttrM;
-    std::vector<uint8_t> dataM;
-    std::vector<wxString> stringsM;
-    std::vector<IBPP::Blob> blobsM;
     void invalidateIsDeletable();
     void setIsModified(bool value);
 public:
     DataGridRowBuffer(unsigned fieldCount);
     DataGridRowBuffer(const DataGridRowBuffer* other);
-    virtual ~DataGridRowBuffer() {}
+    DataGridRowBuffer(DataGridColumnStore* store, unsigned row);
+    DataGridRowBuffer(DataGridPagedStore* store, unsigned row);
+    virtual ~DataGridRowBuffer();
 
+    void copyFrom(const DataGridRowBuffer* other);
+    DataGridColumnStore* getStore() const;
+    unsigned getRow() const;
+
+    bool getBytes(unsigned index, const char*& data, unsigned& length);
     wxString getString(unsigned index);
     IBPP::Blob *getBlob(unsigned index);
-    bool getValue(unsigned offset, double& value);
-    bool getValue(unsigned offset, float& value);
-    bool getValue(unsigned offset, int& value);
-    bool getValue(unsigned offset, int64_t& value);
-    bool getValue(unsigned offset, IBPP::DBKey& value, unsigned size);
+    bool getValue(unsigned index, double& value);
+    bool getValue(unsigned index, float& value);
+    bool getValue(unsigned index, int& value);
+    bool getValue(unsigned index, int64_t& value);
+    bool getValue(unsigned index, IBPP::DBKey& value);
     bool isFieldNull(unsigned num);
     void setFieldNull(unsigned num, bool isNull);
-    virtual bool isFieldNA(unsigned num);
-    virtual void setFieldNA(unsigned num, bool isNA);
+    bool isFieldNA(unsigned num);
+    void setFieldNA(unsigned num, bool isNA);
     bool isStringLoaded(unsigned num);
     void setStringLoaded(unsigned num, bool isLoaded);
+    void setBytes(unsigned num, const char* data, unsigned length);
     void setString(unsigned num, const wxString& value);
     void setBlob(unsigned num, IBPP::Blob b);
-    void setValue(unsigned offset, double value);
-    void setValue(unsigned offset, float value);
-    void setValue(unsigned offset, int value);
-    void setValue(unsigned offset, int64_t value);
-    void setValue(unsigned offset, IBPP::DBKey value);
+    void setValue(unsigned index, double value);
+    void setValue(unsigned index, float value);
+    void setValue(unsigned index, int value);
+    void setValue(unsigned index, int64_t value);
+    void setValue(unsigned index, IBPP::DBKey value);
 
-    virtual bool isInserted();
+    bool isInserted();
     bool isFieldModified(unsigned num);
     bool isDeletable();
     bool isDeletableIsSet();
@@ -90,19 +296,13 @@ public:
     void setIsDeleted(bool value);
 };
 
-// class for rows inserted by user - to minimize memory usage of regular rows
-// and also speed up code in DataGridRows::isFieldReadonly
+// class for rows inserted by user, they are kept in a private store until
+// they are added to the grid
 class InsertedGridRowBuffer: public DataGridRowBuffer
 {
-protected:
-    std::vector<bool> naFieldsM;
 public:
     InsertedGridRowBuffer(unsigned fieldCount);
     InsertedGridRowBuffer(const InsertedGridRowBuffer* other);
-
-    virtual bool isInserted();
-    virtual bool isFieldNA(unsigned num);
-    virtual void setFieldNA(unsigned num, bool isNA);
 };
 
 #endif
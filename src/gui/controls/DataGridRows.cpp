@@ -32,19 +32,30 @@
 
 #include <wx/datetime.h>
 #include <wx/ffile.h>
+#include <wx/stopwatch.h>
 #include <wx/textbuf.h>
 
 #include <algorithm>
 #include <bitset>
+#include <cmath>
+#include <cstring>
+#include <map>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "config/Config.h"
 #include "core/FRError.h"
 #include "core/Observer.h"
 #include "core/ProgressIndicator.h"
 #include "core/StringUtils.h"
+#include "engine/MetadataLoader.h"
+#include "gui/controls/DataGridGroups.h"
 #include "gui/controls/DataGridRowBuffer.h"
 #include "gui/controls/DataGridRows.h"
+#include "gui/controls/DataGridSort.h"
+#include "gui/controls/DataGridTextMatcher.h"
 #include "metadata/column.h"
 #include "metadata/database.h"
 #include "metadata/table.h"
@@ -491,6 +502,13 @@ wxString ResultsetColumnDef::getAsFirebirdString(DataGridRowBuffer* buffer)
     return getAsString(buffer);
 }
 
+void ResultsetColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv* converter)
+{
+    wxASSERT(buffer);
+    statement->Set(param, wx2std(getAsString(buffer), converter));
+}
+
 wxString ResultsetColumnDef::getName()
 {
     return nameM;
@@ -516,6 +534,32 @@ bool ResultsetColumnDef::isNullable()
     return nullableM;
 }
 
+ResultsetColumnDef::SortType ResultsetColumnDef::getSortType()
+{
+    return stNone;
+}
+
+bool ResultsetColumnDef::getSortInteger(DataGridRowBuffer*, int64_t&)
+{
+    return false;
+}
+
+bool ResultsetColumnDef::getSortDouble(DataGridRowBuffer*, double&)
+{
+    return false;
+}
+
+bool ResultsetColumnDef::getSortBytes(DataGridRowBuffer*, const char*&,
+    unsigned&)
+{
+    return false;
+}
+
+bool ResultsetColumnDef::isSortedAsServer()
+{
+    return true;
+}
+
 // DummyColumnDef class
 class DummyColumnDef : public ResultsetColumnDef
 {
@@ -525,6 +569,9 @@ public:
     virtual unsigned getBufferSize();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
@@ -549,6 +596,13 @@ void DummyColumnDef::setValue(DataGridRowBuffer* /*buffer*/, unsigned /*col*/,
 {
 }
 
+void DummyColumnDef::setValues(DataGridColumnStore* /*store*/,
+    unsigned /*firstRow*/, unsigned /*col*/,
+    const IBPP::ColumnBatch& /*batch*/, unsigned /*batchRow*/,
+    unsigned /*rows*/, wxMBConv* /*converter*/)
+{
+}
+
 void DummyColumnDef::setFromString(DataGridRowBuffer* /* buffer */,
          const wxString& /* source */)
 {
@@ -558,22 +612,29 @@ void DummyColumnDef::setFromString(DataGridRowBuffer* /* buffer */,
 class IntegerColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
 public:
-    IntegerColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    IntegerColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortInteger(DataGridRowBuffer* buffer, int64_t& value);
     virtual bool isNumeric();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-IntegerColumnDef::IntegerColumnDef(const wxString& name, unsigned offset,
+IntegerColumnDef::IntegerColumnDef(const wxString& name, unsigned index,
     bool readOnly, bool nullable)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index)
 {
 }
 
@@ -581,7 +642,7 @@ wxString IntegerColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     int value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
     return wxString::Format("%d", value);
 }
@@ -593,7 +654,7 @@ void IntegerColumnDef::setFromString(DataGridRowBuffer* buffer,
     long value;
     if (!source.ToLong(&value))
         throw FRError(_("Invalid integer numeric value"));
-    buffer->setValue(offsetM, (int)value);
+    buffer->setValue(indexM, (int)value);
 }
 
 unsigned IntegerColumnDef::getBufferSize()
@@ -601,6 +662,21 @@ unsigned IntegerColumnDef::getBufferSize()
     return sizeof(int);
 }
 
+ResultsetColumnDef::SortType IntegerColumnDef::getSortType()
+{
+    return stInteger;
+}
+
+bool IntegerColumnDef::getSortInteger(DataGridRowBuffer* buffer, int64_t& value)
+{
+    wxASSERT(buffer);
+    int v;
+    if (!buffer->getValue(indexM, v))
+        return false;
+    value = v;
+    return true;
+}
+
 bool IntegerColumnDef::isNumeric()
 {
     return true;
@@ -612,29 +688,59 @@ void IntegerColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     wxASSERT(buffer);
     int value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value);
+    buffer->setValue(indexM, value);
+}
+
+void IntegerColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    int value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+            store->setValue(firstRow + row, indexM, value);
+    }
+}
+
+void IntegerColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    int value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, int32_t(value));
+    else
+        statement->SetNull(param);
 }
 
 // Int64ColumnDef class
 class Int64ColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
 public:
-    Int64ColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    Int64ColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortInteger(DataGridRowBuffer* buffer, int64_t& value);
     virtual bool isNumeric();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-Int64ColumnDef::Int64ColumnDef(const wxString& name, unsigned offset,
+Int64ColumnDef::Int64ColumnDef(const wxString& name, unsigned index,
     bool readOnly, bool nullable)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index)
 {
 }
 
@@ -642,7 +748,7 @@ wxString Int64ColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     int64_t value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
     return wxLongLong(value).ToString();
 }
@@ -655,7 +761,7 @@ void Int64ColumnDef::setFromString(DataGridRowBuffer* buffer,
     wxLongLong_t ll;
     if (source.ToLongLong(&ll))
     {
-        buffer->setValue(offsetM, (int64_t)ll);
+        buffer->setValue(indexM, (int64_t)ll);
         return;
     }
 
@@ -663,7 +769,7 @@ void Int64ColumnDef::setFromString(DataGridRowBuffer* buffer,
     long l;
     if (!source.ToLong(&l)) // nope, that fails as well
         throw FRError(_("Invalid 64bit numeric value"));
-    buffer->setValue(offsetM, (int64_t)l);
+    buffer->setValue(indexM, (int64_t)l);
 }
 
 unsigned Int64ColumnDef::getBufferSize()
@@ -671,6 +777,17 @@ unsigned Int64ColumnDef::getBufferSize()
     return sizeof(int64_t);
 }
 
+ResultsetColumnDef::SortType Int64ColumnDef::getSortType()
+{
+    return stInteger;
+}
+
+bool Int64ColumnDef::getSortInteger(DataGridRowBuffer* buffer, int64_t& value)
+{
+    wxASSERT(buffer);
+    return buffer->getValue(indexM, value);
+}
+
 bool Int64ColumnDef::isNumeric()
 {
     return true;
@@ -682,45 +799,73 @@ void Int64ColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     wxASSERT(buffer);
     int64_t value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value);
+    buffer->setValue(indexM, value);
+}
+
+void Int64ColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    int64_t value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+            store->setValue(firstRow + row, indexM, value);
+    }
+}
+
+void Int64ColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    int64_t value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, value);
+    else
+        statement->SetNull(param);
 }
 
 // DBKeyColumnDef class
 class DBKeyColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
-    unsigned sizeM;
+    unsigned indexM;
 public:
-    DBKeyColumnDef(const wxString& name, unsigned offset, unsigned size);
+    DBKeyColumnDef(const wxString& name, unsigned index);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
     virtual bool isNumeric();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
-    void getDBKey(IBPP::DBKey& dbkey, DataGridRowBuffer* buffer);
 };
 
-DBKeyColumnDef::DBKeyColumnDef(const wxString& name, unsigned offset,
-    unsigned size)
-    : ResultsetColumnDef(name, true, false), offsetM(offset), sizeM(size)
+DBKeyColumnDef::DBKeyColumnDef(const wxString& name, unsigned index)
+    : ResultsetColumnDef(name, true, false), indexM(index)
 {
 }
 
 wxString DBKeyColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
+    IBPP::DBKey dbkey;
+    if (!buffer->getValue(indexM, dbkey))
+        return wxEmptyString;
+    std::vector<uint32_t> key(dbkey.Size() / sizeof(uint32_t));
+    dbkey.GetKey(&key[0], dbkey.Size());
+
     wxString ret;
-    for (int i = 0; i < (int)sizeM / 8; i++)
+    for (size_t i = 0; i + 1 < key.size(); i += 2)
     {
         if (i > 0)
             ret += "-";
-        int v1, v2;
-        buffer->getValue(offsetM+i*8, v1);
-        buffer->getValue(offsetM+i*8+4, v2);
-        ret += wxString::Format("%08x:%08x", (unsigned)v1, (unsigned)v2);
+        ret += wxString::Format("%08x:%08x", key[i], key[i + 1]);
     }
     return ret;
 }
@@ -733,7 +878,7 @@ void DBKeyColumnDef::setFromString(DataGridRowBuffer* /*buffer*/,
 
 unsigned DBKeyColumnDef::getBufferSize()
 {
-    return sizeM;
+    return 0;
 }
 
 bool DBKeyColumnDef::isNumeric()
@@ -747,35 +892,65 @@ void DBKeyColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     wxASSERT(buffer);
     IBPP::DBKey value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value);
+    buffer->setValue(indexM, value);
 }
 
-void DBKeyColumnDef::getDBKey(IBPP::DBKey& dbkey, DataGridRowBuffer* buffer)
+void DBKeyColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    IBPP::DBKey value;
+    std::vector<char> key;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (batch.Get(batchRow + row, col, value))
+            continue;
+        key.resize(value.Size());
+        if (!key.empty())
+            value.GetKey(&key[0], key.size());
+        store->setBytes(firstRow + row, indexM, key.empty() ? 0 : &key[0],
+            key.size());
+    }
+}
+
+void DBKeyColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
 {
     wxASSERT(buffer);
-    buffer->getValue(offsetM, dbkey, sizeM);
+    IBPP::DBKey value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, value);
+    else
+        statement->SetNull(param);
 }
 
 // DateColumnDef class
 class DateColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
 public:
-    DateColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    DateColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable);
     virtual wxString getAsFirebirdString(DataGridRowBuffer* buffer);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortInteger(DataGridRowBuffer* buffer, int64_t& value);
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-DateColumnDef::DateColumnDef(const wxString& name, unsigned offset,
+DateColumnDef::DateColumnDef(const wxString& name, unsigned index,
     bool readOnly, bool nullable)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index)
 {
 }
 
@@ -783,7 +958,7 @@ wxString DateColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     int value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
 
     IBPP::Date date(value);
@@ -796,7 +971,7 @@ wxString DateColumnDef::getAsFirebirdString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     int value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
 
     IBPP::Date date(value);
@@ -831,7 +1006,7 @@ void DateColumnDef::setFromString(DataGridRowBuffer* buffer,
             throw FRError(_("Cannot parse date"));
         idt.SetDate(y, m, d);
     }
-    buffer->setValue(offsetM, idt.GetDate());
+    buffer->setValue(indexM, idt.GetDate());
 }
 
 unsigned DateColumnDef::getBufferSize()
@@ -839,35 +1014,80 @@ unsigned DateColumnDef::getBufferSize()
     return sizeof(int);
 }
 
+ResultsetColumnDef::SortType DateColumnDef::getSortType()
+{
+    return stInteger;
+}
+
+bool DateColumnDef::getSortInteger(DataGridRowBuffer* buffer, int64_t& value)
+{
+    wxASSERT(buffer);
+    int v;
+    if (!buffer->getValue(indexM, v))
+        return false;
+    value = v;
+    return true;
+}
+
 void DateColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     const IBPP::Statement& statement, wxMBConv*)
 {
     wxASSERT(buffer);
     IBPP::Date value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value.GetDate());
+    buffer->setValue(indexM, value.GetDate());
+}
+
+void DateColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    IBPP::Date value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+            store->setValue(firstRow + row, indexM, value.GetDate());
+    }
+}
+
+void DateColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    int value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, IBPP::Date(value));
+    else
+        statement->SetNull(param);
 }
 
 // TimeColumnDef class
 class TimeColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
 public:
-    TimeColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    TimeColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable);
     virtual wxString getAsFirebirdString(DataGridRowBuffer* buffer);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortInteger(DataGridRowBuffer* buffer, int64_t& value);
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-TimeColumnDef::TimeColumnDef(const wxString& name, unsigned offset,
+TimeColumnDef::TimeColumnDef(const wxString& name, unsigned index,
     bool readOnly, bool nullable)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index)
 {
 }
 
@@ -875,7 +1095,7 @@ wxString TimeColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     int value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
 
     IBPP::Time time(value);
@@ -889,7 +1109,7 @@ wxString TimeColumnDef::getAsFirebirdString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     int value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
 
     IBPP::Time time(value);
@@ -917,7 +1137,7 @@ void TimeColumnDef::setFromString(DataGridRowBuffer* buffer,
             throw FRError(_("Cannot parse time"));
         itm.SetTime(hr, mn, sc, 10 * ms);
     }
-    buffer->setValue(offsetM, itm.GetTime());
+    buffer->setValue(indexM, itm.GetTime());
 }
 
 unsigned TimeColumnDef::getBufferSize()
@@ -925,49 +1145,106 @@ unsigned TimeColumnDef::getBufferSize()
     return sizeof(int);
 }
 
+ResultsetColumnDef::SortType TimeColumnDef::getSortType()
+{
+    return stInteger;
+}
+
+bool TimeColumnDef::getSortInteger(DataGridRowBuffer* buffer, int64_t& value)
+{
+    wxASSERT(buffer);
+    int v;
+    if (!buffer->getValue(indexM, v))
+        return false;
+    value = v;
+    return true;
+}
+
 void TimeColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     const IBPP::Statement& statement, wxMBConv*)
 {
     wxASSERT(buffer);
     IBPP::Time value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value.GetTime());
+    buffer->setValue(indexM, value.GetTime());
+}
+
+void TimeColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    IBPP::Time value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+            store->setValue(firstRow + row, indexM, value.GetTime());
+    }
+}
+
+void TimeColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    int value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, IBPP::Time(value));
+    else
+        statement->SetNull(param);
 }
 
 // TimestampColumnDef class
+// the date and time parts are stored as one 64 bit value (date in the upper
+// half), so that the stored values compare like the timestamps themselves
+static int64_t packTimestamp(int date, int time)
+{
+    return (int64_t(date) << 32) | uint32_t(time);
+}
+
+static void unpackTimestamp(int64_t value, int& date, int& time)
+{
+    date = int(value >> 32);
+    time = int(uint32_t(value));
+}
+
 class TimestampColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
 public:
-    TimestampColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    TimestampColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable);
     virtual wxString getAsFirebirdString(DataGridRowBuffer* buffer);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortInteger(DataGridRowBuffer* buffer, int64_t& value);
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-TimestampColumnDef::TimestampColumnDef(const wxString& name, unsigned offset,
+TimestampColumnDef::TimestampColumnDef(const wxString& name, unsigned index,
     bool readOnly, bool nullable)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index)
 {
 }
 
 wxString TimestampColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
-    int value;
-    if (!buffer->getValue(offsetM, value))
-        return wxEmptyString;
-    IBPP::Date date(value);
-
-    if (!buffer->getValue(offsetM + sizeof(int), value))
+    int64_t value;
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
-    IBPP::Time time(value);
+    int datePart, timePart;
+    unpackTimestamp(value, datePart, timePart);
+    IBPP::Date date(datePart);
+    IBPP::Time time(timePart);
 
     int year, month, day, hour, minute, second, tenththousands;
     date.GetDate(year, month, day);
@@ -980,14 +1257,13 @@ wxString TimestampColumnDef::getAsString(DataGridRowBuffer* buffer)
 wxString TimestampColumnDef::getAsFirebirdString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
-    int value;
-    if (!buffer->getValue(offsetM, value))
-        return wxEmptyString;
-    IBPP::Date date(value);
-
-    if (!buffer->getValue(offsetM + sizeof(int), value))
+    int64_t value;
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
-    IBPP::Time time(value);
+    int datePart, timePart;
+    unpackTimestamp(value, datePart, timePart);
+    IBPP::Date date(datePart);
+    IBPP::Time time(timePart);
 
     int year, month, day, hour, minute, second, tenththousands;
     date.GetDate(year, month, day);
@@ -1032,13 +1308,23 @@ void TimestampColumnDef::setFromString(DataGridRowBuffer* buffer,
     }
 
     // all done, set the value
-    buffer->setValue(offsetM, its.GetDate());
-    buffer->setValue(offsetM + sizeof(int), its.GetTime());
+    buffer->setValue(indexM, packTimestamp(its.GetDate(), its.GetTime()));
 }
 
 unsigned TimestampColumnDef::getBufferSize()
 {
-    return 2 * sizeof(int);
+    return sizeof(int64_t);
+}
+
+ResultsetColumnDef::SortType TimestampColumnDef::getSortType()
+{
+    return stInteger;
+}
+
+bool TimestampColumnDef::getSortInteger(DataGridRowBuffer* buffer, int64_t& value)
+{
+    wxASSERT(buffer);
+    return buffer->getValue(indexM, value);
 }
 
 void TimestampColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
@@ -1047,30 +1333,70 @@ void TimestampColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     wxASSERT(buffer);
     IBPP::Timestamp value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value.GetDate());
-    buffer->setValue(offsetM + sizeof(int), value.GetTime());
+    buffer->setValue(indexM, packTimestamp(value.GetDate(),
+        value.GetTime()));
+}
+
+void TimestampColumnDef::setValues(DataGridColumnStore* store,
+    unsigned firstRow, unsigned col, const IBPP::ColumnBatch& batch,
+    unsigned batchRow, unsigned rows, wxMBConv*)
+{
+    IBPP::Timestamp value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+        {
+            store->setValue(firstRow + row, indexM,
+                packTimestamp(value.GetDate(), value.GetTime()));
+        }
+    }
+}
+
+void TimestampColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    int64_t value;
+    if (!buffer->getValue(indexM, value))
+    {
+        statement->SetNull(param);
+        return;
+    }
+    int datePart, timePart;
+    unpackTimestamp(value, datePart, timePart);
+    IBPP::Timestamp timestamp;
+    timestamp.SetDate(datePart);
+    timestamp.SetTime(timePart);
+    statement->Set(param, timestamp);
 }
 
 // FloatColumnDef class
 class FloatColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
 public:
-    FloatColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    FloatColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortDouble(DataGridRowBuffer* buffer, double& value);
     virtual bool isNumeric();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-FloatColumnDef::FloatColumnDef(const wxString& name, unsigned offset,
+FloatColumnDef::FloatColumnDef(const wxString& name, unsigned index,
         bool readOnly, bool nullable)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index)
 {
 }
 
@@ -1078,7 +1404,7 @@ wxString FloatColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     float value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
 
     return GridCellFormats::get().format<float>(value);
@@ -1091,7 +1417,7 @@ void FloatColumnDef::setFromString(DataGridRowBuffer* buffer,
     double d;
     if (!source.ToDouble(&d))
         throw FRError(_("Invalid float numeric value"));
-    buffer->setValue(offsetM, (float)d);
+    buffer->setValue(indexM, (float)d);
 }
 
 unsigned FloatColumnDef::getBufferSize()
@@ -1099,6 +1425,21 @@ unsigned FloatColumnDef::getBufferSize()
     return sizeof(float);
 }
 
+ResultsetColumnDef::SortType FloatColumnDef::getSortType()
+{
+    return stDouble;
+}
+
+bool FloatColumnDef::getSortDouble(DataGridRowBuffer* buffer, double& value)
+{
+    wxASSERT(buffer);
+    float v;
+    if (!buffer->getValue(indexM, v))
+        return false;
+    value = v;
+    return true;
+}
+
 bool FloatColumnDef::isNumeric()
 {
     return true;
@@ -1110,30 +1451,60 @@ void FloatColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     wxASSERT(buffer);
     float value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value);
+    buffer->setValue(indexM, value);
+}
+
+void FloatColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    float value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+            store->setValue(firstRow + row, indexM, value);
+    }
+}
+
+void FloatColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    float value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, value);
+    else
+        statement->SetNull(param);
 }
 
 // DoubleColumnDef class
 class DoubleColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned offsetM;
+    unsigned indexM;
     short scaleM;
 public:
-    DoubleColumnDef(const wxString& name, unsigned offset, bool readOnly,
+    DoubleColumnDef(const wxString& name, unsigned index, bool readOnly,
         bool nullable, short scale);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortDouble(DataGridRowBuffer* buffer, double& value);
     virtual bool isNumeric();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-DoubleColumnDef::DoubleColumnDef(const wxString& name, unsigned offset,
+DoubleColumnDef::DoubleColumnDef(const wxString& name, unsigned index,
         bool readOnly, bool nullable, short scale)
-    : ResultsetColumnDef(name, readOnly, nullable), offsetM(offset),
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index),
         scaleM(scale)
 {
 }
@@ -1142,7 +1513,7 @@ wxString DoubleColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
     double value;
-    if (!buffer->getValue(offsetM, value))
+    if (!buffer->getValue(indexM, value))
         return wxEmptyString;
 
     if (scaleM)
@@ -1157,7 +1528,7 @@ void DoubleColumnDef::setFromString(DataGridRowBuffer* buffer,
     double d;
     if (!source.ToDouble(&d))
         throw FRError(_("Invalid double numeric value"));
-    buffer->setValue(offsetM, d);
+    buffer->setValue(indexM, d);
 }
 
 unsigned DoubleColumnDef::getBufferSize()
@@ -1165,6 +1536,17 @@ unsigned DoubleColumnDef::getBufferSize()
     return sizeof(double);
 }
 
+ResultsetColumnDef::SortType DoubleColumnDef::getSortType()
+{
+    return stDouble;
+}
+
+bool DoubleColumnDef::getSortDouble(DataGridRowBuffer* buffer, double& value)
+{
+    wxASSERT(buffer);
+    return buffer->getValue(indexM, value);
+}
+
 bool DoubleColumnDef::isNumeric()
 {
     return true;
@@ -1176,40 +1558,71 @@ void DoubleColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
     wxASSERT(buffer);
     double value;
     statement->Get(col, value);
-    buffer->setValue(offsetM, value);
+    buffer->setValue(indexM, value);
+}
+
+void DoubleColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    double value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, value))
+            store->setValue(firstRow + row, indexM, value);
+    }
+}
+
+void DoubleColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    double value;
+    if (buffer->getValue(indexM, value))
+        statement->Set(param, value);
+    else
+        statement->SetNull(param);
 }
 
 class BlobColumnDef : public ResultsetColumnDef
 {
 private:
-    unsigned indexM, stringIndexM;
+    unsigned indexM;
     bool textualM;
     wxMBConv* converterM;
 public:
     BlobColumnDef(const wxString& name, bool readOnly, bool nullable,
-        unsigned stringIndex, unsigned blobIndex, bool textual);
+        unsigned index, bool textual, wxMBConv* converter);
     void reset(DataGridRowBuffer* buffer);
+    // the rows set by setValues() have the ids of their BLOBs only, this
+    // creates the BLOB objects for them
+    void createBlobs(DataGridColumnStore* store, unsigned firstRow,
+        unsigned rows, const IBPP::Database& database,
+        const IBPP::Transaction& transaction);
     virtual unsigned getIndex();
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
     bool isTextual() { return textualM; };
 };
 
 BlobColumnDef::BlobColumnDef(const wxString& name, bool readOnly,
-        bool nullable, unsigned stringIndex, unsigned blobIndex, bool textual)
-    : ResultsetColumnDef(name, readOnly, nullable), indexM(blobIndex),
-        textualM(textual), stringIndexM(stringIndex), converterM(0)
+        bool nullable, unsigned index, bool textual, wxMBConv* converter)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index),
+        textualM(textual), converterM(converter)
 {
     //readOnlyM = true;   // TODO: uncomment this when we make BlobDialog
 }
 
 void BlobColumnDef::reset(DataGridRowBuffer* buffer)
 {
-    buffer->setStringLoaded(stringIndexM, false);
+    buffer->setStringLoaded(indexM, false);
 }
 
 unsigned BlobColumnDef::getIndex()
@@ -1220,8 +1633,8 @@ unsigned BlobColumnDef::getIndex()
 wxString BlobColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
-    if (buffer->isStringLoaded(stringIndexM))
-        return buffer->getString(stringIndexM);
+    if (buffer->isStringLoaded(indexM))
+        return buffer->getString(indexM);
     if (!GridCellFormats::get().showBlobContent())
         return _("[BLOB]");
     if (!textualM && !GridCellFormats::get().showBinaryBlobContent())
@@ -1240,31 +1653,29 @@ wxString BlobColumnDef::getAsString(DataGridRowBuffer* buffer)
         return _("[ERROR]");
     }
 
+    // fetch all the bytes to show in one go, ReadBlock() gathers the
+    // segments, the whole data is there unless the buffer got full
     std::string result;
     int bytesToFetch = GridCellFormats::get().maxBlobBytesToFetch();
-    while (bytesToFetch > 0)
+    if (bytesToFetch > 0)
     {
-        char buffer[1025];
-        int size = b->Read((void*)buffer, 1024);
-        if (size < 1)
-            break;
-        bytesToFetch -= size;
+        std::string data(bytesToFetch, '\0');
+        int bytesRead = b->ReadBlock(&data[0], bytesToFetch);
+        data.resize(bytesRead);
         if (textualM)
-        {
-            std::string s(buffer, size);
-            result += s;    // we don't convert here due to incomplete strings
-        }
+            result.swap(data);  // we don't convert here due to incomplete strings
         else    // binary (show as hexadecimal)
         {
-            for (int i=0; i<size; i+=8)
+            static const char hexDigits[] = "0123456789ABCDEF";
+            result.reserve(bytesRead * 2 + bytesRead / 8 + bytesRead / 32);
+            for (int i = 0; i < bytesRead; i += 8)
             {
-                int last = 8;
-                if (i+last >= size)
-                    last = size - i;
-                for (int j=0; j<last; j++)
+                int last = std::min(8, bytesRead - i);
+                for (int j = 0; j < last; j++)
                 {
-                    result += wx2std(wxString::Format("%02X",
-                        (unsigned char)(buffer[i+j])));
+                    unsigned char c = (unsigned char)data[i + j];
+                    result += hexDigits[c >> 4];
+                    result += hexDigits[c & 0x0F];
                 }
                 result += " ";
                 if (((i + 8) % 32) == 0)
@@ -1282,7 +1693,8 @@ wxString BlobColumnDef::getAsString(DataGridRowBuffer* buffer)
             wxs = wxString(result.c_str(), *converterM);   // try converting again
         }
     }
-    buffer->setString(stringIndexM, wxs);
+    buffer->setString(indexM, wxs);
+    buffer->setStringLoaded(indexM, true);
     return wxs;
 }
 
@@ -1294,45 +1706,93 @@ void BlobColumnDef::setFromString(DataGridRowBuffer* /*buffer*/,
     // buffer->setString(indexM, source);
 }
 
+// the id of the BLOB
 unsigned BlobColumnDef::getBufferSize()
 {
-    return 0;
+    return sizeof(int64_t);
 }
 
 void BlobColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
-    const IBPP::Statement& statement, wxMBConv* converter)
+    const IBPP::Statement& statement, wxMBConv*)
 {
     wxASSERT(buffer);
     IBPP::Blob b = IBPP::BlobFactory(statement->DatabasePtr(),
         statement->TransactionPtr());
     statement->Get(col, b);
     buffer->setBlob(indexM, b);
-    converterM = converter; // store for later when we fetch the data
+}
+
+// this is called by the fetch thread too, and must not create BLOB objects
+// since these are attached to the database and transaction objects
+void BlobColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    int64_t id;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.GetBlobId(batchRow + row, col, id))
+            store->setValue(firstRow + row, indexM, id);
+    }
+}
+
+void BlobColumnDef::createBlobs(DataGridColumnStore* store,
+    unsigned firstRow, unsigned rows, const IBPP::Database& database,
+    const IBPP::Transaction& transaction)
+{
+    int64_t id;
+    for (unsigned row = firstRow; row < firstRow + rows; ++row)
+    {
+        if (!store->isFieldNull(row, indexM)
+            && store->getValue(row, indexM, id))
+        {
+            store->setBlob(row, indexM,
+                IBPP::BlobFactory(database, transaction, id));
+        }
+    }
 }
 
 // StringColumnDef class
+// the raw bytes in the connection character set are stored, conversion to
+// wxString is only done when the value is actually needed
 class StringColumnDef : public ResultsetColumnDef
 {
 protected:
     unsigned indexM;
     int charSizeM;
+    bool octetsM;
+    bool binaryCollationM;
+    wxMBConv* converterM;
+    std::string valueM; // reused for fetching to avoid reallocations
 public:
-    StringColumnDef(const wxString& name, unsigned stringIndex, bool readOnly,
-        bool nullable, int charSize);
+    StringColumnDef(const wxString& name, unsigned index, bool readOnly,
+        bool nullable, int charSize, bool octets, bool binaryCollation,
+        wxMBConv* converter);
     virtual unsigned getIndex();
     virtual wxString getAsFirebirdString(DataGridRowBuffer* buffer);
     virtual wxString getAsString(DataGridRowBuffer* buffer);
     virtual unsigned getBufferSize();
+    virtual SortType getSortType();
+    virtual bool getSortBytes(DataGridRowBuffer* buffer, const char*& data,
+        unsigned& length);
+    virtual bool isSortedAsServer();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
     virtual void setFromString(DataGridRowBuffer* buffer,
         const wxString& source);
 };
 
-StringColumnDef::StringColumnDef(const wxString& name, unsigned stringIndex,
-    bool readOnly, bool nullable, int charSize)
-    : ResultsetColumnDef(name, readOnly, nullable), indexM(stringIndex),
-      charSizeM(charSize)
+StringColumnDef::StringColumnDef(const wxString& name, unsigned index,
+    bool readOnly, bool nullable, int charSize, bool octets,
+    bool binaryCollation, wxMBConv* converter)
+    : ResultsetColumnDef(name, readOnly, nullable), indexM(index),
+      charSizeM(charSize), octetsM(octets),
+      binaryCollationM(octets || binaryCollation), converterM(converter)
 {
 }
 
@@ -1344,7 +1804,7 @@ unsigned StringColumnDef::getIndex()
 wxString StringColumnDef::getAsFirebirdString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
-    wxString s(buffer->getString(indexM));
+    wxString s(getAsString(buffer));
     // SF bug #1889800: quote chars have to be escaped
     s.Replace("'", "''");
     return s;
@@ -1353,15 +1813,53 @@ wxString StringColumnDef::getAsFirebirdString(DataGridRowBuffer* buffer)
 wxString StringColumnDef::getAsString(DataGridRowBuffer* buffer)
 {
     wxASSERT(buffer);
-    return buffer->getString(indexM);
+    const char* data;
+    unsigned length;
+    if (!buffer->getBytes(indexM, data, length))
+        return wxEmptyString;
+
+    if (octetsM)
+    {
+        wxString val;
+        val.reserve(2 * length);
+        for (unsigned p = 0; p < length; p++)
+            val += wxString::Format("%02x", uint8_t(data[p]));
+        return val;
+    }
+
+    wxString val(data, *converterM, length);
+    size_t trimLen = val.Strip().Length();
+    if (val.Length() > size_t(charSizeM))
+        val.Truncate(trimLen > size_t(charSizeM) ? trimLen : charSizeM);
+    return val;
 }
 
 void StringColumnDef::setFromString(DataGridRowBuffer* buffer,
         const wxString& source)
 {
     wxASSERT(buffer);
-    // TODO: if CHARACTER SET OCTETS - check if it is a valid hexdec string
-    buffer->setString(indexM, source);
+    if (octetsM)
+    {
+        // store hexadecimal strings as the bytes they represent
+        std::string bytes;
+        bool isHex = (source.Length() % 2) == 0;
+        for (size_t p = 0; isHex && p < source.Length(); p += 2)
+        {
+            unsigned long l = 0;
+            isHex = source.Mid(p, 2).ToULong(&l, 16);
+            bytes += char(l);
+        }
+        if (isHex)
+        {
+            buffer->setBytes(indexM, bytes.data(), bytes.length());
+            return;
+        }
+    }
+
+    wxCharBuffer cb(source.mb_str(*converterM));
+    if (!source.IsEmpty() && cb.length() == 0)
+        throw FRError(_("Value can not be converted to the connection character set"));
+    buffer->setBytes(indexM, cb.data(), cb.length());
 }
 
 unsigned StringColumnDef::getBufferSize()
@@ -1369,61 +1867,129 @@ unsigned StringColumnDef::getBufferSize()
     return 0;
 }
 
-void StringColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
-    const IBPP::Statement& statement, wxMBConv* converter)
+// the bytes of the stored strings, which is the order of the characters for
+// single-byte character sets and for UTF8
+ResultsetColumnDef::SortType StringColumnDef::getSortType()
+{
+    return stBytes;
+}
+
+bool StringColumnDef::getSortBytes(DataGridRowBuffer* buffer,
+    const char*& data, unsigned& length)
 {
     wxASSERT(buffer);
-    std::string value;
-    statement->Get(col, value);
-    if (statement->ColumnType(col) == IBPP::sdBoolean) // Firebird v3
-    {
-        bool value; // UGLY, must create a specific Columm (child one ?)
-        statement->Get(col, value);
-        wxString val = value ? "true" : "false";
-        buffer->setString(indexM, val);
-    }
-    else if (statement->ColumnSubtype(col) == 1)   // charset OCTETS
-    {
-        wxString val;
-        for (std::string::size_type p = 0; p < value.length(); p++)
-            val += wxString::Format("%02x", uint8_t(value[p]));
-        buffer->setString(indexM, val);
-    }
-    else
-    {
-        wxString val = wxString(value.c_str(), *converter);
-        size_t trimLen = val.Strip().Length();
-        if (val.Length() > size_t(charSizeM))
-            val.Truncate(trimLen > size_t(charSizeM) ? trimLen : charSizeM);
-        buffer->setString(indexM, val);
-    }
+    return buffer->getBytes(indexM, data, length);
 }
 
-class BooleanColumnDef : public StringColumnDef // Firebird v3
+// the server orders by the bytes only with the binary collations, the
+// others ignore case or accents, or have their own order of the letters
+bool StringColumnDef::isSortedAsServer()
+{
+    return binaryCollationM;
+}
+
+void StringColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
+    const IBPP::Statement& statement, wxMBConv*)
+{
+    wxASSERT(buffer);
+    statement->Get(col, valueM);
+    buffer->setBytes(indexM, valueM.data(), valueM.length());
+}
+
+void StringColumnDef::setValues(DataGridColumnStore* store, unsigned firstRow,
+    unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+    unsigned rows, wxMBConv*)
+{
+    // the bytes are copied from the batch directly, without valueM
+    const char* data;
+    int length;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (!batch.Get(batchRow + row, col, data, length))
+            store->setBytes(firstRow + row, indexM, data, length);
+    }
+}
+
+void StringColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    // the bytes are in the connection character set already
+    const char* data;
+    unsigned length;
+    if (buffer->getBytes(indexM, data, length))
+        statement->Set(param, std::string(data, length));
+    else
+        statement->SetNull(param);
+}
+
+class BooleanColumnDef : public StringColumnDef // Firebird v3
 {
 public:
-    BooleanColumnDef(const wxString& name, unsigned stringIndex, bool readOnly, bool nullable);
-    virtual void setValue(DataGridRowBuffer* buffer, unsigned col, const IBPP::Statement& statement);
+    BooleanColumnDef(const wxString& name, unsigned index, bool readOnly,
+        bool nullable, wxMBConv* converter);
+    virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
+        const IBPP::Statement& statement, wxMBConv* converter);
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter);
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
 };
 
-BooleanColumnDef::BooleanColumnDef(const wxString& name, unsigned stringIndex,
-    bool readOnly, bool nullable) : StringColumnDef(name, stringIndex, readOnly, nullable, 5)
+BooleanColumnDef::BooleanColumnDef(const wxString& name, unsigned index,
+    bool readOnly, bool nullable, wxMBConv* converter)
+    // "FALSE" sorts before "TRUE" bytewise, as on the server
+    : StringColumnDef(name, index, readOnly, nullable, 5, false, true,
+        converter)
 {
 }
 
 void BooleanColumnDef::setValue(DataGridRowBuffer* buffer, unsigned col,
-    const IBPP::Statement& statement)
+    const IBPP::Statement& statement, wxMBConv*)
 {
     wxASSERT(buffer);
     bool value;
     statement->Get(col, value);
-    wxString val = value ? "true" : "false";
-    buffer->setString(StringColumnDef::indexM, val);
+    if (value)
+        buffer->setBytes(StringColumnDef::indexM, "true", 4);
+    else
+        buffer->setBytes(StringColumnDef::indexM, "false", 5);
+}
+
+void BooleanColumnDef::setValues(DataGridColumnStore* store,
+    unsigned firstRow, unsigned col, const IBPP::ColumnBatch& batch,
+    unsigned batchRow, unsigned rows, wxMBConv*)
+{
+    unsigned index = StringColumnDef::indexM;
+    bool value;
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        if (batch.Get(batchRow + row, col, value))
+            continue;
+        if (value)
+            store->setBytes(firstRow + row, index, "true", 4);
+        else
+            store->setBytes(firstRow + row, index, "false", 5);
+    }
+}
+
+void BooleanColumnDef::setParameter(const IBPP::Statement& statement,
+    int param, DataGridRowBuffer* buffer, wxMBConv*)
+{
+    wxASSERT(buffer);
+    const char* data;
+    unsigned length;
+    if (buffer->getBytes(StringColumnDef::indexM, data, length))
+        statement->Set(param, std::string(data, length) == "true");
+    else
+        statement->SetNull(param);
 }
 
 // DataGridRows class
 DataGridRows::DataGridRows(Database* db)
-    : bufferSizeM(0), databaseM(db), readOnlyM(false)
+    : databaseM(db), readOnlyM(false), sortColumnM(0), sortAscendingM(true),
+        filterM(0), changeCountM(0)
 {
 }
 
@@ -1437,55 +2003,170 @@ ResultsetColumnDef* DataGridRows::getColumnDef(unsigned col)
     return columnDefsM[col];
 }
 
+// the row data is copied, the buffer is still owned by the caller
 void DataGridRows::addRow(DataGridRowBuffer* buffer)
 {
-    if (buffersM.size() == buffersM.capacity())
-        buffersM.reserve(buffersM.capacity() + 1024);
-    buffersM.push_back(buffer);
+    wxASSERT(buffer);
+    DataGridRowBuffer row(&storeM, storeM.appendRow());
+    row.copyFrom(buffer);
 }
 
 void DataGridRows::addRow(const IBPP::Statement& statement)
 {
-    DataGridRowBuffer* buffer = new DataGridRowBuffer(columnDefsM.size());
-    // if anything fails, make sure we release the memory
+    DataGridRowBuffer buffer(&storeM, storeM.appendRow());
+    // if anything fails, make sure we don't keep the incomplete row
+    try
+    {
+        setRowValues(&buffer, statement);
+    }
+    catch(...)
+    {
+        storeM.removeLastRow();
+        throw;
+    }
+}
+
+// the rows are appended page by page, and the values are written into the
+// page of the paged store directly
+void DataGridRows::addRows(const IBPP::ColumnBatch& batch)
+{
+    unsigned firstRow = storeM.getRowCount();
+    unsigned rows = batch.Rows();
+    // if anything fails, make sure we don't keep the incomplete rows
     try
     {
-        // starts with last column -> with highest buffer offset and
-        // string array index to allocate all needed memory at once
-        unsigned col = columnDefsM.size();
-        do
+        for (unsigned batchRow = 0; batchRow < rows; )
         {
-            // IBPP column counts are 1-based, not 0-based...
-            unsigned colIBPP = col--;
-            bool isNull = statement->IsNull(colIBPP);
-            buffer->setFieldNull(col, isNull);
-            if (!isNull)
+            unsigned row = storeM.appendRow();
+            unsigned count = 1;
+            while (batchRow + count < rows && storeM.getPageIndex(
+                storeM.getRowCount()) == storeM.getPageIndex(row))
             {
-                columnDefsM[col]->setValue(buffer, colIBPP, statement,
-                    databaseM->getCharsetConverter());
+                storeM.appendRow();
+                ++count;
             }
+            // nothing else uses the store until the values are set
+            unsigned pageRow;
+            DataGridColumnStore* page = storeM.getPage(row, pageRow);
+            setBatchValues(batch, batchRow, count, page, pageRow);
+            createBlobs(page, pageRow, count, batch.DatabasePtr(),
+                batch.TransactionPtr());
+            batchRow += count;
         }
-        while (col > 0);
     }
     catch(...)
     {
-        delete buffer;
+        while (storeM.getRowCount() > firstRow)
+            storeM.removeLastRow();
         throw;
     }
-    addRow(buffer);
 }
 
-    void freeBuffer(DataGridRowBuffer* buffer) { delete buffer; }
+// used by the fetch thread, so BLOB columns get the ids of the BLOBs only
+void DataGridRows::addRows(const IBPP::ColumnBatch& batch,
+    DataGridColumnStore& store)
+{
+    while (store.getColumnCount() < columnDefsM.size())
+        store.addColumn(columnDefsM[store.getColumnCount()]->getBufferSize());
 
-    void freeColumnDef(ResultsetColumnDef* columnDef) { delete columnDef; }
+    unsigned firstRow = store.getRowCount();
+    unsigned rows = batch.Rows();
+    for (unsigned i = 0; i < rows; ++i)
+        store.appendRow();
+    // if anything fails, make sure we don't keep the incomplete rows
+    try
+    {
+        setBatchValues(batch, 0, rows, &store, firstRow);
+    }
+    catch(...)
+    {
+        while (store.getRowCount() > firstRow)
+            store.removeLastRow();
+        throw;
+    }
+}
 
-void DataGridRows::clear()
+// the values are stored column by column, so that the type of each column
+// is only looked at once per batch and not for every single value
+void DataGridRows::setBatchValues(const IBPP::ColumnBatch& batch,
+    unsigned batchRow, unsigned rows, DataGridColumnStore* store,
+    unsigned firstRow)
+{
+    wxMBConv* converter = databaseM->getCharsetConverter();
+    for (unsigned col = 0; col < columnDefsM.size(); ++col)
+    {
+        // IBPP column counts are 1-based, not 0-based...
+        unsigned colIBPP = col + 1;
+        // the new rows have all fields NULL
+        for (unsigned i = 0; i < rows; ++i)
+        {
+            if (!batch.IsNull(batchRow + i, colIBPP))
+                store->setFieldNull(firstRow + i, col, false);
+        }
+        columnDefsM[col]->setValues(store, firstRow, colIBPP, batch,
+            batchRow, rows, converter);
+    }
+}
+
+void DataGridRows::setRowValues(DataGridRowBuffer* buffer,
+    const IBPP::Statement& statement)
+{
+    wxMBConv* converter = databaseM->getCharsetConverter();
+    for (unsigned col = 0; col < columnDefsM.size(); ++col)
+    {
+        // IBPP column counts are 1-based, not 0-based...
+        unsigned colIBPP = col + 1;
+        bool isNull = statement->IsNull(colIBPP);
+        buffer->setFieldNull(col, isNull);
+        if (!isNull)
+            columnDefsM[col]->setValue(buffer, colIBPP, statement, converter);
+    }
+}
+
+void DataGridRows::setRow(unsigned row, const IBPP::Statement& statement)
+{
+    wxASSERT(storeM.isRowMissing(row));
+    DataGridRowBuffer buffer(&storeM, row);
+    setRowValues(&buffer, statement);
+    storeM.setRowPresent(row);
+    ++changeCountM;
+}
+
+void DataGridRows::addRows(DataGridColumnStore& rows,
+    const IBPP::Database& database, const IBPP::Transaction& transaction)
+{
+    createBlobs(&rows, 0, rows.getRowCount(), database, transaction);
+    addRows(rows);
+}
+
+void DataGridRows::addRows(const DataGridColumnStore& rows)
 {
-    if (buffersM.size())
+    for (unsigned i = 0; i < rows.getRowCount(); ++i)
     {
-        for_each(buffersM.begin(), buffersM.end(), freeBuffer);
-        buffersM.clear();
+        DataGridRowBuffer buffer(&storeM, storeM.appendRow());
+        buffer.getStore()->copyRow(rows, i, buffer.getRow());
     }
+}
+
+void DataGridRows::createBlobs(DataGridColumnStore* store, unsigned firstRow,
+    unsigned rows, const IBPP::Database& database,
+    const IBPP::Transaction& transaction)
+{
+    for (unsigned col = 0; col < columnDefsM.size(); ++col)
+    {
+        if (BlobColumnDef* bcd = dynamic_cast<BlobColumnDef*>(columnDefsM[col]))
+            bcd->createBlobs(store, firstRow, rows, database, transaction);
+    }
+}
+
+    void freeColumnDef(ResultsetColumnDef* columnDef) { delete columnDef; }
+
+void DataGridRows::clear()
+{
+    storeM.clear();
+    orderM.clear();
+    clearFilter();
+    ++changeCountM;
     if (columnDefsM.size())
     {
         for_each(columnDefsM.begin(), columnDefsM.end(), freeColumnDef);
@@ -1494,17 +2175,20 @@ void DataGridRows::clear()
     statementTablesM.clear();
     deleteFromM = statementTablesM.end();
     dbKeysM.clear();
-    bufferSizeM = 0;
 }
 
 bool DataGridRows::canRemoveRow(size_t row)
 {
-    if (row >= buffersM.size())
+    if (row >= getShownRowCount())
+        return false;
+    row = getStoreRow(row);
+    if (storeM.isRowMissing(row))
         return false;
     // check that it is safe to call statementM->Columns()
     if (statementM->Type() == IBPP::stUnknown)
         return false;
-    if (!buffersM[row]->isDeletableIsSet())
+    DataGridRowBuffer buffer(&storeM, row);
+    if (!buffer.isDeletableIsSet())
     {
         // find table with valid constraint
         bool tableok = false;
@@ -1527,7 +2211,7 @@ bool DataGridRows::canRemoveRow(size_t row)
                         continue;
                     wxString tn(std2wxIdentifier(statementM->ColumnTable(c2),
                         databaseM->getCharsetConverter()));
-                    if (tn == (*it).first && buffersM[row]->isFieldNA(c2-1))
+                    if (tn == (*it).first && buffer.isFieldNA(c2-1))
                     {
                         tableok = false;
                         break;
@@ -1535,9 +2219,9 @@ bool DataGridRows::canRemoveRow(size_t row)
                 }
             }
         }
-        buffersM[row]->setIsDeletable(tableok);
+        buffer.setIsDeletable(tableok);
     }
-    return buffersM[row]->isDeletable();
+    return buffer.isDeletable();
 }
 
 bool DataGridRows::removeRows(size_t from, size_t count, wxString& stm)
@@ -1575,32 +2259,814 @@ bool DataGridRows::removeRows(size_t from, size_t count, wxString& stm)
             stm += wxTextBuffer::GetEOL();
         wxString s = "DELETE FROM "
             + Identifier((*deleteFromM).first).getQuoted() + " WHERE ";
-        IBPP::Statement st = addWhere((*deleteFromM).second, s,
-            (*deleteFromM).first, buffersM[from+pos]);
+        wxString sql(s);
+        std::vector<unsigned> paramColumns;
+        DataGridRowBuffer buffer(&storeM, getStoreRow(from + pos));
+        addWhere((*deleteFromM).second, s, sql, paramColumns,
+            (*deleteFromM).first, &buffer);
+        IBPP::Statement st = prepareStatement(sql, paramColumns, 1, &buffer);
         st->Execute();
         stm += s + ";";
     }
 
-    std::vector<DataGridRowBuffer*>::iterator i2, it = buffersM.begin();
-    from += count - 1;
-    while (from--)
+    if (from + count > getShownRowCount())    // should never happen
+        return false;
+    for (size_t pos = from; pos < from + count; ++pos)
+        storeM.setRowDeleted(getStoreRow(pos), true);
+    return true;
+}
+
+unsigned DataGridRows::getRowCount()
+{
+    return storeM.getRowCount();
+}
+
+void DataGridRows::setRowCount(unsigned count)
+{
+    storeM.setRowCount(count);
+}
+
+bool DataGridRows::isRowFetched(unsigned row)
+{
+    return !storeM.isRowMissing(getStoreRow(row));
+}
+
+bool DataGridRows::findMissingRow(unsigned from, unsigned& row)
+{
+    return storeM.findMissingRow(from, row);
+}
+
+unsigned DataGridRows::getOrderedRow(unsigned row) const
+{
+    return row < orderM.size() ? orderM[row] : row;
+}
+
+unsigned DataGridRows::getStoreRow(unsigned row) const
+{
+    if (filterM)
+        return row < viewM.size() ? viewM[row] : row;
+    return getOrderedRow(row);
+}
+
+namespace
+{
+
+// reads the keys of all rows in the order of the store, the rows with NULL
+// (or N/A) are returned in their previous order
+template<typename T, typename ReadKey>
+void readSortKeys(DataGridPagedStore& store, unsigned col,
+    const std::vector<unsigned>& positions, ReadKey readKey,
+    std::vector<RowSortKey<T> >& keys, std::vector<unsigned>& nulls)
+{
+    std::vector<std::pair<unsigned, unsigned> > nullPositions;
+    keys.reserve(store.getRowCount());
+    for (unsigned row = 0; row < store.getRowCount(); ++row)
+    {
+        DataGridRowBuffer buffer(&store, row);
+        RowSortKey<T> key;
+        if (buffer.isFieldNA(col) || buffer.isFieldNull(col)
+            || !readKey(&buffer, key.value))
+        {
+            nullPositions.push_back(std::make_pair(positions[row], row));
+            continue;
+        }
+        key.row = row;
+        key.position = positions[row];
+        keys.push_back(key);
+    }
+    std::sort(nullPositions.begin(), nullPositions.end());
+    for (size_t i = 0; i < nullPositions.size(); ++i)
+        nulls.push_back(nullPositions[i].second);
+}
+
+template<typename T>
+void appendSortedRows(const std::vector<RowSortKey<T> >& keys,
+    std::vector<unsigned>& order)
+{
+    for (typename std::vector<RowSortKey<T> >::const_iterator it =
+        keys.begin(); it != keys.end(); ++it)
+    {
+        order.push_back((*it).row);
+    }
+}
+
+}
+
+// the keys are read from the store once, then only the keys are sorted, so
+// that the (paged) store isn't accessed from several threads
+bool DataGridRows::sortRows(unsigned col, bool ascending)
+{
+    if (col >= columnDefsM.size())
+        return false;
+    ResultsetColumnDef* columnDef = columnDefsM[col];
+    ResultsetColumnDef::SortType type = columnDef->getSortType();
+    unsigned missingRow;
+    if (type == ResultsetColumnDef::stNone || !columnDef->isSortedAsServer()
+        || storeM.findMissingRow(0, missingRow))
+    {
+        return false;
+    }
+
+    unsigned count = storeM.getRowCount();
+    std::vector<unsigned> positions(count);
+    for (unsigned row = 0; row < count; ++row)
+        positions[getOrderedRow(row)] = row;
+
+    std::vector<unsigned> nulls, sorted;
+    sorted.reserve(count);
+    if (type == ResultsetColumnDef::stInteger)
+    {
+        std::vector<RowSortKey<int64_t> > keys;
+        readSortKeys(storeM, col, positions,
+            [columnDef](DataGridRowBuffer* buffer, int64_t& value) -> bool {
+                return columnDef->getSortInteger(buffer, value); },
+            keys, nulls);
+        parallelSort(keys, RowSortKeyLess<int64_t>(ascending));
+        appendSortedRows(keys, sorted);
+    }
+    else if (type == ResultsetColumnDef::stDouble)
+    {
+        std::vector<RowSortKey<double> > keys;
+        readSortKeys(storeM, col, positions,
+            [columnDef](DataGridRowBuffer* buffer, double& value) -> bool {
+                return columnDef->getSortDouble(buffer, value); },
+            keys, nulls);
+        parallelSort(keys, RowSortKeyLess<double>(ascending));
+        appendSortedRows(keys, sorted);
+    }
+    else
+    {
+        std::vector<char> bytes;
+        std::vector<RowSortKey<BytesSortValue> > keys;
+        readSortKeys(storeM, col, positions,
+            [columnDef, &bytes](DataGridRowBuffer* buffer,
+                BytesSortValue& value) -> bool
+            {
+                const char* data;
+                if (!columnDef->getSortBytes(buffer, data, value.length))
+                    return false;
+                value.offset = bytes.size();
+                bytes.insert(bytes.end(), data, data + value.length);
+                return true;
+            },
+            keys, nulls);
+        // memcmp() needs valid pointers even if there are no values
+        bytes.push_back(0);
+        parallelSort(keys, BytesSortKeyLess(&bytes[0], ascending));
+        appendSortedRows(keys, sorted);
+    }
+
+    // NULLs come first in ascending order, as with ORDER BY in Firebird
+    std::vector<unsigned> order;
+    order.reserve(count);
+    if (ascending)
+        order.insert(order.end(), nulls.begin(), nulls.end());
+    order.insert(order.end(), sorted.begin(), sorted.end());
+    if (!ascending)
+        order.insert(order.end(), nulls.begin(), nulls.end());
+    orderM.swap(order);
+    sortColumnM = col;
+    sortAscendingM = ascending;
+    ++changeCountM;
+    if (filterM)
+    {
+        applyFilter(matchesM.size());
+        buildFilterView();
+    }
+    return true;
+}
+
+int DataGridRows::getSortColumn()
+{
+    if (orderM.empty() || orderM.size() != storeM.getRowCount())
+        return -1;
+    return sortColumnM;
+}
+
+bool DataGridRows::isSortedAscending()
+{
+    return sortAscendingM;
+}
+
+// DataGridRowFilter class: the conditions of a filter for the columns of a
+// result set, with the value converted to the raw value of each column.
+// Rows are matched by reading the column stores of pages, which can be done
+// from several threads at once
+class DataGridRowFilter
+{
+private:
+    struct Condition
     {
-        if (++it == buffersM.end())     // should never happen
+        unsigned col;
+        ResultsetColumnDef* columnDef;
+        ResultsetColumnDef::SortType type;
+        DataGridFilter::Operator op;
+        int64_t intValue;
+        double doubleValue;
+        std::string bytesValue;
+        DataGridTextMatcher matcher;
+    };
+    std::vector<Condition> conditionsM;
+
+    static bool matchesCompare(DataGridFilter::Operator op, int compare);
+    static bool matchesCondition(const Condition& condition,
+        DataGridRowBuffer& buffer);
+public:
+    DataGridRowFilter(const DataGridFilter& filter,
+        const std::vector<ResultsetColumnDef*>& columnDefs);
+
+    bool matches(DataGridColumnStore* page, unsigned pageRow) const;
+};
+
+DataGridRowFilter::DataGridRowFilter(const DataGridFilter& filter,
+    const std::vector<ResultsetColumnDef*>& columnDefs)
+{
+    // the value is converted in a row of its own
+    DataGridRowBuffer value(columnDefs.size());
+    for (unsigned col = 0; col < columnDefs.size(); ++col)
+    {
+        if (filter.column != -1 && filter.column != int(col))
+            continue;
+        Condition condition;
+        condition.intValue = 0;
+        condition.doubleValue = 0;
+        condition.col = col;
+        condition.columnDef = columnDefs[col];
+        condition.type = columnDefs[col]->getSortType();
+        condition.op = filter.op;
+        // BLOBs can only be checked for NULL
+        if (condition.type == ResultsetColumnDef::stNone
+            && filter.op != DataGridFilter::foIsNull
+            && filter.op != DataGridFilter::foIsNotNull)
+        {
+            continue;
+        }
+
+        if (filter.op != DataGridFilter::foIsNull
+            && filter.op != DataGridFilter::foIsNotNull)
+        {
+            try
+            {
+                condition.columnDef->setFromString(&value, filter.value);
+                value.setFieldNull(col, false);
+            }
+            catch (const FRError&)
+            {
+                // the value needs to be valid for the column it is
+                // entered for, with all columns it is simply skipped
+                if (filter.column != -1)
+                    throw;
+                continue;
+            }
+
+            bool converted;
+            const char* data = 0;
+            unsigned length = 0;
+            if (condition.type == ResultsetColumnDef::stInteger)
+            {
+                converted = condition.columnDef->getSortInteger(&value,
+                    condition.intValue);
+            }
+            else if (condition.type == ResultsetColumnDef::stDouble)
+            {
+                converted = condition.columnDef->getSortDouble(&value,
+                    condition.doubleValue);
+            }
+            else
+            {
+                converted = condition.columnDef->getSortBytes(&value, data,
+                    length);
+                condition.bytesValue.assign(data, length);
+                condition.matcher.setString(data, length);
+            }
+            if (!converted)
+                continue;
+            // only strings can contain the value
+            if (condition.op == DataGridFilter::foContains
+                && condition.type != ResultsetColumnDef::stBytes)
+            {
+                condition.op = DataGridFilter::foEqual;
+            }
+        }
+        conditionsM.push_back(condition);
+    }
+}
+
+/*static*/
+bool DataGridRowFilter::matchesCompare(DataGridFilter::Operator op,
+    int compare)
+{
+    switch (op)
+    {
+        case DataGridFilter::foEqual:
+            return compare == 0;
+        case DataGridFilter::foNotEqual:
+            return compare != 0;
+        case DataGridFilter::foLess:
+            return compare < 0;
+        case DataGridFilter::foLessEqual:
+            return compare <= 0;
+        case DataGridFilter::foGreater:
+            return compare > 0;
+        case DataGridFilter::foGreaterEqual:
+            return compare >= 0;
+        default:
             return false;
     }
-    while (count--)
+}
+
+/*static*/
+bool DataGridRowFilter::matchesCondition(const Condition& condition,
+    DataGridRowBuffer& buffer)
+{
+    bool isNull = buffer.isFieldNA(condition.col)
+        || buffer.isFieldNull(condition.col);
+    if (condition.op == DataGridFilter::foIsNull)
+        return isNull;
+    if (isNull)
+        return condition.op == DataGridFilter::foIsNotNull;
+    if (condition.op == DataGridFilter::foIsNotNull)
+        return true;
+
+    if (condition.type == ResultsetColumnDef::stInteger)
+    {
+        int64_t value;
+        if (!condition.columnDef->getSortInteger(&buffer, value))
+            return false;
+        return matchesCompare(condition.op, (value > condition.intValue)
+            - (value < condition.intValue));
+    }
+    if (condition.type == ResultsetColumnDef::stDouble)
+    {
+        double value;
+        if (!condition.columnDef->getSortDouble(&buffer, value))
+            return false;
+        return matchesCompare(condition.op, (value > condition.doubleValue)
+            - (value < condition.doubleValue));
+    }
+    const char* data;
+    unsigned length;
+    if (!condition.columnDef->getSortBytes(&buffer, data, length))
+        return false;
+    if (condition.op == DataGridFilter::foContains)
+        return condition.matcher.contains(data, length);
+    return matchesCompare(condition.op, DataGridTextMatcher::compare(data,
+        length, condition.bytesValue.data(), condition.bytesValue.length()));
+}
+
+// rows match if any condition does, rows inserted by the user are always
+// shown
+bool DataGridRowFilter::matches(DataGridColumnStore* page,
+    unsigned pageRow) const
+{
+    if (page->isRowInserted(pageRow))
+        return true;
+    DataGridRowBuffer buffer(page, pageRow);
+    for (std::vector<Condition>::const_iterator it = conditionsM.begin();
+        it != conditionsM.end(); ++it)
+    {
+        if (matchesCondition(*it, buffer))
+            return true;
+    }
+    return false;
+}
+
+namespace
+{
+
+struct FilterPageScan
+{
+    DataGridColumnStore* page;
+    unsigned firstRow;
+};
+
+// only reads from the store, so it can be run by several threads at once
+void scanFilterPages(const DataGridRowFilter* filter,
+    const DataGridPagedStore* store, const FilterPageScan* first,
+    const FilterPageScan* last, unsigned firstRow, std::vector<char>* matches)
+{
+    for (const FilterPageScan* scan = first; scan != last; ++scan)
+    {
+        unsigned pageRows = scan->page->getRowCount();
+        for (unsigned pageRow = 0; pageRow < pageRows; ++pageRow)
+        {
+            unsigned row = scan->firstRow + pageRow;
+            if (row >= firstRow)
+            {
+                (*matches)[row] = !store->isRowMissing(row)
+                    && filter->matches(scan->page, pageRow);
+            }
+        }
+    }
+}
+
+}
+
+bool DataGridRows::setFilter(const DataGridFilter& filter)
+{
+    unsigned missingRow;
+    if (storeM.findMissingRow(0, missingRow))
+        return false;
+    DataGridRowFilter* rowFilter = new DataGridRowFilter(filter, columnDefsM);
+    clearFilter();
+    filterM = rowFilter;
+    applyFilter(0);
+    buildFilterView();
+    return true;
+}
+
+void DataGridRows::clearFilter()
+{
+    delete filterM;
+    filterM = 0;
+    viewM.clear();
+    matchesM.clear();
+    ++changeCountM;
+}
+
+bool DataGridRows::isFiltered()
+{
+    return filterM != 0;
+}
+
+// the rows added are shown after the others, in the order of the store
+void DataGridRows::updateFilter()
+{
+    if (!filterM || matchesM.size() >= storeM.getRowCount())
+        return;
+    unsigned firstRow = matchesM.size();
+    applyFilter(firstRow);
+    for (unsigned row = firstRow; row < matchesM.size(); ++row)
+    {
+        if (matchesM[row])
+            viewM.push_back(getOrderedRow(row));
+    }
+}
+
+unsigned DataGridRows::getShownRowCount()
+{
+    return filterM ? viewM.size() : storeM.getRowCount();
+}
+
+unsigned DataGridRows::getChangeCount()
+{
+    return changeCountM;
+}
+
+bool DataGridRows::getNumericValues(unsigned col, unsigned from, unsigned to,
+    std::vector<double>& values)
+{
+    if (col >= columnDefsM.size() || !columnDefsM[col]->isNumeric())
+        return false;
+    ResultsetColumnDef* columnDef = columnDefsM[col];
+    bool integer = columnDef->getSortType() == ResultsetColumnDef::stInteger;
+    to = std::min(to, getShownRowCount());
+    for (unsigned row = from; row < to; ++row)
     {
-        i2 = it;
-        if (it != buffersM.begin ())//Prevents it from going before the first one
-          it--;
-        (*i2)->setIsDeleted(true);
+        unsigned storeRow = getStoreRow(row);
+        if (storeM.isRowMissing(storeRow))
+            continue;
+        DataGridRowBuffer buffer(&storeM, storeRow);
+        if (buffer.isFieldNA(col) || buffer.isFieldNull(col))
+            continue;
+        if (integer)
+        {
+            int64_t value;
+            if (columnDef->getSortInteger(&buffer, value))
+                values.push_back(double(value));
+        }
+        else
+        {
+            double value;
+            if (columnDef->getSortDouble(&buffer, value))
+                values.push_back(value);
+        }
     }
     return true;
 }
 
-unsigned DataGridRows::getRowCount()
+// the pages that can stay in memory together are scanned at the same time,
+// each thread scans a part of them
+void DataGridRows::applyFilter(unsigned firstRow)
+{
+    wxASSERT(filterM);
+    unsigned rowCount = storeM.getRowCount();
+    matchesM.resize(rowCount, 0);
+    if (firstRow >= rowCount)
+        return;
+
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    unsigned pageCount = storeM.getPageCount();
+    unsigned groupPages = std::max(1u, storeM.getScanPageCount());
+    std::vector<FilterPageScan> scans;
+    std::vector<std::thread> threads;
+    for (unsigned index = storeM.getPageIndex(firstRow); index < pageCount;
+        index += groupPages)
+    {
+        scans.clear();
+        for (unsigned i = index; i < std::min(pageCount, index + groupPages);
+            ++i)
+        {
+            FilterPageScan scan;
+            scan.page = storeM.getPageByIndex(i, scan.firstRow);
+            scans.push_back(scan);
+        }
+
+        size_t parts = std::min(threadCount, scans.size());
+        for (size_t part = 1; part < parts; ++part)
+        {
+            threads.push_back(std::thread(scanFilterPages, filterM, &storeM,
+                &scans[0] + scans.size() * part / parts,
+                &scans[0] + scans.size() * (part + 1) / parts,
+                firstRow, &matchesM));
+        }
+        scanFilterPages(filterM, &storeM, &scans[0],
+            &scans[0] + scans.size() / parts, firstRow, &matchesM);
+        joinThreads(threads);
+    }
+}
+
+void DataGridRows::buildFilterView()
+{
+    viewM.clear();
+    for (unsigned row = 0; row < matchesM.size(); ++row)
+    {
+        unsigned storeRow = getOrderedRow(row);
+        if (matchesM[storeRow])
+            viewM.push_back(storeRow);
+    }
+}
+
+namespace
 {
-    return buffersM.size();
+
+void appendGroupKey(ResultsetColumnDef* columnDef, DataGridRowBuffer* buffer,
+    unsigned col, std::vector<char>& keys)
+{
+    if (buffer->isFieldNA(col) || buffer->isFieldNull(col))
+    {
+        keys.push_back(0);
+        return;
+    }
+    keys.push_back(1);
+    int64_t integer;
+    double number;
+    const char* data;
+    unsigned length;
+    wxScopedCharBuffer text;
+    switch (columnDef->getSortType())
+    {
+        case ResultsetColumnDef::stInteger:
+            if (columnDef->getSortInteger(buffer, integer))
+            {
+                data = reinterpret_cast<const char*>(&integer);
+                keys.insert(keys.end(), data, data + sizeof(integer));
+            }
+            return;
+        case ResultsetColumnDef::stDouble:
+            if (columnDef->getSortDouble(buffer, number))
+            {
+                // 0.0 and -0.0 are the same group
+                if (number == 0)
+                    number = 0;
+                data = reinterpret_cast<const char*>(&number);
+                keys.insert(keys.end(), data, data + sizeof(number));
+            }
+            return;
+        case ResultsetColumnDef::stBytes:
+            if (!columnDef->getSortBytes(buffer, data, length))
+                return;
+            break;
+        default:
+            text = columnDef->getAsString(buffer).utf8_str();
+            data = text.data();
+            length = text.length();
+            break;
+    }
+    // the length keeps the values of several columns apart
+    const char* lengthData = reinterpret_cast<const char*>(&length);
+    keys.insert(keys.end(), lengthData, lengthData + sizeof(length));
+    keys.insert(keys.end(), data, data + length);
+}
+
+wxString formatGroupValue(double value)
+{
+    if (value == std::floor(value) && std::fabs(value) < 1e18)
+        return wxLongLong(wxLongLong_t(value)).ToString();
+    return wxString::Format("%.15g", value);
+}
+
+wxString getGroupFunctionName(DataGridGrouping::Function function)
+{
+    switch (function)
+    {
+        case DataGridGrouping::gfSum:
+            return "SUM";
+        case DataGridGrouping::gfAverage:
+            return "AVG";
+        case DataGridGrouping::gfMinimum:
+            return "MIN";
+        case DataGridGrouping::gfMaximum:
+            return "MAX";
+        default:
+            return "COUNT";
+    }
+}
+
+} // namespace
+
+// the keys and values are read in the order of the store, then grouped by
+// DataGridGroups
+bool DataGridRows::groupRows(const DataGridGrouping& grouping,
+    DataGridGroupResult& result)
+{
+    const unsigned colCount = columnDefsM.size();
+    std::vector<unsigned> keyColumns(grouping.groupColumns);
+    if (grouping.pivotColumn >= 0)
+        keyColumns.push_back(grouping.pivotColumn);
+    for (std::vector<unsigned>::const_iterator it = keyColumns.begin();
+        it != keyColumns.end(); ++it)
+    {
+        if (*it >= colCount)
+            throw FRError(_("Invalid column."));
+        if (isBlobColumn(*it))
+        {
+            throw FRError(wxString::Format(
+                _("Rows can't be grouped by the BLOB column %s."),
+                columnDefsM[*it]->getName().c_str()));
+        }
+    }
+    const unsigned aggregateCount = grouping.aggregates.size();
+    for (unsigned a = 0; a < aggregateCount; ++a)
+    {
+        const DataGridGrouping::Aggregate& aggregate = grouping.aggregates[a];
+        if (aggregate.column >= int(colCount)
+            || (aggregate.column < 0
+                && aggregate.function != DataGridGrouping::gfCount))
+        {
+            throw FRError(_("Invalid column."));
+        }
+        if (aggregate.function != DataGridGrouping::gfCount
+            && !columnDefsM[aggregate.column]->isNumeric())
+        {
+            throw FRError(wxString::Format(_("Column %s is not numeric."),
+                columnDefsM[aggregate.column]->getName().c_str()));
+        }
+    }
+    unsigned missingRow;
+    if (storeM.findMissingRow(0, missingRow))
+        return false;
+
+    const unsigned unshown = unsigned(-1);
+    const unsigned storeCount = storeM.getRowCount();
+    std::vector<unsigned> positions(storeCount, unshown);
+    for (unsigned row = 0; row < getShownRowCount(); ++row)
+        positions[getStoreRow(row)] = row;
+
+    DataGridGroupInput input;
+    input.aggregateCount = aggregateCount;
+    for (unsigned row = 0; row < storeCount; ++row)
+    {
+        if (positions[row] == unshown)
+            continue;
+        DataGridRowBuffer buffer(&storeM, row);
+        input.keyOffsets.push_back(input.keys.size());
+        for (size_t i = 0; i < keyColumns.size(); ++i)
+        {
+            if (i == grouping.groupColumns.size())
+                input.pivotOffsets.push_back(input.keys.size());
+            appendGroupKey(columnDefsM[keyColumns[i]], &buffer,
+                keyColumns[i], input.keys);
+        }
+        if (grouping.pivotColumn < 0)
+            input.pivotOffsets.push_back(input.keys.size());
+        input.storeRows.push_back(row);
+        input.positions.push_back(positions[row]);
+
+        for (unsigned a = 0; a < aggregateCount; ++a)
+        {
+            int col = grouping.aggregates[a].column;
+            double value = 0;
+            bool null = col >= 0
+                && (buffer.isFieldNA(col) || buffer.isFieldNull(col));
+            if (!null && col >= 0
+                && grouping.aggregates[a].function
+                    != DataGridGrouping::gfCount)
+            {
+                ResultsetColumnDef* columnDef = columnDefsM[col];
+                if (columnDef->getSortType()
+                    == ResultsetColumnDef::stInteger)
+                {
+                    int64_t integer;
+                    null = !columnDef->getSortInteger(&buffer, integer);
+                    value = double(integer);
+                }
+                else
+                    null = !columnDef->getSortDouble(&buffer, value);
+            }
+            input.values.push_back(value);
+            input.nulls.push_back(null ? 1 : 0);
+        }
+    }
+    input.keyOffsets.push_back(input.keys.size());
+    // the keys need valid pointers even if they are all empty
+    input.keys.push_back(0);
+
+    DataGridGroups groups;
+    groups.compute(input);
+    const std::vector<DataGridGroups::Group>& states = groups.getGroups();
+    const std::vector<size_t>& resultRows = groups.getResultRows();
+    const std::vector<size_t>& pivotRows = groups.getPivotRows();
+
+    result.columnNames.clear();
+    result.numericColumns.clear();
+    for (std::vector<unsigned>::const_iterator it =
+        grouping.groupColumns.begin(); it != grouping.groupColumns.end();
+        ++it)
+    {
+        result.columnNames.push_back(columnDefsM[*it]->getName());
+        result.numericColumns.push_back(columnDefsM[*it]->isNumeric());
+    }
+    // without a pivot column there is a single (empty) pivot value, even
+    // if there are no rows
+    size_t pivotCount = pivotRows.size();
+    if (grouping.pivotColumn < 0)
+        pivotCount = 1;
+    for (size_t p = 0; p < pivotCount; ++p)
+    {
+        wxString pivotValue;
+        if (grouping.pivotColumn >= 0)
+        {
+            DataGridRowBuffer buffer(&storeM, input.storeRows[pivotRows[p]]);
+            if (buffer.isFieldNull(grouping.pivotColumn))
+                pivotValue = " [null]";
+            else
+            {
+                pivotValue = " [" + columnDefsM[grouping.pivotColumn]
+                    ->getAsString(&buffer) + "]";
+            }
+        }
+        for (unsigned a = 0; a < aggregateCount; ++a)
+        {
+            const DataGridGrouping::Aggregate& aggregate =
+                grouping.aggregates[a];
+            wxString name = getGroupFunctionName(aggregate.function) + "("
+                + (aggregate.column < 0 ? wxString("*")
+                    : columnDefsM[aggregate.column]->getName()) + ")";
+            result.columnNames.push_back(name + pivotValue);
+            result.numericColumns.push_back(true);
+        }
+    }
+
+    const size_t groupColCount = grouping.groupColumns.size();
+    result.rows.assign(resultRows.size(),
+        std::vector<wxString>(result.columnNames.size()));
+    for (size_t r = 0; r < resultRows.size(); ++r)
+    {
+        DataGridRowBuffer buffer(&storeM, input.storeRows[resultRows[r]]);
+        for (size_t c = 0; c < groupColCount; ++c)
+        {
+            unsigned col = grouping.groupColumns[c];
+            if (buffer.isFieldNull(col))
+                result.rows[r][c] = "[null]";
+            else
+                result.rows[r][c] = columnDefsM[col]->getAsString(&buffer);
+        }
+    }
+    for (size_t s = 0; s < states.size(); ++s)
+    {
+        std::vector<wxString>& row = result.rows[states[s].resultRow];
+        size_t c = groupColCount + states[s].pivot * aggregateCount;
+        for (unsigned a = 0; a < aggregateCount; ++a, ++c)
+        {
+            const DataGridGroups::Aggregate& values = states[s].aggregates[a];
+            switch (grouping.aggregates[a].function)
+            {
+                case DataGridGrouping::gfCount:
+                    row[c] = wxString::Format("%u",
+                        grouping.aggregates[a].column < 0
+                            ? states[s].rowCount : values.count);
+                    break;
+                case DataGridGrouping::gfSum:
+                    if (values.count)
+                        row[c] = formatGroupValue(values.sum);
+                    break;
+                case DataGridGrouping::gfAverage:
+                    if (values.count)
+                        row[c] = formatGroupValue(values.sum / values.count);
+                    break;
+                case DataGridGrouping::gfMinimum:
+                    if (values.count)
+                        row[c] = formatGroupValue(values.min);
+                    break;
+                case DataGridGrouping::gfMaximum:
+                    if (values.count)
+                        row[c] = formatGroupValue(values.max);
+                    break;
+            }
+        }
+    }
+    return true;
 }
 
 unsigned DataGridRows::getRowFieldCount()
@@ -1740,16 +3206,16 @@ bool DataGridRows::initialize(const IBPP::Statement& statement)
     statementM = statement;
 
     clear();
-    // column definitions may have an index into the string array,
-    // an offset into the buffer, or use no data at all
+    // rows exceeding the memory limit are swapped out to a temporary file
+    storeM.setMemoryLimit(
+        size_t(config().get("DataGridMemoryLimit", 512)) * 1024 * 1024);
+    // every column definition stores its data in the column of the store
+    // with the same index, the store needs to know the size of fixed-size
+    // values, variable-length data goes into the arena
     unsigned colCount = statement->Columns();
     columnDefsM.reserve(colCount);
-    bufferSizeM = 0;
-    unsigned stringIndex = 0;
-    unsigned blobIndex = 0;
 
-    // Create column definitions and compute the necessary buffer size
-    // and string array length when all fields contain data
+    // Create column definitions and the store columns
     for (unsigned col = 1; col <= colCount; ++col)
     {
         bool readOnly, nullable;
@@ -1767,57 +3233,61 @@ bool DataGridRows::initialize(const IBPP::Statement& statement)
         if (statement->ColumnScale(col) > 0)
             type = IBPP::sdDouble;
 
+        unsigned index = col - 1;
         ResultsetColumnDef* columnDef = 0;
         if (std::string(statement->ColumnName(col)) == "DB_KEY")
-            columnDef = new DBKeyColumnDef(colName, bufferSizeM, statement->ColumnSize(col));
+            columnDef = new DBKeyColumnDef(colName, index);
         else
         {
             switch (type)
             {
                 case IBPP::sdBoolean: // Firebird v3
-                    columnDef = new BooleanColumnDef(colName, stringIndex, readOnly, nullable);
-                    ++stringIndex;
+                    columnDef = new BooleanColumnDef(colName, index, readOnly, nullable, databaseM->getCharsetConverter());
                     break;
                 case IBPP::sdDate:
-                    columnDef = new DateColumnDef(colName, bufferSizeM, readOnly, nullable);
+                    columnDef = new DateColumnDef(colName, index, readOnly, nullable);
                     break;
                 case IBPP::sdTime:
-                    columnDef = new TimeColumnDef(colName, bufferSizeM, readOnly, nullable);
+                    columnDef = new TimeColumnDef(colName, index, readOnly, nullable);
                     break;
                 case IBPP::sdTimestamp:
-                    columnDef = new TimestampColumnDef(colName, bufferSizeM, readOnly, nullable);
+                    columnDef = new TimestampColumnDef(colName, index, readOnly, nullable);
                     break;
 
                 case IBPP::sdSmallint:
                 case IBPP::sdInteger:
-                    columnDef = new IntegerColumnDef(colName, bufferSizeM, readOnly, nullable);
+                    columnDef = new IntegerColumnDef(colName, index, readOnly, nullable);
                     break;
                 case IBPP::sdLargeint:
-                    columnDef = new Int64ColumnDef(colName, bufferSizeM, readOnly, nullable);
+                    columnDef = new Int64ColumnDef(colName, index, readOnly, nullable);
                     break;
 
                 case IBPP::sdFloat:
-                    columnDef = new FloatColumnDef(colName, bufferSizeM, readOnly, nullable);
+                    columnDef = new FloatColumnDef(colName, index, readOnly, nullable);
                     break;
                 case IBPP::sdDouble:
-                    columnDef = new DoubleColumnDef(colName, bufferSizeM, readOnly, nullable, statement->ColumnScale(col));
+                    columnDef = new DoubleColumnDef(colName, index, readOnly, nullable, statement->ColumnScale(col));
                     break;
 
                 case IBPP::sdString:
                 {
-                    CharacterSet cs = databaseM->getCharsetById(statement->ColumnSubtype(col));
+                    int subtype = statement->ColumnSubtype(col);
+                    CharacterSet cs = databaseM->getCharsetById(subtype);
                     int bpc = cs.getBytesPerChar();
                     int size = statement->ColumnSize(col);
                     if (bpc)
                         size /= bpc;
-                    columnDef = new StringColumnDef(colName, stringIndex, readOnly, nullable, size);
-                    ++stringIndex;
+                    // the collation ID is in the high byte of the subtype,
+                    // the default collations and UCS_BASIC are binary
+                    int collation = subtype / 256;
+                    bool binary = collation == 0
+                        || (subtype % 256 == 4 && collation == 1);
+                    columnDef = new StringColumnDef(colName, index, readOnly, nullable, size, subtype % 256 == 1, binary, databaseM->getCharsetConverter());
                     break;
                 }
                 case IBPP::sdBlob:
-                    columnDef = new BlobColumnDef(colName, readOnly, nullable, stringIndex, blobIndex, statement->ColumnSubtype(col) == 1);
-                    ++blobIndex;    // stores blob handle
-                    ++stringIndex;  // stored blob data (fetched on demand)
+                    // stores blob handle and blob data (fetched on demand)
+                    columnDef = new BlobColumnDef(colName, readOnly, nullable, index, statement->ColumnSubtype(col) == 1, databaseM->getCharsetConverter());
                     break;
                 default:
                     // IBPP::sdArray not really handled ATM
@@ -1826,7 +3296,7 @@ bool DataGridRows::initialize(const IBPP::Statement& statement)
             }
         }
         wxASSERT(columnDef);
-        bufferSizeM += columnDef->getBufferSize();
+        storeM.addColumn(columnDef->getBufferSize());
         columnDefsM.push_back(columnDef);
     }
     return true;
@@ -1856,16 +3326,18 @@ bool DataGridRows::isColumnReadonly(unsigned col)
 bool DataGridRows::getFieldInfo(unsigned row, unsigned col,
     DataGridFieldInfo& info)
 {
-    if (col >= columnDefsM.size() || row >= buffersM.size())
+    if (col >= columnDefsM.size() || row >= getShownRowCount())
         return false;
-    info.rowInserted = buffersM[row]->isInserted();
-    info.rowDeleted = buffersM[row]->isDeleted();
-    info.fieldReadOnly = readOnlyM || info.rowDeleted
+    unsigned storeRow = getStoreRow(row);
+    bool missing = storeM.isRowMissing(storeRow);
+    info.rowInserted = storeM.isRowInserted(storeRow);
+    info.rowDeleted = storeM.isRowDeleted(storeRow);
+    info.fieldReadOnly = readOnlyM || info.rowDeleted || missing
         || isColumnReadonly(col) || isFieldReadonly(row, col);
     info.fieldModified = !info.rowDeleted
-        && buffersM[row]->isFieldModified(col);
-    info.fieldNull = buffersM[row]->isFieldNull(col);
-    info.fieldNA = buffersM[row]->isFieldNA(col);
+        && storeM.isRowModified(storeRow);
+    info.fieldNull = !missing && storeM.isFieldNull(storeRow, col);
+    info.fieldNA = missing || storeM.isFieldNA(storeRow, col);
     info.fieldNumeric = isColumnNumeric(col);
     info.fieldBlob = isBlobColumn(col);
     return true;
@@ -1873,14 +3345,15 @@ bool DataGridRows::getFieldInfo(unsigned row, unsigned col,
 
 bool DataGridRows::isFieldReadonly(unsigned row, unsigned col)
 {
-    if (col >= columnDefsM.size() || row >= buffersM.size())
+    if (col >= columnDefsM.size() || row >= getShownRowCount())
         return false;
     if (columnDefsM[col]->isReadOnly())
         return true;
+    row = getStoreRow(row);
 
     // if row is loaded from the database and not inserted by user, we don't
     // need to check anything else
-    if (!buffersM[row]->isInserted())
+    if (!storeM.isRowInserted(row))
         return false;
 
     // TODO: this needs to be cached too
@@ -1904,7 +3377,7 @@ bool DataGridRows::isFieldReadonly(unsigned row, unsigned col)
                 continue;
             wxString tn(std2wxIdentifier(statementM->ColumnTable(c2),
                 databaseM->getCharsetConverter()));
-            if (tn == table && buffersM[row]->isFieldNA(c2-1))
+            if (tn == table && storeM.isFieldNA(row, c2-1))
                 return true;
         }
     }
@@ -1913,38 +3386,35 @@ bool DataGridRows::isFieldReadonly(unsigned row, unsigned col)
 
 wxString DataGridRows::getFieldValue(unsigned row, unsigned col)
 {
-    if (row >= buffersM.size() || col >= columnDefsM.size())
+    if (row >= getShownRowCount() || col >= columnDefsM.size())
         return wxEmptyString;
-    return columnDefsM[col]->getAsString(buffersM[row]);
+    DataGridRowBuffer buffer(&storeM, getStoreRow(row));
+    return columnDefsM[col]->getAsString(&buffer);
 }
 
 bool DataGridRows::isFieldNull(unsigned row, unsigned col)
 {
-    if (row >= buffersM.size())
-        return false;
-    return buffersM[row]->isFieldNull(col);
+    row = getStoreRow(row);
+    return !storeM.isRowMissing(row) && storeM.isFieldNull(row, col);
 }
 
+// fields of rows not yet fetched are not available either
 bool DataGridRows::isFieldNA(unsigned row, unsigned col)
 {
-    if (row >= buffersM.size())
-        return false;
-    return buffersM[row]->isFieldNA(col);
+    row = getStoreRow(row);
+    return storeM.isRowMissing(row) || storeM.isFieldNA(row, col);
 }
 
-IBPP::Statement DataGridRows::addWhere(UniqueConstraint* uq, wxString& stm,
-    const wxString& table, DataGridRowBuffer *buffer)
+// appends the condition on the key columns to stm with the values of the
+// row, and to sql with parameters, whose columns are added to paramColumns
+void DataGridRows::addWhere(UniqueConstraint* uq, wxString& stm,
+    wxString& sql, std::vector<unsigned>& paramColumns, const wxString& table,
+    DataGridRowBuffer *buffer)
 {
-    bool dbkey = false;
     for (ColumnConstraint::const_iterator ci = uq->begin(); ci !=
         uq->end(); ++ci)
     {
-        if ((*ci) == "DB_KEY")
-        {
-            stm += " RDB$DB_KEY = ?";
-            dbkey = true;
-            break;
-        }
+        bool dbkey = ((*ci) == "DB_KEY");
         for (int c2 = 1; c2 <= statementM->Columns(); ++c2)
         {
             wxString cn(std2wxIdentifier(statementM->ColumnName(c2),
@@ -1954,44 +3424,170 @@ IBPP::Statement DataGridRows::addWhere(UniqueConstraint* uq, wxString& stm,
             if (cn == (*ci) && tn == table) // found it, add to WHERE list
             {
                 if (buffer->isFieldNA(c2-1))
+                {
+                    if (dbkey)
+                        throw FRError(_("N/A value in DB_KEY column."));
                     throw FRError(_("N/A value in key column."));
-                if (ci != uq->begin())
-                    stm += " AND ";
-                stm += Identifier(cn).getQuoted() + " = '";
-                stm += columnDefsM[c2-1]->getAsFirebirdString(buffer);
-                stm += "'";
+                }
+                if (dbkey)
+                {
+                    if (!dynamic_cast<DBKeyColumnDef *>(columnDefsM[c2-1]))
+                        throw FRError(_("Invalid Column"));
+                    stm += " RDB$DB_KEY = ?";
+                    sql += " RDB$DB_KEY = ?";
+                }
+                else
+                {
+                    if (ci != uq->begin())
+                    {
+                        stm += " AND ";
+                        sql += " AND ";
+                    }
+                    stm += Identifier(cn).getQuoted() + " = '";
+                    stm += columnDefsM[c2-1]->getAsFirebirdString(buffer);
+                    stm += "'";
+                    sql += Identifier(cn).getQuoted() + " = ?";
+                }
+                paramColumns.push_back(c2-1);
                 break;
             }
         }
+        if (dbkey)
+            break;
     }
+}
 
-    IBPP::Statement st = IBPP::StatementFactory(statementM->DatabasePtr(),
-        statementM->TransactionPtr());
-    st->Prepare(wx2std(stm, databaseM->getCharsetConverter()));
-    if (dbkey)  // find the column and set the parameter
+// the statement comes from the statement cache of the database, so that
+// changing many rows of the same table prepares it only once
+IBPP::Statement DataGridRows::prepareStatement(const wxString& sql,
+    const std::vector<unsigned>& paramColumns, int firstParam,
+    DataGridRowBuffer* buffer)
+{
+    wxMBConv* converter = databaseM->getCharsetConverter();
+    IBPP::Statement st = databaseM->getStatementCache()->getStatement(
+        statementM->TransactionPtr(), wx2std(sql, converter));
+    for (size_t i = 0; i < paramColumns.size(); ++i)
     {
-        for (int c2 = 1; c2 <= statementM->Columns(); ++c2)
+        columnDefsM[paramColumns[i]]->setParameter(st, firstParam + int(i),
+            buffer, converter);
+    }
+    return st;
+}
+
+// only types whose literals compare exactly like the fetched values
+bool DataGridRows::getKeyColumns(std::vector<unsigned>& columns)
+{
+    columns.clear();
+    wxMBConv* converter = databaseM->getCharsetConverter();
+    wxString tableName;
+    for (int c = 1; c <= statementM->Columns() && tableName.empty(); ++c)
+        tableName = std2wxIdentifier(statementM->ColumnTable(c), converter);
+
+    Table* t = dynamic_cast<Table *>(
+        databaseM->findRelation(Identifier(tableName)));
+    if (!t)
+        return false;
+    PrimaryKeyConstraint* pk = t->getPrimaryKey();
+    if (!pk)
+        return false;
+    for (ColumnConstraint::const_iterator ci = pk->begin(); ci != pk->end();
+        ++ci)
+    {
+        int col = 0;
+        for (int c2 = 1; c2 <= statementM->Columns() && !col; ++c2)
         {
             wxString cn(std2wxIdentifier(statementM->ColumnName(c2),
-                databaseM->getCharsetConverter()));
+                converter));
             wxString tn(std2wxIdentifier(statementM->ColumnTable(c2),
-                databaseM->getCharsetConverter()));
-            if (cn == "DB_KEY" && tn == table)
-            {
-                DBKeyColumnDef *dbk =
-                    dynamic_cast<DBKeyColumnDef *>(columnDefsM[c2-1]);
-                if (!dbk)
-                    throw FRError(_("Invalid Column"));
-                if (buffer->isFieldNA(c2-1))
-                    throw FRError(_("N/A value in DB_KEY column."));
-                IBPP::DBKey dbkey;
-                dbk->getDBKey(dbkey, buffer);
-                // if updating BLOB, param = 2, else param = 1
-                st->Set(st->Parameters(), dbkey);
-            }
+                converter));
+            if (cn == (*ci) && tn == tableName)
+                col = c2;
         }
+        if (!col || statementM->ColumnScale(col) != 0)
+            return false;
+        switch (statementM->ColumnType(col))
+        {
+            case IBPP::sdSmallint:
+            case IBPP::sdInteger:
+            case IBPP::sdLargeint:
+            case IBPP::sdDate:
+                break;
+            case IBPP::sdString:
+                if (statementM->ColumnSubtype(col) == 1) // charset OCTETS
+                    return false;
+                break;
+            default:
+                return false;
+        }
+        columns.push_back(col - 1);
+    }
+    return !columns.empty();
+}
+
+wxString DataGridRows::getKeyOrder(const std::vector<unsigned>& columns)
+{
+    wxString order;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        wxString cn(std2wxIdentifier(statementM->ColumnName(columns[i] + 1),
+            databaseM->getCharsetConverter()));
+        if (i > 0)
+            order += ", ";
+        order += Identifier(cn).getQuoted();
+    }
+    return order;
+}
+
+// (K1 > ?) OR (K1 = ? AND K2 > ?) OR ..., the parameters are the values
+// of the columns in paramColumns
+wxString DataGridRows::getKeyCondition(const std::vector<unsigned>& columns,
+    std::vector<unsigned>& paramColumns)
+{
+    paramColumns.clear();
+    wxString condition, equal;
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        unsigned col = columns[i];
+        wxString cn(Identifier(std2wxIdentifier(
+            statementM->ColumnName(col + 1),
+            databaseM->getCharsetConverter())).getQuoted());
+
+        if (i > 0)
+            condition += " OR ";
+        condition += "(" + equal + cn + " > ?)";
+        equal += cn + " = ? AND ";
+        paramColumns.insert(paramColumns.end(), columns.begin(),
+            columns.begin() + i + 1);
+    }
+    return condition;
+}
+
+// the values are copied, so the row can be changed or removed meanwhile
+DataGridRowBuffer* DataGridRows::copyKeyRow(
+    const std::vector<unsigned>& columns, unsigned row)
+{
+    if (row >= storeM.getRowCount())
+        throw FRError(_("Invalid row index."));
+    DataGridRowBuffer buffer(&storeM, row);
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        if (buffer.isFieldNA(columns[i]) || buffer.isFieldNull(columns[i]))
+            throw FRError(_("N/A value in key column."));
+    }
+    return new DataGridRowBuffer(&buffer);
+}
+
+// the values are set with their own types, so they don't depend on how
+// they would be formatted as strings
+void DataGridRows::setKeyParameters(const IBPP::Statement& statement,
+    const std::vector<unsigned>& paramColumns, DataGridRowBuffer* keyRow)
+{
+    wxMBConv* converter = databaseM->getCharsetConverter();
+    for (size_t i = 0; i < paramColumns.size(); ++i)
+    {
+        columnDefsM[paramColumns[i]]->setParameter(statement, int(i) + 1,
+            keyRow, converter);
     }
-    return st;
 }
 
 bool DataGridRows::isBlobColumn(unsigned col, bool* pIsTextual)
@@ -2004,11 +3600,12 @@ bool DataGridRows::isBlobColumn(unsigned col, bool* pIsTextual)
 
 IBPP::Blob* DataGridRows::getBlob(unsigned row, unsigned col, bool validateBlob)
 {
-    if (row >= buffersM.size())
+    if (row >= getShownRowCount())
       throw FRError(_("Invalid row index."));
     if (col >= columnDefsM.size())
       throw FRError(_("Invalid col index."));
-    IBPP::Blob* b0 = buffersM[row]->getBlob(columnDefsM[col]->getIndex());
+    IBPP::Blob* b0 = storeM.getBlob(getStoreRow(row),
+        columnDefsM[col]->getIndex());
     if ((validateBlob) && (!b0))
         throw FRError(_("BLOB data not valid"));
     return b0;
@@ -2018,6 +3615,9 @@ IBPP::Blob* DataGridRows::getBlob(unsigned row, unsigned col, bool validateBlob)
 // Finally the BLOB will be set with setBlob(...)
 DataGridRowsBlob DataGridRows::setBlobPrepare(unsigned row, unsigned col)
 {
+    if (storeM.isRowMissing(getStoreRow(row)))
+        throw FRError(_("The row has not been fetched yet."));
+
     wxString tn(std2wxIdentifier(statementM->ColumnTable(col + 1),
         databaseM->getCharsetConverter()));
     wxString cn(std2wxIdentifier(statementM->ColumnName(col + 1),
@@ -2037,7 +3637,12 @@ DataGridRowsBlob DataGridRows::setBlobPrepare(unsigned row, unsigned col)
     DataGridRowsBlob b;
     b.row = row;
     b.col = col;
-    b.st = addWhere((*it).second, stm, tn, buffersM[row]);
+    DataGridRowBuffer buffer(&storeM, getStoreRow(row));
+    wxString sql(stm);
+    std::vector<unsigned> paramColumns;
+    addWhere((*it).second, stm, sql, paramColumns, tn, &buffer);
+    // the first parameter is the blob
+    b.st = prepareStatement(sql, paramColumns, 2, &buffer);
     b.blob = IBPP::BlobFactory(b.st->DatabasePtr(), b.st->TransactionPtr());
     return b;
 }
@@ -2050,13 +3655,60 @@ void DataGridRows::setBlob(DataGridRowsBlob &b)
         b.st->Execute();  // we execute before updating internal storage
     }
     
-    buffersM[b.row]->setBlob(columnDefsM[b.col]->getIndex(), b.blob);
-    buffersM[b.row]->setFieldNull(b.col, (b.blob == 0));
-    buffersM[b.row]->setFieldNA(b.col, false);
+    DataGridRowBuffer buffer(&storeM, getStoreRow(b.row));
+    buffer.setBlob(columnDefsM[b.col]->getIndex(), b.blob);
+    buffer.setFieldNull(b.col, (b.blob == 0));
+    buffer.setFieldNA(b.col, false);
     BlobColumnDef *bcd = dynamic_cast<BlobColumnDef *>(columnDefsM[b.col]);
     if (!bcd)
         throw FRError(_("Not a BLOB column."));
-    bcd->reset(buffersM[b.row]);  // reset cached blob data
+    bcd->reset(&buffer);  // reset cached blob data
+}
+
+namespace
+{
+
+// shows the transfer rate of blob import / export in the progress message
+class BlobTransferProgress
+{
+private:
+    ProgressIndicator* piM;
+    wxString messageM;
+    wxStopWatch watchM;
+    wxLongLong bytesM;
+    long lastUpdateM;
+public:
+    BlobTransferProgress(ProgressIndicator* pi, const wxString& message,
+            size_t size)
+        : piM(pi), messageM(message), bytesM(0), lastUpdateM(0)
+    {
+        if (piM)
+            piM->initProgress(messageM, size);
+    }
+    bool isCanceled()
+    {
+        return piM && piM->isCanceled();
+    }
+    void step(size_t bytes)
+    {
+        if (!piM)
+            return;
+        bytesM += bytes;
+        piM->stepProgress(bytes);
+        long now = watchM.Time();
+        if (now - lastUpdateM >= 250 && now > 0)
+        {
+            lastUpdateM = now;
+            double mbPerSec = bytesM.ToDouble() / 1048.576 / now;
+            piM->setProgressMessage(wxString::Format(_("%s (%.1f MB/s)"),
+                messageM.c_str(), mbPerSec));
+        }
+    }
+};
+
+// size of the buffer used to stream blobs from and to files
+const int blobFileBufferSize = 1024 * 1024;
+
 }
 
 void DataGridRows::exportBlobFile(const wxString& filename, unsigned row,
@@ -2068,20 +3720,20 @@ void DataGridRows::exportBlobFile(const wxString& filename, unsigned row,
     IBPP::Blob *b0 = getBlob(row,col,true);
     IBPP::Blob b = *b0;
 
+    b->SetReadAhead(true);
     b->Open();
     int size;
     b->Info(&size, 0, 0);
-    if (pi)
-        pi->initProgress(_("Saving..."), size);
-    while (!pi || !pi->isCanceled())
+    BlobTransferProgress progress(pi, _("Saving..."), size);
+    std::vector<char> buffer(blobFileBufferSize);
+    while (!progress.isCanceled())
     {
-        uint8_t buffer[32768];
-        int size = b->Read((void*)buffer, 32767);
-        if (size < 1)
+        // the next block is read while this one is written to the file
+        int bytesRead = b->ReadBlock(&buffer[0], blobFileBufferSize);
+        if (bytesRead < 1)
             break;
-        fl.Write(buffer, size);
-        if (pi)
-            pi->stepProgress(size);
+        fl.Write(&buffer[0], bytesRead);
+        progress.step(bytesRead);
     }
     fl.Close();
     b->Close();
@@ -2093,24 +3745,22 @@ void DataGridRows::importBlobFile(const wxString& filename, unsigned row,
     wxFFile fl(filename, "rb");
     if (!fl.IsOpened())
         throw FRError(_("Cannot open BLOB file."));
-    if (pi)
-        pi->initProgress(_("Loading..."), fl.Length()); // wxFileOffset
+    BlobTransferProgress progress(pi, _("Loading..."), fl.Length());
 
     DataGridRowsBlob b = setBlobPrepare(row,col);
     b.blob->Create();
-    uint8_t buffer[32768];
+    std::vector<char> buffer(blobFileBufferSize);
     while (!fl.Eof())
     {
-        size_t len = fl.Read(buffer, 32767);    // slow when not 32k
-        if (len < 1 || (pi && pi->isCanceled()))
+        size_t len = fl.Read(&buffer[0], blobFileBufferSize);
+        if (len < 1 || progress.isCanceled())
             break;
-        b.blob->Write(buffer, len);
-        if (pi)
-            pi->stepProgress(len);
+        b.blob->WriteBlock(&buffer[0], len);
+        progress.step(len);
     }
     fl.Close();
     b.blob->Close();
-    if (pi && pi->isCanceled())
+    if (progress.isCanceled())
         return;
 
     setBlob(b);
@@ -2122,6 +3772,10 @@ wxString DataGridRows::setFieldValue(unsigned row, unsigned col,
 {
     if (columnDefsM[col]->isReadOnly())
         throw FRError(_("This column is not editable."));
+    row = getStoreRow(row);
+    if (storeM.isRowMissing(row))
+        throw FRError(_("The row has not been fetched yet."));
+    ++changeCountM;
 
     // user wants to store null
     bool newIsNull = (
@@ -2130,26 +3784,20 @@ wxString DataGridRows::setFieldValue(unsigned row, unsigned col,
     if (newIsNull && !columnDefsM[col]->isNullable())
         throw FRError(_("This column does not accept NULLs."));
 
-    // to ensure atomicity, we create a temporary buffer, try to store value
-    // in it and also in database. if anything fails, we revert to the values
-    // from temp buffer
-    DataGridRowBuffer *oldRecord;
-    // we create a copy of appropriate type
-    InsertedGridRowBuffer *test =
-        dynamic_cast<InsertedGridRowBuffer *>(buffersM[row]);
-    if (test)
-        oldRecord = new InsertedGridRowBuffer(test);
-    else
-        oldRecord = new DataGridRowBuffer(buffersM[row]);
+    // to ensure atomicity, we save a copy of the row, store the value in
+    // the row and also in database. if anything fails, we revert to the
+    // values from the copy
+    DataGridRowBuffer buffer(&storeM, row);
+    DataGridRowBuffer oldRecord(&buffer);
     try
     {
-        buffersM[row]->setFieldNA(col, false);
+        buffer.setFieldNA(col, false);
         if (newIsNull)
-            buffersM[row]->setFieldNull(col, true);
+            buffer.setFieldNull(col, true);
         else
         {
-            columnDefsM[col]->setFromString(buffersM[row], value);
-            buffersM[row]->setFieldNull(col, false);
+            columnDefsM[col]->setFromString(&buffer, value);
+            buffer.setFieldNull(col, false);
         }
 
         // run the UPDATE statement
@@ -2161,15 +3809,22 @@ wxString DataGridRows::setFieldValue(unsigned row, unsigned col,
         Identifier iTn(tn, databaseM->getSqlDialect());
         Identifier iCn(cn, databaseM->getSqlDialect());
 
+        // the statement executed has parameters for the values, the one
+        // returned has them in the text
         wxString stm = "UPDATE " + iTn.getQuoted()
             + " SET " + iCn.getQuoted();
+        wxString sql(stm);
+        std::vector<unsigned> paramColumns;
         if (newIsNull)
+        {
             stm += " = NULL WHERE ";
+            sql += " = NULL WHERE ";
+        }
         else
         {
-            stm += " = '" +
-                columnDefsM[col]->getAsFirebirdString(buffersM[row])
+            stm += " = '" + columnDefsM[col]->getAsFirebirdString(&buffer)
                 + "' WHERE ";
+            sql += " = ? WHERE ";
         }
 
         std::map<wxString, UniqueConstraint *>::iterator it =
@@ -2180,15 +3835,21 @@ wxString DataGridRows::setFieldValue(unsigned row, unsigned col,
         if (it == statementTablesM.end() || (*it).second == 0)
             throw FRError(_("This column should not be editable"));
 
-        IBPP::Statement st = addWhere((*it).second, stm, tn, oldRecord);
+        // the key values are those of the row before the change
+        addWhere((*it).second, stm, sql, paramColumns, tn, &oldRecord);
+        IBPP::Statement st = prepareStatement(sql, paramColumns,
+            newIsNull ? 1 : 2, &oldRecord);
+        if (!newIsNull)
+        {
+            columnDefsM[col]->setParameter(st, 1, &buffer,
+                databaseM->getCharsetConverter());
+        }
         st->Execute();
-        delete oldRecord;
         return stm;
     }
     catch(...)
     {
-        delete buffersM[row];       // delete the new record as it is invalid
-        buffersM[row] = oldRecord;
+        buffer.copyFrom(&oldRecord);    // the new values are invalid
         throw;
     }
 }
@@ -30,10 +30,11 @@
 
 #include <ibpp.h>
 
+#include "gui/controls/DataGridRowBuffer.h"
 #include "metadata/constraints.h"
 
 class Database;
-class DataGridRowBuffer;
+class DataGridRowFilter;
 class ProgressIndicator;
 class wxMBConv;
 
@@ -61,6 +62,29 @@ public:
     bool isNullable();
     virtual void setValue(DataGridRowBuffer* buffer, unsigned col,
         const IBPP::Statement& statement, wxMBConv* converter) = 0;
+    // stores the non-null values of the column for the given rows of the
+    // batch into the rows of the store following firstRow, which are new
+    // rows, so the values are written to the store directly
+    virtual void setValues(DataGridColumnStore* store, unsigned firstRow,
+        unsigned col, const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, wxMBConv* converter) = 0;
+    // sets the value of the column as statement parameter, with the type
+    // of the column
+    virtual void setParameter(const IBPP::Statement& statement, int param,
+        DataGridRowBuffer* buffer, wxMBConv* converter);
+
+    // the rows are sorted locally by the raw values of the column, the
+    // sort type tells which of the getSortXXX() methods returns them, they
+    // return false for NULL
+    enum SortType { stNone, stInteger, stDouble, stBytes };
+    virtual SortType getSortType();
+    virtual bool getSortInteger(DataGridRowBuffer* buffer, int64_t& value);
+    virtual bool getSortDouble(DataGridRowBuffer* buffer, double& value);
+    virtual bool getSortBytes(DataGridRowBuffer* buffer, const char*& data,
+        unsigned& length);
+    // whether the order of the sort values is the order of ORDER BY, which
+    // isn't the case for strings with a non-binary collation
+    virtual bool isSortedAsServer();
 };
 
 struct DataGridFieldInfo
@@ -74,6 +98,40 @@ struct DataGridFieldInfo
     bool fieldNumeric;
     bool fieldBlob;
 };
+// condition for the rows shown, the value is entered as in the grid
+struct DataGridFilter
+{
+    enum Operator { foContains, foEqual, foNotEqual, foLess, foLessEqual,
+        foGreater, foGreaterEqual, foIsNull, foIsNotNull };
+    // -1 to show the rows with any column matching
+    int column;
+    Operator op;
+    wxString value;
+};
+// groups the rows by the values of some columns, like GROUP BY does
+struct DataGridGrouping
+{
+    enum Function { gfCount, gfSum, gfAverage, gfMinimum, gfMaximum };
+    struct Aggregate
+    {
+        // -1 for COUNT(*), the other functions need a numeric column
+        int column;
+        Function function;
+    };
+    std::vector<unsigned> groupColumns;
+    // -1, or the column whose values become columns of the result, with
+    // the aggregates of the rows having that value
+    int pivotColumn;
+    std::vector<Aggregate> aggregates;
+};
+struct DataGridGroupResult
+{
+    std::vector<wxString> columnNames;
+    std::vector<bool> numericColumns;
+    // a row for every group, in the order the groups are first shown
+    std::vector<std::vector<wxString> > rows;
+};
+
 struct DataGridRowsBlob
 {
     IBPP::Blob blob;
@@ -89,23 +147,97 @@ private:
     const bool readOnlyM;
     IBPP::Statement statementM;
     std::vector<ResultsetColumnDef*> columnDefsM;
-    std::vector<DataGridRowBuffer*> buffersM;
+    DataGridPagedStore storeM;
     std::map<wxString, UniqueConstraint *> statementTablesM;
     std::map<wxString, UniqueConstraint *>::iterator deleteFromM;
     std::list<UniqueConstraint> dbKeysM;
-    unsigned bufferSizeM;
+    // rows of the store in the order they are shown, rows following them
+    // (fetched after the rows were sorted) are shown in the store order
+    std::vector<unsigned> orderM;
+    unsigned sortColumnM;
+    bool sortAscendingM;
+    // when filtered the rows of the store shown, in the order shown, and
+    // for all rows of the store whether they match the filter
+    DataGridRowFilter* filterM;
+    std::vector<unsigned> viewM;
+    std::vector<char> matchesM;
+    unsigned changeCountM;
+
+    unsigned getOrderedRow(unsigned row) const;
+    unsigned getStoreRow(unsigned row) const;
+    void applyFilter(unsigned firstRow);
+    void buildFilterView();
 
     void getColumnInfo(Database* db, unsigned col, bool& readOnly,
         bool& nullable);
-    IBPP::Statement addWhere(UniqueConstraint* uq, wxString& stm,
-        const wxString& table, DataGridRowBuffer *buffer);
+    void setRowValues(DataGridRowBuffer* buffer,
+        const IBPP::Statement& statement);
+    void addRows(const DataGridColumnStore& rows);
+    void setBatchValues(const IBPP::ColumnBatch& batch, unsigned batchRow,
+        unsigned rows, DataGridColumnStore* store, unsigned firstRow);
+    void createBlobs(DataGridColumnStore* store, unsigned firstRow,
+        unsigned rows, const IBPP::Database& database,
+        const IBPP::Transaction& transaction);
+    void addWhere(UniqueConstraint* uq, wxString& stm, wxString& sql,
+        std::vector<unsigned>& paramColumns, const wxString& table,
+        DataGridRowBuffer *buffer);
+    IBPP::Statement prepareStatement(const wxString& sql,
+        const std::vector<unsigned>& paramColumns, int firstParam,
+        DataGridRowBuffer* buffer);
 public:
     DataGridRows(Database* db);
     ~DataGridRows();
 
     void addRow(const IBPP::Statement& statement);
+    // adds the rows of a batch fetched by IBPP::IStatement::FetchBatch()
+    void addRows(const IBPP::ColumnBatch& batch);
+    // fetching in the background the rows of batches are put into a store
+    // of their own first, then added with the BLOBs of the statement
+    void addRows(const IBPP::ColumnBatch& batch, DataGridColumnStore& store);
+    void addRows(DataGridColumnStore& rows, const IBPP::Database& database,
+        const IBPP::Transaction& transaction);
     void clear();
     unsigned getRowCount();
+    // rows following the fetched ones can be added as missing, so that
+    // rows can be fetched out of order (with a scrollable cursor)
+    void setRowCount(unsigned count);
+    bool isRowFetched(unsigned row);
+    // the rows passed to all other methods are the rows in the order shown,
+    // these and copyKeyRow() use the rows in the order fetched
+    bool findMissingRow(unsigned from, unsigned& row);
+    // stores the current row of the statement in a missing row
+    void setRow(unsigned row, const IBPP::Statement& statement);
+
+    // sorts the rows by the values of a column, without executing the
+    // statement again. Rows with equal values keep their previous order.
+    // Returns false if the column can't be sorted or rows are missing
+    bool sortRows(unsigned col, bool ascending);
+    // returns -1 if the rows aren't (or no longer all) sorted
+    int getSortColumn();
+    bool isSortedAscending();
+
+    // shows only the rows matching the filter, and the rows inserted by
+    // the user. Throws FRError if the value can't be converted for the
+    // column, returns false if rows are missing
+    bool setFilter(const DataGridFilter& filter);
+    void clearFilter();
+    bool isFiltered();
+    // applies the filter to the rows added since it was last applied
+    void updateFilter();
+    // less than getRowCount() if the rows are filtered
+    unsigned getShownRowCount();
+    // groups the shown rows without executing a statement. Throws FRError
+    // for columns that can't be grouped or aggregated, returns false if
+    // rows are missing
+    bool groupRows(const DataGridGrouping& grouping,
+        DataGridGroupResult& result);
+    // changes whenever the values of the shown rows may have changed, rows
+    // appended after them don't change it
+    unsigned getChangeCount();
+    // appends the non-null values of a numeric column in the shown rows
+    // [from, to) to values, returns false if the column isn't numeric
+    bool getNumericValues(unsigned col, unsigned from, unsigned to,
+        std::vector<double>& values);
     unsigned getRowFieldCount();
     wxString getRowFieldName(unsigned col);
     bool initialize(const IBPP::Statement& statement);
@@ -132,6 +264,19 @@ public:
     ResultsetColumnDef* getColumnDef(unsigned col);
     void addRow(DataGridRowBuffer* buffer);
 
+    // result set columns with the primary key of the table, returns false
+    // if the rows can't be read in pages of key ranges
+    bool getKeyColumns(std::vector<unsigned>& columns);
+    wxString getKeyOrder(const std::vector<unsigned>& columns);
+    // condition for the rows following a given one in the key order, its
+    // parameters are set by setKeyParameters() from a copy of that row
+    wxString getKeyCondition(const std::vector<unsigned>& columns,
+        std::vector<unsigned>& paramColumns);
+    DataGridRowBuffer* copyKeyRow(const std::vector<unsigned>& columns,
+        unsigned row);
+    void setKeyParameters(const IBPP::Statement& statement,
+        const std::vector<unsigned>& paramColumns, DataGridRowBuffer* keyRow);
+
     // BLOB-Stuff
     IBPP::Blob* getBlob(unsigned row, unsigned col, bool validateBlob);
     DataGridRowsBlob setBlobPrepare(unsigned row, unsigned col);
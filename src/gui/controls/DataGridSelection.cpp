@@ -0,0 +1,199 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <algorithm>
+#include <limits>
+
+#include "gui/controls/DataGridSelection.h"
+
+// DataGridSelection class
+DataGridSelection::DataGridSelection(int rowCount, int colCount)
+    : rowCountM(rowCount), cellCountM(0)
+{
+    columnRangesM.resize(colCount);
+}
+
+void DataGridSelection::addRange(int col, int firstRow, int lastRow)
+{
+    if (col < 0 || col >= getColCount())
+        return;
+    firstRow = std::max(firstRow, 0);
+    lastRow = std::min(lastRow, rowCountM - 1);
+    if (firstRow <= lastRow)
+        columnRangesM[col].push_back(std::make_pair(firstRow, lastRow));
+}
+
+void DataGridSelection::addRows(int firstRow, int lastRow)
+{
+    for (int col = 0; col < getColCount(); col++)
+        addRange(col, firstRow, lastRow);
+}
+
+void DataGridSelection::finish()
+{
+    mergeRanges();
+    buildRowSpans();
+}
+
+// overlapping and adjacent ranges are merged
+void DataGridSelection::mergeRanges()
+{
+    cellCountM = 0;
+    for (std::vector<RowRanges>::iterator it = columnRangesM.begin();
+        it != columnRangesM.end(); ++it)
+    {
+        RowRanges& ranges = *it;
+        if (ranges.empty())
+            continue;
+        std::sort(ranges.begin(), ranges.end());
+        RowRanges::iterator last = ranges.begin();
+        for (RowRanges::iterator r = ranges.begin() + 1; r != ranges.end();
+            ++r)
+        {
+            if ((*r).first <= (*last).second + 1)
+                (*last).second = std::max((*last).second, (*r).second);
+            else
+                *(++last) = *r;
+        }
+        ranges.erase(last + 1, ranges.end());
+        for (RowRanges::const_iterator r = ranges.begin(); r != ranges.end();
+            ++r)
+        {
+            cellCountM += (*r).second - (*r).first + 1;
+        }
+    }
+}
+
+// the rows are split wherever a range of a column starts or ends
+void DataGridSelection::buildRowSpans()
+{
+    // (row, col) for the first row of a range, (row, -1 - col) for the row
+    // following it
+    std::vector<std::pair<int, int> > bounds;
+    for (int col = 0; col < getColCount(); col++)
+    {
+        const RowRanges& ranges = columnRangesM[col];
+        for (RowRanges::const_iterator r = ranges.begin(); r != ranges.end();
+            ++r)
+        {
+            bounds.push_back(std::make_pair((*r).first, col));
+            bounds.push_back(std::make_pair((*r).second + 1, -1 - col));
+        }
+    }
+    std::sort(bounds.begin(), bounds.end());
+    rowSpansM.clear();
+
+    std::vector<bool> selected(getColCount(), false);
+    int selectedCount = 0;
+    for (size_t i = 0; i < bounds.size(); )
+    {
+        int row = bounds[i].first;
+        for (; i < bounds.size() && bounds[i].first == row; ++i)
+        {
+            int col = bounds[i].second;
+            if (col >= 0)
+            {
+                selected[col] = true;
+                ++selectedCount;
+            }
+            else
+            {
+                selected[-1 - col] = false;
+                --selectedCount;
+            }
+        }
+        if (selectedCount == 0 || i == bounds.size())
+            continue;
+
+        RowSpan span;
+        span.firstRow = row;
+        span.lastRow = bounds[i].first - 1;
+        for (int col = 0; col < getColCount(); col++)
+        {
+            if (selected[col])
+                span.columns.push_back(col);
+        }
+        rowSpansM.push_back(span);
+    }
+}
+
+int DataGridSelection::getColCount() const
+{
+    return columnRangesM.size();
+}
+
+int DataGridSelection::getRowCount() const
+{
+    return rowCountM;
+}
+
+size_t DataGridSelection::getCellCount() const
+{
+    return cellCountM;
+}
+
+bool DataGridSelection::isEmpty() const
+{
+    return cellCountM == 0;
+}
+
+bool DataGridSelection::isAllSelected() const
+{
+    return cellCountM > 0
+        && cellCountM == size_t(rowCountM) * columnRangesM.size();
+}
+
+bool DataGridSelection::isSelected(int row, int col) const
+{
+    if (col < 0 || col >= getColCount())
+        return false;
+    // find the last range starting at or before the row
+    const RowRanges& ranges = columnRangesM[col];
+    RowRanges::const_iterator it = std::upper_bound(ranges.begin(),
+        ranges.end(), std::make_pair(row, std::numeric_limits<int>::max()));
+    if (it == ranges.begin())
+        return false;
+    --it;
+    return row <= (*it).second;
+}
+
+const DataGridSelection::RowRanges& DataGridSelection::getColumnRanges(
+    int col) const
+{
+    return columnRangesM[col];
+}
+
+const std::vector<DataGridSelection::RowSpan>& DataGridSelection::getRowSpans()
+    const
+{
+    return rowSpansM;
+}
@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_DATAGRIDSELECTION_H
+#define FR_DATAGRIDSELECTION_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class wxGrid;
+
+// DataGridSelection: the selected cells of a grid as ranges of rows, built
+// from the selected rows, columns, blocks and cells of wxGrid, so that the
+// cells don't need to be tested one by one with IsInSelection()
+class DataGridSelection
+{
+public:
+    // rows [first, last], sorted and not overlapping
+    typedef std::vector<std::pair<int, int> > RowRanges;
+    // consecutive rows having the same columns selected
+    struct RowSpan
+    {
+        int firstRow;
+        int lastRow;
+        std::vector<int> columns;
+    };
+private:
+    int rowCountM;
+    std::vector<RowRanges> columnRangesM;
+    std::vector<RowSpan> rowSpansM;
+    size_t cellCountM;
+
+    void mergeRanges();
+    void buildRowSpans();
+public:
+    DataGridSelection(int rowCount, int colCount);
+    // defined in DataGrid.cpp
+    DataGridSelection(wxGrid* grid);
+
+    // the ranges are clipped to the grid, and need to be merged by calling
+    // finish() when all are added
+    void addRange(int col, int firstRow, int lastRow);
+    void addRows(int firstRow, int lastRow);
+    void finish();
+
+    int getColCount() const;
+    int getRowCount() const;
+    size_t getCellCount() const;
+    bool isEmpty() const;
+    bool isAllSelected() const;
+    bool isSelected(int row, int col) const;
+
+    const RowRanges& getColumnRanges(int col) const;
+    const std::vector<RowSpan>& getRowSpans() const;
+};
+
+#endif
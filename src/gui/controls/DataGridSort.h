@@ -0,0 +1,144 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_DATAGRIDSORT_H
+#define FR_DATAGRIDSORT_H
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// sort key of a row, rows with equal values are kept in the order they
+// had before
+template<typename T>
+struct RowSortKey
+{
+    T value;
+    unsigned row;       // in the store
+    unsigned position;  // in the previous order
+};
+
+template<typename T>
+class RowSortKeyLess
+{
+private:
+    bool ascendingM;
+public:
+    RowSortKeyLess(bool ascending) : ascendingM(ascending) {}
+    bool operator()(const RowSortKey<T>& a, const RowSortKey<T>& b) const
+    {
+        if (a.value < b.value)
+            return ascendingM;
+        if (b.value < a.value)
+            return !ascendingM;
+        return a.position < b.position;
+    }
+};
+
+// the bytes of strings are copied out of the store, since pages of the
+// store may be released while the keys are read
+struct BytesSortValue
+{
+    size_t offset;
+    unsigned length;
+};
+
+class BytesSortKeyLess
+{
+private:
+    const char* dataM;
+    bool ascendingM;
+public:
+    BytesSortKeyLess(const char* data, bool ascending)
+        : dataM(data), ascendingM(ascending) {}
+    bool operator()(const RowSortKey<BytesSortValue>& a,
+        const RowSortKey<BytesSortValue>& b) const
+    {
+        int res = memcmp(dataM + a.value.offset, dataM + b.value.offset,
+            std::min(a.value.length, b.value.length));
+        if (res == 0)
+            res = int(a.value.length) - int(b.value.length);
+        if (res != 0)
+            return (res < 0) == ascendingM;
+        return a.position < b.position;
+    }
+};
+
+inline void joinThreads(std::vector<std::thread>& threads)
+{
+    for (std::vector<std::thread>::iterator it = threads.begin();
+        it != threads.end(); ++it)
+    {
+        (*it).join();
+    }
+    threads.clear();
+}
+
+// sorts parts of the keys on all processors (or the given number of
+// threads), and merges the sorted parts pairwise (in parallel too, as long
+// as there is more than one pair)
+template<typename T, typename Less>
+void parallelSort(std::vector<T>& keys, Less less,
+    size_t threadCount = std::thread::hardware_concurrency())
+{
+    // for fewer keys per thread starting the threads doesn't pay off
+    const size_t minKeysPerThread = 32 * 1024;
+    size_t parts = std::min(threadCount, keys.size() / minKeysPerThread);
+    if (parts < 2)
+    {
+        std::sort(keys.begin(), keys.end(), less);
+        return;
+    }
+
+    typedef typename std::vector<T>::iterator Iterator;
+    std::vector<Iterator> bounds;
+    for (size_t i = 0; i <= parts; ++i)
+        bounds.push_back(keys.begin() + keys.size() * i / parts);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < parts; ++i)
+    {
+        Iterator first = bounds[i], last = bounds[i + 1];
+        threads.push_back(std::thread([first, last, less]() {
+            std::sort(first, last, less);
+        }));
+    }
+    std::sort(bounds[0], bounds[1], less);
+    joinThreads(threads);
+
+    for (size_t width = 1; width < parts; width *= 2)
+    {
+        for (size_t i = 0; i + width < parts; i += 2 * width)
+        {
+            Iterator first = bounds[i], middle = bounds[i + width],
+                last = bounds[std::min(i + 2 * width, parts)];
+            threads.push_back(std::thread([first, middle, last, less]() {
+                std::inplace_merge(first, middle, last, less);
+            }));
+        }
+        joinThreads(threads);
+    }
+}
+
+#endif
@@ -31,13 +31,22 @@
 #endif
 
 #include <wx/grid.h>
+#include <wx/stopwatch.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <limits>
+#include <list>
+#include <mutex>
 #include <set>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
 
 #include "config/Config.h"
 #include "core/FRError.h"
 #include "core/StringUtils.h"
+#include "gui/controls/DataGridFetchQueue.h"
 #include "gui/controls/DataGridRows.h"
 #include "gui/controls/DataGridTable.h"
 #include "gui/AdvancedMessageDialog.h"
@@ -45,25 +54,503 @@
 #include "metadata/column.h"
 #include "metadata/database.h"
 #include "metadata/table.h"
+#include "sql/SelectStatement.h"
+
+// DataGridCellCache: bounded LRU cache for the formatted values of the
+// cells shown in the grid, so that they are not formatted again whenever
+// the grid is repainted. Invalidated when the formatting options change.
+class DataGridCellCache: public ConfigCache
+{
+private:
+    typedef std::pair<uint64_t, wxString> Entry;
+    typedef std::list<Entry> EntryList;
+    EntryList entriesM;
+    std::unordered_map<uint64_t, EntryList::iterator> lookupM;
+    size_t capacityM;
+
+    static uint64_t makeKey(unsigned row, unsigned col);
+protected:
+    virtual void loadFromConfig();
+public:
+    DataGridCellCache(size_t capacity);
+
+    void clear();
+    bool get(unsigned row, unsigned col, wxString& value);
+    void put(unsigned row, unsigned col, const wxString& value);
+};
+
+DataGridCellCache::DataGridCellCache(size_t capacity)
+    : ConfigCache(config()), capacityM(capacity)
+{
+}
+
+uint64_t DataGridCellCache::makeKey(unsigned row, unsigned col)
+{
+    return (uint64_t(row) << 32) | col;
+}
+
+void DataGridCellCache::loadFromConfig()
+{
+    // date and number formats may have changed
+    clear();
+}
+
+void DataGridCellCache::clear()
+{
+    entriesM.clear();
+    lookupM.clear();
+}
+
+bool DataGridCellCache::get(unsigned row, unsigned col, wxString& value)
+{
+    ensureCacheValid();
+    std::unordered_map<uint64_t, EntryList::iterator>::iterator it =
+        lookupM.find(makeKey(row, col));
+    if (it == lookupM.end())
+        return false;
+    // move to front as most recently used
+    entriesM.splice(entriesM.begin(), entriesM, (*it).second);
+    value = (*it).second->second;
+    return true;
+}
+
+void DataGridCellCache::put(unsigned row, unsigned col, const wxString& value)
+{
+    ensureCacheValid();
+    uint64_t key = makeKey(row, col);
+    std::unordered_map<uint64_t, EntryList::iterator>::iterator it =
+        lookupM.find(key);
+    if (it != lookupM.end())
+    {
+        (*it).second->second = value;
+        entriesM.splice(entriesM.begin(), entriesM, (*it).second);
+        return;
+    }
+    entriesM.push_front(Entry(key, value));
+    lookupM[key] = entriesM.begin();
+    if (entriesM.size() > capacityM)
+    {
+        lookupM.erase(entriesM.back().first);
+        entriesM.pop_back();
+    }
+}
+
+// DataGridFetchThread: owns the cursor while the rows following the initial
+// ones are fetched, the rows are passed in blocks through the queue and are
+// added to the grid by the main thread. The thread sleeps while the queue is
+// full or no more rows are wanted, and is woken up by the main thread.
+class DataGridFetchThread
+{
+private:
+    DataGridRows& rowsM;
+    IBPP::Statement statementM;
+    const std::atomic<bool>& fetchAllRowsM;
+    const std::atomic<unsigned>& maxRowToFetchM;
+    unsigned fetchedRowsM;
+    DataGridFetchQueue queueM;
+    std::atomic<bool> stopM;
+    std::atomic<bool> discardRowsM;
+    std::atomic<bool> finishedM;
+    std::thread threadM;
+    // guards the waits for the conditions below, which are signalled when
+    // the queue isn't full any more or more rows are wanted (for the fetch
+    // thread) and when rows were added or the thread finished (for the
+    // main thread)
+    std::mutex mutexM;
+    std::condition_variable producerM;
+    std::condition_variable consumerM;
+    // only valid after the thread has finished
+    bool endOfDataM;
+    std::string errorM;
+    bool systemErrorM;
+
+    bool isFetchWanted();
+    bool pushRows(DataGridColumnStore* rows);
+    void run();
+public:
+    DataGridFetchThread(DataGridRows& rows, IBPP::Statement& statement,
+        const std::atomic<bool>& fetchAllRows,
+        const std::atomic<unsigned>& maxRowToFetch);
+
+    // returns false if the thread can't be started
+    bool start();
+    // to be called when more rows are wanted
+    void wakeUp();
+    DataGridColumnStore* popRows();
+    // waits until rows can be popped or the thread has finished
+    void waitForRows();
+    bool isFinished();
+    // the rows fetched are kept if the queue is emptied until the thread
+    // has finished
+    void requestStop(bool discardRows = true);
+    void join();
+    bool isEndOfData();
+    bool getError(wxString& message);
+};
+
+DataGridFetchThread::DataGridFetchThread(DataGridRows& rows,
+        IBPP::Statement& statement, const std::atomic<bool>& fetchAllRows,
+        const std::atomic<unsigned>& maxRowToFetch)
+    : rowsM(rows), statementM(statement), fetchAllRowsM(fetchAllRows),
+        maxRowToFetchM(maxRowToFetch), fetchedRowsM(rows.getRowCount()),
+        stopM(false), discardRowsM(true), finishedM(false),
+        endOfDataM(false), systemErrorM(false)
+{
+}
+
+bool DataGridFetchThread::start()
+{
+    try
+    {
+        threadM = std::thread(&DataGridFetchThread::run, this);
+    }
+    catch (std::system_error&)
+    {
+        return false;
+    }
+    return true;
+}
+
+bool DataGridFetchThread::isFetchWanted()
+{
+    return fetchAllRowsM || fetchedRowsM < maxRowToFetchM;
+}
+
+void DataGridFetchThread::run()
+{
+    // rows are passed on when the block is full or when the fetching is slow
+    const unsigned blockRows = 256;
+    const long blockMillis = 50;
+    // rows are fetched in batches small enough to check the time often
+    const unsigned batchRows = 32;
+
+    IBPP::ColumnBatch batch;
+    DataGridColumnStore* rows = 0;
+    wxStopWatch sw;
+    while (!stopM)
+    {
+        // fetch only as many rows as needed unless all rows are wanted
+        if (!isFetchWanted())
+        {
+            DataGridColumnStore* block = rows;
+            rows = 0;
+            if (block && !pushRows(block))
+                break;
+            std::unique_lock<std::mutex> lock(mutexM);
+            producerM.wait(lock, [this]() {
+                return stopM || isFetchWanted(); });
+            continue;
+        }
+        if (!rows)
+        {
+            rows = new DataGridColumnStore();
+            sw.Start();
+        }
+        unsigned count = std::min(batchRows, blockRows - rows->getRowCount());
+        if (!fetchAllRowsM)
+            count = std::min(count, maxRowToFetchM - fetchedRowsM);
+        unsigned fetched;
+        try
+        {
+            fetched = statementM->FetchBatch(count, batch);
+            rowsM.addRows(batch, *rows);
+        }
+        catch (IBPP::Exception& e)
+        {
+            errorM = e.what();
+            break;
+        }
+        catch (...)
+        {
+            systemErrorM = true;
+            break;
+        }
+        fetchedRowsM += fetched;
+        if (fetched < count)
+        {
+            endOfDataM = true;
+            break;
+        }
+
+        if (rows->getRowCount() >= blockRows || sw.Time() > blockMillis)
+        {
+            DataGridColumnStore* block = rows;
+            rows = 0;
+            if (!pushRows(block))
+                break;
+        }
+    }
+    if (rows && rows->getRowCount() > 0)
+        pushRows(rows);
+    else
+        delete rows;
+
+    std::lock_guard<std::mutex> lock(mutexM);
+    finishedM.store(true, std::memory_order_release);
+    consumerM.notify_all();
+}
+
+// waits while the queue is full, returns false if the thread is stopped
+bool DataGridFetchThread::pushRows(DataGridColumnStore* rows)
+{
+    std::unique_lock<std::mutex> lock(mutexM);
+    while (!queueM.push(rows))
+    {
+        if (stopM && discardRowsM)
+        {
+            delete rows;
+            return false;
+        }
+        producerM.wait(lock);
+    }
+    consumerM.notify_all();
+    return true;
+}
+
+void DataGridFetchThread::wakeUp()
+{
+    std::lock_guard<std::mutex> lock(mutexM);
+    producerM.notify_all();
+}
+
+// the queue itself needs no lock, the mutex is only taken to wake up the
+// fetch thread waiting for free space in it
+DataGridColumnStore* DataGridFetchThread::popRows()
+{
+    DataGridColumnStore* rows = queueM.pop();
+    if (rows)
+        wakeUp();
+    return rows;
+}
+
+void DataGridFetchThread::waitForRows()
+{
+    std::unique_lock<std::mutex> lock(mutexM);
+    consumerM.wait(lock, [this]() {
+        return queueM.canPop() || finishedM.load(std::memory_order_acquire);
+    });
+}
+
+bool DataGridFetchThread::isFinished()
+{
+    return finishedM.load(std::memory_order_acquire);
+}
+
+void DataGridFetchThread::requestStop(bool discardRows)
+{
+    std::lock_guard<std::mutex> lock(mutexM);
+    discardRowsM = discardRows;
+    stopM = true;
+    producerM.notify_all();
+}
+
+void DataGridFetchThread::join()
+{
+    if (threadM.joinable())
+        threadM.join();
+}
+
+bool DataGridFetchThread::isEndOfData()
+{
+    wxASSERT(isFinished());
+    return endOfDataM;
+}
+
+bool DataGridFetchThread::getError(wxString& message)
+{
+    wxASSERT(isFinished());
+    if (systemErrorM)
+        message = _("A system error occurred!");
+    else
+        message = errorM;
+    return systemErrorM || !errorM.empty();
+}
+
+// DataGridBrowsePager: reads the result set in pages, every page is read by
+// its own statement in a short read-only read committed transaction, so no
+// cursor and no transaction is kept open while the user browses the data
+class DataGridBrowsePager
+{
+private:
+    enum PagingMode { pmKeyset, pmOffset, pmCursor };
+    PagingMode modeM;
+    DataGridRows& rowsM;
+    wxMBConv* converterM;
+    // only prepared, needed for the column information
+    IBPP::Statement statementM;
+    IBPP::Transaction statementTransactionM;
+    SelectStatement selectM;
+    std::vector<unsigned> keyColumnsM;
+    wxString keyOrderM;
+    wxString keyConditionM;
+    std::vector<unsigned> keyParamColumnsM;
+    // copy of the last row read, 0 before the first page
+    DataGridRowBuffer* keyRowM;
+    unsigned offsetM;
+    // BLOB handles are only valid in the transaction they were fetched in
+    bool keepTransactionM;
+    IBPP::Transaction transactionM;
+    bool finishedM;
+
+    unsigned fetchCursorRows(unsigned rows);
+public:
+    DataGridBrowsePager(Database* db, DataGridRows& rows,
+        IBPP::Statement& statement, const wxString& sql);
+    ~DataGridBrowsePager();
+
+    bool isFinished();
+    // returns the number of rows added
+    unsigned fetchPage(unsigned rows);
+};
+
+DataGridBrowsePager::DataGridBrowsePager(Database* db, DataGridRows& rows,
+        IBPP::Statement& statement, const wxString& sql)
+    : modeM(pmCursor), rowsM(rows), converterM(db->getCharsetConverter()),
+        statementM(statement),
+        statementTransactionM(statement->TransactionPtr()), selectM(sql),
+        keyRowM(0), offsetM(0), keepTransactionM(false), finishedM(false)
+{
+    bool hasOrderBy = false;
+    if (selectM.canFetchInPages(hasOrderBy))
+    {
+        // the user's order is kept, but can't be used to build key ranges
+        if (hasOrderBy)
+            modeM = pmOffset;
+        else if (rowsM.getKeyColumns(keyColumnsM))
+        {
+            modeM = pmKeyset;
+            keyOrderM = rowsM.getKeyOrder(keyColumnsM);
+            keyConditionM = rowsM.getKeyCondition(keyColumnsM,
+                keyParamColumnsM);
+        }
+    }
+    for (unsigned col = 0; col < rowsM.getRowFieldCount(); ++col)
+    {
+        if (rowsM.isBlobColumn(col))
+            keepTransactionM = true;
+    }
+
+    // without a stable order the rows can only be read with a cursor (in
+    // the read-only read committed transaction the statement was prepared
+    // in), otherwise that transaction isn't needed any more
+    if (modeM == pmCursor)
+        statementM->Execute();
+    else if (statementTransactionM->Started())
+        statementTransactionM->Commit();
+}
+
+DataGridBrowsePager::~DataGridBrowsePager()
+{
+    delete keyRowM;
+}
+
+bool DataGridBrowsePager::isFinished()
+{
+    return finishedM;
+}
+
+unsigned DataGridBrowsePager::fetchCursorRows(unsigned rows)
+{
+    IBPP::ColumnBatch batch;
+    unsigned count = statementM->FetchBatch(rows, batch);
+    rowsM.addRows(batch);
+    if (count < rows)
+    {
+        finishedM = true;
+        if (!keepTransactionM)
+            statementTransactionM->Commit();
+    }
+    return count;
+}
+
+unsigned DataGridBrowsePager::fetchPage(unsigned rows)
+{
+    if (finishedM)
+        return 0;
+    if (modeM == pmCursor)
+        return fetchCursorRows(rows);
+
+    wxString sql;
+    if (modeM == pmKeyset)
+    {
+        sql = selectM.getPageStatement(keyRowM ? keyConditionM : wxString(),
+            keyOrderM, rows);
+    }
+    else
+        sql = selectM.getPageStatement(offsetM + 1, offsetM + rows);
+
+    IBPP::Database db(statementM->DatabasePtr());
+    IBPP::Transaction tr(transactionM);
+    if (tr == 0)
+    {
+        tr = IBPP::TransactionFactory(db, IBPP::amRead,
+            IBPP::ilReadCommitted, IBPP::lrWait);
+    }
+    if (!tr->Started())
+        tr->Start();
+
+    unsigned count = 0;
+    try
+    {
+        IBPP::Statement st = IBPP::StatementFactory(db, tr);
+        st->Prepare(wx2std(sql, converterM));
+        if (keyRowM)
+            rowsM.setKeyParameters(st, keyParamColumnsM, keyRowM);
+        st->Execute();
+        IBPP::ColumnBatch batch;
+        count = st->FetchBatch(rows, batch);
+        rowsM.addRows(batch);
+        st->Close();
+    }
+    catch (...)
+    {
+        finishedM = true;
+        throw;
+    }
+
+    if (keepTransactionM)
+        transactionM = tr;
+    else
+        tr->Commit();
+
+    if (count < rows)
+        finishedM = true;
+    else if (modeM == pmKeyset)
+    {
+        delete keyRowM;
+        keyRowM = 0;
+        keyRowM = rowsM.copyKeyRow(keyColumnsM, rowsM.getRowCount() - 1);
+    }
+    else
+        offsetM += count;
+    return count;
+}
 
 DataGridTable::DataGridTable(IBPP::Statement& s, Database* db)
     : wxGridTableBase(), statementM(s), databaseM(db), nullFlagM(false),
         rowsM(db)
 {
     allRowsFetchedM = false;
-    fetchAllRowsM = false;
+    fetchAllRowsM = config().get("GridFetchAllRecords", false);
+    fetchThreadM = 0;
+    pagerM = 0;
+    rowsMissingM = false;
+    wantedRowM = 0;
+    rowsInsertedM = false;
     readOnlyM = false;
     canInsertRowsIsSetM = false;
     canInsertRowsM = false;
-    config().getValue("GridFetchAllRecords", fetchAllRowsM);
     maxRowToFetchM = 100;
     cellAttriM = new wxGridCellAttr();
+    // enough for all visible cells even on large screens
+    cellCacheM = new DataGridCellCache(8192);
 }
 
 DataGridTable::~DataGridTable()
 {
     Clear();
     cellAttriM->DecRef();
+    delete cellCacheM;
 }
 
 void DataGridTable::setNullFlag(bool isNull)
@@ -80,17 +567,24 @@ bool DataGridTable::canFetchMoreRows()
 
 void DataGridTable::Clear()
 {
+    stopFetching();
+    delete pagerM;
+    pagerM = 0;
+    rowsMissingM = false;
+    rowsInsertedM = false;
     nullFlagM = false;
 
     allRowsFetchedM = true;
-    fetchAllRowsM = false;
     canInsertRowsIsSetM = false;
-    config().getValue("GridFetchAllRecords", fetchAllRowsM);
+    fetchAllRowsM = config().get("GridFetchAllRecords", false);
 
     unsigned oldCols = rowsM.getRowFieldCount();
-    unsigned oldRows = rowsM.getRowCount();
+    unsigned oldRows = rowsM.getShownRowCount();
     rowsM.clear();
+    cellCacheM->clear();
 
+    if (GetView())
+        GetView()->UnsetSortingColumn();
     if (GetView() && oldRows > 0)
     {
         wxGridTableMessage rowMsg(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED,
@@ -126,16 +620,121 @@ void DataGridTable::fetch()
     if (!canFetchMoreRows())
         return;
 
-    // fetch the first 100 rows no matter how long it takes
     unsigned oldRows = rowsM.getRowCount();
-    bool initial = oldRows == 0;
-    // fetch more rows until maxRowToFetchM reached or 100 ms elapsed
-    wxLongLong startms = ::wxGetLocalTimeMillis();
-    do
+    bool threadRunning = fetchThreadM != 0;
+    if (pagerM)
+        fetchPages();
+    else if (rowsMissingM)
+    {
+        if (fetchMissingRows() && GetView())
+            GetView()->ForceRefresh();
+    }
+    else if (fetchThreadM)
+        appendFetchedRows();
+    else
+    {
+        // fetch the first 100 rows no matter how long it takes, the remaining
+        // rows are fetched by a background thread
+        if (rowsM.getRowCount() < maxRowToFetchM)
+        {
+            unsigned count = maxRowToFetchM - rowsM.getRowCount();
+            try
+            {
+                IBPP::ColumnBatch batch;
+                unsigned fetched = statementM->FetchBatch(count, batch);
+                if (fetched < count)
+                    allRowsFetchedM = true;
+                rowsM.addRows(batch);
+            }
+            catch (IBPP::Exception& e)
+            {
+                allRowsFetchedM = true;
+                ::wxMessageBox(e.what(),
+                    _("An IBPP error occurred."), wxOK|wxICON_ERROR);
+            }
+            catch (...)
+            {
+                allRowsFetchedM = true;
+                ::wxMessageBox(_("A system error occurred!"), _("Error"),
+                    wxOK|wxICON_ERROR);
+            }
+        }
+        if (!allRowsFetchedM)
+            startFetchThread();
+    }
+    notifyRowsAppended(oldRows, threadRunning && !fetchThreadM);
+}
+
+bool DataGridTable::isFetching()
+{
+    return fetchThreadM != 0;
+}
+
+// the frame is notified when the fetch thread has finished too, so that it
+// can show the statement metrics
+void DataGridTable::notifyRowsAppended(unsigned oldRows, bool threadFinished)
+{
+    if (!GetView())
+        return;
+    if (rowsM.getRowCount() > oldRows)
+    {
+        rowsM.updateFilter();
+        // the rows appended are shown after the sorted ones
+        if (rowsM.getSortColumn() == -1)
+            GetView()->UnsetSortingColumn();
+    }
+    int shownRows = rowsM.getShownRowCount();
+    if (shownRows > GetView()->GetNumberRows())   // notify the grid
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED,
+            shownRows - GetView()->GetNumberRows());
+        GetView()->ProcessTableMessage(msg);
+    }
+    if (rowsM.getRowCount() > oldRows || threadFinished)
+    {
+        // used in frame to update status bar
+        wxCommandEvent evt(wxEVT_FRDG_ROWCOUNT_CHANGED, GetView()->GetId());
+        evt.SetExtraLong(rowsM.getRowCount());
+        wxPostEvent(GetView(), evt);
+    }
+}
+
+bool DataGridTable::canFetchLastRows()
+{
+    // rows inserted by the user would be mixed up with the missing rows,
+    // and the filter isn't applied to rows fetched out of order
+    return canFetchMoreRows() && !pagerM && !rowsMissingM && !rowsInsertedM
+        && !rowsM.isFiltered() && statementM->Scrollable();
+}
+
+void DataGridTable::fetchLastRows()
+{
+    wxASSERT(canFetchLastRows());
+    unsigned oldRows = rowsM.getRowCount();
+    // the rows fetched in the background are kept, from now on the cursor
+    // is positioned by the main thread
+    if (fetchThreadM)
+    {
+        fetchThreadM->requestStop(false);
+        while (fetchThreadM)
+        {
+            fetchThreadM->waitForRows();
+            appendFetchedRows();
+        }
+    }
+    if (!allRowsFetchedM)
     {
         try
         {
-            if (!statementM->Fetch())
+            unsigned count = countResultRows(rowsM.getRowCount());
+            if (count > rowsM.getRowCount())
+            {
+                rowsM.setRowCount(count);
+                rowsMissingM = true;
+                wantedRowM = count - 1;
+                fetchMissingRows();
+            }
+            else
                 allRowsFetchedM = true;
         }
         catch (IBPP::Exception& e)
@@ -150,30 +749,113 @@ void DataGridTable::fetch()
             ::wxMessageBox(_("A system error occurred!"), _("Error"),
                 wxOK|wxICON_ERROR);
         }
-        if (allRowsFetchedM)
-            break;
-        rowsM.addRow(statementM);
+    }
+    notifyRowsAppended(oldRows);
+}
 
-        if (!initial && (::wxGetLocalTimeMillis() - startms > 100))
-            break;
+void DataGridTable::fetchRowsAround(unsigned row)
+{
+    if (!rowsMissingM || !canFetchMoreRows())
+        return;
+    wantedRowM = row;
+    fetch();
+}
+
+// the cursor has no row position, so the number of rows is found by a
+// binary search for the last row that can be fetched
+unsigned DataGridTable::countResultRows(unsigned fetchedRows)
+{
+    const unsigned maxRows = std::numeric_limits<int>::max();
+    unsigned low = fetchedRows;
+    unsigned high = std::max(2 * low, low + 1024);
+    while (statementM->FetchAbsolute(high))
+    {
+        low = high;
+        if (high == maxRows)
+            return high;
+        high = (high > maxRows / 2) ? maxRows : 2 * high;
+    }
+    while (high - low > 1)
+    {
+        unsigned mid = low + (high - low) / 2;
+        if (statementM->FetchAbsolute(mid))
+            low = mid;
+        else
+            high = mid;
     }
-    while ((fetchAllRowsM && !initial) || rowsM.getRowCount() < maxRowToFetchM);
+    return low;
+}
+
+// fetches the missing rows around the row last shown, when all rows are
+// wanted the missing rows are fetched in order for a while, returns whether
+// rows have been fetched
+bool DataGridTable::fetchMissingRows()
+{
+    const unsigned windowRows = 250;
+    const long fetchMillis = 100;
 
-    if (rowsM.getRowCount() > oldRows && GetView())   // notify the grid
+    wxASSERT(rowsMissingM);
+    bool fetched = false;
+    wxStopWatch sw;
+    try
     {
-        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED,
-            rowsM.getRowCount() - oldRows);
-        GetView()->ProcessTableMessage(msg);
-        // used in frame to update status bar
-        wxCommandEvent evt(wxEVT_FRDG_ROWCOUNT_CHANGED, GetView()->GetId());
-        evt.SetExtraLong(rowsM.getRowCount());
-        wxPostEvent(GetView(), evt);
+        unsigned first = wantedRowM > windowRows / 5
+            ? wantedRowM - windowRows / 5 : 0;
+        unsigned row;
+        while (rowsM.findMissingRow(first, row))
+        {
+            if (row >= first + windowRows)
+            {
+                // rows around the wanted one are there, continue with the
+                // first missing row if all rows are wanted
+                if (!fetchAllRowsM || sw.Time() > fetchMillis
+                    || !rowsM.findMissingRow(0, row))
+                {
+                    break;
+                }
+                first = row;
+            }
+            // positions of the cursor are 1-based
+            if (!statementM->FetchAbsolute(row + 1))
+            {
+                // the result set has changed, which should never happen
+                allRowsFetchedM = true;
+                break;
+            }
+            do
+            {
+                rowsM.setRow(row, statementM);
+                ++row;
+            }
+            while (row < first + windowRows && !rowsM.isRowFetched(row)
+                && statementM->Fetch());
+            fetched = true;
+        }
+    }
+    catch (IBPP::Exception& e)
+    {
+        allRowsFetchedM = true;
+        ::wxMessageBox(e.what(),
+            _("An IBPP error occurred."), wxOK|wxICON_ERROR);
+    }
+    catch (...)
+    {
+        allRowsFetchedM = true;
+        ::wxMessageBox(_("A system error occurred!"), _("Error"),
+            wxOK|wxICON_ERROR);
     }
+    unsigned row;
+    if (!rowsM.findMissingRow(0, row))
+        allRowsFetchedM = true;
+    return fetched;
 }
 
 void DataGridTable::addRow(DataGridRowBuffer *buffer, const wxString& sql)
 {
     rowsM.addRow(buffer);
+    // rows inserted by the user are shown even if they don't match
+    rowsM.updateFilter();
+    rowsInsertedM = true;
     if (GetView())  // notify the grid
     {
         wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, 1);
@@ -308,7 +990,7 @@ int DataGridTable::GetNumberCols()
 
 int DataGridTable::GetNumberRows()
 {
-    return rowsM.getRowCount();
+    return rowsM.getShownRowCount();
 }
 
 int DataGridTable::getStatementColCount()
@@ -429,32 +1111,55 @@ wxString DataGridTable::GetValue(int row, int col)
     // (but make the count of fetched rows a multiple of 50)
     unsigned maxRowToFetch = 50 * (row / 50 + 5);
     if (maxRowToFetchM < maxRowToFetch)
+    {
         maxRowToFetchM = maxRowToFetch;
+        if (fetchThreadM)
+            fetchThreadM->wakeUp();
+    }
+
+    // shown empty until fetched, and not cached
+    if (rowsMissingM && !rowsM.isRowFetched(row))
+    {
+        wantedRowM = row;
+        return wxEmptyString;
+    }
+
+    wxString s;
+    if (cellCacheM->get(row, col, s))
+        return s;
 
     if (rowsM.isFieldNA(row, col))
-        return "N/A";
-    if (rowsM.isFieldNull(row, col))
-        return "[null]";
-    // limit returned string to first line (speeds up output in grid)
-    wxString s(rowsM.getFieldValue(row, col));
-    size_t eol = s.find_first_of("\r\n");
-    if (eol != wxString::npos)
-        s.erase(eol);
+        s = "N/A";
+    else if (rowsM.isFieldNull(row, col))
+        s = "[null]";
+    else
+    {
+        // limit returned string to first line (speeds up output in grid)
+        s = rowsM.getFieldValue(row, col);
+        size_t eol = s.find_first_of("\r\n");
+        if (eol != wxString::npos)
+            s.erase(eol);
+    }
+    cellCacheM->put(row, col, s);
     return s;
 }
 
-void DataGridTable::initialFetch(bool readonly)
+void DataGridTable::initialFetch(bool readonly, const wxString& browseSql,
+    const IBPP::ColumnBatch* firstRows)
 {
     Clear();
     allRowsFetchedM = false;
     readOnlyM = readonly;
     canInsertRowsIsSetM = false;
     canInsertRowsM = false;
-    maxRowToFetchM = 100;
+    maxRowToFetchM = getInitialRowCount();
 
     try
     {
         rowsM.initialize(statementM);
+        if (!browseSql.empty())
+            pagerM = new DataGridBrowsePager(databaseM, rowsM, statementM,
+                browseSql);
     }
     catch (IBPP::Exception& e)
     {
@@ -466,6 +1171,9 @@ void DataGridTable::initialFetch(bool readonly)
         ::wxMessageBox(_("A system error occurred!"), _("Error"),
             wxOK | wxICON_ERROR);
     }
+    // the statement hasn't been executed, so it can't be fetched from
+    if (!browseSql.empty() && !pagerM)
+        allRowsFetchedM = true;
 
     if (GetView())
     {
@@ -476,6 +1184,18 @@ void DataGridTable::initialFetch(bool readonly)
 
     if (statementM->Type() == IBPP::stExecProcedure)
         fetchOne();
+    else if (firstRows && !pagerM
+        && rowsM.getRowFieldCount() == unsigned(firstRows->Columns()))
+    {
+        // the first rows have been fetched when the statement was executed
+        unsigned oldRows = rowsM.getRowCount();
+        rowsM.addRows(*firstRows);
+        if (unsigned(firstRows->Rows()) < maxRowToFetchM)
+            allRowsFetchedM = true;
+        else
+            startFetchThread();
+        notifyRowsAppended(oldRows);
+    }
     else
         fetch();
 }
@@ -507,7 +1227,7 @@ bool DataGridTable::isReadonlyColumn(int col)
 
 bool DataGridTable::isValidCellPos(int row, int col)
 {
-    return (row >= 0 && col >= 0 && row < (int)rowsM.getRowCount()
+    return (row >= 0 && col >= 0 && row < (int)rowsM.getShownRowCount()
         && col < (int)rowsM.getRowFieldCount());
 }
 
@@ -528,18 +1248,203 @@ bool DataGridTable::canRemoveRow(size_t row)
     return rowsM.canRemoveRow(row);
 }
 
-bool DataGridTable::needsMoreRowsFetched()
+bool DataGridTable::sortRows(int col, bool ascending)
+{
+    if (col < 0 || col >= GetNumberCols() || rowsMissingM)
+        return false;
+    if (!rowsM.sortRows(col, ascending))
+        return false;
+
+    // the cached values are those of the rows shown before
+    cellCacheM->clear();
+    if (wxGrid* grid = GetView())
+    {
+        grid->SetSortingColumn(col, ascending);
+        grid->ForceRefresh();
+    }
+    return true;
+}
+
+int DataGridTable::getSortColumn()
+{
+    return rowsM.getSortColumn();
+}
+
+bool DataGridTable::isSortedAscending()
+{
+    return rowsM.isSortedAscending();
+}
+
+bool DataGridTable::setFilter(const DataGridFilter& filter)
+{
+    if (rowsMissingM || !rowsM.setFilter(filter))
+        return false;
+    notifyShownRowsChanged();
+    return true;
+}
+
+void DataGridTable::clearFilter()
+{
+    if (!rowsM.isFiltered())
+        return;
+    rowsM.clearFilter();
+    notifyShownRowsChanged();
+}
+
+bool DataGridTable::isFiltered()
+{
+    return rowsM.isFiltered();
+}
+
+bool DataGridTable::groupRows(const DataGridGrouping& grouping,
+    DataGridGroupResult& result)
+{
+    if (rowsMissingM)
+        return false;
+    return rowsM.groupRows(grouping, result);
+}
+
+unsigned DataGridTable::getFetchedRowCount()
 {
-    if (allRowsFetchedM)
+    return rowsM.getRowCount();
+}
+
+unsigned DataGridTable::getChangeCount()
+{
+    return rowsM.getChangeCount();
+}
+
+bool DataGridTable::getNumericValues(int col, int fromRow, int toRow,
+    std::vector<double>& values)
+{
+    if (col < 0 || fromRow < 0 || toRow < fromRow)
         return false;
-    // true if all rows are to be fetched, or more rows should be cached
-    // for more responsive grid scrolling
-    return (fetchAllRowsM || rowsM.getRowCount() < maxRowToFetchM);
+    return rowsM.getNumericValues(col, fromRow, toRow, values);
+}
+
+// the grid is told how many rows are shown after the filter has changed
+void DataGridTable::notifyShownRowsChanged()
+{
+    cellCacheM->clear();
+    wxGrid* grid = GetView();
+    if (!grid)
+        return;
+    int shownRows = rowsM.getShownRowCount();
+    int gridRows = grid->GetNumberRows();
+    if (shownRows < gridRows)
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED,
+            shownRows, gridRows - shownRows);
+        grid->ProcessTableMessage(msg);
+    }
+    else if (shownRows > gridRows)
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED,
+            shownRows - gridRows);
+        grid->ProcessTableMessage(msg);
+    }
+    grid->ForceRefresh();
+
+    // used in frame to update status bar
+    wxCommandEvent evt(wxEVT_FRDG_ROWCOUNT_CHANGED, grid->GetId());
+    evt.SetExtraLong(rowsM.getRowCount());
+    wxPostEvent(grid, evt);
 }
 
 void DataGridTable::setFetchAllRecords(bool fetchall)
 {
     fetchAllRowsM = fetchall;
+    if (fetchThreadM)
+        fetchThreadM->wakeUp();
+}
+
+void DataGridTable::startFetchThread()
+{
+    wxASSERT(!fetchThreadM);
+    fetchThreadM = new DataGridFetchThread(rowsM, statementM, fetchAllRowsM,
+        maxRowToFetchM);
+    if (!fetchThreadM->start())
+    {
+        delete fetchThreadM;
+        fetchThreadM = 0;
+        allRowsFetchedM = true;
+        ::wxMessageBox(_("Could not start the thread to fetch the data."),
+            _("Error"), wxOK | wxICON_ERROR);
+    }
+}
+
+// reads pages until the rows needed are there, when all rows are wanted it
+// returns after a while so the grid stays responsive
+void DataGridTable::fetchPages()
+{
+    const unsigned pageRows = 500;
+    const long pagesMillis = 100;
+
+    wxASSERT(pagerM);
+    wxStopWatch sw;
+    try
+    {
+        while (!pagerM->isFinished() && (rowsM.getRowCount() < maxRowToFetchM
+            || (fetchAllRowsM && sw.Time() < pagesMillis)))
+        {
+            pagerM->fetchPage(pageRows);
+        }
+    }
+    catch (IBPP::Exception& e)
+    {
+        allRowsFetchedM = true;
+        ::wxMessageBox(e.what(),
+            _("An IBPP error occurred."), wxOK|wxICON_ERROR);
+    }
+    catch (...)
+    {
+        allRowsFetchedM = true;
+        ::wxMessageBox(_("A system error occurred!"), _("Error"),
+            wxOK|wxICON_ERROR);
+    }
+    if (pagerM->isFinished())
+        allRowsFetchedM = true;
+}
+
+// adds the rows fetched by the background thread since the last call
+void DataGridTable::appendFetchedRows()
+{
+    wxASSERT(fetchThreadM);
+    // check before the queue is emptied, so no rows will be left over
+    bool finished = fetchThreadM->isFinished();
+    while (DataGridColumnStore* rows = fetchThreadM->popRows())
+    {
+        rowsM.addRows(*rows, statementM->DatabasePtr(),
+            statementM->TransactionPtr());
+        delete rows;
+    }
+    if (!finished)
+        return;
+
+    fetchThreadM->join();
+    wxString error;
+    bool hasError = fetchThreadM->getError(error);
+    // the thread may also have been stopped by fetchLastRows()
+    allRowsFetchedM = hasError || fetchThreadM->isEndOfData();
+    delete fetchThreadM;
+    fetchThreadM = 0;
+    if (hasError)
+    {
+        ::wxMessageBox(error, _("An IBPP error occurred."),
+            wxOK | wxICON_ERROR);
+    }
+}
+
+void DataGridTable::stopFetching()
+{
+    if (!fetchThreadM)
+        return;
+    fetchThreadM->requestStop();
+    fetchThreadM->join();
+    // rows not yet added to the grid are discarded
+    delete fetchThreadM;
+    fetchThreadM = 0;
+    allRowsFetchedM = true;
 }
 
 IBPP::Blob* DataGridTable::getBlob(unsigned row, unsigned col, bool validateBlob)
@@ -555,12 +1460,14 @@ DataGridRowsBlob DataGridTable::setBlobPrepare(unsigned row, unsigned col)
 void DataGridTable::setBlob(DataGridRowsBlob &b)
 {
     rowsM.setBlob(b);
+    cellCacheM->clear();
 }
 
 void DataGridTable::importBlobFile(const wxString& filename, int row, int col,
     ProgressIndicator *pi)
 {
     rowsM.importBlobFile(filename, row, col, pi);
+    cellCacheM->clear();
 
     // tell the grid it's done
     if (GetView())
@@ -591,6 +1498,8 @@ void DataGridTable::SetValue(int row, int col, const wxString& value)
     // UPDATE statement. See bug report #1882666 at sf.net.
     try
     {
+        // formatted values of the edited cell are no longer valid
+        cellCacheM->clear();
         wxString statement = rowsM.setFieldValue(row, col, value,
             nullFlagM);
         nullFlagM = false;  // reset
@@ -640,6 +1549,7 @@ void DataGridTable::setValueToNull(int row, int col)
         b.row  = row;
         b.st   = statementM;
         rowsM.setBlob(b);
+        cellCacheM->clear();
     }
 }
 
@@ -678,6 +1588,92 @@ bool DataGridTable::DeleteRows(size_t pos, size_t numRows)
     return false;
 }
 
+DataGridGroupTable::DataGridGroupTable()
+    : wxGridTableBase()
+{
+}
+
+void DataGridGroupTable::setResult(DataGridGroupResult& result)
+{
+    int oldRows = resultM.rows.size();
+    int oldCols = resultM.columnNames.size();
+    resultM.columnNames.swap(result.columnNames);
+    resultM.numericColumns.swap(result.numericColumns);
+    resultM.rows.swap(result.rows);
+
+    wxGrid* grid = GetView();
+    if (!grid)
+        return;
+    grid->BeginBatch();
+    if (oldRows)
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED, 0,
+            oldRows);
+        grid->ProcessTableMessage(msg);
+    }
+    if (oldCols)
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_COLS_DELETED, 0,
+            oldCols);
+        grid->ProcessTableMessage(msg);
+    }
+    if (GetNumberCols())
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_COLS_APPENDED,
+            GetNumberCols());
+        grid->ProcessTableMessage(msg);
+    }
+    if (GetNumberRows())
+    {
+        wxGridTableMessage msg(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED,
+            GetNumberRows());
+        grid->ProcessTableMessage(msg);
+    }
+    grid->EndBatch();
+}
+
+bool DataGridGroupTable::isNumericColumn(int col)
+{
+    return col >= 0 && col < GetNumberCols() && resultM.numericColumns[col];
+}
+
+wxString DataGridGroupTable::GetColLabelValue(int col)
+{
+    if (col < 0 || col >= GetNumberCols())
+        return wxEmptyString;
+    return resultM.columnNames[col];
+}
+
+int DataGridGroupTable::GetNumberCols()
+{
+    return resultM.columnNames.size();
+}
+
+int DataGridGroupTable::GetNumberRows()
+{
+    return resultM.rows.size();
+}
+
+wxString DataGridGroupTable::GetValue(int row, int col)
+{
+    if (row < 0 || row >= GetNumberRows() || col < 0
+        || col >= GetNumberCols())
+    {
+        return wxEmptyString;
+    }
+    return resultM.rows[row][col];
+}
+
+bool DataGridGroupTable::IsEmptyCell(int row, int col)
+{
+    return GetValue(row, col).empty();
+}
+
+void DataGridGroupTable::SetValue(int WXUNUSED(row), int WXUNUSED(col),
+    const wxString& WXUNUSED(value))
+{
+}
+
 DEFINE_EVENT_TYPE(wxEVT_FRDG_ROWCOUNT_CHANGED)
 DEFINE_EVENT_TYPE(wxEVT_FRDG_STATEMENT)
 DEFINE_EVENT_TYPE(wxEVT_FRDG_INVALIDATEATTR)
@@ -27,13 +27,18 @@
 #include <wx/wx.h>
 #include <wx/grid.h>
 
+#include <atomic>
+
 #include <ibpp.h>
 
 #include "gui/controls/DataGridRows.h"
 
 class Column;
 class Database;
+class DataGridBrowsePager;
 class DataGridCell;
+class DataGridCellCache;
+class DataGridFetchThread;
 class ResultsetColumnDef;
 class DataGridRowBuffer;
 class ProgressIndicator;
@@ -52,13 +57,22 @@ class DataGridTable: public wxGridTableBase
 {
 private:
     bool allRowsFetchedM;
-    bool fetchAllRowsM;
-    unsigned maxRowToFetchM;
+    // these are read by the fetch thread too
+    std::atomic<bool> fetchAllRowsM;
+    std::atomic<unsigned> maxRowToFetchM;
+    DataGridFetchThread* fetchThreadM;
+    DataGridBrowsePager* pagerM;
+    // after the last rows have been fetched with a scrollable cursor the
+    // rows before them are missing, they are fetched when they are shown
+    bool rowsMissingM;
+    unsigned wantedRowM;
+    bool rowsInsertedM;
     bool readOnlyM;
     bool canInsertRowsIsSetM;
     bool canInsertRowsM;
 
     wxGridCellAttr* cellAttriM;
+    DataGridCellCache* cellCacheM;
     DataGridRows rowsM;
 
     bool nullFlagM;
@@ -69,13 +83,28 @@ private:
 
     int getStatementColCount();
     bool isValidCellPos(int row, int col);
+    void appendFetchedRows();
+    unsigned countResultRows(unsigned fetchedRows);
+    bool fetchMissingRows();
+    void fetchPages();
+    void notifyRowsAppended(unsigned oldRows, bool threadFinished = false);
+    void notifyShownRowsChanged();
+    void startFetchThread();
 public:
     DataGridTable(IBPP::Statement& s, Database* db);
     ~DataGridTable();
 
     bool canFetchMoreRows();
+    // true while rows are fetched by the background thread, which owns the
+    // statement meanwhile
+    bool isFetching();
     void fetch();
     void fetchOne();
+    // with a scrollable cursor the last rows, or the rows around a given
+    // one, can be fetched without fetching the rows before them
+    bool canFetchLastRows();
+    void fetchLastRows();
+    void fetchRowsAround(unsigned row);
     void addRow(DataGridRowBuffer *buffer, const wxString& sql);
     wxString getCellValue(int row, int col);
     wxString getCellValueForInsert(int row, int col);
@@ -89,16 +118,43 @@ public:
     void getFields(const wxString& table, FieldSet& fields);
     Database *getDatabase();
 
-    void initialFetch(bool readonly);
+    // if browseSql isn't empty the statement is only prepared, and the rows
+    // are read in pages by statements created from browseSql
+    void initialFetch(bool readonly, const wxString& browseSql = wxEmptyString,
+        const IBPP::ColumnBatch* firstRows = 0);
+    // number of rows fetched before the grid is shown
+    static unsigned getInitialRowCount() { return 100; }
     bool isNullableColumn(int col);
     bool isNullCell(int row, int col);
     bool isNumericColumn(int col);
     bool isReadonlyColumn(int col);
     bool isBlobColumn(int col, bool* pIsTextual = 0);
-    bool needsMoreRowsFetched();
     void setFetchAllRecords(bool fetchall);
+    // needs to be called before the statement is closed or invalidated
+    void stopFetching();
     bool canInsertRows();
     bool canRemoveRow(size_t row);
+    // sorts the fetched rows locally, returns false if that isn't possible
+    // (BLOB columns, or rows that haven't been fetched yet)
+    bool sortRows(int col, bool ascending);
+    // -1 if the rows are shown in the order they were fetched
+    int getSortColumn();
+    bool isSortedAscending();
+    // shows only the fetched rows matching the filter, returns false if
+    // rows haven't been fetched yet, throws FRError for invalid values
+    bool setFilter(const DataGridFilter& filter);
+    void clearFilter();
+    bool isFiltered();
+    unsigned getFetchedRowCount();
+    // groups the fetched rows shown, returns false if rows haven't been
+    // fetched yet, throws FRError for columns that can't be used
+    bool groupRows(const DataGridGrouping& grouping,
+        DataGridGroupResult& result);
+    // values of the selected cells are read for the selection aggregates,
+    // they need to be read again when the change count changes
+    unsigned getChangeCount();
+    bool getNumericValues(int col, int fromRow, int toRow,
+        std::vector<double>& values);
 
     void setNullFlag(bool isNull);
 
@@ -127,4 +183,25 @@ public:
         ProgressIndicator *pi = 0);
 };
 
+// DataGridGroupTable: read-only table with the groups computed from the
+// rows of a DataGridTable
+class DataGridGroupTable: public wxGridTableBase
+{
+private:
+    DataGridGroupResult resultM;
+public:
+    DataGridGroupTable();
+
+    // takes the contents of result, the grid is resized to show them
+    void setResult(DataGridGroupResult& result);
+    bool isNumericColumn(int col);
+
+    virtual wxString GetColLabelValue(int col);
+    virtual int GetNumberCols();
+    virtual int GetNumberRows();
+    virtual wxString GetValue(int row, int col);
+    virtual bool IsEmptyCell(int row, int col);
+    virtual void SetValue(int row, int col, const wxString& value);
+};
+
 #endif
@@ -0,0 +1,138 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// For compilers that support precompilation, includes "wx/wx.h".
+#include "wx/wxprec.h"
+
+// for all others, include the necessary headers (this file is usually all you
+// need because it includes almost all "standard" wxWindows headers
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "gui/controls/DataGridTextMatcher.h"
+
+DataGridTextMatcher::DataGridTextMatcher()
+    : anchorM(0), anchorLowerM(0), anchorUpperM(0)
+{
+}
+
+/*static*/
+unsigned char DataGridTextMatcher::fold(char c)
+{
+    unsigned char uc = c;
+    return (uc >= 'A' && uc <= 'Z') ? uc + ('a' - 'A') : uc;
+}
+
+void DataGridTextMatcher::setString(const char* data, unsigned length)
+{
+    foldedM.resize(length);
+    anchorM = 0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        foldedM[i] = fold(data[i]);
+        if (anchorM == 0 && i > 0 && foldedM[0] >= 'a' && foldedM[0] <= 'z'
+            && !(foldedM[i] >= 'a' && foldedM[i] <= 'z'))
+        {
+            anchorM = i;
+        }
+    }
+    if (length)
+    {
+        anchorLowerM = foldedM[anchorM];
+        anchorUpperM = (anchorLowerM >= 'a' && anchorLowerM <= 'z')
+            ? anchorLowerM - ('a' - 'A') : anchorLowerM;
+    }
+}
+
+bool DataGridTextMatcher::matchesAt(const char* data) const
+{
+    for (size_t i = 0; i < foldedM.size(); ++i)
+    {
+        if (fold(data[i]) != (unsigned char)foldedM[i])
+            return false;
+    }
+    return true;
+}
+
+bool DataGridTextMatcher::contains(const char* data, unsigned length) const
+{
+    if (foldedM.empty())
+        return true;
+    if (length < foldedM.size())
+        return false;
+    // the anchor byte can be found from here up to (excluding) end
+    const char* first = data + anchorM;
+    const char* end = first + (length - foldedM.size()) + 1;
+    const char* lower = static_cast<const char*>(
+        memchr(first, anchorLowerM, end - first));
+    const char* upper = 0;
+    if (anchorUpperM != anchorLowerM)
+    {
+        upper = static_cast<const char*>(
+            memchr(first, anchorUpperM, end - first));
+    }
+    while (lower || upper)
+    {
+        const char* hit;
+        if (lower && (!upper || lower < upper))
+        {
+            hit = lower;
+            lower = static_cast<const char*>(
+                memchr(hit + 1, anchorLowerM, end - hit - 1));
+        }
+        else
+        {
+            hit = upper;
+            upper = static_cast<const char*>(
+                memchr(hit + 1, anchorUpperM, end - hit - 1));
+        }
+        if (matchesAt(hit - anchorM))
+            return true;
+    }
+    return false;
+}
+
+/*static*/
+int DataGridTextMatcher::compare(const char* data1, unsigned length1,
+    const char* data2, unsigned length2)
+{
+    unsigned common = std::min(length1, length2);
+    int res = memcmp(data1, data2, common);
+    if (res != 0)
+        return res;
+    for (unsigned i = common; i < length1; ++i)
+    {
+        if (data1[i] != ' ')
+            return ((unsigned char)data1[i] < ' ') ? -1 : 1;
+    }
+    for (unsigned i = common; i < length2; ++i)
+    {
+        if (data2[i] != ' ')
+            return ((unsigned char)data2[i] < ' ') ? 1 : -1;
+    }
+    return 0;
+}
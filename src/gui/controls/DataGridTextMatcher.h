@@ -0,0 +1,54 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_DATAGRIDTEXTMATCHER_H
+#define FR_DATAGRIDTEXTMATCHER_H
+
+#include <string>
+
+// DataGridTextMatcher class: finds a string in the bytes of a field, ASCII
+// letters are matched regardless of case. The candidates for a match are
+// found with memchr() (vectorized in the C library) for one byte of the
+// string, preferably one that isn't a letter
+class DataGridTextMatcher
+{
+private:
+    std::string foldedM;
+    size_t anchorM;
+    char anchorLowerM;
+    char anchorUpperM;
+
+    static unsigned char fold(char c);
+    bool matchesAt(const char* data) const;
+public:
+    DataGridTextMatcher();
+    void setString(const char* data, unsigned length);
+    bool contains(const char* data, unsigned length) const;
+
+    // compares strings like Firebird does for CHAR and VARCHAR values, with
+    // the shorter one padded with spaces
+    static int compare(const char* data1, unsigned length1,
+        const char* data2, unsigned length2);
+};
+
+#endif
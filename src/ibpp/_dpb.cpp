@@ -78,6 +78,15 @@ void DPB::Insert(char type, int16_t data)
     mSize += 2;
 }
 
+void DPB::Insert(char type, int32_t data)
+{
+	Grow(2 + 4);
+    mBuffer[mSize++] = type;
+	mBuffer[mSize++] = char(4);
+    *(int32_t*)&mBuffer[mSize] = int32_t((*gds.Call()->m_vax_integer)((char*)&data, 4));
+    mSize += 4;
+}
+
 void DPB::Insert(char type, bool data)
 {
 	Grow(2 + 1);
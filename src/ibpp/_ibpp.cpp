@@ -29,6 +29,10 @@
 
 #include <limits>
 
+#ifdef IBPP_UNIX
+#include <dlfcn.h>
+#endif
+
 #ifdef IBPP_WINDOWS
 
 // Optional Registry Keys introduced by Firebird Server 1.5.x
@@ -235,6 +239,8 @@ FBCLIENT* FBCLIENT::Call()
 #define FB_ENTRYPOINT(X) \
             if ((m_##X = (proto_##X*)GetProcAddress(mHandle, "fb_"#X)) == 0) \
                 throw LogicExceptionImpl("FBCLIENT:gds()", _("Entry-point fb_"#X" not found"))
+#define FB_OPTIONAL_ENTRYPOINT(X) \
+            m_##X = (proto_##X*)GetProcAddress(mHandle, "fb_"#X)
 #endif
 #ifdef IBPP_UNIX
 #ifdef IBPP_LATE_BIND
@@ -244,9 +250,12 @@ FBCLIENT* FBCLIENT::Call()
 #define FB_ENTRYPOINT(X) \
     if ((m_##X = (proto_##X*)dlsym(mHandle,"fb_"#X)) == 0) \
         throw LogicExceptionImpl("FBCLIENT:gds()", _("Entry-point fb_"#X" not found"))
+#define FB_OPTIONAL_ENTRYPOINT(X) m_##X = (proto_##X*)dlsym(mHandle,"fb_"#X)
 #else
 #define IB_ENTRYPOINT(X) m_##X = (proto_##X*)isc_##X
 #define FB_ENTRYPOINT(X) m_##X = (proto_##X*)fb_##X
+// not declared by the ibase.h IBPP is built with, look them up at runtime
+#define FB_OPTIONAL_ENTRYPOINT(X) m_##X = (proto_##X*)dlsym(RTLD_DEFAULT,"fb_"#X)
 #endif
 #endif
 
@@ -297,6 +306,12 @@ FBCLIENT* FBCLIENT::Call()
 		IB_ENTRYPOINT(service_start);
 		IB_ENTRYPOINT(service_query);
 
+		// Firebird 3 and later object oriented API, used for scrollable cursors
+		FB_OPTIONAL_ENTRYPOINT(get_master_interface);
+		FB_OPTIONAL_ENTRYPOINT(get_transaction_interface);
+		FB_OPTIONAL_ENTRYPOINT(get_statement_interface);
+		FB_OPTIONAL_ENTRYPOINT(cancel_operation);
+
 		mReady = true;
 	}
 
@@ -365,6 +380,15 @@ namespace IBPP
 							dynamic_cast<TransactionImpl*>(tr.intf()));
 	}
 
+	Blob BlobFactory(Database db, Transaction tr, int64_t BlobId)
+	{
+		(void)gds.Call();			// Triggers the initialization, if needed
+		ISC_QUAD quad;
+		memcpy(&quad, &BlobId, sizeof(quad));
+		return new BlobImpl(dynamic_cast<DatabaseImpl*>(db.intf()),
+							dynamic_cast<TransactionImpl*>(tr.intf()), &quad);
+	}
+
 	Array ArrayFactory(Database db, Transaction tr)
 	{
 		(void)gds.Call();			// Triggers the initialization, if needed
@@ -48,8 +48,15 @@
 #include <windows.h>
 #endif
 
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <limits>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <sstream>
 #include <cstdarg>
@@ -383,6 +390,231 @@ typedef void        ISC_EXPORT proto_encode_sql_time (void *,
 typedef void        ISC_EXPORT proto_encode_timestamp (void *,
                     ISC_TIMESTAMP *);
 
+//
+//  Minimal declarations of the object oriented API of Firebird 3 and later
+//  (see firebird/IdlFbInterfaces.h). Only the leading part of each function
+//  table which is used by IBPP is declared, the interfaces are only used
+//  through the legacy handles they are obtained from.
+//
+
+struct FbStatus;
+struct FbMaster;
+struct FbTransaction;
+struct FbStatement;
+struct FbResultSet;
+struct FbMessageMetadata;
+struct FbBatch;
+struct FbBatchCompletionState;
+
+struct FbStatusVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*dispose)(FbStatus* self);
+    void (*init)(FbStatus* self);
+    unsigned (*getState)(const FbStatus* self);
+    void (*setErrors2)(FbStatus* self, unsigned length, const intptr_t* value);
+    void (*setWarnings2)(FbStatus* self, unsigned length, const intptr_t* value);
+    void (*setErrors)(FbStatus* self, const intptr_t* value);
+    void (*setWarnings)(FbStatus* self, const intptr_t* value);
+    const intptr_t* (*getErrors)(const FbStatus* self);
+};
+
+struct FbStatus
+{
+    enum { STATE_WARNINGS = 0x1, STATE_ERRORS = 0x2 };
+    enum { RESULT_ERROR = -1, RESULT_OK = 0, RESULT_NO_DATA = 1 };
+
+    void* cloopDummy[1];
+    FbStatusVTable* cloopVTable;
+};
+
+struct FbMasterVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    FbStatus* (*getStatus)(FbMaster* self);
+};
+
+struct FbMaster
+{
+    void* cloopDummy[1];
+    FbMasterVTable* cloopVTable;
+};
+
+struct FbTransactionVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*addRef)(FbTransaction* self);
+    int (*release)(FbTransaction* self);
+};
+
+struct FbTransaction
+{
+    void* cloopDummy[1];
+    FbTransactionVTable* cloopVTable;
+};
+
+struct FbMessageMetadataVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*addRef)(FbMessageMetadata* self);
+    int (*release)(FbMessageMetadata* self);
+    unsigned (*getCount)(FbMessageMetadata* self, FbStatus* status);
+    const char* (*getField)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    const char* (*getRelation)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    const char* (*getOwner)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    const char* (*getAlias)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    unsigned (*getType)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    FB_BOOLEAN (*isNullable)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    int (*getSubType)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    unsigned (*getLength)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    int (*getScale)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    unsigned (*getCharSet)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    unsigned (*getOffset)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    unsigned (*getNullOffset)(FbMessageMetadata* self, FbStatus* status, unsigned index);
+    void* (*getBuilder)(FbMessageMetadata* self, FbStatus* status);
+    unsigned (*getMessageLength)(FbMessageMetadata* self, FbStatus* status);
+};
+
+struct FbMessageMetadata
+{
+    void* cloopDummy[1];
+    FbMessageMetadataVTable* cloopVTable;
+};
+
+struct FbStatementVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*addRef)(FbStatement* self);
+    int (*release)(FbStatement* self);
+    void (*getInfo)(FbStatement* self, FbStatus* status, unsigned itemsLength,
+        const unsigned char* items, unsigned bufferLength, unsigned char* buffer);
+    unsigned (*getType)(FbStatement* self, FbStatus* status);
+    const char* (*getPlan)(FbStatement* self, FbStatus* status, FB_BOOLEAN detailed);
+    ISC_UINT64 (*getAffectedRecords)(FbStatement* self, FbStatus* status);
+    FbMessageMetadata* (*getInputMetadata)(FbStatement* self, FbStatus* status);
+    FbMessageMetadata* (*getOutputMetadata)(FbStatement* self, FbStatus* status);
+    FbTransaction* (*execute)(FbStatement* self, FbStatus* status,
+        FbTransaction* transaction, FbMessageMetadata* inMetadata, void* inBuffer,
+        FbMessageMetadata* outMetadata, void* outBuffer);
+    FbResultSet* (*openCursor)(FbStatement* self, FbStatus* status,
+        FbTransaction* transaction, FbMessageMetadata* inMetadata, void* inBuffer,
+        FbMessageMetadata* outMetadata, unsigned flags);
+    void (*setCursorName)(FbStatement* self, FbStatus* status, const char* name);
+    // named deprecatedFree() since Firebird 5
+    void (*free)(FbStatement* self, FbStatus* status);
+    unsigned (*getFlags)(FbStatement* self, FbStatus* status);
+    // Firebird 4 and later (version 4 of the interface)
+    unsigned (*getTimeout)(FbStatement* self, FbStatus* status);
+    void (*setTimeout)(FbStatement* self, FbStatus* status, unsigned timeOut);
+    FbBatch* (*createBatch)(FbStatement* self, FbStatus* status,
+        FbMessageMetadata* inMetadata, unsigned parLength, const unsigned char* par);
+};
+
+struct FbStatement
+{
+    enum { CURSOR_TYPE_SCROLLABLE = 0x1 };
+    // First version with getTimeout(), setTimeout() and createBatch()
+    enum { VERSION_TIMEOUT = 4, VERSION_BATCH = 4 };
+
+    void* cloopDummy[1];
+    FbStatementVTable* cloopVTable;
+};
+
+struct FbResultSetVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*addRef)(FbResultSet* self);
+    int (*release)(FbResultSet* self);
+    int (*fetchNext)(FbResultSet* self, FbStatus* status, void* message);
+    int (*fetchPrior)(FbResultSet* self, FbStatus* status, void* message);
+    int (*fetchFirst)(FbResultSet* self, FbStatus* status, void* message);
+    int (*fetchLast)(FbResultSet* self, FbStatus* status, void* message);
+    int (*fetchAbsolute)(FbResultSet* self, FbStatus* status, int position, void* message);
+    int (*fetchRelative)(FbResultSet* self, FbStatus* status, int offset, void* message);
+    FB_BOOLEAN (*isEof)(FbResultSet* self, FbStatus* status);
+    FB_BOOLEAN (*isBof)(FbResultSet* self, FbStatus* status);
+    FbMessageMetadata* (*getMetadata)(FbResultSet* self, FbStatus* status);
+    // named deprecatedClose() since Firebird 4, releases the interface too
+    void (*close)(FbResultSet* self, FbStatus* status);
+};
+
+struct FbResultSet
+{
+    void* cloopDummy[1];
+    FbResultSetVTable* cloopVTable;
+};
+
+// Firebird 4 and later
+struct FbBatchVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*addRef)(FbBatch* self);
+    int (*release)(FbBatch* self);
+    void (*add)(FbBatch* self, FbStatus* status, unsigned count, const void* inBuffer);
+    void (*addBlob)(FbBatch* self, FbStatus* status, unsigned length,
+        const void* inBuffer, ISC_QUAD* blobId, unsigned parLength,
+        const unsigned char* par);
+    void (*appendBlobData)(FbBatch* self, FbStatus* status, unsigned length,
+        const void* inBuffer);
+    void (*addBlobStream)(FbBatch* self, FbStatus* status, unsigned length,
+        const void* inBuffer);
+    void (*registerBlob)(FbBatch* self, FbStatus* status,
+        const ISC_QUAD* existingBlob, ISC_QUAD* blobId);
+    FbBatchCompletionState* (*execute)(FbBatch* self, FbStatus* status,
+        FbTransaction* transaction);
+};
+
+struct FbBatch
+{
+    enum { VERSION1 = 1, TAG_MULTIERROR = 1, TAG_RECORD_COUNTS = 2 };
+
+    void* cloopDummy[1];
+    FbBatchVTable* cloopVTable;
+};
+
+struct FbBatchCompletionStateVTable
+{
+    void* cloopDummy[1];
+    uintptr_t version;
+    void (*dispose)(FbBatchCompletionState* self);
+    unsigned (*getSize)(FbBatchCompletionState* self, FbStatus* status);
+    int (*getState)(FbBatchCompletionState* self, FbStatus* status, unsigned pos);
+    unsigned (*findError)(FbBatchCompletionState* self, FbStatus* status,
+        unsigned pos);
+    void (*getStatus)(FbBatchCompletionState* self, FbStatus* status,
+        FbStatus* to, unsigned pos);
+};
+
+struct FbBatchCompletionState
+{
+    enum { EXECUTE_FAILED = -1, SUCCESS_NO_INFO = -2 };
+
+    void* cloopDummy[1];
+    FbBatchCompletionStateVTable* cloopVTable;
+};
+
+typedef FbMaster* ISC_EXPORT proto_get_master_interface();
+
+// Firebird 2.5 and later
+typedef ISC_STATUS ISC_EXPORT proto_cancel_operation (ISC_STATUS*,
+                        isc_db_handle*, ISC_USHORT);
+
+// Firebird 4 and later, the interfaces are returned with a reference
+typedef ISC_STATUS ISC_EXPORT proto_get_transaction_interface (ISC_STATUS*,
+                        void*,
+                        isc_tr_handle*);
+
+typedef ISC_STATUS ISC_EXPORT proto_get_statement_interface (ISC_STATUS*,
+                        void*,
+                        isc_stmt_handle*);
+
 //
 //  Internal binding structure to the FBCLIENT DLL
 //
@@ -459,6 +691,12 @@ struct FBCLIENT
     proto_service_detach*           m_service_detach;
     proto_service_start*            m_service_start;
     proto_service_query*            m_service_query;
+
+    // optional entry points, 0 if the client library doesn't have them
+    proto_get_master_interface*     m_get_master_interface;
+    proto_get_transaction_interface* m_get_transaction_interface;
+    proto_get_statement_interface*  m_get_statement_interface;
+    proto_cancel_operation*         m_cancel_operation;
     //proto_decode_sql_date*            m_decode_sql_date;
     //proto_decode_sql_time*            m_decode_sql_time;
     //proto_decode_timestamp*           m_decode_timestamp;
@@ -523,6 +761,7 @@ class DPB
 public:
     void Insert(char, const char*); // Insert a new char* 'cluster'
     void Insert(char, int16_t);     // Insert a new int16_t 'cluster'
+    void Insert(char, int32_t);     // Insert a new int32_t 'cluster'
     void Insert(char, bool);        // Insert a new bool 'cluster'
     void Insert(char, char);        // Insert a new byte 'cluster'
     void Reset();               // Clears the DPB
@@ -602,6 +841,7 @@ public:
     const char* ErrorMessage() const;
     int SqlCode() const;
     int EngineCode() const { return (mVector[0] == 1) ? (int)mVector[1] : 0; }
+    void EngineCodes(std::vector<int>& codes) const;
     void Reset();
 
     IBS();
@@ -694,6 +934,7 @@ class SQLExceptionImpl : public IBPP::SQLException, public ExceptionBase
 private:
     int mSqlCode;
     int mEngineCode;
+    std::vector<int> mEngineCodes;
 
 public:
 
@@ -715,6 +956,7 @@ public:
     virtual const char* what() const throw();
     virtual int SqlCode() const throw();
     virtual int EngineCode() const throw();
+    virtual bool HasEngineCode(int code) const throw();
 };
 
 class WrongTypeImpl : public IBPP::WrongType, public ExceptionBase
@@ -746,7 +988,7 @@ class ServiceImpl : public IBPP::IService
     //  (((((((( OBJECT INTERNALS ))))))))
 
 private:
-    int mRefCount;              // Reference counter
+    std::atomic<int> mRefCount;  // Reference counter
     isc_svc_handle mHandle;     // Firebird API Service Handle
     std::string mServerName;    // Server Name
     std::string mUserName;      // User Name
@@ -807,7 +1049,7 @@ class DatabaseImpl : public IBPP::IDatabase
 {
     //  (((((((( OBJECT INTERNALS ))))))))
 
-    int mRefCount;              // Reference counter
+    std::atomic<int> mRefCount;  // Reference counter
     isc_db_handle mHandle;      // InterBase API Session Handle
     std::string mServerName;    // Server name
     std::string mDatabaseName;  // Database name (path/file)
@@ -818,12 +1060,23 @@ class DatabaseImpl : public IBPP::IDatabase
     std::string mCreateParams;  // Other parameters (creation only)
 
     int mDialect;                           // 1 if IB5, 1 or 3 if IB6/FB1
+    unsigned mStatementTimeout;             // Milliseconds, 0 if not set
+    unsigned mIdleTimeout;                  // Seconds, 0 if not set
+    IBPP::CLI mClientInterface;             // Requested by SetClientInterface()
+    IBPP::ConnectionProfile mProfile;       // DPB tuning, see SetProfile()
+    std::mutex mObjectsMutex;               // Guards the tables below
     std::vector<TransactionImpl*> mTransactions;// Table of Transaction*
     std::vector<StatementImpl*> mStatements;// Table of Statement*
     std::vector<BlobImpl*> mBlobs;          // Table of Blob*
     std::vector<ArrayImpl*> mArrays;        // Table of Array*
     std::vector<EventsImpl*> mEvents;       // Table of Events*
 
+    template<class T> T* LastObject(std::vector<T*>& objects)
+    {
+        std::lock_guard<std::mutex> guard(mObjectsMutex);
+        return objects.empty() ? 0 : objects.back();
+    }
+
 public:
     isc_db_handle* GetHandlePtr() { return &mHandle; }
     isc_db_handle GetHandle() { return mHandle; }
@@ -838,6 +1091,7 @@ public:
     void DetachArrayImpl(ArrayImpl*);
     void AttachEventsImpl(EventsImpl*);
     void DetachEventsImpl(EventsImpl*);
+    void ExecuteSessionStatement(const std::string& sql, const char* context);
 
     DatabaseImpl(const std::string& ServerName, const std::string& DatabaseName,
                 const std::string& UserName, const std::string& UserPassword,
@@ -874,6 +1128,15 @@ public:
     void Inactivate();
     void Disconnect();
     void Drop();
+    void CancelOperation();
+    void SetStatementTimeout(unsigned milliseconds);
+    unsigned StatementTimeout() { return mStatementTimeout; }
+    void SetIdleTimeout(unsigned seconds);
+    unsigned IdleTimeout() { return mIdleTimeout; }
+    void SetClientInterface(IBPP::CLI ci) { mClientInterface = ci; }
+    void SetProfile(const IBPP::ConnectionProfile& p) { mProfile = p; }
+    const IBPP::ConnectionProfile& Profile() const { return mProfile; }
+    IBPP::CLI ClientInterface();
 
     IBPP::IDatabase* AddRef();
     void Release();
@@ -884,9 +1147,10 @@ class TransactionImpl : public IBPP::ITransaction
     //  (((((((( OBJECT INTERNALS ))))))))
 
 private:
-    int mRefCount;                  // Reference counter
+    std::atomic<int> mRefCount;      // Reference counter
     isc_tr_handle mHandle;          // Transaction InterBase
 
+    std::mutex mObjectsMutex;                   // Guards the tables below
     std::vector<DatabaseImpl*> mDatabases;      // Table of IDatabase*
     std::vector<StatementImpl*> mStatements;    // Table of IStatement*
     std::vector<BlobImpl*> mBlobs;              // Table of IBlob*
@@ -894,6 +1158,13 @@ private:
     std::vector<TPB*> mTPBs;                    // Table of TPB
 
     void Init();            // A usage exclusif des constructeurs
+    void CursorsClosed();
+
+    template<class T> T* LastObject(std::vector<T*>& objects)
+    {
+        std::lock_guard<std::mutex> guard(mObjectsMutex);
+        return objects.empty() ? 0 : objects.back();
+    }
 
 public:
     isc_tr_handle* GetHandlePtr() { return &mHandle; }
@@ -941,7 +1212,7 @@ class RowImpl : public IBPP::IRow
     //  (((((((( OBJECT INTERNALS ))))))))
 
 private:
-    int mRefCount;                  // Reference counter
+    std::atomic<int> mRefCount;      // Reference counter
 
     XSQLDA* mDescrArea;             // XSQLDA descriptor itself
     std::vector<double> mNumerics;  // Temporary storage for Numerics
@@ -952,6 +1223,12 @@ private:
     std::vector<char> mBools;       // Temporary storage for Bools
     std::vector<std::string> mStrings;  // Temporary storage for Strings
     std::vector<bool> mUpdated;     // Which columns where updated (Set()) ?
+    std::vector<int64_t> mArena;    // Values and indicators of all columns
+
+    // Column numbers by name, then by alias, built on first use of ColumnNum()
+    std::unordered_map<std::string, int> mColumnNums;
+    bool mColumnsIndexed;
+    std::string mColumnKey;         // Upper case name looked up, reused
 
     int mDialect;                   // Related database dialect
     DatabaseImpl* mDatabase;        // Related Database (important for Blobs, ...)
@@ -959,12 +1236,21 @@ private:
 
     void SetValue(int, IITYPE, const void* value, int = 0);
     void* GetValue(int, IITYPE, void* = 0);
+    static int ValueSize(const XSQLVAR* var);
+    void RebaseVariables(const RowImpl& copied);
+    void IndexColumns();
 
 public:
     void Free();
     short AllocatedSize() { return mDescrArea->sqln; }
     void Resize(int n);
     void AllocVariables();
+    bool Recycle(const RowImpl& copied);    // Copy without reallocations
+    // Values as stored for batches : the indicator followed by the bytes of
+    // the XSQLVAR data, RawSize() bytes for each column
+    static int RawSize(const XSQLVAR* var);
+    void GetRaw(int, char* data);
+    void SetRaw(int, const char* data);
     bool MissingValues();       // Returns wether one of the mMissing[] is true
     XSQLDA* Self() { return mDescrArea; }
 
@@ -1055,7 +1341,7 @@ class StatementImpl : public IBPP::IStatement
 private:
     friend class TransactionImpl;
 
-    int mRefCount;              // Reference counter
+    std::atomic<int> mRefCount;  // Reference counter
     isc_stmt_handle mHandle;    // Statement Handle
 
     DatabaseImpl* mDatabase;        // Attached database
@@ -1068,8 +1354,56 @@ private:
     IBPP::STT mType;            // Type de requète
     std::string mSql;           // Last SQL statement prepared or executed
 
+    // Cursor opened with the object interface, either by ExecuteScrollable()
+    // or by Execute() when the database uses ciObject. Its rows are fetched
+    // into mResultBuffer and copied to the XSQLDA of the output row
+    FbResultSet* mResultSet;
+    bool mResultScrollable;
+    FbMessageMetadata* mResultMeta;
+    std::vector<char> mResultBuffer;
+    std::vector<unsigned> mResultOffsets;
+    std::vector<unsigned> mResultNullOffsets;
+
+    enum ScrollOp {soNext, soPrior, soFirst, soLast, soAbsolute, soRelative};
+
+    // Layout of the output columns for FetchBatch(), set up by Prepare()
+    // (only sqltype, scale and size of each column are used)
+    std::vector<IBPP::ColumnBatch::Column> mBatchLayout;
+
+    // Rows of parameters collected by AddBatch(), in the format of
+    // RowImpl::GetRaw() for each parameter
+    std::vector<char> mBatchData;
+    int mBatchRows;
+    unsigned mTimeout;              // Milliseconds, 0 if not set
+
+    // Measurements of the last Prepare() and execution, see Metrics()
+    int64_t mPrepareTime;           // Microseconds
+    int64_t mExecuteTime;
+    int64_t mFetchTime;
+    int mRowsFetched;
+    bool mCountPages;               // Set by CountPages()
+    bool mPagesCounting;            // Execution started, result set not ended
+    int mPagesStart[4];             // Page counters of the attachment
+    int mPages[4];                  // Pages counted, -1 if not counted
+
     // Internal Methods
     void CursorFree();
+    void ResultSetFree();
+    bool OpenResultSet(unsigned flags, const std::string& context);
+    bool FetchMessage(ScrollOp op, int position, const char* context);
+    bool ScrollFetch(ScrollOp op, int position, RowImpl* row, const char* context);
+    int BatchRowSize();
+    bool ExecuteInterfaceBatch(IBPP::BatchErrors& errors);
+    void ExecuteBlockBatch(IBPP::BatchErrors& errors);
+    void ExecuteSingleton();
+    void ExecuteSingleRows(int first, int count, IBPP::BatchErrors& errors);
+    void ApplyTimeout(const char* context);
+    void ClearMetrics();
+    void StartMetrics();
+    void EndPageCount();
+    void ReadPageCount();
+    void RecordCounts(int& selects, int& inserts, int& updates, int& deletes,
+        const char* context);
 
 public:
     // Properties and Attributes Access Methods
@@ -1079,6 +1413,7 @@ public:
     void DetachDatabaseImpl();
     void AttachTransactionImpl(TransactionImpl*);
     void DetachTransactionImpl();
+    void CursorClosed();    // The transaction ended, the server closed it
 
     StatementImpl(DatabaseImpl*, TransactionImpl*);
     ~StatementImpl();
@@ -1094,7 +1429,24 @@ public:
     inline void CursorExecute(const std::string& cursor)    { CursorExecute(cursor, std::string()); }
     bool Fetch();
     bool Fetch(IBPP::Row&);
+    int FetchBatch(int rows, IBPP::ColumnBatch&);
+    void AddBatch();
+    int BatchRows() { return mBatchRows; }
+    int ExecuteBatch(IBPP::BatchErrors& errors);
+    void ClearBatch();
+    void ExecuteScrollable();
+    bool Scrollable() { return mResultSet != 0 && mResultScrollable; }
+    bool FetchFirst();
+    bool FetchLast();
+    bool FetchPrior();
+    bool FetchAbsolute(int position);
+    bool FetchRelative(int offset);
+    void SetTimeout(unsigned milliseconds);
+    unsigned Timeout() { return mTimeout; }
     int AffectedRows();
+    void Metrics(IBPP::StatementMetrics&);
+    void ServerMetrics(IBPP::StatementMetrics&);
+    void CountPages(bool count) { mCountPages = count; }
     void Close();   // Free resources, attachments maintained
     std::string& Sql() { return mSql; }
     IBPP::STT Type() { return mType; }
@@ -1194,8 +1546,9 @@ class BlobImpl : public IBPP::IBlob
 
 private:
     friend class RowImpl;
+    friend class IBPP::ColumnBatch;
 
-    int mRefCount;
+    std::atomic<int> mRefCount;
     bool                    mIdAssigned;
     ISC_QUAD                mId;
     isc_blob_handle         mHandle;
@@ -1203,18 +1556,30 @@ private:
     DatabaseImpl*           mDatabase;      // Belongs to this database
     TransactionImpl*        mTransaction;   // Belongs to this transaction
 
+    // Block streaming, see ReadBlock()
+    bool                    mEof;           // isc_get_segment reached the end
+    bool                    mReadAhead;
+    std::vector<char>       mAhead;         // Block read in the background
+    int                     mAheadPos;
+    int                     mAheadLength;
+    std::future<int>        mAheadPending;  // Pending read into mAhead
+
     void Init();
     void SetId(ISC_QUAD*);
     void GetId(ISC_QUAD*);
+    int FillBlock(char*, int size);
+    void WaitReadAhead();
 
 public:
     void AttachDatabaseImpl(DatabaseImpl*);
     void DetachDatabaseImpl();
     void AttachTransactionImpl(TransactionImpl*);
     void DetachTransactionImpl();
+    void CursorClosed();    // The transaction ended, the server closed it
 
     BlobImpl(const BlobImpl&);
     BlobImpl(DatabaseImpl*, TransactionImpl* = 0);
+    BlobImpl(DatabaseImpl*, TransactionImpl*, ISC_QUAD*);
     ~BlobImpl();
 
     //  (((((((( OBJECT INTERFACE ))))))))
@@ -1231,6 +1596,10 @@ public:
     void Save(const std::string& data);
     void Load(std::string& data);
 
+    int ReadBlock(void*, int size);
+    void WriteBlock(const void*, int size);
+    void SetReadAhead(bool);
+
     IBPP::Database DatabasePtr() const;
     IBPP::Transaction TransactionPtr() const;
 
@@ -1245,7 +1614,7 @@ class ArrayImpl : public IBPP::IArray
 private:
     friend class RowImpl;
 
-    int                 mRefCount;      // Reference counter
+    std::atomic<int> mRefCount;          // Reference counter
     bool                mIdAssigned;
     ISC_QUAD            mId;
     bool                mDescribed;
@@ -1268,6 +1637,7 @@ public:
     void DetachDatabaseImpl();
     void AttachTransactionImpl(TransactionImpl*);
     void DetachTransactionImpl();
+    void CursorClosed();    // The transaction ended, the server closed it
 
     ArrayImpl(const ArrayImpl&);
     ArrayImpl(DatabaseImpl*, TransactionImpl* = 0);
@@ -1340,16 +1710,31 @@ class EventsImpl : public IBPP::IEvents
     Buffer mEventBuffer;
     Buffer mResultsBuffer;
 
-    int mRefCount;      // Reference counter
+    std::atomic<int> mRefCount; // Reference counter
 
     DatabaseImpl* mDatabase;
     ISC_LONG mId;           // Firebird internal Id of these events
-    bool mQueued;           // Has isc_que_events() been called?
-    bool mTrapped;          // EventHandled() was called since last que_events()
-
+    std::atomic<bool> mQueued;  // Has isc_que_events() been called?
+    std::atomic<bool> mTrapped; // EventHandled() was called since last que_events()
+
+    // Asynchronous delivery, see StartDelivery(). mMutex guards the buffers
+    // and the objrefs against the delivery thread. EventHandler() never takes
+    // it, as isc_cancel_events() may wait for the handler to return; it only
+    // takes mWakeMutex for the time of signalling mWakeup.
+    std::recursive_mutex mMutex;
+    std::mutex mWakeMutex;
+    std::condition_variable mWakeup;
+    std::thread mDeliveryThread;
+    bool mStopDelivery;                         // Guarded by mWakeMutex
+    std::shared_ptr<std::atomic<bool> > mAlive; // Cleared by the destructor
+
+    typedef std::vector<std::pair<IBPP::EventInterface*, IBPP::EventCounts> >
+        Deliveries;
     void FireActions();
+    void CollectActions(Deliveries&);
     void Queue();
     void Cancel();
+    static void DeliveryLoop(EventsImpl*, std::shared_ptr<std::atomic<bool> >);
 
     EventsImpl& operator=(const EventsImpl&);
     EventsImpl(const EventsImpl&);
@@ -1369,6 +1754,9 @@ public:
     void List(std::vector<std::string>&);
     void Clear();               // Drop all events
     void Dispatch();            // Dispatch NON async events
+    void StartDelivery();
+    void StopDelivery();
+    bool Delivering();
 
     IBPP::Database DatabasePtr() const;
 
@@ -77,6 +77,19 @@ const char* IBS::ErrorMessage() const
 	return mMessage.c_str();
 }
 
+// The codes of the errors in the vector, the first one is EngineCode()
+void IBS::EngineCodes(std::vector<int>& codes) const
+{
+	codes.clear();
+	int i = 0;
+	while (i < 19 && mVector[i] != isc_arg_end)
+	{
+		if (mVector[i] == isc_arg_gds)
+			codes.push_back((int)mVector[i + 1]);
+		i += (mVector[i] == isc_arg_cstring) ? 3 : 2;
+	}
+}
+
 void IBS::Reset()
 {
 	for (int i = 0; i < 20; i++) mVector[i] = 0;
@@ -26,8 +26,16 @@
 #pragma hdrstop
 #endif
 
+#include <algorithm>
+
 using namespace ibpp_internals;
 
+namespace
+{
+	// Largest segment isc_get_segment/isc_put_segment can deal with
+	const int MAXSEGMENT = 64*1024-1;
+}
+
 //	(((((((( OBJECT INTERFACE IMPLEMENTATION ))))))))
 
 void BlobImpl::Open()
@@ -47,6 +55,8 @@ void BlobImpl::Open()
 	if (status.Errors())
 		throw SQLExceptionImpl(status, "Blob::Open", _("isc_open_blob2 failed."));
 	mWriteMode = false;
+	mEof = false;
+	mAheadPos = mAheadLength = 0;
 }
 
 void BlobImpl::Create()
@@ -72,6 +82,8 @@ void BlobImpl::Close()
 {
 	if (mHandle == 0) return;	// Not opened anyway
 
+	WaitReadAhead();
+
 	IBS status;
 	(*gds.Call()->m_close_blob)(status.Self(), &mHandle);
 	if (status.Errors())
@@ -103,6 +115,9 @@ int BlobImpl::Read(void* buffer, int size)
 	if (size < 1 || size > (64*1024-1))
 		throw LogicExceptionImpl("Blob::Read", _("Invalid segment size (max 64Kb-1)"));
 
+	// Don't step on the toes of a read-ahead in progress
+	if (mReadAhead) return ReadBlock(buffer, size);
+
 	IBS status;
 	unsigned short bytesread;
 	ISC_STATUS result = (*gds.Call()->m_get_segment)(status.Self(), &mHandle, &bytesread,
@@ -172,7 +187,7 @@ void BlobImpl::Save(const std::string& data)
 	size_t len = data.size();
 	while (len != 0)
 	{
-		size_t blklen = (len < 32*1024-1) ? len : 32*1024-1;
+		size_t blklen = (len < (size_t)MAXSEGMENT) ? len : (size_t)MAXSEGMENT;
 		status.Reset();
 		(*gds.Call()->m_put_segment)(status.Self(), &mHandle,
 			(unsigned short)blklen, const_cast<char*>(data.data()+pos));
@@ -208,25 +223,29 @@ void BlobImpl::Load(std::string& data)
 		throw SQLExceptionImpl(status, "Blob::Load", _("isc_open_blob2 failed."));
 	mWriteMode = false;
 
-	size_t blklen = 32*1024-1;
-	data.resize(blklen);
+	// Size the string once, rather than growing it segment after segment,
+	// which would take up to twice the memory of a large blob
+	int total = 0;
+	Info(&total, 0, 0);
+
+	size_t blklen = MAXSEGMENT;
+	data.resize((size_t)total + blklen);
 
 	size_t size = 0;
-	size_t pos = 0;
 	for (;;)
 	{
 		status.Reset();
 		unsigned short bytesread;
 		ISC_STATUS result = (*gds.Call()->m_get_segment)(status.Self(), &mHandle,
 						&bytesread, (unsigned short)blklen,
-							const_cast<char*>(data.data()+pos));
+							const_cast<char*>(data.data()+size));
 		if (result == isc_segstr_eof) break;	// End of blob
 		if (result != isc_segment && status.Errors())
 			throw SQLExceptionImpl(status, "Blob::Load", _("isc_get_segment failed."));
 
-		pos += bytesread;
 		size += bytesread;
-		data.resize(size + blklen);
+		if (data.size() < size + blklen)
+			data.resize(size + blklen);
 	}
 	data.resize(size);
 	
@@ -237,6 +256,74 @@ void BlobImpl::Load(std::string& data)
 	mHandle = 0;
 }
 
+int BlobImpl::ReadBlock(void* buffer, int size)
+{
+	if (mHandle == 0)
+		throw LogicExceptionImpl("Blob::ReadBlock", _("The Blob is not opened"));
+	if (mWriteMode)
+		throw LogicExceptionImpl("Blob::ReadBlock", _("Can't read from Blob opened for write"));
+	if (buffer == 0 || size < 1)
+		throw LogicExceptionImpl("Blob::ReadBlock", _("Invalid buffer size"));
+
+	char* out = (char*)buffer;
+	int got = 0;
+
+	// First hand out what was read ahead, if anything
+	if (mAheadPending.valid())
+	{
+		mAheadPos = 0;
+		mAheadLength = 0;
+		mAheadLength = mAheadPending.get();	// Rethrows what the read threw
+	}
+	if (mAheadPos < mAheadLength)
+	{
+		got = std::min(size, mAheadLength - mAheadPos);
+		memcpy(out, &mAhead[mAheadPos], got);
+		mAheadPos += got;
+	}
+	if (got < size)
+		got += FillBlock(out + got, size - got);
+
+	// Then read the next block while the caller processes this one
+	if (mReadAhead && ! mEof && mAheadPos >= mAheadLength)
+	{
+		if ((int)mAhead.size() < size) mAhead.resize(size);
+		mAheadPos = mAheadLength = 0;
+		mAheadPending = std::async(std::launch::async,
+			&BlobImpl::FillBlock, this, &mAhead[0], size);
+	}
+	return got;
+}
+
+void BlobImpl::WriteBlock(const void* buffer, int size)
+{
+	if (mHandle == 0)
+		throw LogicExceptionImpl("Blob::WriteBlock", _("The Blob is not opened"));
+	if (! mWriteMode)
+		throw LogicExceptionImpl("Blob::WriteBlock", _("Can't write to Blob opened for read"));
+	if (buffer == 0 || size < 0)
+		throw LogicExceptionImpl("Blob::WriteBlock", _("Invalid buffer size"));
+
+	const char* data = (const char*)buffer;
+	while (size > 0)
+	{
+		int blklen = std::min(size, MAXSEGMENT);
+		IBS status;
+		(*gds.Call()->m_put_segment)(status.Self(), &mHandle,
+			(unsigned short)blklen, const_cast<char*>(data));
+		if (status.Errors())
+			throw SQLExceptionImpl(status, "Blob::WriteBlock", _("isc_put_segment failed."));
+		data += blklen;
+		size -= blklen;
+	}
+}
+
+void BlobImpl::SetReadAhead(bool readahead)
+{
+	if (! readahead) WaitReadAhead();
+	mReadAhead = readahead;
+}
+
 IBPP::Database BlobImpl::DatabasePtr() const
 {
 	if (mDatabase == 0) throw LogicExceptionImpl("Blob::DatabasePtr",
@@ -262,8 +349,8 @@ void BlobImpl::Release()
 {
 	// Release cannot throw, except in DEBUG builds on assertion
 	ASSERTION(mRefCount >= 0);
-	--mRefCount;
-	try { if (mRefCount <= 0) delete this; }
+	int refs = --mRefCount;
+	try { if (refs <= 0) delete this; }
 		catch (...) { }
 }
 
@@ -276,6 +363,46 @@ void BlobImpl::Init()
 	mHandle = 0;
 	mDatabase = 0;
 	mTransaction = 0;
+	mEof = false;
+	mReadAhead = false;
+	mAheadPos = mAheadLength = 0;
+}
+
+int BlobImpl::FillBlock(char* buffer, int size)
+{
+	// Reads segments until the buffer is full or the blob exhausted. This is
+	// also the body of the read-ahead, so it touches nothing but mHandle and
+	// mEof, which the caller leaves alone until the read-ahead is over.
+
+	int got = 0;
+	while (got < size && ! mEof)
+	{
+		IBS status;
+		unsigned short bytesread = 0;
+		ISC_STATUS result = (*gds.Call()->m_get_segment)(status.Self(), &mHandle,
+			&bytesread, (unsigned short)std::min(size - got, MAXSEGMENT), buffer + got);
+		if (result == isc_segstr_eof)
+		{
+			mEof = true;
+			break;
+		}
+		if (result != isc_segment && status.Errors())
+			throw SQLExceptionImpl(status, "Blob::ReadBlock", _("isc_get_segment failed."));
+		got += bytesread;
+	}
+	return got;
+}
+
+void BlobImpl::WaitReadAhead()
+{
+	// The block read ahead is of no use anymore, but the read must be over
+	// before the blob gets closed
+	if (mAheadPending.valid())
+	{
+		try { mAheadPending.get(); }
+			catch (...) { }
+	}
+	mAheadPos = mAheadLength = 0;
 }
 
 void BlobImpl::SetId(ISC_QUAD* quad)
@@ -345,6 +472,16 @@ BlobImpl::BlobImpl(DatabaseImpl* database, TransactionImpl* transaction)
 	if (transaction != 0) AttachTransactionImpl(transaction);
 }
 
+BlobImpl::BlobImpl(DatabaseImpl* database, TransactionImpl* transaction,
+	ISC_QUAD* quad)
+	: mRefCount(0)
+{
+	Init();
+	AttachDatabaseImpl(database);
+	if (transaction != 0) AttachTransactionImpl(transaction);
+	SetId(quad);
+}
+
 BlobImpl::~BlobImpl()
 {
 	try
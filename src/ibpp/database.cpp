@@ -27,6 +27,7 @@
 #endif
 
 #include <algorithm>
+#include <sstream>
 
 using namespace ibpp_internals;
 
@@ -83,6 +84,22 @@ void DatabaseImpl::Connect()
     if (! mRoleName.empty()) dpb.Insert(isc_dpb_sql_role_name, mRoleName.c_str());
     if (! mCharSet.empty()) dpb.Insert(isc_dpb_lc_ctype, mCharSet.c_str());
 
+    // The connection profile, wire settings go through the per-attachment
+    // configuration of Firebird 3
+    if (mProfile.pageBuffers > 0)
+        dpb.Insert(isc_dpb_num_buffers, int32_t(mProfile.pageBuffers));
+    std::string config;
+    if (mProfile.wireCompression)
+        config.append("WireCompression = true\n");
+    switch (mProfile.wireCrypt)
+    {
+        case IBPP::wcDisabled: config.append("WireCrypt = Disabled\n"); break;
+        case IBPP::wcEnabled: config.append("WireCrypt = Enabled\n"); break;
+        case IBPP::wcRequired: config.append("WireCrypt = Required\n"); break;
+        default: break;
+    }
+    if (! config.empty()) dpb.Insert(isc_dpb_config, config.c_str());
+
     std::string connect;
     if (! mServerName.empty())
         connect.assign(mServerName).append(":");
@@ -136,6 +153,21 @@ void DatabaseImpl::Connect()
         mHandle = 0;     // Should be, but better be sure...
         throw LogicExceptionImpl("Database::Connect", _("Dialect 1 or 3 required"));
     }
+
+    // Restore the timeouts of the previous connection, failing to do so
+    // fails the connection like any other error above
+    try
+    {
+        if (mStatementTimeout != 0) SetStatementTimeout(mStatementTimeout);
+        if (mIdleTimeout != 0) SetIdleTimeout(mIdleTimeout);
+    }
+    catch (...)
+    {
+        status.Reset();
+        (*gds.Call()->m_detach_database)(status.Self(), &mHandle);
+        mHandle = 0;
+        throw;
+    }
 }
 
 void DatabaseImpl::Inactivate()
@@ -144,36 +176,46 @@ void DatabaseImpl::Inactivate()
 
     IBS status;
 
+    // The tables are copied first : the objects are called without holding
+    // mObjectsMutex, since they may attach or detach themselves meanwhile
+    std::vector<TransactionImpl*> transactions;
+    std::vector<EventsImpl*> events;
+    {
+        std::lock_guard<std::mutex> guard(mObjectsMutex);
+        transactions = mTransactions;
+        events = mEvents;
+    }
+
     // Rollback any started transaction...
-    for (unsigned i = 0; i < mTransactions.size(); i++)
+    for (unsigned i = 0; i < transactions.size(); i++)
     {
-        if (mTransactions[i]->Started())
-            mTransactions[i]->Rollback();
+        if (transactions[i]->Started())
+            transactions[i]->Rollback();
     }
 
     // Cancel all pending event traps
-    for (unsigned i = 0; i < mEvents.size(); i++)
-        mEvents[i]->Clear();
+    for (unsigned i = 0; i < events.size(); i++)
+        events[i]->Clear();
 
     // Let's detach from all Blobs
-    while (mBlobs.size() > 0)
-        mBlobs.back()->DetachDatabaseImpl();
+    while (BlobImpl* obj = LastObject(mBlobs))
+        obj->DetachDatabaseImpl();
 
     // Let's detach from all Arrays
-    while (mArrays.size() > 0)
-        mArrays.back()->DetachDatabaseImpl();
+    while (ArrayImpl* obj = LastObject(mArrays))
+        obj->DetachDatabaseImpl();
 
     // Let's detach from all Statements
-    while (mStatements.size() > 0)
-        mStatements.back()->DetachDatabaseImpl();
+    while (StatementImpl* obj = LastObject(mStatements))
+        obj->DetachDatabaseImpl();
 
     // Let's detach from all Transactions
-    while (mTransactions.size() > 0)
-        mTransactions.back()->DetachDatabaseImpl(this);
+    while (TransactionImpl* obj = LastObject(mTransactions))
+        obj->DetachDatabaseImpl(this);
 
     // Let's detach from all Events
-    while (mEvents.size() > 0)
-        mEvents.back()->DetachDatabaseImpl();
+    while (EventsImpl* obj = LastObject(mEvents))
+        obj->DetachDatabaseImpl();
 }
 
 void DatabaseImpl::Disconnect()
@@ -210,6 +252,59 @@ void DatabaseImpl::Drop()
     mHandle = 0;
 }
 
+void DatabaseImpl::CancelOperation()
+{
+    if (mHandle == 0)
+        throw LogicExceptionImpl("Database::CancelOperation", _("Database is not connected."));
+    if (gds.Call()->m_cancel_operation == 0)
+        throw LogicExceptionImpl("Database::CancelOperation",
+            _("The client library doesn't support cancelling operations."));
+
+    // The attachment is not changed, so this is safe while another thread
+    // waits for the server on it
+    IBS status;
+    (*gds.Call()->m_cancel_operation)(status.Self(), &mHandle, fb_cancel_raise);
+    if (status.Errors())
+        throw SQLExceptionImpl(status, "Database::CancelOperation", _("fb_cancel_operation failed"));
+}
+
+void DatabaseImpl::SetStatementTimeout(unsigned milliseconds)
+{
+    if (mHandle != 0)
+    {
+        std::ostringstream sql;
+        sql<< "SET STATEMENT TIMEOUT "<< milliseconds<< " MILLISECOND";
+        ExecuteSessionStatement(sql.str(), "Database::SetStatementTimeout");
+    }
+    mStatementTimeout = milliseconds;
+}
+
+void DatabaseImpl::SetIdleTimeout(unsigned seconds)
+{
+    if (mHandle != 0)
+    {
+        std::ostringstream sql;
+        sql<< "SET SESSION IDLE TIMEOUT "<< seconds<< " SECOND";
+        ExecuteSessionStatement(sql.str(), "Database::SetIdleTimeout");
+    }
+    mIdleTimeout = seconds;
+}
+
+IBPP::CLI DatabaseImpl::ClientInterface()
+{
+    // The cursors of the object interface are opened on the statement
+    // handles, through the bridge functions of the Firebird 4 client
+    FBCLIENT* client = gds.Call();
+    if (mClientInterface == IBPP::ciObject
+        && client->m_get_master_interface != 0
+        && client->m_get_statement_interface != 0
+        && client->m_get_transaction_interface != 0)
+    {
+        return IBPP::ciObject;
+    }
+    return IBPP::ciLegacy;
+}
+
 void DatabaseImpl::Info(int* ODSMajor, int* ODSMinor,
     int* PageSize, int* Pages, int* Buffers, int* Sweep,
     bool* Sync, bool* Reserve, bool* ReadOnly)
@@ -398,19 +493,32 @@ void DatabaseImpl::Release()
 {
     // Release cannot throw, except in DEBUG builds on assertion
     ASSERTION(mRefCount >= 0);
-    --mRefCount;
-    try { if (mRefCount <= 0) delete this; }
+    int refs = --mRefCount;
+    try { if (refs <= 0) delete this; }
         catch (...) { }
 }
 
 //  (((((((( OBJECT INTERNAL METHODS ))))))))
 
+// Session management statements of Firebird 4 don't need a transaction
+void DatabaseImpl::ExecuteSessionStatement(const std::string& sql,
+    const char* context)
+{
+    isc_tr_handle tr_handle = 0;
+    IBS status;
+    (*gds.Call()->m_dsql_execute_immediate)(status.Self(), &mHandle, &tr_handle,
+        0, const_cast<char*>(sql.c_str()), short(mDialect), NULL);
+    if (status.Errors())
+        throw SQLExceptionImpl(status, context, _("isc_dsql_execute_immediate failed"));
+}
+
 void DatabaseImpl::AttachTransactionImpl(TransactionImpl* tr)
 {
     if (tr == 0)
         throw LogicExceptionImpl("Database::AttachTransaction",
                     _("Transaction object is null."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mTransactions.push_back(tr);
 }
 
@@ -420,6 +528,7 @@ void DatabaseImpl::DetachTransactionImpl(TransactionImpl* tr)
         throw LogicExceptionImpl("Database::DetachTransaction",
                 _("ITransaction object is null."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mTransactions.erase(std::find(mTransactions.begin(), mTransactions.end(), tr));
 }
 
@@ -429,6 +538,7 @@ void DatabaseImpl::AttachStatementImpl(StatementImpl* st)
         throw LogicExceptionImpl("Database::AttachStatement",
                     _("Can't attach a null Statement object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mStatements.push_back(st);
 }
 
@@ -438,6 +548,7 @@ void DatabaseImpl::DetachStatementImpl(StatementImpl* st)
         throw LogicExceptionImpl("Database::DetachStatement",
                 _("Can't detach a null Statement object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mStatements.erase(std::find(mStatements.begin(), mStatements.end(), st));
 }
 
@@ -447,6 +558,7 @@ void DatabaseImpl::AttachBlobImpl(BlobImpl* bb)
         throw LogicExceptionImpl("Database::AttachBlob",
                     _("Can't attach a null Blob object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mBlobs.push_back(bb);
 }
 
@@ -456,6 +568,7 @@ void DatabaseImpl::DetachBlobImpl(BlobImpl* bb)
         throw LogicExceptionImpl("Database::DetachBlob",
                 _("Can't detach a null Blob object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mBlobs.erase(std::find(mBlobs.begin(), mBlobs.end(), bb));
 }
 
@@ -465,6 +578,7 @@ void DatabaseImpl::AttachArrayImpl(ArrayImpl* ar)
         throw LogicExceptionImpl("Database::AttachArray",
                     _("Can't attach a null Array object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mArrays.push_back(ar);
 }
 
@@ -474,6 +588,7 @@ void DatabaseImpl::DetachArrayImpl(ArrayImpl* ar)
         throw LogicExceptionImpl("Database::DetachArray",
                 _("Can't detach a null Array object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mArrays.erase(std::find(mArrays.begin(), mArrays.end(), ar));
 }
 
@@ -483,6 +598,7 @@ void DatabaseImpl::AttachEventsImpl(EventsImpl* ev)
         throw LogicExceptionImpl("Database::AttachEventsImpl",
                     _("Can't attach a null Events object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mEvents.push_back(ev);
 }
 
@@ -492,6 +608,7 @@ void DatabaseImpl::DetachEventsImpl(EventsImpl* ev)
         throw LogicExceptionImpl("Database::DetachEventsImpl",
                 _("Can't detach a null Events object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mEvents.erase(std::find(mEvents.begin(), mEvents.end(), ev));
 }
 
@@ -504,7 +621,8 @@ DatabaseImpl::DatabaseImpl(const std::string& ServerName, const std::string& Dat
     mServerName(ServerName), mDatabaseName(DatabaseName),
     mUserName(UserName), mUserPassword(UserPassword), mRoleName(RoleName),
     mCharSet(CharSet), mCreateParams(CreateParams),
-    mDialect(3)
+    mDialect(3), mStatementTimeout(0), mIdleTimeout(0),
+    mClientInterface(IBPP::ciLegacy)
 {
 }
 
@@ -69,6 +69,7 @@ void EventsImpl::Add(const std::string& eventname, IBPP::EventInterface* objref)
 		throw LogicExceptionImpl("Events::Add",
 			_("Can't add this event, the events list would overflow IB/FB limitation"));
 
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
 	Cancel();
 
 	// 1) Alloc or grow the buffers
@@ -111,6 +112,7 @@ void EventsImpl::Drop(const std::string& eventname)
 	if (eventname.size() > MAXEVENTNAMELEN)
 		throw LogicExceptionImpl("EventsImpl::Drop", _("Event name is too long"));
 
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
 	if (mEventBuffer.size() <= 1) return;	// Nothing to do, but not an error
 
 	Cancel();
@@ -140,6 +142,7 @@ void EventsImpl::List(std::vector<std::string>& events)
 {
 	events.clear();
 	
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
 	if (mEventBuffer.size() <= 1) return;	// Nothing to do, but not an error
 
 	typedef EventBufferIterator<Buffer::iterator> EventIterator;
@@ -155,6 +158,7 @@ void EventsImpl::List(std::vector<std::string>& events)
 
 void EventsImpl::Clear()
 {
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
 	Cancel();
 	
 	mObjectReferences.clear();
@@ -164,14 +168,61 @@ void EventsImpl::Clear()
 
 void EventsImpl::Dispatch()
 {
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
+
 	// If no events registered, nothing to do of course.
 	if (mEventBuffer.size() == 0) return;
 
+	// The delivery thread, when running, does all of this by itself.
+	if (mDeliveryThread.joinable()) return;
+
 	// Let's fire the events actions for all the events which triggered, if any, and requeue.
 	FireActions();
 	Queue();
 }
 
+void EventsImpl::StartDelivery()
+{
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
+	if (mDeliveryThread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> wake(mWakeMutex);
+		mStopDelivery = false;
+	}
+	mDeliveryThread = std::thread(DeliveryLoop, this, mAlive);
+}
+
+void EventsImpl::StopDelivery()
+{
+	std::thread thread;
+	{
+		std::lock_guard<std::recursive_mutex> guard(mMutex);
+		if (! mDeliveryThread.joinable()) return;
+		thread.swap(mDeliveryThread);
+	}
+
+	{
+		std::lock_guard<std::mutex> wake(mWakeMutex);
+		mStopDelivery = true;
+	}
+	mWakeup.notify_one();
+
+	// Not waiting for mMutex to be released above would deadlock, the thread
+	// takes it. And it can't wait for itself, should it end up here through
+	// the release of the last reference to these Events from a handler.
+	if (thread.get_id() == std::this_thread::get_id())
+		thread.detach();
+	else
+		thread.join();
+}
+
+bool EventsImpl::Delivering()
+{
+	std::lock_guard<std::recursive_mutex> guard(mMutex);
+	return mDeliveryThread.joinable();
+}
+
 IBPP::Database EventsImpl::DatabasePtr() const
 {
 	if (mDatabase == 0) throw LogicExceptionImpl("Events::DatabasePtr",
@@ -190,8 +241,8 @@ void EventsImpl::Release()
 {
 	// Release cannot throw, except in DEBUG builds on assertion
 	ASSERTION(mRefCount >= 0);
-	--mRefCount;
-	try { if (mRefCount <= 0) delete this; }
+	int refs = --mRefCount;
+	try { if (refs <= 0) delete this; }
 		catch (...) { }
 }
 
@@ -252,40 +303,92 @@ void EventsImpl::Cancel()
 
 void EventsImpl::FireActions()
 {
-	if (mTrapped)
+	Deliveries deliveries;
+	CollectActions(deliveries);
+
+	for (Deliveries::iterator it = deliveries.begin(); it != deliveries.end(); ++it)
+		it->first->ibppEventsHandler(this, it->second);
+}
+
+void EventsImpl::CollectActions(Deliveries& deliveries)
+{
+	// Computes the counts of the events which triggered since the previous
+	// call, grouped by the object to notify, and consumes the results buffer.
+	// mMutex is supposed to be held by the caller.
+
+	deliveries.clear();
+	if (! mTrapped) return;
+	mTrapped = false;
+
+	typedef EventBufferIterator<Buffer::iterator> EventIterator;
+	EventIterator eit(mEventBuffer.begin()+1);
+	EventIterator rit(mResultsBuffer.begin()+1);
+
+	for (ObjRefs::iterator oit = mObjectReferences.begin();
+		 oit != mObjectReferences.end();
+			 ++oit, ++eit, ++rit)
+	{
+		if (eit == EventIterator(mEventBuffer.end())
+			  || rit == EventIterator(mResultsBuffer.end()))
+			throw LogicExceptionImpl("EventsImpl::FireActions", _("Internal buffer size error"));
+		uint32_t vnew = rit.get_count();
+		uint32_t vold = eit.get_count();
+		if (vnew > vold)
+		{
+			Deliveries::iterator dit = deliveries.begin();
+			while (dit != deliveries.end() && dit->first != *oit)
+				++dit;
+			if (dit == deliveries.end())
+				dit = deliveries.insert(dit, std::make_pair(*oit, IBPP::EventCounts()));
+			dit->second.push_back(std::make_pair(eit.get_name(), (int)(vnew - vold)));
+		}
+		// This handles initialization too, where vold == (uint32_t)(-1)
+		// Thanks to M. Hieke for this idea and related initialization to (-1)
+		if (vnew != vold)
+			std::copy(rit.begin(), rit.end(), eit.begin());
+	}
+}
+
+void EventsImpl::DeliveryLoop(EventsImpl* evi, std::shared_ptr<std::atomic<bool> > alive)
+{
+	// >>>>> This method is a STATIC member !! <<<<<
+	// Body of the thread started by StartDelivery(). Each time EventHandler()
+	// signals new counts, they are collected and the events requeued at once,
+	// so that the server keeps counting while the handlers run. Whatever got
+	// posted in between is coalesced into the counts of the next delivery.
+
+	Deliveries deliveries;
+	for (;;)
 	{
-		typedef EventBufferIterator<Buffer::iterator> EventIterator;
-		EventIterator eit(mEventBuffer.begin()+1);
-		EventIterator rit(mResultsBuffer.begin()+1);
+		{
+			std::unique_lock<std::mutex> wake(evi->mWakeMutex);
+			while (! evi->mStopDelivery && ! evi->mTrapped)
+				evi->mWakeup.wait(wake);
+			if (evi->mStopDelivery) return;
+		}
+
+		{
+			std::lock_guard<std::recursive_mutex> guard(evi->mMutex);
+			try
+			{
+				evi->CollectActions(deliveries);
+				if (evi->mDatabase != 0 && ! evi->mEventBuffer.empty())
+					evi->Queue();
+			}
+			catch (...) { }	// Lost connection, nothing more will come
+		}
+		if (deliveries.empty()) continue;
 
-		for (ObjRefs::iterator oit = mObjectReferences.begin();
-			 oit != mObjectReferences.end();
-				 ++oit, ++eit, ++rit)
 		{
-			if (eit == EventIterator(mEventBuffer.end())
-				  || rit == EventIterator(mResultsBuffer.end()))
-				throw LogicExceptionImpl("EventsImpl::FireActions", _("Internal buffer size error"));
-			uint32_t vnew = rit.get_count();
-			uint32_t vold = eit.get_count();
-			if (vnew > vold)
+			IBPP::Events events(evi);
+			for (Deliveries::iterator it = deliveries.begin(); it != deliveries.end(); ++it)
 			{
-				// Fire the action
-				try
-				{
-					(*oit)->ibppEventHandler(this, eit.get_name(), (int)(vnew - vold));
-				}
-				catch (...)
-				{
-					std::copy(rit.begin(), rit.end(), eit.begin());
-					throw;
-				}
-				std::copy(rit.begin(), rit.end(), eit.begin());
+				try { it->first->ibppEventsHandler(events, it->second); }
+					catch (...) { }
 			}
-			// This handles initialization too, where vold == (uint32_t)(-1)
-			// Thanks to M. Hieke for this idea and related initialization to (-1)
-			if (vnew != vold)
- 				std::copy(rit.begin(), rit.end(), eit.begin());
 		}
+		// Releasing 'events' above may well have destroyed evi
+		if (! *alive) return;
 	}
 }
 
@@ -318,6 +421,11 @@ void EventsImpl::EventHandler(const char* object, short size, const char* tmpbuf
 				rb[i] = tmpbuffer[i];
 			evi->mTrapped = true;
 			evi->mQueued = false;
+
+			// Wake up the delivery thread, if any. Taking the mutex, if only
+			// for a moment, makes sure it doesn't miss the notification.
+			{ std::lock_guard<std::mutex> wake(evi->mWakeMutex); }
+			evi->mWakeup.notify_one();
 		}
 		catch (...) { }
 	}
@@ -342,7 +450,8 @@ void EventsImpl::DetachDatabaseImpl()
 }
 
 EventsImpl::EventsImpl(DatabaseImpl* database)
-	: mRefCount(0)
+	: mRefCount(0), mStopDelivery(false),
+	mAlive(std::make_shared<std::atomic<bool> >(true))
 {
 	mDatabase = 0;
 	mId = 0;
@@ -352,6 +461,10 @@ EventsImpl::EventsImpl(DatabaseImpl* database)
 
 EventsImpl::~EventsImpl()
 {
+	*mAlive = false;
+	try { StopDelivery(); }
+		catch (...) { }
+
 	try { Clear(); }
 		catch (...) { }
 	
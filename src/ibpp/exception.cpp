@@ -26,6 +26,7 @@
 #pragma hdrstop
 #endif
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 
@@ -174,7 +175,7 @@ SQLExceptionImpl::SQLExceptionImpl() throw()
 
 SQLExceptionImpl::SQLExceptionImpl(const SQLExceptionImpl& copied) throw()
 	: IBPP::SQLException(), ExceptionBase(copied), mSqlCode(copied.mSqlCode),
-		mEngineCode(copied.mEngineCode)
+		mEngineCode(copied.mEngineCode), mEngineCodes(copied.mEngineCodes)
 {
 }
 
@@ -183,6 +184,7 @@ SQLExceptionImpl& SQLExceptionImpl::operator=(const SQLExceptionImpl& copied) th
 	ExceptionBase::operator=(copied);
 	mSqlCode = copied.mSqlCode;
 	mEngineCode = copied.mEngineCode;
+	mEngineCodes = copied.mEngineCodes;
 	return *this;
 }
 
@@ -196,6 +198,7 @@ SQLExceptionImpl::SQLExceptionImpl(const IBS& status, const std::string& context
 	va_end(argptr);
 	mSqlCode = status.SqlCode();
 	mEngineCode = status.EngineCode();
+	status.EngineCodes(mEngineCodes);
 	mWhat.append(status.ErrorMessage());
 }
 
@@ -223,6 +226,12 @@ int SQLExceptionImpl::EngineCode() const throw()
 	return mEngineCode;
 }
 
+bool SQLExceptionImpl::HasEngineCode(int code) const throw()
+{
+	return std::find(mEngineCodes.begin(), mEngineCodes.end(), code)
+		!= mEngineCodes.end();
+}
+
 //	(((((((( WrongTypeImpl Implementation ))))))))
 
 // The following constructors are small and could be inlined, but for object
@@ -68,6 +68,11 @@
 #include <string>
 #include <vector>
 
+namespace ibpp_internals
+{
+    class StatementImpl;    // Fills IBPP::ColumnBatch
+}
+
 namespace IBPP
 {
     //  Typically you use this constant in a call IBPP::CheckVersion as in:
@@ -132,6 +137,9 @@ namespace IBPP
     // TransactionFactory Flags
     enum TFF {tfIgnoreLimbo = 0x1, tfAutoCommit = 0x2, tfNoAutoUndo = 0x4};
 
+    // Client library interfaces for the statements of a Database
+    enum CLI {ciLegacy, ciObject};
+
     /* IBPP never return any error codes. It throws exceptions.
      * On database engine reported errors, an IBPP::SQLException is thrown.
      * In all other cases, IBPP throws IBPP::LogicException.
@@ -165,8 +173,21 @@ namespace IBPP
     class SQLException : public Exception
     {
     public:
+        // Engine codes of cancelled statements, from iberror.h. Firebird 4
+        // reports a statement timeout as ecCancelled followed by its reason
+        enum
+        {
+            ecCancelled = 335544794,        // isc_cancelled
+            ecCfgStmtTimeout = 335545268,   // isc_cfg_stmt_timeout
+            ecAttStmtTimeout = 335545269,   // isc_att_stmt_timeout
+            ecReqStmtTimeout = 335545270    // isc_req_stmt_timeout
+        };
+
         virtual int SqlCode() const throw() = 0;
         virtual int EngineCode() const throw() = 0;
+        // Whether the code is the EngineCode() or one of the secondary
+        // codes of the error
+        virtual bool HasEngineCode(int code) const throw() = 0;
 
         virtual ~SQLException() throw();
     };
@@ -357,6 +378,15 @@ namespace IBPP
     };
 
     //  Interface Wrapper
+    //
+    //  Threads : the reference counts are atomic, and the objects of one
+    //  attachment (transactions, statements, blobs, arrays, events) may be
+    //  created and released from different threads. Each object, and each
+    //  Ptr instance, must still be used by only one thread at a time, and
+    //  the client library serializes the requests made on one attachment.
+    //  IDatabase::CancelOperation() is the only call meant to be made while
+    //  another thread is inside a request. Inactivate() and Disconnect()
+    //  must not run concurrently with any other use of the attachment.
     template <class T>
     class Ptr
     {
@@ -441,6 +471,17 @@ namespace IBPP
         virtual void Save(const std::string& data) = 0;
         virtual void Load(std::string& data) = 0;
 
+        /* Streaming of large blobs through buffers supplied (and reused) by
+         * the caller, of any size. ReadBlock() fills the whole buffer from as
+         * many segments as needed, returning less only at the end of the
+         * blob. WriteBlock() splits the buffer in segments of up to 64 KB-1.
+         * With SetReadAhead(true), set before or after Open(), the next
+         * block is read in the background while the caller deals with the
+         * current one. */
+        virtual int ReadBlock(void*, int size) = 0;
+        virtual void WriteBlock(const void*, int size) = 0;
+        virtual void SetReadAhead(bool) = 0;
+
         virtual Database DatabasePtr() const = 0;
         virtual Transaction TransactionPtr() const = 0;
 
@@ -537,6 +578,31 @@ namespace IBPP
     };
     typedef std::map<int, CountInfo> DatabaseCounts; // int = relation ID
 
+    /* Class ConnectionProfile holds the tuning of the link to the server,
+     * requested in the DPB when attaching, see IDatabase::SetProfile(). Wire
+     * compression and the wire encryption level need Firebird 3 or later at
+     * both ends, older servers ignore them. */
+
+    enum WCL {wcDefault, wcDisabled, wcEnabled, wcRequired};
+
+    class ConnectionProfile
+    {
+    public:
+        ConnectionProfile(): wireCompression(false), wireCrypt(wcDefault),
+            pageBuffers(0) {}
+        bool wireCompression;
+        WCL wireCrypt;          // wcDefault leaves it to firebird.conf
+        int pageBuffers;        // 0 for the database default
+
+        bool operator==(const ConnectionProfile& p) const
+        {
+            return wireCompression == p.wireCompression
+                && wireCrypt == p.wireCrypt && pageBuffers == p.pageBuffers;
+        }
+        bool operator!=(const ConnectionProfile& p) const
+            { return ! (*this == p); }
+    };
+
     class IDatabase
     {
     public:
@@ -567,6 +633,26 @@ namespace IBPP
         virtual void Inactivate() = 0;
         virtual void Disconnect() = 0;
         virtual void Drop() = 0;
+        // Asks the server to cancel the request running on the attachment,
+        // called from another thread than the one waiting for the request
+        virtual void CancelOperation() = 0;
+        // Timeouts of Firebird 4 for all statements of the attachment (in
+        // milliseconds) and for the idle attachment itself (in seconds), 0
+        // for none. They are kept and set again when reconnecting.
+        virtual void SetStatementTimeout(unsigned milliseconds) = 0;
+        virtual unsigned StatementTimeout() = 0;
+        virtual void SetIdleTimeout(unsigned seconds) = 0;
+        virtual unsigned IdleTimeout() = 0;
+        // Statements of the attachment call the legacy isc_dsql functions,
+        // or the object oriented API of Firebird 3 and later. ciObject is
+        // only used when the client library provides the fb_get_*_interface
+        // functions of Firebird 4, ClientInterface() returns the interface
+        // actually in use.
+        virtual void SetClientInterface(IBPP::CLI ci) = 0;
+        virtual IBPP::CLI ClientInterface() = 0;
+        // Takes effect at the next Connect()
+        virtual void SetProfile(const IBPP::ConnectionProfile&) = 0;
+        virtual const IBPP::ConnectionProfile& Profile() const = 0;
 
         virtual IDatabase* AddRef() = 0;
         virtual void Release() = 0;
@@ -683,6 +769,117 @@ namespace IBPP
         virtual ~IRow() {}
     };
 
+    /*
+     *  Class ColumnBatch holds a block of rows fetched by
+     *  IStatement::FetchBatch(), stored column by column : the values of a
+     *  column are packed in one buffer with one null flag per row. Rows are
+     *  numbered from 0, columns from 1. Like IRow::Get(), the Get() methods
+     *  return true when the value is SQL NULL.
+     */
+
+    class ColumnBatch
+    {
+    public:
+        struct Column
+        {
+            int sqltype;            // Without the nullable flag
+            int scale;
+            int size;               // Bytes per value, 0 for VARCHAR
+            std::vector<char> data;
+            std::vector<int> offsets;   // VARCHAR : start of each value
+            std::vector<bool> nulls;
+        };
+
+    private:
+        friend class ibpp_internals::StatementImpl;
+
+        std::vector<Column> mColumns;
+        int mRows;
+        Database mDatabase;         // For Get(..., std::string&) on blobs
+        Transaction mTransaction;
+
+        const char* GetData(int row, int col, const Column*&, int&) const;
+
+    public:
+        void Clear();
+        // Empties the batch for the given layout, keeping the capacity of
+        // the buffers for the expected number of rows. The values of a row
+        // are then added column after column by AddValue(), data being 0
+        // for SQL NULL, and the row is completed by AddRow().
+        void Reset(const std::vector<Column>& layout, int rows);
+        void AddValue(int col, const char* data, int length);
+        void AddRow() { mRows++; }
+        int Rows() const { return mRows; }
+        int Columns() const { return (int)mColumns.size(); }
+        Database DatabasePtr() const { return mDatabase; }
+        Transaction TransactionPtr() const { return mTransaction; }
+
+        bool IsNull(int row, int col) const;
+        bool Get(int row, int col, bool&) const;
+        bool Get(int row, int col, const char*&, int&) const;  // No copy
+        bool Get(int row, int col, std::string&) const;
+        bool Get(int row, int col, int16_t&) const;
+        bool Get(int row, int col, int32_t&) const;
+        bool Get(int row, int col, int64_t&) const;
+        bool Get(int row, int col, float&) const;
+        bool Get(int row, int col, double&) const;
+        bool Get(int row, int col, Timestamp&) const;
+        bool Get(int row, int col, Date&) const;
+        bool Get(int row, int col, Time&) const;
+        bool Get(int row, int col, DBKey&) const;
+        bool Get(int row, int col, Blob&) const;
+        // The id of a blob only, for a Blob made later by BlobFactory(), so
+        // that no Blob object needs to be created while fetching the rows
+        bool GetBlobId(int row, int col, int64_t&) const;
+
+        ColumnBatch() : mRows(0) { }
+    };
+
+    /*
+     *  Class BatchError reports a row of parameters which failed in
+     *  IStatement::ExecuteBatch(). Rows are numbered from 0, in the order
+     *  of the AddBatch() calls.
+     */
+
+    class BatchError
+    {
+    public:
+        BatchError(): row(0), sqlcode(0) {}
+        int row;
+        int sqlcode;
+        std::string message;
+    };
+    typedef std::vector<BatchError> BatchErrors;
+
+    /*
+     *  Class StatementMetrics holds the measurements of the last Prepare()
+     *  and execution of a statement, see IStatement::Metrics(). The times
+     *  are wall clock times of the calls to the client library.
+     */
+
+    class StatementMetrics
+    {
+    public:
+        StatementMetrics(): prepareTime(0), executeTime(0), fetchTime(0),
+            rowsFetched(0), selects(0), inserts(0), updates(0), deletes(0),
+            fetches(-1), marks(-1), reads(-1), writes(-1) {}
+        int64_t prepareTime;    // Microseconds
+        int64_t executeTime;
+        int64_t fetchTime;
+        int rowsFetched;
+        // Records selected, inserted, updated and deleted by the statement
+        int selects;
+        int inserts;
+        int updates;
+        int deletes;
+        // Page fetches, marks, reads and writes of the attachment from the
+        // execution to the end of the result set, -1 if not counted
+        int fetches;
+        int marks;
+        int reads;
+        int writes;
+    };
+
     /* IStatement is the interface to the statements execution in IBPP.
      * Statement is the object class you actually use in your programming. A
      * Statement object is the work horse of IBPP. All your data manipulation
@@ -699,9 +896,42 @@ namespace IBPP
         virtual void ExecuteImmediate(const std::string&) = 0;
         virtual void CursorExecute(const std::string& cursor) = 0;
         virtual void CursorExecute(const std::string& cursor, const std::string&) = 0;
+        // The parameters set before each AddBatch() call are executed at
+        // once by ExecuteBatch(), with the batch interface of Firebird 4 or
+        // else in EXECUTE BLOCK statements. It returns the number of rows
+        // which succeeded, the failed ones are reported in errors.
+        virtual void AddBatch() = 0;
+        virtual int BatchRows() = 0;
+        virtual int ExecuteBatch(BatchErrors& errors) = 0;
+        virtual void ClearBatch() = 0;
         virtual bool Fetch() = 0;
         virtual bool Fetch(Row&) = 0;
+        // Fetches up to 'rows' rows into the batch, returns how many were
+        // fetched (less than asked only at the end of the result set).
+        virtual int FetchBatch(int rows, ColumnBatch&) = 0;
+        // Scrollable cursors need a Firebird 4 client and a Firebird 5 server,
+        // positions are 1-based and negative ones count from the last row.
+        // The Fetch() methods above return the next row of such a cursor.
+        virtual void ExecuteScrollable() = 0;
+        virtual bool Scrollable() = 0;
+        virtual bool FetchFirst() = 0;
+        virtual bool FetchLast() = 0;
+        virtual bool FetchPrior() = 0;
+        virtual bool FetchAbsolute(int position) = 0;
+        virtual bool FetchRelative(int offset) = 0;
+        // Timeout of each execution in milliseconds (0 for none), needs
+        // Firebird 4. It is kept when the statement is prepared again.
+        virtual void SetTimeout(unsigned milliseconds) = 0;
+        virtual unsigned Timeout() = 0;
         virtual int AffectedRows() = 0;
+        // Times and rows fetched of the last Prepare() and execution, the
+        // record and page counts are only set by ServerMetrics(), which asks
+        // the server for them. Pages are counted for the executions following
+        // CountPages(true), at the cost of two round trips each. Before the
+        // end of the result set ServerMetrics() counts them up to now.
+        virtual void Metrics(IBPP::StatementMetrics&) = 0;
+        virtual void ServerMetrics(IBPP::StatementMetrics&) = 0;
+        virtual void CountPages(bool) = 0;
         virtual void Close() = 0;
         virtual std::string& Sql() = 0;
         virtual STT Type() = 0;
@@ -807,6 +1037,15 @@ namespace IBPP
         virtual void Clear() = 0;               // Drop all events
         virtual void Dispatch() = 0;            // Dispatch events (calls handlers)
 
+        /* StartDelivery() hands events over to a thread owned by the Events
+         * object, which requeues them as soon as they fire and calls the
+         * handlers with the counts coalesced per event name, so Dispatch()
+         * need not be polled. Handlers then run on that thread and must not
+         * call StopDelivery(), which waits for it to finish. */
+        virtual void StartDelivery() = 0;
+        virtual void StopDelivery() = 0;
+        virtual bool Delivering() = 0;
+
         virtual Database DatabasePtr() const = 0;
 
         virtual IEvents* AddRef() = 0;
@@ -820,10 +1059,19 @@ namespace IBPP
      * which your own event interface classes have to derive from.
      * Please read the reference guide at http://www.ibpp.org for more info. */
 
+    typedef std::vector<std::pair<std::string, int> > EventCounts;
+
     class EventInterface
     {
     public:
         virtual void ibppEventHandler(Events, const std::string&, int) = 0;
+        // Called with all the events of one delivery, in registration order
+        virtual void ibppEventsHandler(Events events, const EventCounts& counts)
+        {
+            for (EventCounts::const_iterator it = counts.begin();
+                    it != counts.end(); ++it)
+                ibppEventHandler(events, it->first, it->second);
+        }
         virtual ~EventInterface() { }
     };
 
@@ -867,6 +1115,8 @@ namespace IBPP
     }
 
     Blob BlobFactory(Database db, Transaction tr);
+    // For an existing blob, see ColumnBatch::GetBlobId()
+    Blob BlobFactory(Database db, Transaction tr, int64_t BlobId);
 
     Array ArrayFactory(Database db, Transaction tr);
 
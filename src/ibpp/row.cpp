@@ -30,6 +30,7 @@
 #pragma hdrstop
 #endif
 
+#include <algorithm>
 #include <cmath>
 #include <ctime>
 
@@ -585,45 +586,41 @@ int RowImpl::ColumnNum(const std::string& name)
 	if (name.empty())
 		throw LogicExceptionImpl("Row::ColumnNum", _("Column name <empty> not found."));
 
-	XSQLVAR* var;
-	char Uname[sizeof(var->sqlname)+1];		// Max size of sqlname + '\0'
+	if (! mColumnsIndexed) IndexColumns();
 
 	// Local upper case copy of the column name
-	size_t len = name.length();
-	if (len > sizeof(var->sqlname)) len = sizeof(var->sqlname);
-	strncpy(Uname, name.c_str(), len);
-	Uname[len] = '\0';
-	char* p = Uname;
-	while (*p != '\0') { *p = char(toupper(*p)); ++p; }
-
-	// Loop through the columns of the descriptor
-	for (int i = 0; i < mDescrArea->sqld; i++)
-	{
-		var = &(mDescrArea->sqlvar[i]);
-		if (var->sqlname_length != (int16_t)len) continue;
-		if (strncmp(Uname, var->sqlname, len) == 0) return i+1;
-	}
+	mColumnKey.assign(name, 0, sizeof(XSQLVAR::sqlname));
+	for (size_t i = 0; i < mColumnKey.length(); i++)
+		mColumnKey[i] = char(toupper(mColumnKey[i]));
 
-	// Failed finding the column name, let's retry using the aliases
-	char Ualias[sizeof(var->aliasname)+1];		// Max size of aliasname + '\0'
+	std::unordered_map<std::string, int>::const_iterator it =
+		mColumnNums.find(mColumnKey);
+	if (it == mColumnNums.end())
+		throw LogicExceptionImpl("Row::ColumnNum", _("Could not find matching column."));
+	return it->second;
+}
 
-	// Local upper case copy of the column name
-	len = name.length();
-	if (len > sizeof(var->aliasname)) len = sizeof(var->aliasname);
-	strncpy(Ualias, name.c_str(), len);
-	Ualias[len] = '\0';
-	p = Ualias;
-	while (*p != '\0') { *p = char(toupper(*p)); ++p; }
-
-	// Loop through the columns of the descriptor
-	for (int i = 0; i < mDescrArea->sqld; i++)
+// Names take precedence over aliases, and the first column over the
+// following ones with the same name or alias
+void RowImpl::IndexColumns()
+{
+	mColumnNums.clear();
+	int i;
+	for (i = 0; i < mDescrArea->sqld; i++)
 	{
-		var = &(mDescrArea->sqlvar[i]);
-		if (var->aliasname_length != (int16_t)len) continue;
-		if (strncmp(Ualias, var->aliasname, len) == 0) return i+1;
+		XSQLVAR* var = &(mDescrArea->sqlvar[i]);
+		if (var->sqlname_length > 0)
+			mColumnNums.insert(std::make_pair(
+				std::string(var->sqlname, var->sqlname_length), i+1));
 	}
-
-	throw LogicExceptionImpl("Row::ColumnNum", _("Could not find matching column."));
+	for (i = 0; i < mDescrArea->sqld; i++)
+	{
+		XSQLVAR* var = &(mDescrArea->sqlvar[i]);
+		if (var->aliasname_length > 0)
+			mColumnNums.insert(std::make_pair(
+				std::string(var->aliasname, var->aliasname_length), i+1));
+	}
+	mColumnsIndexed = true;
 }
 
 /*
@@ -787,8 +784,8 @@ void RowImpl::Release()
 {
 	// Release cannot throw, except in DEBUG builds on assertion
 	ASSERTION(mRefCount >= 0);
-	--mRefCount;
-	try { if (mRefCount <= 0) delete this; }
+	int refs = --mRefCount;
+	try { if (refs <= 0) delete this; }
 		catch (...) { }
 }
 
@@ -1015,6 +1012,13 @@ void RowImpl::SetValue(int varnum, IITYPE ivType, const void* value, int userlen
 			encodeTime(*(ISC_TIME*)var->sqldata, *(IBPP::Time*)value);
 			break;
 
+		case SQL_BOOLEAN :	// Firebird v3
+			if (ivType != ivBool)
+				throw WrongTypeImpl("RowImpl::SetValue", var->sqltype, ivType,
+											_("Incompatible types."));
+			var->sqldata[0] = *(bool*)value ? 1 : 0;
+			break;
+
 		case SQL_BLOB :
 			if (ivType == ivBlob)
 			{
@@ -1368,32 +1372,6 @@ void RowImpl::Free()
 {
 	if (mDescrArea != 0)
 	{
-		for (int i = 0; i < mDescrArea->sqln; i++)
-		{
-			XSQLVAR* var = &(mDescrArea->sqlvar[i]);
-			if (var->sqldata != 0)
-			{
-				switch (var->sqltype & ~1)
-				{
-					case SQL_ARRAY :
-					case SQL_BLOB :		delete (ISC_QUAD*) var->sqldata; break;
-					case SQL_TIMESTAMP :delete (ISC_TIMESTAMP*) var->sqldata; break;
-					case SQL_TYPE_TIME :delete (ISC_TIME*) var->sqldata; break;
-					case SQL_TYPE_DATE :delete (ISC_DATE*) var->sqldata; break;
-					case SQL_BOOLEAN : // Firebird v3
-					case SQL_TEXT :
-					case SQL_VARYING :	delete [] var->sqldata; break;
-					case SQL_SHORT :	delete (int16_t*) var->sqldata; break;
-					case SQL_LONG :		delete (int32_t*) var->sqldata; break;
-					case SQL_INT64 :	delete (int64_t*) var->sqldata; break;
-					case SQL_FLOAT : 	delete (float*) var->sqldata; break;
-					case SQL_DOUBLE :	delete (double*) var->sqldata; break;
-					default : throw LogicExceptionImpl("RowImpl::Free",
-								_("Found an unknown sqltype !"));
-				}
-			}
-			if (var->sqlind != 0) delete var->sqlind;
-		}
 		delete [] (char*)mDescrArea;
 		mDescrArea = 0;
 	}
@@ -1406,6 +1384,9 @@ void RowImpl::Free()
 	mBools.clear();
 	mStrings.clear();
 	mUpdated.clear();
+	mArena.clear();		// Keeps its capacity for the next AllocVariables()
+	mColumnNums.clear();
+	mColumnsIndexed = false;
 
 	mDialect = 0;
 	mDatabase = 0;
@@ -1444,50 +1425,146 @@ void RowImpl::Resize(int n)
 	mDescrArea->sqln = (int16_t)n;
 }
 
+// Size of the value of a column in the arena, rounded up so that all the
+// values stay aligned on 8 bytes
+int RowImpl::ValueSize(const XSQLVAR* var)
+{
+	int size;
+	switch (var->sqltype & ~1)
+	{
+		case SQL_ARRAY :
+		case SQL_BLOB :		size = sizeof(ISC_QUAD); break;
+		case SQL_TIMESTAMP :size = sizeof(ISC_TIMESTAMP); break;
+		case SQL_TYPE_TIME :size = sizeof(ISC_TIME); break;
+		case SQL_TYPE_DATE :size = sizeof(ISC_DATE); break;
+		case SQL_BOOLEAN :	size = 1; break; // Firebird v3
+		case SQL_TEXT :		size = var->sqllen + 1; break;
+		case SQL_VARYING :	size = var->sqllen + 3; break;
+		case SQL_SHORT :	size = sizeof(int16_t); break;
+		case SQL_LONG :		size = sizeof(int32_t); break;
+		case SQL_INT64 :	size = sizeof(int64_t); break;
+		case SQL_FLOAT : 	size = sizeof(float); break;
+		case SQL_DOUBLE :	size = sizeof(double); break;
+		default : throw LogicExceptionImpl("RowImpl::AllocVariables",
+					_("Found an unknown sqltype !"));
+	}
+	return (size + 7) & ~7;
+}
+
 void RowImpl::AllocVariables()
 {
+	// The values of all columns, followed by their indicators, are stored
+	// in a single arena allocated at once
 	int i;
+	size_t size = 0;
+	for (i = 0; i < mDescrArea->sqld; i++)
+		size += ValueSize(&mDescrArea->sqlvar[i]);
+	size_t indicators = size;
+	for (i = 0; i < mDescrArea->sqld; i++)
+		if (mDescrArea->sqlvar[i].sqltype & 1) size += sizeof(short);
+	mArena.assign((size + 7) / 8, 0);
+	mColumnsIndexed = false;	// The columns have just been described
+	if (mArena.empty()) return;
+
+	char* data = (char*)&mArena[0];
+	short* ind = (short*)(data + indicators);
 	for (i = 0; i < mDescrArea->sqld; i++)
 	{
 		XSQLVAR* var = &(mDescrArea->sqlvar[i]);
+		var->sqldata = data;
 		switch (var->sqltype & ~1)
 		{
-			case SQL_ARRAY :
-			case SQL_BLOB :		var->sqldata = (char*) new ISC_QUAD;
-								memset(var->sqldata, 0, sizeof(ISC_QUAD));
-								break;
-			case SQL_TIMESTAMP :var->sqldata = (char*) new ISC_TIMESTAMP;
-								memset(var->sqldata, 0, sizeof(ISC_TIMESTAMP));
-								break;
-			case SQL_TYPE_TIME :var->sqldata = (char*) new ISC_TIME;
-								memset(var->sqldata, 0, sizeof(ISC_TIME));
-								break;
-			case SQL_TYPE_DATE :var->sqldata = (char*) new ISC_DATE;
-								memset(var->sqldata, 0, sizeof(ISC_DATE));
-								break;
-		    case SQL_BOOLEAN :  var->sqldata = new char[1]; // Firebird v3
-								break;
-			case SQL_TEXT :		var->sqldata = new char[var->sqllen+1];
-								memset(var->sqldata, ' ', var->sqllen);
-								var->sqldata[var->sqllen] = '\0';
+			case SQL_TEXT :		memset(var->sqldata, ' ', var->sqllen);
 								break;
-			case SQL_VARYING :	var->sqldata = new char[var->sqllen+3];
-								memset(var->sqldata, 0, 2);
-								memset(var->sqldata+2, ' ', var->sqllen);
-								var->sqldata[var->sqllen+2] = '\0';
+			case SQL_VARYING :	memset(var->sqldata+2, ' ', var->sqllen);
 								break;
-			case SQL_SHORT :	var->sqldata = (char*) new int16_t(0); break;
-			case SQL_LONG :		var->sqldata = (char*) new int32_t(0); break;
-			case SQL_INT64 :	var->sqldata = (char*) new int64_t(0); break;
-			case SQL_FLOAT : 	var->sqldata = (char*) new float(0.0); break;
-			case SQL_DOUBLE :	var->sqldata = (char*) new double(0.0); break;
-			default : throw LogicExceptionImpl("RowImpl::AllocVariables",
-						_("Found an unknown sqltype !"));
 		}
-		if (var->sqltype & 1) var->sqlind = new short(-1);	// 0 indicator
+		data += ValueSize(var);
+		if (var->sqltype & 1) { var->sqlind = ind++; *var->sqlind = -1; }	// 0 indicator
+	}
+}
+
+// Points the variables, copied from those of another row, into this arena
+void RowImpl::RebaseVariables(const RowImpl& copied)
+{
+	if (mArena.empty()) return;
+
+	char* base = (char*)&mArena[0];
+	const char* orgbase = (const char*)&copied.mArena[0];
+	for (int i = 0; i < mDescrArea->sqld; i++)
+	{
+		XSQLVAR* var = &(mDescrArea->sqlvar[i]);
+		const XSQLVAR* org = &(copied.mDescrArea->sqlvar[i]);
+		if (org->sqldata != 0) var->sqldata = base + (org->sqldata - orgbase);
+		if (org->sqlind != 0)
+			var->sqlind = (short*)(base + ((const char*)org->sqlind - orgbase));
 	}
 }
 
+// Same as the assignment operator, but the buffers of this row are reused
+// when nobody else holds the row and it has the same columns as the copied one
+bool RowImpl::Recycle(const RowImpl& copied)
+{
+	if (mRefCount != 1 || mDescrArea == 0 || copied.mDescrArea == 0)
+		return false;
+	if (mDescrArea->sqln != copied.mDescrArea->sqln
+		|| mDescrArea->sqld != copied.mDescrArea->sqld
+		|| mArena.size() != copied.mArena.size())
+		return false;
+	for (int i = 0; i < mDescrArea->sqld; i++)
+	{
+		const XSQLVAR* var = &(mDescrArea->sqlvar[i]);
+		const XSQLVAR* org = &(copied.mDescrArea->sqlvar[i]);
+		if (var->sqltype != org->sqltype || var->sqllen != org->sqllen)
+			return false;
+		// The index of the column names stays valid
+		if (var->sqlname_length != org->sqlname_length
+			|| var->aliasname_length != org->aliasname_length
+			|| memcmp(var->sqlname, org->sqlname, var->sqlname_length) != 0
+			|| memcmp(var->aliasname, org->aliasname, var->aliasname_length) != 0)
+			return false;
+	}
+
+	memcpy(mDescrArea, copied.mDescrArea, XSQLDA_LENGTH(mDescrArea->sqln));
+	std::copy(copied.mArena.begin(), copied.mArena.end(), mArena.begin());
+	RebaseVariables(copied);
+	mUpdated = copied.mUpdated;
+
+	mDialect = copied.mDialect;
+	mDatabase = copied.mDatabase;
+	mTransaction = copied.mTransaction;
+	return true;
+}
+
+int RowImpl::RawSize(const XSQLVAR* var)
+{
+	int size = var->sqllen;
+	if ((var->sqltype & ~1) == SQL_VARYING) size += 2;
+	return (int)sizeof(short) + size;
+}
+
+void RowImpl::GetRaw(int varnum, char* data)
+{
+	if (varnum < 1 || varnum > mDescrArea->sqld)
+		throw LogicExceptionImpl("RowImpl::GetRaw", _("Variable index out of range."));
+
+	XSQLVAR* var = &(mDescrArea->sqlvar[varnum-1]);
+	short ind = (var->sqltype & 1) ? *var->sqlind : 0;
+	memcpy(data, &ind, sizeof(short));
+	memcpy(data + sizeof(short), var->sqldata, RawSize(var) - sizeof(short));
+}
+
+void RowImpl::SetRaw(int varnum, const char* data)
+{
+	if (varnum < 1 || varnum > mDescrArea->sqld)
+		throw LogicExceptionImpl("RowImpl::SetRaw", _("Variable index out of range."));
+
+	XSQLVAR* var = &(mDescrArea->sqlvar[varnum-1]);
+	if (var->sqltype & 1) memcpy(var->sqlind, data, sizeof(short));
+	memcpy(var->sqldata, data + sizeof(short), RawSize(var) - sizeof(short));
+	mUpdated[varnum-1] = true;
+}
+
 bool RowImpl::MissingValues()
 {
 	for (int i = 0; i < mDescrArea->sqld; i++)
@@ -1507,43 +1584,8 @@ RowImpl& RowImpl::operator=(const RowImpl& copied)
 	memcpy(mDescrArea, copied.mDescrArea, size);
 
 	// Copy of the columns data
-	for (int i = 0; i < mDescrArea->sqld; i++)
-	{
-		XSQLVAR* var = &(mDescrArea->sqlvar[i]);
-		XSQLVAR* org = &(copied.mDescrArea->sqlvar[i]);
-		switch (var->sqltype & ~1)
-		{
-			case SQL_ARRAY :
-			case SQL_BLOB :		var->sqldata = (char*) new ISC_QUAD;
-								memcpy(var->sqldata, org->sqldata, sizeof(ISC_QUAD));
-								break;
-			case SQL_TIMESTAMP :var->sqldata = (char*) new ISC_TIMESTAMP;
-								memcpy(var->sqldata, org->sqldata, sizeof(ISC_TIMESTAMP));
-								break;
-			case SQL_TYPE_TIME :var->sqldata = (char*) new ISC_TIME;
-								memcpy(var->sqldata, org->sqldata, sizeof(ISC_TIME));
-								break;
-			case SQL_TYPE_DATE :var->sqldata = (char*) new ISC_DATE;
-								memcpy(var->sqldata, org->sqldata, sizeof(ISC_DATE));
-								break;
-			case SQL_BOOLEAN :  var->sqldata = new char[1]; // Firebird v3
-								break;
-			case SQL_TEXT :		var->sqldata = new char[var->sqllen+1];
-								memcpy(var->sqldata, org->sqldata, var->sqllen+1);
-								break;
-			case SQL_VARYING :	var->sqldata = new char[var->sqllen+3];
-								memcpy(var->sqldata, org->sqldata, var->sqllen+3);
-								break;
-			case SQL_SHORT :	var->sqldata = (char*) new int16_t(*(int16_t*)org->sqldata); break;
-			case SQL_LONG :		var->sqldata = (char*) new int32_t(*(int32_t*)org->sqldata); break;
-			case SQL_INT64 :	var->sqldata = (char*) new int64_t(*(int64_t*)org->sqldata); break;
-			case SQL_FLOAT : 	var->sqldata = (char*) new float(*(float*)org->sqldata); break;
-			case SQL_DOUBLE :	var->sqldata = (char*) new double(*(double*)org->sqldata); break;
-			default : throw LogicExceptionImpl("RowImpl::Ctor",
-						_("Found an unknown sqltype !"));
-		}
-		if (var->sqltype & 1) var->sqlind = new short(*org->sqlind);	// 0 indicator
-	}
+	mArena = copied.mArena;
+	RebaseVariables(copied);
 
 	// Pointers init, real data copy
 	mNumerics = copied.mNumerics;
@@ -1553,6 +1595,9 @@ RowImpl& RowImpl::operator=(const RowImpl& copied)
 	mInt16s = copied.mInt16s;
 	mBools = copied.mBools;
 	mStrings = copied.mStrings;
+	mUpdated = copied.mUpdated;
+	mColumnNums = copied.mColumnNums;
+	mColumnsIndexed = copied.mColumnsIndexed;
 
 	mDialect = copied.mDialect;
 	mDatabase = copied.mDatabase;
@@ -1562,14 +1607,14 @@ RowImpl& RowImpl::operator=(const RowImpl& copied)
 }
 
 RowImpl::RowImpl(const RowImpl& copied)
-	: IBPP::IRow(), mRefCount(0), mDescrArea(0)
+	: IBPP::IRow(), mRefCount(0), mDescrArea(0), mColumnsIndexed(false)
 {
 	// mRefCount and mDescrArea are set to 0 before using the assignment operator
 	*this = copied;		// The assignment operator does the real copy
 }
 
 RowImpl::RowImpl(int dialect, int n, DatabaseImpl* db, TransactionImpl* tr)
-	: mRefCount(0), mDescrArea(0)
+	: mRefCount(0), mDescrArea(0), mColumnsIndexed(false)
 {
 	Resize(n);
 	mDialect = dialect;
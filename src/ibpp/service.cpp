@@ -683,8 +683,8 @@ void ServiceImpl::Release()
 {
 	// Release cannot throw, except in DEBUG builds on assertion
 	ASSERTION(mRefCount >= 0);
-	--mRefCount;
-	try { if (mRefCount <= 0) delete this; }
+	int refs = --mRefCount;
+	try { if (refs <= 0) delete this; }
 		catch (...) { }
 }
 
@@ -26,8 +26,202 @@
 #pragma hdrstop
 #endif
 
+#include <chrono>
+#include <cmath>
+
 using namespace ibpp_internals;
 
+namespace
+{
+	// Status interface of the object oriented API, errors are copied into
+	// an IBS so they are reported like the ones of the legacy API
+	class OOStatus
+	{
+		FbStatus* mStatus;
+
+	public:
+		FbStatus* Self() { return mStatus; }
+		bool Errors()
+		{
+			return (mStatus->cloopVTable->getState(mStatus) & FbStatus::STATE_ERRORS) != 0;
+		}
+		void Reset() { mStatus->cloopVTable->init(mStatus); }
+		void CopyTo(IBS& status)
+		{
+			ISC_STATUS* vector = status.Self();
+			const intptr_t* errors = mStatus->cloopVTable->getErrors(mStatus);
+			const int size = 20;
+			int i = 0;
+			while (errors[i] != isc_arg_end)
+			{
+				int n = (errors[i] == isc_arg_cstring) ? 3 : 2;
+				if (i + n >= size) break;
+				for (int j = 0; j < n; j++)
+					vector[i + j] = errors[i + j];
+				i += n;
+			}
+			vector[i] = isc_arg_end;
+		}
+		void Raise(const std::string& context, const char* message)
+		{
+			IBS status;
+			CopyTo(status);
+			throw SQLExceptionImpl(status, context, message);
+		}
+
+		OOStatus()
+		{
+			FbMaster* master = (*gds.Call()->m_get_master_interface)();
+			mStatus = master->cloopVTable->getStatus(master);
+		}
+		~OOStatus() { mStatus->cloopVTable->dispose(mStatus); }
+	};
+
+	// Adds the wall clock time spent in its scope to a total in microseconds
+	class ScopeTimer
+	{
+		int64_t& mTotal;
+		std::chrono::steady_clock::time_point mStart;
+
+	public:
+		ScopeTimer(int64_t& total)
+			: mTotal(total), mStart(std::chrono::steady_clock::now()) { }
+		~ScopeTimer()
+		{
+			mTotal += std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - mStart).count();
+		}
+	};
+
+	// Offsets of the values and null indicators in the messages described by
+	// the metadata, returns false if the message doesn't hold the columns of
+	// the XSQLDA with the same types and lengths
+	bool MessageLayout(FbMessageMetadata* meta, OOStatus& status, XSQLDA* da,
+		std::vector<unsigned>& offsets, std::vector<unsigned>& nullOffsets,
+		unsigned& length)
+	{
+		FbMessageMetadataVTable* vtable = meta->cloopVTable;
+		offsets.clear();
+		nullOffsets.clear();
+		if (vtable->getCount(meta, status.Self()) != (unsigned)da->sqld
+			|| status.Errors())
+			return false;
+		for (int i = 0; i < da->sqld; i++)
+		{
+			XSQLVAR* var = &(da->sqlvar[i]);
+			unsigned type = vtable->getType(meta, status.Self(), i);
+			unsigned len = vtable->getLength(meta, status.Self(), i);
+			if (status.Errors()) return false;
+			if ((type & ~1) != (unsigned)(var->sqltype & ~1)
+				|| len != (unsigned)var->sqllen)
+				return false;
+			offsets.push_back(vtable->getOffset(meta, status.Self(), i));
+			nullOffsets.push_back(vtable->getNullOffset(meta, status.Self(), i));
+		}
+		length = vtable->getMessageLength(meta, status.Self());
+		return ! status.Errors();
+	}
+
+	// Copies a row in the format of RowImpl::GetRaw() to a message
+	void RawToMessage(XSQLDA* da, const char* data,
+		const std::vector<unsigned>& offsets,
+		const std::vector<unsigned>& nullOffsets, char* message)
+	{
+		for (int i = 0; i < da->sqld; i++)
+		{
+			XSQLVAR* var = &(da->sqlvar[i]);
+			short ind;
+			memcpy(&ind, data, sizeof(short));
+			ind = ind ? -1 : 0;
+			memcpy(message + nullOffsets[i], &ind, sizeof(short));
+			memcpy(message + offsets[i], data + sizeof(short),
+				RowImpl::RawSize(var) - sizeof(short));
+			data += RowImpl::RawSize(var);
+		}
+	}
+
+	// Positions of the parameter markers of an SQL statement, outside of
+	// string literals, quoted identifiers and comments
+	void FindParameters(const std::string& sql, std::vector<size_t>& markers)
+	{
+		size_t i = 0;
+		while (i < sql.length())
+		{
+			size_t end;
+			if (sql[i] == '\'' || sql[i] == '"')
+				end = sql.find(sql[i], i + 1);
+			else if (sql.compare(i, 2, "--") == 0)
+				end = sql.find('\n', i + 2);
+			else if (sql.compare(i, 2, "/*") == 0)
+			{
+				end = sql.find("*/", i + 2);
+				if (end != std::string::npos) ++end;
+			}
+			else
+			{
+				if (sql[i] == '?') markers.push_back(i);
+				++i;
+				continue;
+			}
+			if (end == std::string::npos) break;
+			i = end + 1;
+		}
+	}
+
+	typedef std::map<int, std::pair<std::string, int> > Charsets;
+
+	// Declaration of a parameter in EXECUTE BLOCK with the type the statement
+	// described it with, empty if it can't be declared
+	std::string BlockParameterType(const XSQLVAR* var, const Charsets& charsets)
+	{
+		std::ostringstream type;
+		int scale = -var->sqlscale;
+		switch (var->sqltype & ~1)
+		{
+			case SQL_TEXT :
+			case SQL_VARYING :
+			{
+				Charsets::const_iterator it = charsets.find(var->sqlsubtype & 0xFF);
+				if (it == charsets.end() || it->second.second <= 0) return "";
+				type<< ((var->sqltype & ~1) == SQL_TEXT ? "CHAR(" : "VARCHAR(")
+					<< var->sqllen / it->second.second<< ") CHARACTER SET "
+					<< it->second.first;
+				break;
+			}
+			case SQL_SHORT :
+				if (scale > 0) type<< "NUMERIC(4, "<< scale<< ")";
+				else type<< "SMALLINT";
+				break;
+			case SQL_LONG :
+				if (scale > 0) type<< "NUMERIC(9, "<< scale<< ")";
+				else type<< "INTEGER";
+				break;
+			case SQL_INT64 :
+				if (scale > 0) type<< "NUMERIC(18, "<< scale<< ")";
+				else type<< "BIGINT";
+				break;
+			case SQL_FLOAT :		type<< "FLOAT"; break;
+			case SQL_DOUBLE :		type<< "DOUBLE PRECISION"; break;
+			case SQL_TIMESTAMP :	type<< "TIMESTAMP"; break;
+			case SQL_TYPE_DATE :	type<< "DATE"; break;
+			case SQL_TYPE_TIME :	type<< "TIME"; break;
+			case SQL_BOOLEAN :		type<< "BOOLEAN"; break;
+			case SQL_BLOB :			type<< "BLOB SUB_TYPE "<< var->sqlsubtype; break;
+			default :				return "";
+		}
+		return type.str();
+	}
+
+	// Values are packed in the buffers of a ColumnBatch without alignment
+	template<typename T>
+	T BatchValue(const char* data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+}
+
 //	(((((((( OBJECT INTERFACE IMPLEMENTATION ))))))))
 
 void StatementImpl::Prepare(const std::string& sql)
@@ -46,6 +240,10 @@ void StatementImpl::Prepare(const std::string& sql)
 	// Saves the SQL sentence, only for reporting reasons in case of errors
 	mSql = sql;
 
+	ClearMetrics();
+	mPrepareTime = 0;
+	ScopeTimer timer(mPrepareTime);
+
 	IBS status;
 
 	// Free all resources currently attached to this Statement, then allocate
@@ -224,7 +422,58 @@ void StatementImpl::Prepare(const std::string& sql)
 	}
 
 	// Allocates variables of the output descriptor
-	if (mOutRow != 0) mOutRow->AllocVariables();
+	if (mOutRow != 0)
+	{
+		mOutRow->AllocVariables();
+
+		// What FetchBatch() copies of each column only depends on its type
+		XSQLDA* da = mOutRow->Self();
+		mBatchLayout.resize(da->sqld);
+		for (int i = 0; i < da->sqld; i++)
+		{
+			XSQLVAR* var = &(da->sqlvar[i]);
+			IBPP::ColumnBatch::Column& column = mBatchLayout[i];
+			column.sqltype = var->sqltype & ~1;
+			column.scale = var->sqlscale;
+			column.size = (column.sqltype == SQL_VARYING) ? 0 : var->sqllen;
+		}
+	}
+
+	// The timeout belongs to the statement handle, which has just been allocated
+	if (mTimeout != 0) ApplyTimeout("Statement::Prepare");
+}
+
+void StatementImpl::SetTimeout(unsigned milliseconds)
+{
+	mTimeout = milliseconds;
+	if (mHandle != 0) ApplyTimeout("Statement::SetTimeout");
+}
+
+void StatementImpl::ApplyTimeout(const char* context)
+{
+	FBCLIENT* client = gds.Call();
+	if (client->m_get_statement_interface == 0)
+		throw LogicExceptionImpl(context,
+			_("The client library doesn't support statement timeouts."));
+
+	IBS status;
+	FbStatement* statement = 0;
+	(*client->m_get_statement_interface)(status.Self(), &statement, &mHandle);
+	if (status.Errors())
+		throw SQLExceptionImpl(status, context,
+			_("fb_get_statement_interface failed"));
+	if (statement->cloopVTable->version < FbStatement::VERSION_TIMEOUT)
+	{
+		statement->cloopVTable->release(statement);
+		throw LogicExceptionImpl(context,
+			_("The client library doesn't support statement timeouts."));
+	}
+
+	OOStatus oostatus;
+	statement->cloopVTable->setTimeout(statement, oostatus.Self(), mTimeout);
+	statement->cloopVTable->release(statement);
+	if (oostatus.Errors())
+		oostatus.Raise(context, _("IStatement::setTimeout failed"));
 }
 
 void StatementImpl::Plan(std::string& plan)
@@ -264,9 +513,25 @@ void StatementImpl::Execute(const std::string& sql)
 
 	CursorFree();	// Free a previous 'cursor' if any
 
+	StartMetrics();
+	ScopeTimer timer(mExecuteTime);
 	IBS status;
 	if (mType == IBPP::stSelect)
 	{
+		// The rows of databases using the object interface are fetched
+		// through an IResultSet, unless the messages can't be laid out
+		// like the XSQLDAs
+		if (mOutRow != 0 && mDatabase->ClientInterface() == IBPP::ciObject)
+		{
+			std::string context = "Statement::Execute( ";
+			context.append(mSql).append(" )");
+			if (OpenResultSet(0, context))
+			{
+				mResultSetAvailable = true;
+				return;
+			}
+		}
+
 		// Could return a result set (none, single or multi rows)
 		(*gds.Call()->m_dsql_execute)(status.Self(), mTransaction->GetHandlePtr(),
 			&mHandle, 1, mInRow == 0 ? 0 : mInRow->Self());
@@ -282,17 +547,501 @@ void StatementImpl::Execute(const std::string& sql)
 	}
 	else
 	{
-		// Should return at most a single row
-		(*gds.Call()->m_dsql_execute2)(status.Self(), mTransaction->GetHandlePtr(),
-			&mHandle, 1, mInRow == 0 ? 0 : mInRow->Self(),
-			mOutRow == 0 ? 0 : mOutRow->Self());
-		if (status.Errors())
+		ExecuteSingleton();
+		EndPageCount();
+	}
+}
+
+// Executes a statement which returns at most a single row, without
+// touching the metrics, so that batches can execute rows one by one
+void StatementImpl::ExecuteSingleton()
+{
+	IBS status;
+	(*gds.Call()->m_dsql_execute2)(status.Self(), mTransaction->GetHandlePtr(),
+		&mHandle, 1, mInRow == 0 ? 0 : mInRow->Self(),
+		mOutRow == 0 ? 0 : mOutRow->Self());
+	if (status.Errors())
+	{
+		//Close();	Commented because Execute error should not free the statement
+		std::string context = "Statement::Execute( ";
+		context.append(mSql).append(" )");
+		throw SQLExceptionImpl(status, context.c_str(),
+			_("isc_dsql_execute2 failed"));
+	}
+}
+
+void StatementImpl::ExecuteScrollable()
+{
+	if (mHandle == 0)
+		throw LogicExceptionImpl("Statement::ExecuteScrollable",
+			_("No statement has been prepared."));
+	if (mType != IBPP::stSelect || mOutRow == 0)
+		throw LogicExceptionImpl("Statement::ExecuteScrollable",
+			_("Only select statements can use a scrollable cursor."));
+	if (mInRow != 0 && mInRow->MissingValues())
+		throw LogicExceptionImpl("Statement::ExecuteScrollable",
+			_("All parameters must be specified."));
+
+	FBCLIENT* client = gds.Call();
+	if (client->m_get_master_interface == 0
+		|| client->m_get_statement_interface == 0
+		|| client->m_get_transaction_interface == 0)
+	{
+		throw LogicExceptionImpl("Statement::ExecuteScrollable",
+			_("The client library doesn't support scrollable cursors."));
+	}
+
+	CursorFree();	// Free a previous 'cursor' if any
+
+	StartMetrics();
+	ScopeTimer timer(mExecuteTime);
+	std::string context = "Statement::ExecuteScrollable( ";
+	context.append(mSql).append(" )");
+	if (! OpenResultSet(FbStatement::CURSOR_TYPE_SCROLLABLE, context))
+		throw LogicExceptionImpl("Statement::ExecuteScrollable",
+			_("The result set layout doesn't match the statement description."));
+	mResultSetAvailable = true;
+}
+
+// Opens mResultSet with the object interface, the parameters of mInRow are
+// sent in an input message. Returns false if the input or output message
+// isn't laid out like the XSQLDA of the row.
+bool StatementImpl::OpenResultSet(unsigned flags, const std::string& context)
+{
+	FBCLIENT* client = gds.Call();
+	IBS status;
+	FbStatement* statement = 0;
+	(*client->m_get_statement_interface)(status.Self(), &statement, &mHandle);
+	if (status.Errors())
+		throw SQLExceptionImpl(status, context.c_str(),
+			_("fb_get_statement_interface failed"));
+	FbTransaction* transaction = 0;
+	(*client->m_get_transaction_interface)(status.Self(), &transaction,
+		mTransaction->GetHandlePtr());
+	if (status.Errors())
+	{
+		statement->cloopVTable->release(statement);
+		throw SQLExceptionImpl(status, context.c_str(),
+			_("fb_get_transaction_interface failed"));
+	}
+
+	OOStatus oostatus;
+	bool matches = true;
+	FbMessageMetadata* inMeta = 0;
+	std::vector<char> inMessage;
+	if (mInRow != 0)
+	{
+		inMeta = statement->cloopVTable->getInputMetadata(statement,
+			oostatus.Self());
+		std::vector<unsigned> offsets, nullOffsets;
+		unsigned length = 0;
+		if (! oostatus.Errors())
+			matches = MessageLayout(inMeta, oostatus, mInRow->Self(), offsets,
+				nullOffsets, length);
+		if (matches && ! oostatus.Errors())
 		{
-			//Close();	Commented because Execute error should not free the statement
-			std::string context = "Statement::Execute( ";
-			context.append(mSql).append(" )");
-			throw SQLExceptionImpl(status, context.c_str(),
-				_("isc_dsql_execute2 failed"));
+			XSQLDA* da = mInRow->Self();
+			std::vector<char> raw(BatchRowSize());
+			size_t offset = 0;
+			for (int i = 0; i < da->sqld; i++)
+			{
+				mInRow->GetRaw(i+1, &raw[offset]);
+				offset += RowImpl::RawSize(&(da->sqlvar[i]));
+			}
+			inMessage.resize(std::max(length, 1u));
+			RawToMessage(da, &raw[0], offsets, nullOffsets, &inMessage[0]);
+		}
+	}
+	if (matches && ! oostatus.Errors())
+	{
+		mResultMeta = statement->cloopVTable->getOutputMetadata(statement,
+			oostatus.Self());
+		unsigned length = 0;
+		if (! oostatus.Errors())
+			matches = MessageLayout(mResultMeta, oostatus, mOutRow->Self(),
+				mResultOffsets, mResultNullOffsets, length);
+		if (matches && ! oostatus.Errors())
+			mResultBuffer.resize(length);
+	}
+	if (matches && ! oostatus.Errors())
+	{
+		mResultSet = statement->cloopVTable->openCursor(statement,
+			oostatus.Self(), transaction, inMeta,
+			inMeta == 0 ? 0 : &inMessage[0], mResultMeta, flags);
+	}
+	if (inMeta != 0) inMeta->cloopVTable->release(inMeta);
+	statement->cloopVTable->release(statement);
+	transaction->cloopVTable->release(transaction);
+	if (oostatus.Errors())
+	{
+		mResultSet = 0;
+		ResultSetFree();
+		oostatus.Raise(context, _("IStatement::openCursor failed"));
+	}
+	if (! matches)
+	{
+		ResultSetFree();
+		return false;
+	}
+	mResultScrollable = (flags & FbStatement::CURSOR_TYPE_SCROLLABLE) != 0;
+	return true;
+}
+
+void StatementImpl::AddBatch()
+{
+	if (mHandle == 0)
+		throw LogicExceptionImpl("Statement::AddBatch",
+			_("No statement has been prepared."));
+	if (mInRow == 0)
+		throw LogicExceptionImpl("Statement::AddBatch",
+			_("The statement does not take parameters."));
+	if (mOutRow != 0)
+		throw LogicExceptionImpl("Statement::AddBatch",
+			_("Statements returning values can't be executed in batches."));
+	if (mInRow->MissingValues())
+		throw LogicExceptionImpl("Statement::AddBatch",
+			_("All parameters must be specified."));
+
+	size_t offset = mBatchData.size();
+	mBatchData.resize(offset + BatchRowSize());
+	XSQLDA* da = mInRow->Self();
+	for (int i = 0; i < da->sqld; i++)
+	{
+		mInRow->GetRaw(i+1, &mBatchData[offset]);
+		offset += RowImpl::RawSize(&(da->sqlvar[i]));
+	}
+	++mBatchRows;
+}
+
+void StatementImpl::ClearBatch()
+{
+	mBatchData.clear();
+	mBatchRows = 0;
+}
+
+int StatementImpl::ExecuteBatch(IBPP::BatchErrors& errors)
+{
+	if (mHandle == 0)
+		throw LogicExceptionImpl("Statement::ExecuteBatch",
+			_("No statement has been prepared."));
+
+	errors.clear();
+	int rows = mBatchRows;
+	if (rows == 0) return 0;
+
+	StartMetrics();
+	ScopeTimer timer(mExecuteTime);
+	try
+	{
+		if (! ExecuteInterfaceBatch(errors))
+			ExecuteBlockBatch(errors);
+	}
+	catch (...)
+	{
+		ClearBatch();
+		throw;
+	}
+	ClearBatch();
+	EndPageCount();
+	return rows - (int)errors.size();
+}
+
+int StatementImpl::BatchRowSize()
+{
+	int size = 0;
+	XSQLDA* da = mInRow->Self();
+	for (int i = 0; i < da->sqld; i++)
+		size += RowImpl::RawSize(&(da->sqlvar[i]));
+	return size;
+}
+
+// Sends the rows with the IBatch interface of Firebird 4, returns false if
+// the client library or the server don't support it
+bool StatementImpl::ExecuteInterfaceBatch(IBPP::BatchErrors& errors)
+{
+	FBCLIENT* client = gds.Call();
+	if (client->m_get_master_interface == 0
+		|| client->m_get_statement_interface == 0
+		|| client->m_get_transaction_interface == 0)
+		return false;
+
+	// Blobs would have to be registered with the batch
+	XSQLDA* da = mInRow->Self();
+	for (int i = 0; i < da->sqld; i++)
+	{
+		int type = da->sqlvar[i].sqltype & ~1;
+		if (type == SQL_BLOB || type == SQL_ARRAY) return false;
+	}
+
+	IBS status;
+	FbStatement* statement = 0;
+	(*client->m_get_statement_interface)(status.Self(), &statement, &mHandle);
+	if (status.Errors()) return false;
+	if (statement->cloopVTable->version < FbStatement::VERSION_BATCH)
+	{
+		statement->cloopVTable->release(statement);
+		return false;
+	}
+
+	// The message layout of the parameters must match the XSQLDA of mInRow
+	OOStatus oostatus;
+	FbMessageMetadata* meta = statement->cloopVTable->getInputMetadata(statement,
+		oostatus.Self());
+	std::vector<unsigned> offsets, nullOffsets;
+	unsigned length = 0;
+	bool matches = ! oostatus.Errors()
+		&& MessageLayout(meta, oostatus, da, offsets, nullOffsets, length);
+
+	FbBatch* batch = 0;
+	if (matches && ! oostatus.Errors())
+	{
+		// Continue after errors and report the state of each row
+		const unsigned char bpb[] = {FbBatch::VERSION1,
+			FbBatch::TAG_MULTIERROR, 4, 0, 0, 0, 1, 0, 0, 0,
+			FbBatch::TAG_RECORD_COUNTS, 4, 0, 0, 0, 1, 0, 0, 0};
+		batch = statement->cloopVTable->createBatch(statement, oostatus.Self(),
+			meta, sizeof(bpb), bpb);
+	}
+	if (meta != 0) meta->cloopVTable->release(meta);
+	statement->cloopVTable->release(statement);
+	if (batch == 0 || oostatus.Errors())
+	{
+		// The server is older than Firebird 4
+		if (batch != 0) batch->cloopVTable->release(batch);
+		return false;
+	}
+
+	FbTransaction* transaction = 0;
+	(*client->m_get_transaction_interface)(status.Self(), &transaction,
+		mTransaction->GetHandlePtr());
+	if (status.Errors())
+	{
+		batch->cloopVTable->release(batch);
+		throw SQLExceptionImpl(status, "Statement::ExecuteBatch",
+			_("fb_get_transaction_interface failed"));
+	}
+
+	// The rows are executed in parts of a few megabytes, to stay below the
+	// size of the buffer of the batch
+	std::vector<char> message(length);
+	const int rowSize = BatchRowSize();
+	const int partRows = std::max(1, (int)((4 << 20) / std::max(length, 1u)));
+	std::string context = "Statement::ExecuteBatch( ";
+	context.append(mSql).append(" )");
+	for (int first = 0; first < mBatchRows && ! oostatus.Errors(); first += partRows)
+	{
+		int count = std::min(partRows, mBatchRows - first);
+		for (int row = first; row < first + count && ! oostatus.Errors(); row++)
+		{
+			RawToMessage(da, &mBatchData[(size_t)row * rowSize], offsets,
+				nullOffsets, &message[0]);
+			batch->cloopVTable->add(batch, oostatus.Self(), 1, &message[0]);
+		}
+		if (oostatus.Errors()) break;
+
+		FbBatchCompletionState* state = batch->cloopVTable->execute(batch,
+			oostatus.Self(), transaction);
+		if (oostatus.Errors()) break;
+		unsigned size = state->cloopVTable->getSize(state, oostatus.Self());
+		OOStatus rowstatus;
+		for (unsigned pos = 0; pos < size && ! oostatus.Errors(); pos++)
+		{
+			if (state->cloopVTable->getState(state, oostatus.Self(), pos)
+				!= FbBatchCompletionState::EXECUTE_FAILED)
+				continue;
+
+			// Only the first errors are detailed, the others have an empty status
+			rowstatus.Reset();
+			state->cloopVTable->getStatus(state, oostatus.Self(),
+				rowstatus.Self(), pos);
+			IBS rowerrors;
+			if (rowstatus.Errors()) rowstatus.CopyTo(rowerrors);
+			SQLExceptionImpl e(rowerrors, context, _("Batch row failed"));
+			IBPP::BatchError error;
+			error.row = first + (int)pos;
+			error.sqlcode = e.SqlCode();
+			error.message = e.what();
+			errors.push_back(error);
+		}
+		state->cloopVTable->dispose(state);
+	}
+	batch->cloopVTable->release(batch);
+	transaction->cloopVTable->release(transaction);
+	if (oostatus.Errors())
+		oostatus.Raise(context, _("IBatch::execute failed"));
+	return true;
+}
+
+// Packs as many rows as the limits of Firebird allow in each EXECUTE BLOCK
+// statement, a block which fails is executed again row by row to know which
+// rows failed
+void StatementImpl::ExecuteBlockBatch(IBPP::BatchErrors& errors)
+{
+	XSQLDA* da = mInRow->Self();
+	const int params = da->sqld;
+	std::vector<size_t> markers;
+	FindParameters(mSql, markers);
+	bool packed = mDatabase->Dialect() == 3 && (int)markers.size() == params
+		&& mBatchRows > 1;
+
+	// Character sets of the text parameters, with their bytes per character
+	Charsets charsets;
+	for (int i = 0; packed && i < params; i++)
+	{
+		int type = da->sqlvar[i].sqltype & ~1;
+		if (type != SQL_TEXT && type != SQL_VARYING) continue;
+
+		IBPP::Statement st = new StatementImpl(mDatabase, mTransaction);
+		st->Execute("select rdb$character_set_id, rdb$character_set_name, "
+			"rdb$bytes_per_character from rdb$character_sets");
+		while (st->Fetch())
+		{
+			int id, bytes;
+			std::string name;
+			st->Get(1, id);
+			st->Get(2, name);
+			st->Get(3, bytes);
+			name.erase(name.find_last_not_of(' ') + 1);
+			charsets[id] = std::make_pair(name, bytes);
+		}
+		break;
+	}
+
+	std::vector<std::string> types;
+	for (int i = 0; packed && i < params; i++)
+	{
+		types.push_back(BlockParameterType(&(da->sqlvar[i]), charsets));
+		packed = ! types.back().empty();
+	}
+
+	// Message and statement text below 64 KB, at most 256 rows and about
+	// 1000 parameters per block
+	std::string sql = mSql;
+	sql.erase(sql.find_last_not_of(" \t\r\n;") + 1);
+	int blockRows = 0;
+	if (packed)
+	{
+		int message = 0, text = (int)sql.length() + 40;
+		for (int i = 0; i < params; i++)
+		{
+			message += RowImpl::RawSize(&(da->sqlvar[i])) + 8;
+			text += (int)types[i].length() + 30;
+		}
+		blockRows = std::min(256, std::min(60000 / message, 60000 / text));
+		if (params > 0) blockRows = std::min(blockRows, std::max(1, 1000 / params));
+	}
+	if (blockRows < 2)
+	{
+		ExecuteSingleRows(0, mBatchRows, errors);
+		return;
+	}
+
+	const int rowSize = BatchRowSize();
+	IBPP::Statement block;
+	int preparedRows = 0;
+	for (int first = 0; first < mBatchRows; first += blockRows)
+	{
+		int count = std::min(blockRows, mBatchRows - first);
+		if (count < 2)
+		{
+			ExecuteSingleRows(first, count, errors);
+			continue;
+		}
+
+		if (count != preparedRows)
+		{
+			std::ostringstream text;
+			text<< "EXECUTE BLOCK (";
+			for (int row = 0; row < count; row++)
+				for (int i = 0; i < params; i++)
+				{
+					if (row != 0 || i != 0) text<< ", ";
+					text<< "P"<< row<< "_"<< i+1<< " "<< types[i]<< " = ?";
+				}
+			text<< ")\nAS\nBEGIN\n";
+			for (int row = 0; row < count; row++)
+			{
+				size_t pos = 0;
+				for (int i = 0; i < params; i++)
+				{
+					text<< sql.substr(pos, markers[i] - pos)<< ":P"<< row<< "_"<< i+1;
+					pos = markers[i] + 1;
+				}
+				text<< sql.substr(pos)<< ";\n";
+			}
+			text<< "END";
+
+			try
+			{
+				block = new StatementImpl(mDatabase, mTransaction);
+				block->Prepare(text.str());
+			}
+			catch (IBPP::SQLException&)
+			{
+				// Declared types the server doesn't accept
+				ExecuteSingleRows(first, mBatchRows - first, errors);
+				return;
+			}
+			preparedRows = count;
+		}
+
+		StatementImpl* impl = (StatementImpl*)block.intf();
+		bool matches = impl->mInRow != 0 && impl->mInRow->Columns() == count * params;
+		for (int n = 0; matches && n < count * params; n++)
+		{
+			XSQLVAR* var = &(impl->mInRow->Self()->sqlvar[n]);
+			XSQLVAR* org = &(da->sqlvar[n % params]);
+			matches = (var->sqltype & ~1) == (org->sqltype & ~1)
+				&& var->sqllen == org->sqllen;
+		}
+		if (! matches)
+		{
+			ExecuteSingleRows(first, mBatchRows - first, errors);
+			return;
+		}
+
+		const char* data = &mBatchData[(size_t)first * rowSize];
+		for (int n = 0; n < count * params; n++)
+		{
+			impl->mInRow->SetRaw(n+1, data);
+			data += RowImpl::RawSize(&(da->sqlvar[n % params]));
+		}
+		try
+		{
+			block->Execute();
+		}
+		catch (IBPP::SQLException&)
+		{
+			// Nothing of the block was done, find out which rows fail
+			ExecuteSingleRows(first, count, errors);
+		}
+	}
+}
+
+void StatementImpl::ExecuteSingleRows(int first, int count,
+	IBPP::BatchErrors& errors)
+{
+	XSQLDA* da = mInRow->Self();
+	const int rowSize = BatchRowSize();
+	for (int row = first; row < first + count; row++)
+	{
+		const char* data = &mBatchData[(size_t)row * rowSize];
+		for (int i = 0; i < da->sqld; i++)
+		{
+			mInRow->SetRaw(i+1, data);
+			data += RowImpl::RawSize(&(da->sqlvar[i]));
+		}
+		try
+		{
+			ExecuteSingleton();
+		}
+		catch (IBPP::SQLException& e)
+		{
+			IBPP::BatchError error;
+			error.row = row;
+			error.sqlcode = e.SqlCode();
+			error.message = e.what();
+			errors.push_back(error);
 		}
 	}
 }
@@ -318,6 +1067,8 @@ void StatementImpl::CursorExecute(const std::string& cursor, const std::string&
 
 	CursorFree();	// Free a previous 'cursor' if any
 
+	StartMetrics();
+	ScopeTimer timer(mExecuteTime);
 	IBS status;
 	(*gds.Call()->m_dsql_execute)(status.Self(), mTransaction->GetHandlePtr(),
 		&mHandle, 1, mInRow == 0 ? 0 : mInRow->Self());
@@ -358,6 +1109,10 @@ void StatementImpl::ExecuteImmediate(const std::string& sql)
 
 	IBS status;
 	Close();
+	ClearMetrics();
+	mPrepareTime = 0;
+	StartMetrics();
+	ScopeTimer timer(mExecuteTime);
     (*gds.Call()->m_dsql_execute_immediate)(status.Self(), mDatabase->GetHandlePtr(),
     	mTransaction->GetHandlePtr(), 0, const_cast<char*>(sql.c_str()),
     		short(mDatabase->Dialect()), 0);
@@ -368,18 +1123,34 @@ void StatementImpl::ExecuteImmediate(const std::string& sql)
 		throw SQLExceptionImpl(status, context.c_str(),
 			_("isc_dsql_execute_immediate failed"));
 	}
+	EndPageCount();
 }
 
 int StatementImpl::AffectedRows()
+{
+	int selects, inserts, updates, deletes;
+	RecordCounts(selects, inserts, updates, deletes, "Statement::AffectedRows");
+
+	// Cover the INSERT or UPDATE case
+	if (mType == IBPP::stInsert || mType == IBPP::stUpdate)
+		return inserts + updates;
+	else if (mType == IBPP::stDelete)
+		return deletes;
+	else if (mType == IBPP::stSelect)
+		return selects;
+	return 0;	// Returns zero count for unknown cases
+}
+
+void StatementImpl::RecordCounts(int& selects, int& inserts, int& updates,
+	int& deletes, const char* context)
 {
 	if (mHandle == 0)
-		throw LogicExceptionImpl("Statement::AffectedRows", _("No statement has been prepared."));
+		throw LogicExceptionImpl(context, _("No statement has been prepared."));
 	if (mDatabase == 0)
-		throw LogicExceptionImpl("Statement::AffectedRows", _("A Database must be attached."));
+		throw LogicExceptionImpl(context, _("A Database must be attached."));
 	if (mDatabase->GetHandle() == 0)
-		throw LogicExceptionImpl("Statement::AffectedRows", _("Database must be connected."));
+		throw LogicExceptionImpl(context, _("Database must be connected."));
 
-	int count(0);
 	IBS status;
 	RB result;
 	char itemsReq[] = {isc_info_sql_records};
@@ -387,21 +1158,80 @@ int StatementImpl::AffectedRows()
 	(*gds.Call()->m_dsql_sql_info)(status.Self(), &mHandle, 1, itemsReq,
 		result.Size(), result.Self());
 	if (status.Errors()) throw SQLExceptionImpl(status,
-			"Statement::AffectedRows", _("isc_dsql_sql_info failed."));
+			context, _("isc_dsql_sql_info failed."));
 
-	// Cover the INSERT or UPDATE case
-	if (mType == IBPP::stInsert || mType == IBPP::stUpdate)
+	selects = result.GetValue(isc_info_sql_records, isc_info_req_select_count);
+	inserts = result.GetValue(isc_info_sql_records, isc_info_req_insert_count);
+	updates = result.GetValue(isc_info_sql_records, isc_info_req_update_count);
+	deletes = result.GetValue(isc_info_sql_records, isc_info_req_delete_count);
+}
+
+void StatementImpl::Metrics(IBPP::StatementMetrics& metrics)
+{
+	metrics = IBPP::StatementMetrics();
+	metrics.prepareTime = mPrepareTime;
+	metrics.executeTime = mExecuteTime;
+	metrics.fetchTime = mFetchTime;
+	metrics.rowsFetched = mRowsFetched;
+}
+
+void StatementImpl::ServerMetrics(IBPP::StatementMetrics& metrics)
+{
+	Metrics(metrics);
+	if (mHandle != 0)
+		RecordCounts(metrics.selects, metrics.inserts, metrics.updates,
+			metrics.deletes, "Statement::ServerMetrics");
+
+	// While the result set hasn't ended the pages are counted up to now,
+	// and go on being counted for the next call
+	if (mPagesCounting) ReadPageCount();
+	metrics.fetches = mPages[0];
+	metrics.marks = mPages[1];
+	metrics.reads = mPages[2];
+	metrics.writes = mPages[3];
+}
+
+void StatementImpl::ClearMetrics()
+{
+	mExecuteTime = 0;
+	mFetchTime = 0;
+	mRowsFetched = 0;
+	mPagesCounting = false;
+	for (int i = 0; i < 4; i++) mPages[i] = -1;
+}
+
+// Called before each execution, the pages used by the attachment from now to
+// the end of the result set are counted
+void StatementImpl::StartMetrics()
+{
+	ClearMetrics();
+	if (mCountPages)
 	{
-		count += result.GetValue(isc_info_sql_records, isc_info_req_insert_count);
-		count += result.GetValue(isc_info_sql_records, isc_info_req_update_count);
+		mDatabase->Statistics(&mPagesStart[0], &mPagesStart[1],
+			&mPagesStart[2], &mPagesStart[3], 0);
+		mPagesCounting = true;
 	}
-	else if (mType == IBPP::stDelete)
-			count = result.GetValue(isc_info_sql_records, isc_info_req_delete_count);
-	else if (mType == IBPP::stSelect)
-			count = result.GetValue(isc_info_sql_records, isc_info_req_select_count);
-	else	count = 0;	// Returns zero count for unknown cases
+}
+
+void StatementImpl::EndPageCount()
+{
+	if (! mPagesCounting) return;
+	mPagesCounting = false;
+	ReadPageCount();
+}
 
-	return count;
+void StatementImpl::ReadPageCount()
+{
+	int pages[4];
+	try
+	{
+		mDatabase->Statistics(&pages[0], &pages[1], &pages[2], &pages[3], 0);
+	}
+	catch (IBPP::Exception&)
+	{
+		return;		// The pages stay uncounted, the rows are what matters
+	}
+	for (int i = 0; i < 4; i++) mPages[i] = pages[i] - mPagesStart[i];
 }
 
 bool StatementImpl::Fetch()
@@ -410,10 +1240,18 @@ bool StatementImpl::Fetch()
 		throw LogicExceptionImpl("Statement::Fetch",
 			_("No statement has been executed or no result set available."));
 
+	if (mResultSet != 0)
+		return ScrollFetch(soNext, 0, mOutRow, "Statement::Fetch");
+
 	IBS status;
-	ISC_STATUS code = (*gds.Call()->m_dsql_fetch)(status.Self(), &mHandle, 1, mOutRow->Self());
+	ISC_STATUS code;
+	{
+		ScopeTimer timer(mFetchTime);
+		code = (*gds.Call()->m_dsql_fetch)(status.Self(), &mHandle, 1, mOutRow->Self());
+	}
 	if (code == 100)	// This special code means "no more rows"
 	{
+		EndPageCount();
 		mResultSetAvailable = false;
 		// Oddly enough, fetching rows up to the last one seems to open
 		// an 'implicit' cursor that needs to be closed.
@@ -431,6 +1269,7 @@ bool StatementImpl::Fetch()
     // Close the 'implicit' cursor to allow for forther Execute() calls
     // on the prepared statement without fetching up to the last row
 	mCursorOpened = true;
+	++mRowsFetched;
 	return true;
 }
 
@@ -440,14 +1279,42 @@ bool StatementImpl::Fetch(IBPP::Row& row)
 		throw LogicExceptionImpl("Statement::Fetch(row)",
 			_("No statement has been executed or no result set available."));
 
-	RowImpl* rowimpl = new RowImpl(*mOutRow);
-	row = rowimpl;
+	// The row of the previous Fetch(row) is reused unless it is shared, so
+	// that fetching row after row does not allocate anything
+	RowImpl* rowimpl = dynamic_cast<RowImpl*>(row.intf());
+	if (rowimpl == 0 || ! rowimpl->Recycle(*mOutRow))
+	{
+		rowimpl = new RowImpl(*mOutRow);
+		row = rowimpl;
+	}
+
+	if (mResultSet != 0)
+	{
+		bool fetched = false;
+		try
+		{
+			fetched = ScrollFetch(soNext, 0, rowimpl, "Statement::Fetch(row)");
+		}
+		catch (...)
+		{
+			row.clear();
+			throw;
+		}
+		if (! fetched)
+			row.clear();
+		return fetched;
+	}
 
 	IBS status;
-	ISC_STATUS code = (*gds.Call()->m_dsql_fetch)(status.Self(), &mHandle, 1,
+	ISC_STATUS code;
+	{
+		ScopeTimer timer(mFetchTime);
+		code = (*gds.Call()->m_dsql_fetch)(status.Self(), &mHandle, 1,
 					rowimpl->Self());
+	}
 	if (code == 100)	// This special code means "no more rows"
 	{
+		EndPageCount();
 		mResultSetAvailable = false;
 		// Oddly enough, fetching rows up to the last one seems to open
 		// an 'implicit' cursor that needs to be closed.
@@ -464,16 +1331,112 @@ bool StatementImpl::Fetch(IBPP::Row& row)
 			_("isc_dsql_fetch failed."));
 	}
 
+	++mRowsFetched;
 	return true;
 }
 
+int StatementImpl::FetchBatch(int rows, IBPP::ColumnBatch& batch)
+{
+	if (! mResultSetAvailable)
+		throw LogicExceptionImpl("Statement::FetchBatch",
+			_("No statement has been executed or no result set available."));
+	if (rows <= 0)
+		throw LogicExceptionImpl("Statement::FetchBatch",
+			_("The number of rows to fetch must be positive."));
+
+	// The buffers of the batch keep their capacity, so that fetching a
+	// result set batch after batch does not reallocate them
+	batch.Reset(mBatchLayout, rows);
+	// Only assigned when they change, batch after batch they don't
+	if (batch.mDatabase != mDatabase) batch.mDatabase = mDatabase;
+	if (batch.mTransaction != mTransaction) batch.mTransaction = mTransaction;
+
+	// The rows of a cursor of the object interface are taken from the
+	// message, without copying them to the XSQLDA of the output row first
+	XSQLDA* da = mOutRow->Self();
+	const bool message = mResultSet != 0;
+	while (batch.mRows < rows
+		&& (message ? FetchMessage(soNext, 0, "Statement::FetchBatch") : Fetch()))
+	{
+		for (int i = 0; i < da->sqld; i++)
+		{
+			XSQLVAR* var = &(da->sqlvar[i]);
+			bool null;
+			const char* data;
+			if (message)
+			{
+				null = *(const short*)&mResultBuffer[mResultNullOffsets[i]] != 0;
+				data = &mResultBuffer[mResultOffsets[i]];
+			}
+			else
+			{
+				null = (var->sqltype & 1) && *(var->sqlind) != 0;
+				data = var->sqldata;
+			}
+			if (null)
+				batch.AddValue(i + 1, 0, 0);
+			else if (mBatchLayout[i].size != 0)
+				batch.AddValue(i + 1, data, mBatchLayout[i].size);
+			else
+				batch.AddValue(i + 1, data + 2, *(const int16_t*)data);
+		}
+		batch.AddRow();
+	}
+
+	return batch.mRows;
+}
+
+bool StatementImpl::FetchFirst()
+{
+	if (! Scrollable())
+		throw LogicExceptionImpl("Statement::FetchFirst",
+			_("No scrollable cursor has been opened."));
+	return ScrollFetch(soFirst, 0, mOutRow, "Statement::FetchFirst");
+}
+
+bool StatementImpl::FetchLast()
+{
+	if (! Scrollable())
+		throw LogicExceptionImpl("Statement::FetchLast",
+			_("No scrollable cursor has been opened."));
+	return ScrollFetch(soLast, 0, mOutRow, "Statement::FetchLast");
+}
+
+bool StatementImpl::FetchPrior()
+{
+	if (! Scrollable())
+		throw LogicExceptionImpl("Statement::FetchPrior",
+			_("No scrollable cursor has been opened."));
+	return ScrollFetch(soPrior, 0, mOutRow, "Statement::FetchPrior");
+}
+
+bool StatementImpl::FetchAbsolute(int position)
+{
+	if (! Scrollable())
+		throw LogicExceptionImpl("Statement::FetchAbsolute",
+			_("No scrollable cursor has been opened."));
+	return ScrollFetch(soAbsolute, position, mOutRow, "Statement::FetchAbsolute");
+}
+
+bool StatementImpl::FetchRelative(int offset)
+{
+	if (! Scrollable())
+		throw LogicExceptionImpl("Statement::FetchRelative",
+			_("No scrollable cursor has been opened."));
+	return ScrollFetch(soRelative, offset, mOutRow, "Statement::FetchRelative");
+}
+
 void StatementImpl::Close()
 {
 	// Free all statement resources.
 	// Used before preparing a new statement or from destructor.
 
+	ResultSetFree();
+
 	if (mInRow != 0) { mInRow->Release(); mInRow = 0; }
 	if (mOutRow != 0) { mOutRow->Release(); mOutRow = 0; }
+	mBatchLayout.clear();
+	ClearBatch();
 
 	mResultSetAvailable = false;
 	mCursorOpened = false;
@@ -1210,8 +2173,8 @@ void StatementImpl::Release()
 {
 	// Release cannot throw, except in DEBUG builds on assertion
 	ASSERTION(mRefCount >= 0);
-	--mRefCount;
-	try { if (mRefCount <= 0) delete this; }
+	int refs = --mRefCount;
+	try { if (refs <= 0) delete this; }
 		catch (...) { }
 }
 
@@ -1257,8 +2220,90 @@ void StatementImpl::DetachTransactionImpl()
 	mTransaction = 0;
 }
 
+void StatementImpl::ResultSetFree()
+{
+	// Errors are ignored, the cursor is gone anyway if the transaction ended
+	mResultScrollable = false;
+	if (mResultSet != 0)
+	{
+		OOStatus status;
+		mResultSet->cloopVTable->close(mResultSet, status.Self());
+		if (status.Errors())	// close() only releases the interface on success
+			mResultSet->cloopVTable->release(mResultSet);
+		mResultSet = 0;
+	}
+	if (mResultMeta != 0)
+	{
+		mResultMeta->cloopVTable->release(mResultMeta);
+		mResultMeta = 0;
+	}
+	mResultBuffer.clear();
+	mResultOffsets.clear();
+	mResultNullOffsets.clear();
+}
+
+// Fetches the next row of mResultSet into mResultBuffer, returns false
+// without a row
+bool StatementImpl::FetchMessage(ScrollOp op, int position,
+	const char* context)
+{
+	ScopeTimer timer(mFetchTime);
+	OOStatus status;
+	FbResultSetVTable* vtable = mResultSet->cloopVTable;
+	void* message = &mResultBuffer[0];
+	int code;
+	switch (op)
+	{
+		case soPrior:	code = vtable->fetchPrior(mResultSet, status.Self(), message); break;
+		case soFirst:	code = vtable->fetchFirst(mResultSet, status.Self(), message); break;
+		case soLast:	code = vtable->fetchLast(mResultSet, status.Self(), message); break;
+		case soAbsolute:code = vtable->fetchAbsolute(mResultSet, status.Self(), position, message); break;
+		case soRelative:code = vtable->fetchRelative(mResultSet, status.Self(), position, message); break;
+		default:		code = vtable->fetchNext(mResultSet, status.Self(), message); break;
+	}
+	if (status.Errors())
+		status.Raise(context, _("IResultSet fetch failed."));
+	if (code == FbStatus::RESULT_NO_DATA)
+	{
+		EndPageCount();
+		// Unlike Fetch() from the legacy API a scrollable cursor stays open
+		// after the last row, so that it can still be positioned
+		if (! mResultScrollable)
+		{
+			ResultSetFree();
+			mResultSetAvailable = false;
+		}
+		return false;
+	}
+	++mRowsFetched;
+	return true;
+}
+
+bool StatementImpl::ScrollFetch(ScrollOp op, int position, RowImpl* row,
+	const char* context)
+{
+	if (! FetchMessage(op, position, context))
+		return false;
+
+	XSQLDA* da = row->Self();
+	for (int i = 0; i < da->sqld; i++)
+	{
+		XSQLVAR* var = &(da->sqlvar[i]);
+		const char* data = &mResultBuffer[mResultOffsets[i]];
+		if (var->sqlind != 0)
+			*var->sqlind = *(const short*)&mResultBuffer[mResultNullOffsets[i]] ? -1 : 0;
+		if ((var->sqltype & ~1) == SQL_VARYING)
+			memcpy(var->sqldata, data, 2 + *(const unsigned short*)data);
+		else
+			memcpy(var->sqldata, data, var->sqllen);
+	}
+	return true;
+}
+
 void StatementImpl::CursorFree()
 {
+	ResultSetFree();
+
 	if (mCursorOpened)
 	{
 		mCursorOpened = false;
@@ -1273,11 +2318,21 @@ void StatementImpl::CursorFree()
 	}
 }
 
+void StatementImpl::CursorClosed()
+{
+	ResultSetFree();
+	mCursorOpened = false;
+	mResultSetAvailable = false;
+}
+
 StatementImpl::StatementImpl(DatabaseImpl* database, TransactionImpl* transaction)
 	: mRefCount(0), mHandle(0), mDatabase(0), mTransaction(0),
 	mInRow(0), mOutRow(0),
-	mResultSetAvailable(false), mCursorOpened(false), mType(IBPP::stUnknown)
+	mResultSetAvailable(false), mCursorOpened(false), mType(IBPP::stUnknown),
+	mResultSet(0), mResultScrollable(false), mResultMeta(0), mBatchRows(0),
+	mTimeout(0), mPrepareTime(0), mCountPages(false)
 {
+	ClearMetrics();
 	AttachDatabaseImpl(database);
 	if (transaction != 0) AttachTransactionImpl(transaction);
 }
@@ -1292,3 +2347,342 @@ StatementImpl::~StatementImpl()
 		catch (...) { }
 }
 
+//	(((((((( COLUMN BATCH IMPLEMENTATION ))))))))
+
+void IBPP::ColumnBatch::Clear()
+{
+	mColumns.clear();
+	mRows = 0;
+	mDatabase.clear();
+	mTransaction.clear();
+}
+
+void IBPP::ColumnBatch::Reset(const std::vector<Column>& layout, int rows)
+{
+	mColumns.resize(layout.size());
+	for (size_t i = 0; i < mColumns.size(); i++)
+	{
+		Column& column = mColumns[i];
+		column.sqltype = layout[i].sqltype;
+		column.scale = layout[i].scale;
+		column.size = layout[i].size;
+		column.data.clear();
+		column.offsets.clear();
+		column.nulls.clear();
+		if (column.size != 0)
+			column.data.reserve((size_t)column.size * rows);
+		else
+			column.offsets.reserve(rows);
+		column.nulls.reserve(rows);
+	}
+	mRows = 0;
+}
+
+// Fixed size values keep their slot even when NULL, it is zero-filled
+void IBPP::ColumnBatch::AddValue(int col, const char* data, int length)
+{
+	Column& column = mColumns[col-1];
+	column.nulls.push_back(data == 0);
+	if (column.size != 0)
+	{
+		if (data == 0)
+			column.data.resize(column.data.size() + column.size, 0);
+		else
+			column.data.insert(column.data.end(), data, data + column.size);
+	}
+	else
+	{
+		column.offsets.push_back((int)column.data.size());
+		if (data != 0)
+			column.data.insert(column.data.end(), data, data + length);
+	}
+}
+
+// Returns 0 when the value is SQL NULL
+const char* IBPP::ColumnBatch::GetData(int row, int col,
+	const Column*& column, int& length) const
+{
+	if (col < 1 || col > (int)mColumns.size())
+		throw LogicExceptionImpl("ColumnBatch::Get", _("Variable index out of range."));
+	if (row < 0 || row >= mRows)
+		throw LogicExceptionImpl("ColumnBatch::Get", _("Row index out of range."));
+
+	column = &mColumns[col-1];
+	if (column->nulls[row]) return 0;
+
+	if (column->size != 0)
+	{
+		length = column->size;
+		return &column->data[(size_t)column->size * row];
+	}
+
+	int start = column->offsets[row];
+	int end = (row + 1 < mRows) ? column->offsets[row+1] : (int)column->data.size();
+	length = end - start;
+	return length == 0 ? "" : &column->data[start];
+}
+
+bool IBPP::ColumnBatch::IsNull(int row, int col) const
+{
+	const Column* column;
+	int length;
+	return GetData(row, col, column, length) == 0;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, bool& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	switch (column->sqltype)
+	{
+		case SQL_BOOLEAN :	value = (*data != 0); break;
+		case SQL_TEXT :
+		case SQL_VARYING :
+			value = (length >= 1 && (*data == 't' || *data == 'T' ||
+				*data == 'y' || *data == 'Y' || *data == '1'));
+			break;
+		case SQL_SHORT :	value = (BatchValue<int16_t>(data) != 0); break;
+		case SQL_LONG :		value = (BatchValue<int32_t>(data) != 0); break;
+		case SQL_INT64 :	value = (BatchValue<int64_t>(data) != 0); break;
+		default : throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivBool,
+						_("Incompatible types."));
+	}
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, const char*& value, int& length) const
+{
+	const Column* column;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_TEXT && column->sqltype != SQL_VARYING)
+		throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivByte,
+			_("Incompatible types."));
+	value = data;
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, std::string& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype == SQL_TEXT || column->sqltype == SQL_VARYING)
+		value.assign(data, length);
+	else if (column->sqltype == SQL_BLOB)
+	{
+		BlobImpl blob(dynamic_cast<DatabaseImpl*>(mDatabase.intf()),
+			dynamic_cast<TransactionImpl*>(mTransaction.intf()));
+		ISC_QUAD id = BatchValue<ISC_QUAD>(data);
+		blob.SetId(&id);
+		blob.Load(value);
+	}
+	else throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivString,
+			_("Incompatible types."));
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, int16_t& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	int64_t tmp;
+	switch (column->sqltype)
+	{
+		case SQL_SHORT :	value = BatchValue<int16_t>(data); return false;
+		case SQL_LONG :		tmp = BatchValue<int32_t>(data); break;
+		case SQL_INT64 :	tmp = BatchValue<int64_t>(data); break;
+		default : throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivInt16,
+						_("Incompatible types."));
+	}
+	if (tmp < consts::min16 || tmp > consts::max16)
+		throw LogicExceptionImpl("ColumnBatch::Get",
+			_("Out of range numeric conversion !"));
+	value = (int16_t)tmp;
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, int32_t& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	int64_t tmp;
+	switch (column->sqltype)
+	{
+		case SQL_SHORT :	value = BatchValue<int16_t>(data); return false;
+		case SQL_LONG :		value = BatchValue<int32_t>(data); return false;
+		case SQL_INT64 :	tmp = BatchValue<int64_t>(data); break;
+		default : throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivInt32,
+						_("Incompatible types."));
+	}
+	if (tmp < consts::min32 || tmp > consts::max32)
+		throw LogicExceptionImpl("ColumnBatch::Get",
+			_("Out of range numeric conversion !"));
+	value = (int32_t)tmp;
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, int64_t& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	switch (column->sqltype)
+	{
+		case SQL_SHORT :	value = BatchValue<int16_t>(data); break;
+		case SQL_LONG :		value = BatchValue<int32_t>(data); break;
+		case SQL_INT64 :	value = BatchValue<int64_t>(data); break;
+		default : throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivInt64,
+						_("Incompatible types."));
+	}
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, float& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	// SQL_SHORT, SQL_LONG and SQL_INT64 are NUMERIC(x,y), scale them !
+	double divisor = consts::dscales[-column->scale];
+	switch (column->sqltype)
+	{
+		case SQL_FLOAT :	value = BatchValue<float>(data); break;
+		case SQL_SHORT :	value = (float)(BatchValue<int16_t>(data) / divisor); break;
+		case SQL_LONG :		value = (float)(BatchValue<int32_t>(data) / divisor); break;
+		case SQL_INT64 :	value = (float)(BatchValue<int64_t>(data) / divisor); break;
+		default : throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivFloat,
+						_("Incompatible types."));
+	}
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, double& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	double divisor = consts::dscales[-column->scale];
+	switch (column->sqltype)
+	{
+		case SQL_DOUBLE :
+			value = BatchValue<double>(data);
+			// Round to scale y of NUMERIC(x,y)
+			if (column->scale < 0)
+				value = floor(value * divisor + 0.5) / divisor;
+			break;
+		case SQL_SHORT :	value = BatchValue<int16_t>(data) / divisor; break;
+		case SQL_LONG :		value = BatchValue<int32_t>(data) / divisor; break;
+		case SQL_INT64 :	value = BatchValue<int64_t>(data) / divisor; break;
+		default : throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivDouble,
+						_("Incompatible types."));
+	}
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, IBPP::Timestamp& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_TIMESTAMP)
+		throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivTimestamp,
+			_("Incompatible types."));
+	decodeTimestamp(value, BatchValue<ISC_TIMESTAMP>(data));
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, IBPP::Date& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_TYPE_DATE)
+		throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivDate,
+			_("Incompatible types."));
+	decodeDate(value, BatchValue<ISC_DATE>(data));
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, IBPP::Time& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_TYPE_TIME)
+		throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivTime,
+			_("Incompatible types."));
+	decodeTime(value, BatchValue<ISC_TIME>(data));
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, IBPP::DBKey& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_TEXT)
+		throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivDBKey,
+			_("Incompatible types."));
+	value.SetKey(data, length);
+	return false;
+}
+
+bool IBPP::ColumnBatch::Get(int row, int col, IBPP::Blob& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_BLOB)
+		throw WrongTypeImpl("ColumnBatch::Get", column->sqltype, ivBlob,
+			_("Incompatible types."));
+	BlobImpl* blob = dynamic_cast<BlobImpl*>(value.intf());
+	if (blob == 0)
+		throw LogicExceptionImpl("ColumnBatch::Get", _("The Blob has not been created."));
+	ISC_QUAD id = BatchValue<ISC_QUAD>(data);
+	blob->SetId(&id);
+	return false;
+}
+
+bool IBPP::ColumnBatch::GetBlobId(int row, int col, int64_t& value) const
+{
+	const Column* column;
+	int length;
+	const char* data = GetData(row, col, column, length);
+	if (data == 0) return true;
+
+	if (column->sqltype != SQL_BLOB)
+		throw WrongTypeImpl("ColumnBatch::GetBlobId", column->sqltype, ivBlob,
+			_("Incompatible types."));
+	ISC_QUAD id = BatchValue<ISC_QUAD>(data);
+	memcpy(&value, &id, sizeof(value));
+	return false;
+}
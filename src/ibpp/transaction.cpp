@@ -63,6 +63,7 @@ void TransactionImpl::AddReservation(IBPP::Database db,
                 _("Can't add table reservation on an unbound Database."));
 
     // Find the TPB associated with this database
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     std::vector<DatabaseImpl*>::iterator pos =
         std::find(mDatabases.begin(), mDatabases.end(), dynamic_cast<DatabaseImpl*>(db.intf()));
     if (pos != mDatabases.end())
@@ -106,6 +107,8 @@ void TransactionImpl::Start()
 {
     if (mHandle != 0) return;   // Already started anyway
 
+    // The tables can't change while the TEBs point into them
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     if (mDatabases.empty())
         throw LogicExceptionImpl("Transaction::Start", _("No Database is attached."));
 
@@ -153,11 +156,7 @@ void TransactionImpl::Commit()
         throw SQLExceptionImpl(status, "Transaction::Commit");
     mHandle = 0;    // Should be, better be sure
 
-    /*
-    size_t i;
-    for (i = mStatements.size(); i != 0; i--)
-        mStatements[i-1]->CursorFree();
-    */
+    CursorsClosed();
 }
 
 void TransactionImpl::CommitRetain()
@@ -183,11 +182,7 @@ void TransactionImpl::Rollback()
         throw SQLExceptionImpl(status, "Transaction::Rollback");
     mHandle = 0;    // Should be, better be sure
 
-    /*
-    size_t i;
-    for (i = mStatements.size(); i != 0; i--)
-        mStatements[i-1]->CursorFree();
-    */
+    CursorsClosed();
 }
 
 void TransactionImpl::RollbackRetain()
@@ -213,8 +208,8 @@ void TransactionImpl::Release()
 {
     // Release cannot throw, except in DEBUG builds on assertion
     ASSERTION(mRefCount >= 0);
-    --mRefCount;
-    try { if (mRefCount <= 0) delete this; }
+    int refs = --mRefCount;
+    try { if (refs <= 0) delete this; }
         catch (...) { }
 }
 
@@ -230,12 +225,26 @@ void TransactionImpl::Init()
     mArrays.clear();
 }
 
+// The server closes the cursors when the transaction ends, the statements
+// stay prepared and can be executed again when the transaction is restarted
+void TransactionImpl::CursorsClosed()
+{
+    std::vector<StatementImpl*> statements;
+    {
+        std::lock_guard<std::mutex> guard(mObjectsMutex);
+        statements = mStatements;
+    }
+    for (size_t i = 0; i < statements.size(); i++)
+        statements[i]->CursorClosed();
+}
+
 void TransactionImpl::AttachStatementImpl(StatementImpl* st)
 {
     if (st == 0)
         throw LogicExceptionImpl("Transaction::AttachStatement",
                     _("Can't attach a 0 Statement object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mStatements.push_back(st);
 }
 
@@ -245,6 +254,7 @@ void TransactionImpl::DetachStatementImpl(StatementImpl* st)
         throw LogicExceptionImpl("Transaction::DetachStatement",
                 _("Can't detach a 0 Statement object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mStatements.erase(std::find(mStatements.begin(), mStatements.end(), st));
 }
 
@@ -254,6 +264,7 @@ void TransactionImpl::AttachBlobImpl(BlobImpl* bb)
         throw LogicExceptionImpl("Transaction::AttachBlob",
                     _("Can't attach a 0 BlobImpl object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mBlobs.push_back(bb);
 }
 
@@ -263,6 +274,7 @@ void TransactionImpl::DetachBlobImpl(BlobImpl* bb)
         throw LogicExceptionImpl("Transaction::DetachBlob",
                 _("Can't detach a 0 BlobImpl object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mBlobs.erase(std::find(mBlobs.begin(), mBlobs.end(), bb));
 }
 
@@ -272,6 +284,7 @@ void TransactionImpl::AttachArrayImpl(ArrayImpl* ar)
         throw LogicExceptionImpl("Transaction::AttachArray",
                     _("Can't attach a 0 ArrayImpl object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mArrays.push_back(ar);
 }
 
@@ -281,6 +294,7 @@ void TransactionImpl::DetachArrayImpl(ArrayImpl* ar)
         throw LogicExceptionImpl("Transaction::DetachArray",
                 _("Can't detach a 0 ArrayImpl object."));
 
+    std::lock_guard<std::mutex> guard(mObjectsMutex);
     mArrays.erase(std::find(mArrays.begin(), mArrays.end(), ar));
 }
 
@@ -294,8 +308,6 @@ void TransactionImpl::AttachDatabaseImpl(DatabaseImpl* dbi,
         throw LogicExceptionImpl("Transaction::AttachDatabase",
                 _("Can't attach a null Database."));
 
-    mDatabases.push_back(dbi);
-
     // Prepare a new TPB
     TPB* tpb = new TPB;
     if (am == IBPP::amRead) tpb->Insert(isc_tpb_read);
@@ -318,7 +330,11 @@ void TransactionImpl::AttachDatabaseImpl(DatabaseImpl* dbi,
     if (flags & IBPP::tfAutoCommit)     tpb->Insert(isc_tpb_autocommit);
     if (flags & IBPP::tfNoAutoUndo)     tpb->Insert(isc_tpb_no_auto_undo);
 
-    mTPBs.push_back(tpb);
+    {
+        std::lock_guard<std::mutex> guard(mObjectsMutex);
+        mDatabases.push_back(dbi);
+        mTPBs.push_back(tpb);
+    }
 
     // Signals the Database object that it has been attached to the Transaction
     dbi->AttachTransactionImpl(this);
@@ -333,16 +349,20 @@ void TransactionImpl::DetachDatabaseImpl(DatabaseImpl* dbi)
         throw LogicExceptionImpl("Transaction::DetachDatabase",
                 _("Can't detach a null Database."));
 
-    std::vector<DatabaseImpl*>::iterator pos =
-        std::find(mDatabases.begin(), mDatabases.end(), dbi);
-    if (pos != mDatabases.end())
+    TPB* tpb = 0;
     {
-        size_t index = pos - mDatabases.begin();
-        TPB* tpb = mTPBs[index];
-        mDatabases.erase(pos);
-        mTPBs.erase(mTPBs.begin()+index);
-        delete tpb;
+        std::lock_guard<std::mutex> guard(mObjectsMutex);
+        std::vector<DatabaseImpl*>::iterator pos =
+            std::find(mDatabases.begin(), mDatabases.end(), dbi);
+        if (pos != mDatabases.end())
+        {
+            size_t index = pos - mDatabases.begin();
+            tpb = mTPBs[index];
+            mDatabases.erase(pos);
+            mTPBs.erase(mTPBs.begin()+index);
+        }
     }
+    delete tpb;
 
     // Signals the Database object that it has been detached from the Transaction
     dbi->DetachTransactionImpl(this);
@@ -371,34 +391,33 @@ TransactionImpl::~TransactionImpl()
     // And during the deletion, there is a packing of the array through a
     // copy of elements from the end to the beginning of the array.
     try {
-        while (mBlobs.size() > 0)
-            mBlobs.back()->DetachTransactionImpl();
+        while (BlobImpl* obj = LastObject(mBlobs))
+            obj->DetachTransactionImpl();
     } catch (...) { }
 
     // Let's detach cleanly all Arrays from this Transaction.
     // No Array object can still maintain pointers to this
     // Transaction which is disappearing.
     try {
-        while (mArrays.size() > 0)
-            mArrays.back()->DetachTransactionImpl();
+        while (ArrayImpl* obj = LastObject(mArrays))
+            obj->DetachTransactionImpl();
     } catch (...) { }
 
     // Let's detach cleanly all Statements from this Transaction.
     // No Statement object can still maintain pointers to this
     // Transaction which is disappearing.
     try {
-        while (mStatements.size() > 0)
-            mStatements.back()->DetachTransactionImpl();
+        while (StatementImpl* obj = LastObject(mStatements))
+            obj->DetachTransactionImpl();
     } catch (...) { }
 
     // Very important : let's detach cleanly all Databases from this
     // Transaction. No Database object can still maintain pointers to this
     // Transaction which is disappearing.
     try {
-        while (mDatabases.size() > 0)
+        while (DatabaseImpl* dbi = LastObject(mDatabases))
         {
-            size_t i = mDatabases.size()-1;
-            DetachDatabaseImpl(mDatabases[i]);  // <-- remove link to database from mTPBs
+            DetachDatabaseImpl(dbi);        // <-- remove link to database from mTPBs
                                             // array and destroy TPB object
                                             // Fixed : Maxim Abrashkin on 12 Jun 2002
             //mDatabases.back()->DetachTransaction(this);
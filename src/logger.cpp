@@ -35,6 +35,7 @@
 
 #include "config/DatabaseConfig.h"
 #include "core/StringUtils.h"
+#include "engine/MetadataLoader.h"
 #include "frversion.h"
 #include "gui/AdvancedMessageDialog.h"
 #include "logger.h"
@@ -45,11 +46,12 @@ bool Logger::log2database(Config *cfg, const SqlStatement& stm, Database* db)
 {
     wxMBConv* conv = db->getCharsetConverter();
 
-    IBPP::Transaction tr = IBPP::TransactionFactory(db->getIBPPDatabase());
+    // the transaction object and the statements are kept for the next call
+    IBPP::Transaction& tr = db->getLogTransaction();
+    StatementCache* cache = db->getStatementCache();
     try
     {
         tr->Start();
-        IBPP::Statement st = IBPP::StatementFactory(db->getIBPPDatabase(), tr);
 
         // find next id
         wxString sql = "SELECT gen_id(FLAMEROBIN$LOG_GEN, 1) FROM rdb$database";
@@ -58,13 +60,14 @@ bool Logger::log2database(Config *cfg, const SqlStatement& stm, Database* db)
             sql = cfg->get("LoggingCustomSelect",
                 wxString("SELECT 1+MAX(ID) FROM FLAMEROBIN$LOG"));
         }
-        st->Prepare(wx2std(sql, conv));
-        st->Execute();
+        IBPP::Statement& sel = cache->getStatement(tr, wx2std(sql, conv));
+        sel->Execute();
         int cnt = 1;
-        if (st->Fetch() && !st->IsNull(1))
-            st->Get(1, cnt);
+        if (sel->Fetch() && !sel->IsNull(1))
+            sel->Get(1, cnt);
 
-        st->Prepare("INSERT INTO FLAMEROBIN$LOG (id, object_type, \
+        IBPP::Statement& st = cache->getStatement(tr,
+            "INSERT INTO FLAMEROBIN$LOG (id, object_type, \
             object_name, sql_statement) values (?,?,?,?)");
         st->Set(1, cnt);
         if (stm.isDDL())
@@ -94,6 +97,14 @@ bool Logger::log2database(Config *cfg, const SqlStatement& stm, Database* db)
         showWarningDialog(0, _("Logging to database failed"),
             _("Unexpected C++ exception"), AdvancedMessageDialogButtonsOk());
     }
+    // the transaction object is reused, so it isn't rolled back on deletion
+    try
+    {
+        tr->Rollback();
+    }
+    catch (IBPP::Exception&)
+    {
+    }
     return false;
 }
 
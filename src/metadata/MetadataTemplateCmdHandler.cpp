@@ -33,6 +33,7 @@
 #include "core/ProcessableObject.h"
 #include "core/StringUtils.h"
 #include "core/TemplateProcessor.h"
+#include "engine/MetadataLoader.h"
 #include "metadata/CreateDDLVisitor.h"
 #include "metadata/column.h"
 #include "metadata/database.h"
@@ -758,6 +759,21 @@ void MetadataTemplateCmdHandler::handleTemplateCmd(TemplateProcessor *tp,
             processedText += wxString() << db->getInfo().getOldestSnapshot();
         else if (cmdParams[0] == "next_transaction")
             processedText += wxString() << db->getInfo().getNextTransaction();
+        else if (cmdParams[0] == "statement_cache_size")
+        {
+            StatementCache* sc = db->getStatementCache();
+            processedText += wxString::Format("%u / %u", sc->getSize(),
+                sc->getMaximumSize());
+        }
+        else if (cmdParams[0] == "statement_cache_hits")
+            processedText += wxString() << db->getStatementCache()->getHits();
+        else if (cmdParams[0] == "statement_cache_misses")
+            processedText += wxString() << db->getStatementCache()->getMisses();
+        else if (cmdParams[0] == "statement_cache_evictions")
+        {
+            processedText += wxString()
+                << db->getStatementCache()->getEvictions();
+        }
         else if (cmdParams[0] == "connected_users")
         {
             wxArrayString users;
@@ -32,6 +32,7 @@
 
 #include <wx/encconv.h>
 #include <wx/fontmap.h>
+#include <wx/stopwatch.h>
 
 #include <algorithm>
 #include <functional>
@@ -311,7 +312,8 @@ bool DatabaseAuthenticationMode::getUseEncryptedPassword() const
 
 // Database class
 Database::Database()
-    : MetadataItem(ntDatabase), metadataLoaderM(0), connectedM(false),
+    : MetadataItem(ntDatabase), metadataLoaderM(0), statementCacheM(0),
+        connectedM(false), executingStatementsM(0),
         connectionCredentialsM(0), charsetConverterM(0), dialectM(3), idM(0)
 {
 }
@@ -911,15 +913,21 @@ void Database::create(int pagesize, int dialect)
 
 void Database::drop()
 {
+    checkNotExecuting();
     databaseM->Drop();
     setDisconnected();
 }
 
 void Database::reconnect()
 {
+    checkNotExecuting();
     // must recreate, because IBPP::Database member will become invalid
     delete metadataLoaderM;
     metadataLoaderM = 0;
+    // the statements and transactions are detached from the database
+    if (statementCacheM)
+        statementCacheM->clear();
+    logTransactionM.clear();
 
     databaseM->Disconnect();
     databaseM->Connect();
@@ -1018,6 +1026,7 @@ void Database::connect(const wxString& password, ProgressIndicator* indicator)
             (useUserNamePwd ? wx2std(getUsername()) : ""),
             (useUserNamePwd ? wx2std(password) : ""),
             wx2std(getRole()), wx2std(getConnectionCharset()), "");
+        db->SetProfile(getConnectionProfile());
 
         if (indicator)
         {
@@ -1116,6 +1125,8 @@ void Database::connect(const wxString& password, ProgressIndicator* indicator)
                 dialectM = databaseM->Dialect();
                 databaseInfoM.load(databaseM);
                 setPropertiesLoaded(true);
+                applyTimeouts();
+                applyClientInterface();
 
                 // load collections of metadata objects
                 setChildrenLoaded(false);
@@ -1236,6 +1247,7 @@ wxArrayString Database::loadIdentifiers(const wxString& loadStatement,
 
 void Database::disconnect()
 {
+    checkNotExecuting();
     if (connectedM)
     {
         databaseM->Disconnect();
@@ -1243,10 +1255,37 @@ void Database::disconnect()
     }
 }
 
+void Database::beginExecution()
+{
+    ++executingStatementsM;
+}
+
+void Database::endExecution()
+{
+    wxASSERT(executingStatementsM > 0);
+    --executingStatementsM;
+}
+
+bool Database::isExecuting() const
+{
+    return executingStatementsM > 0;
+}
+
+void Database::checkNotExecuting() const
+{
+    if (executingStatementsM)
+    {
+        throw FRError(_("A statement is being executed.\nCancel the execution first."));
+    }
+}
+
 void Database::setDisconnected()
 {
     delete metadataLoaderM;
     metadataLoaderM = 0;
+    delete statementCacheM;
+    statementCacheM = 0;
+    logTransactionM.clear();
     resetCredentials();     // "forget" temporary username/password
     connectedM = false;
     resetPendingLoadData();
@@ -1277,10 +1316,27 @@ bool Database::isConnected() const
 MetadataLoader* Database::getMetadataLoader()
 {
     if (metadataLoaderM == 0)
-        metadataLoaderM = new MetadataLoader(*this, 8);
+        metadataLoaderM = new MetadataLoader(*this);
     return metadataLoaderM;
 }
 
+StatementCache* Database::getStatementCache()
+{
+    if (statementCacheM == 0)
+    {
+        statementCacheM = new StatementCache(databaseM,
+            getStatementCacheSize());
+    }
+    return statementCacheM;
+}
+
+IBPP::Transaction& Database::getLogTransaction()
+{
+    if (logTransactionM == 0)
+        logTransactionM = IBPP::TransactionFactory(databaseM);
+    return logTransactionM;
+}
+
 bool Database::getChildren(std::vector<MetadataItem*>& temp)
 {
     if (!connectedM)
@@ -1722,6 +1778,155 @@ bool Database::showSystemTables()
     return b;
 }
 
+void Database::applyTimeouts()
+{
+    // Firebird 4 and later
+    if (!databaseInfoM.getODSVersionIsHigherOrEqualTo(13, 0))
+        return;
+
+    DatabaseConfig dc(this, config());
+    unsigned millis = unsigned(std::max(0, dc.get("StatementTimeout", 0))) * 1000;
+    if (millis != databaseM->StatementTimeout())
+        databaseM->SetStatementTimeout(millis);
+    unsigned seconds = unsigned(std::max(0, dc.get("IdleSessionTimeout", 0))) * 60;
+    if (seconds != databaseM->IdleTimeout())
+        databaseM->SetIdleTimeout(seconds);
+}
+
+unsigned Database::getStatementCacheSize()
+{
+    DatabaseConfig dc(this, config());
+    return unsigned(std::max(8, dc.get("StatementCacheSize", 32)));
+}
+
+void Database::applyStatementCacheSize()
+{
+    if (statementCacheM != 0)
+        statementCacheM->setMaximumSize(getStatementCacheSize());
+}
+
+void Database::applyClientInterface()
+{
+    DatabaseConfig dc(this, config());
+    databaseM->SetClientInterface(dc.get("UseObjectInterface", false)
+        ? IBPP::ciObject : IBPP::ciLegacy);
+}
+
+IBPP::ConnectionProfile Database::getConnectionProfile() const
+{
+    DatabaseConfig dc(this, config());
+    IBPP::ConnectionProfile profile;
+    profile.wireCompression = dc.get("WireCompression", false);
+    int crypt = dc.get("WireCrypt", 0);
+    if (crypt >= IBPP::wcDefault && crypt <= IBPP::wcRequired)
+        profile.wireCrypt = IBPP::WCL(crypt);
+    profile.pageBuffers = std::max(0, dc.get("PageBuffers", 0));
+    return profile;
+}
+
+/*static*/
+wxString Database::getConnectionProfileDescription(
+    const IBPP::ConnectionProfile& profile)
+{
+    wxString s(profile.wireCompression ? _("compression") : _("no compression"));
+    switch (profile.wireCrypt)
+    {
+        case IBPP::wcDisabled:
+            s += _(", encryption disabled");
+            break;
+        case IBPP::wcEnabled:
+            s += _(", encryption enabled");
+            break;
+        case IBPP::wcRequired:
+            s += _(", encryption required");
+            break;
+        default:
+            break;
+    }
+    if (profile.pageBuffers > 0)
+        s += wxString::Format(_(", %d page buffers"), profile.pageBuffers);
+    return s;
+}
+
+void Database::compareConnectionProfiles(const wxString& sql,
+    std::vector<ConnectionProfileTiming>& timings,
+    ProgressIndicator* indicator)
+{
+    checkConnected(_("compareConnectionProfiles"));
+
+    // the first run of each profile warms up the page cache of the server
+    // and the connection, only the faster of the two runs counts
+    const int runs = 2;
+    if (indicator)
+    {
+        indicator->doShow();
+        indicator->initProgress(_("Comparing connection profiles..."),
+            timings.size() * runs);
+    }
+    std::string stmt(wx2std(sql, getCharsetConverter()));
+
+    std::vector<ConnectionProfileTiming>::iterator it;
+    for (it = timings.begin(); it != timings.end(); ++it)
+    {
+        it->connectMillis = it->fetchMillis = -1;
+        it->rows = 0;
+        it->error.clear();
+        for (int run = 0; run < runs && it->error.empty(); ++run)
+        {
+            checkProgressIndicatorCanceled(indicator);
+            if (indicator)
+            {
+                indicator->setProgressMessage(
+                    getConnectionProfileDescription(it->profile));
+            }
+            try
+            {
+                IBPP::Database db = IBPP::DatabaseFactory(
+                    databaseM->ServerName(), databaseM->DatabaseName(),
+                    databaseM->Username(), databaseM->UserPassword(),
+                    databaseM->RoleName(), databaseM->CharSet(), "");
+                db->SetProfile(it->profile);
+
+                wxStopWatch sw;
+                db->Connect();
+                long connectMillis = sw.Time();
+
+                IBPP::Transaction tr = IBPP::TransactionFactory(db,
+                    IBPP::amRead);
+                tr->Start();
+                IBPP::Statement st = IBPP::StatementFactory(db, tr);
+                sw.Start();
+                st->Prepare(stmt);
+                if (st->Type() != IBPP::stSelect)
+                    throw FRError(_("Only SELECT statements can be compared."));
+                st->Execute();
+                int rows = 0;
+                while (st->Fetch())
+                {
+                    if (++rows % 1000 == 0)
+                        checkProgressIndicatorCanceled(indicator);
+                }
+                long fetchMillis = sw.Time();
+                tr->Rollback();
+                db->Disconnect();
+
+                if (it->fetchMillis < 0 || fetchMillis < it->fetchMillis)
+                {
+                    it->fetchMillis = fetchMillis;
+                    it->connectMillis = connectMillis;
+                    it->rows = rows;
+                }
+            }
+            catch (IBPP::Exception& e)
+            {
+                it->error = e.what();
+            }
+            if (indicator)
+                indicator->stepProgress();
+        }
+    }
+}
+
 wxString mapConnectionCharsetToSystemCharset(const wxString& connectionCharset)
 {
     wxString charset(connectionCharset.Upper().Trim(true).Trim(false));
@@ -27,6 +27,7 @@
 #include <wx/strconv.h>
 
 #include <map>
+#include <vector>
 
 #include <ibpp.h>
 
@@ -34,6 +35,7 @@
 #include "metadata/metadataitem.h"
 
 class MetadataLoader;
+class StatementCache;
 class ProgressIndicator;
 class SqlStatement;
 
@@ -141,6 +143,17 @@ private:
     Mode modeM;
 };
 
+// result of running a statement with a connection profile, see
+// Database::compareConnectionProfiles()
+struct ConnectionProfileTiming
+{
+    IBPP::ConnectionProfile profile;
+    long connectMillis;
+    long fetchMillis;
+    int rows;
+    wxString error;     // empty if the run succeeded
+};
+
 class Database: public MetadataItem,
     public std::enable_shared_from_this<Database>
 {
@@ -148,8 +161,11 @@ private:
     ServerWeakPtr serverM;
     IBPP::Database databaseM;
     MetadataLoader* metadataLoaderM;
+    StatementCache* statementCacheM;
+    IBPP::Transaction logTransactionM;
 
     bool connectedM;
+    unsigned executingStatementsM;
     wxString databaseCharsetM;
     wxString connectionUserM;
     wxString connectionRoleM;
@@ -198,6 +214,10 @@ private:
     bool showSystemTables();
 
     inline void checkConnected(const wxString& operation) const;
+    void checkNotExecuting() const;
+
+    // size of the statement cache of the database preferences
+    unsigned getStatementCacheSize();
 protected:
     virtual void loadChildren();
     virtual void lockChildren();
@@ -227,12 +247,39 @@ public:
     void create(int pagesize, int dialect);
     void connect(const wxString& password, ProgressIndicator* indicator = 0);
     void disconnect();
+    // statements are executed in worker threads while the GUI stays usable,
+    // the database can't be disconnected, reconnected or dropped meanwhile
+    void beginExecution();
+    void endExecution();
+    bool isExecuting() const;
+    // sets the statement and idle timeouts of the database preferences
+    void applyTimeouts();
+    // sets the size of the statement cache of the database preferences
+    void applyStatementCacheSize();
+    // selects the client library interface of the database preferences
+    void applyClientInterface();
+    // wire compression, wire encryption and page buffers of the database
+    // preferences, they are requested when connecting
+    IBPP::ConnectionProfile getConnectionProfile() const;
+    static wxString getConnectionProfileDescription(
+        const IBPP::ConnectionProfile& profile);
+    // runs the select statement on a new attachment for each of the
+    // profiles and fetches all rows, the best of two runs is kept
+    void compareConnectionProfiles(const wxString& sql,
+        std::vector<ConnectionProfileTiming>& timings,
+        ProgressIndicator* indicator = 0);
     void reconnect();
     void prepareTemporaryCredentials();
     void resetCredentials();
     void drop();
 
     MetadataLoader* getMetadataLoader();
+    // prepared statements of the connection, shared by the metadata loader,
+    // the data grid and the logger
+    StatementCache* getStatementCache();
+    // transaction object reused by the logger, so that its statements
+    // stay prepared in the statement cache
+    IBPP::Transaction& getLogTransaction();
 
     wxArrayString loadIdentifiers(const wxString& loadStatement,
         ProgressIndicator* progressIndicator = 0);
@@ -48,7 +48,7 @@ bool SelectStatement::isValidSelectStatement()
 void SelectStatement::setStatement(const wxString& sql)
 {
     sqlM = sql;
-    posSelectM = posFromM = posFromEndM = -1;
+    posSelectM = posFromM = posFromEndM = posWhereM = -1;
     tokenizerM.setStatement(sql);
 
     // find SELECT and FROM position
@@ -71,6 +71,8 @@ void SelectStatement::setStatement(const wxString& sql)
                 posSelectM = tokenizerM.getCurrentTokenPosition();
             if (posSelectM != -1 && stt == kwFROM)
                 posFromM = tokenizerM.getCurrentTokenPosition();
+            if (posFromM != -1 && posWhereM == -1 && stt == kwWHERE)
+                posWhereM = tokenizerM.getCurrentTokenPosition();
             if (posFromM != -1 && (stt == kwWHERE || stt == kwGROUP
                 || stt == kwORDER || stt == kwPLAN || stt == kwROWS))
             {
@@ -241,3 +243,101 @@ void SelectStatement::orderBy(int column)
     }
 }
 
+
+// covers only statements of the form SELECT ... FROM table [WHERE ...]
+// [ORDER BY ...], which is what the "browse data" templates create
+bool SelectStatement::canFetchInPages(bool& hasOrderBy)
+{
+    hasOrderBy = false;
+    if (!isValidSelectStatement())
+        return false;
+
+    tokenizerM.setStatement(sqlM);
+    int paren = 0;
+    bool first = true;
+    do
+    {
+        SqlTokenType stt = tokenizerM.getCurrentToken();
+        if (stt == tkEOF)
+            break;
+        if (stt == tkWHITESPACE || stt == tkCOMMENT)
+            continue;
+        // common table expressions and the like
+        if (first && stt != kwSELECT)
+            return false;
+        first = false;
+
+        // nested select statements don't matter
+        if (stt == tkPARENOPEN)
+            paren++;
+        if (stt == tkPARENCLOSE && paren > 0)
+            paren--;
+        if (paren > 0 || stt == tkPARENCLOSE)
+            continue;
+
+        switch (stt)
+        {
+            // these can't be combined with the clauses added for paging
+            case kwDISTINCT:
+            case kwFIRST:
+            case kwSKIP:
+            case kwROWS:
+            case kwFETCH:
+            case kwGROUP:
+            case kwHAVING:
+            case kwPLAN:
+            case kwUNION:
+            case kwFOR:
+            case kwWITH:
+            case kwINTO:
+            case kwJOIN:
+            case tkTERM:
+                return false;
+            case tkCOMMA:
+                // more than one table in the FROM clause
+                if (tokenizerM.getCurrentTokenPosition() > posFromM)
+                    return false;
+                break;
+            case tkIDENTIFIER:
+                // OFFSET ... FETCH isn't a keyword for the tokenizer
+                if (tokenizerM.getCurrentTokenString().Upper() == "OFFSET")
+                    return false;
+                break;
+            case kwORDER:
+                hasOrderBy = true;
+                break;
+            default:
+                break;
+        }
+    }
+    while (tokenizerM.nextToken());
+    return true;
+}
+
+// adds the condition to the WHERE clause, which needs to be the last one
+wxString SelectStatement::getPageStatement(const wxString& keyCondition,
+    const wxString& keyOrder, unsigned rows)
+{
+    wxString eol(wxTextBuffer::GetEOL());
+    wxString s(sqlM);
+    if (!keyCondition.empty())
+    {
+        // the statement could end with a comment, so start a new line
+        if (posWhereM == -1)
+            s += eol + "WHERE " + keyCondition;
+        else
+        {
+            s = sqlM.Left(posWhereM + 5) + " (" + sqlM.Mid(posWhereM + 5)
+                + eol + ") AND (" + keyCondition + ")";
+        }
+    }
+    s += eol + "ORDER BY " + keyOrder;
+    s += eol + wxString::Format("ROWS %u", rows);
+    return s;
+}
+
+wxString SelectStatement::getPageStatement(unsigned first, unsigned last)
+{
+    return sqlM + wxTextBuffer::GetEOL()
+        + wxString::Format("ROWS %u TO %u", first, last);
+}
@@ -37,7 +37,7 @@ class SelectStatement
 private:
     wxString sqlM;
     SqlTokenizer tokenizerM;
-    int posSelectM, posFromM, posFromEndM;
+    int posSelectM, posFromM, posFromEndM, posWhereM;
     void add(const wxString& toAdd, int position);
 
 public:
@@ -55,6 +55,15 @@ public:
     void addColumn(const wxString& columnList); // adds as-is currently
     
     void orderBy(int column);
+
+    // checks whether the statement reads from a single table and has
+    // nothing that prevents fetching the result set in pages
+    bool canFetchInPages(bool& hasOrderBy);
+    // statement for the first rows following the given key (keyset paging)
+    wxString getPageStatement(const wxString& keyCondition,
+        const wxString& keyOrder, unsigned rows);
+    // statement for the rows first to last of the result set
+    wxString getPageStatement(unsigned first, unsigned last);
 };
 
 #endif
@@ -0,0 +1,191 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for the conversions of IBPP::ColumnBatch
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <ibpp.h>
+#include <ibase.h>
+
+#include "Test.h"
+
+static IBPP::ColumnBatch::Column column(int sqltype, int scale, int size)
+{
+    IBPP::ColumnBatch::Column c;
+    c.sqltype = sqltype;
+    c.scale = scale;
+    c.size = size;
+    return c;
+}
+
+template<typename T>
+static void addValue(IBPP::ColumnBatch& batch, int col, T value)
+{
+    char data[sizeof(T)];
+    memcpy(data, &value, sizeof(T));
+    batch.AddValue(col, data, sizeof(T));
+}
+
+static void addText(IBPP::ColumnBatch& batch, int col, const char* text)
+{
+    batch.AddValue(col, text, text ? strlen(text) : 0);
+}
+
+static void testNumbers()
+{
+    // NUMERIC(9,2), NUMERIC(18,3), SMALLINT, DOUBLE PRECISION NUMERIC(15,2)
+    std::vector<IBPP::ColumnBatch::Column> layout;
+    layout.push_back(column(SQL_LONG, -2, 4));
+    layout.push_back(column(SQL_INT64, -3, 8));
+    layout.push_back(column(SQL_SHORT, 0, 2));
+    layout.push_back(column(SQL_DOUBLE, -2, 8));
+
+    IBPP::ColumnBatch batch;
+    batch.Reset(layout, 2);
+    addValue(batch, 1, int32_t(1234567));
+    addValue(batch, 2, int64_t(-5000000000LL));
+    addValue(batch, 3, int16_t(-7));
+    addValue(batch, 4, 1.23456);
+    batch.AddRow();
+    for (int col = 1; col <= 4; ++col)
+        batch.AddValue(col, 0, 0);
+    batch.AddRow();
+    FR_CHECK(batch.Rows() == 2 && batch.Columns() == 4);
+
+    double d;
+    FR_CHECK(!batch.Get(0, 1, d) && d == 12345.67);
+    FR_CHECK(!batch.Get(0, 2, d) && d == -5000000.0);
+    FR_CHECK(!batch.Get(0, 3, d) && d == -7.0);
+    // doubles are rounded to the scale
+    FR_CHECK(!batch.Get(0, 4, d) && d == 1.23);
+    float f;
+    FR_CHECK(!batch.Get(0, 1, f) && f == 12345.67f);
+
+    // integers are returned unscaled, within the range of the type
+    int64_t i64;
+    FR_CHECK(!batch.Get(0, 1, i64) && i64 == 1234567);
+    int32_t i32;
+    FR_CHECK(!batch.Get(0, 3, i32) && i32 == -7);
+    FR_CHECK_THROWS(batch.Get(0, 2, i32), IBPP::LogicException);
+    int16_t i16;
+    FR_CHECK_THROWS(batch.Get(0, 1, i16), IBPP::LogicException);
+    FR_CHECK_THROWS(batch.Get(0, 4, i64), IBPP::WrongType);
+    bool b;
+    FR_CHECK(!batch.Get(0, 3, b) && b);
+
+    // NULL values leave the target unchanged
+    for (int col = 1; col <= 4; ++col)
+        FR_CHECK(batch.IsNull(1, col) && !batch.IsNull(0, col));
+    d = 42.0;
+    FR_CHECK(batch.Get(1, 1, d) && d == 42.0);
+    i64 = 42;
+    FR_CHECK(batch.Get(1, 2, i64) && i64 == 42);
+}
+
+static void testText()
+{
+    // VARCHAR, CHAR(3) and BOOLEAN
+    std::vector<IBPP::ColumnBatch::Column> layout;
+    layout.push_back(column(SQL_VARYING, 0, 0));
+    layout.push_back(column(SQL_TEXT, 0, 3));
+    layout.push_back(column(SQL_BOOLEAN, 0, 1));
+
+    IBPP::ColumnBatch batch;
+    batch.Reset(layout, 1);
+    const char* values[] = { "first", "", 0, "last" };
+    const char* chars[] = { "abc", "Yes", "  1", 0 };
+    for (int row = 0; row < 4; ++row)
+    {
+        addText(batch, 1, values[row]);
+        addText(batch, 2, chars[row]);
+        if (row == 3)
+            batch.AddValue(3, 0, 0);
+        else
+            addValue(batch, 3, char(row % 2));
+        batch.AddRow();
+    }
+
+    std::string s;
+    for (int row = 0; row < 4; ++row)
+    {
+        s = "unchanged";
+        FR_CHECK(batch.Get(row, 1, s) == (values[row] == 0));
+        FR_CHECK(s == (values[row] ? values[row] : "unchanged"));
+    }
+    const char* data;
+    int length;
+    FR_CHECK(!batch.Get(1, 1, data, length) && length == 0);
+    FR_CHECK(!batch.Get(3, 1, data, length));
+    FR_CHECK(std::string(data, length) == "last");
+    FR_CHECK(!batch.Get(0, 2, s) && s == "abc");
+
+    // booleans from text look at the first character only
+    bool b;
+    FR_CHECK(!batch.Get(0, 2, b) && !b);
+    FR_CHECK(!batch.Get(1, 2, b) && b);
+    FR_CHECK(!batch.Get(2, 2, b) && !b);
+    FR_CHECK(!batch.Get(0, 3, b) && !b);
+    FR_CHECK(!batch.Get(1, 3, b) && b);
+    FR_CHECK(batch.Get(3, 3, b));
+
+    int32_t i32;
+    FR_CHECK_THROWS(batch.Get(0, 1, i32), IBPP::WrongType);
+    double d;
+    FR_CHECK_THROWS(batch.Get(0, 2, d), IBPP::WrongType);
+    FR_CHECK_THROWS(batch.Get(0, 3, data, length), IBPP::WrongType);
+}
+
+static void testReset()
+{
+    std::vector<IBPP::ColumnBatch::Column> layout;
+    layout.push_back(column(SQL_LONG, 0, 4));
+    IBPP::ColumnBatch batch;
+    batch.Reset(layout, 10);
+    addValue(batch, 1, int32_t(1));
+    batch.AddRow();
+
+    // the rows of the previous batch are gone
+    batch.Reset(layout, 10);
+    FR_CHECK(batch.Rows() == 0);
+    addValue(batch, 1, int32_t(2));
+    batch.AddRow();
+    int32_t i32;
+    FR_CHECK(!batch.Get(0, 1, i32) && i32 == 2);
+
+    FR_CHECK_THROWS(batch.Get(1, 1, i32), IBPP::LogicException);
+    FR_CHECK_THROWS(batch.Get(0, 0, i32), IBPP::LogicException);
+    FR_CHECK_THROWS(batch.Get(0, 2, i32), IBPP::LogicException);
+    batch.Clear();
+    FR_CHECK(batch.Rows() == 0 && batch.Columns() == 0);
+}
+
+int main()
+{
+    FR_RUN_TEST(testNumbers);
+    FR_RUN_TEST(testText);
+    FR_RUN_TEST(testReset);
+    return 0;
+}
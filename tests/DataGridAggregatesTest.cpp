@@ -0,0 +1,115 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for merging the aggregates of the data grid selection
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <vector>
+
+#include "gui/controls/DataGridAggregates.h"
+#include "Test.h"
+
+static DataGridSelectionChunkPtr createChunk(const std::vector<double>& values)
+{
+    DataGridSelectionChunkPtr chunk(new DataGridSelectionChunk());
+    chunk->values = values;
+    chunk->compute();
+    return chunk;
+}
+
+static void testChunk()
+{
+    double values[] = { 3, -1, 3, 7.5, -1, 0 };
+    DataGridSelectionChunkPtr chunk = createChunk(
+        std::vector<double>(values, values + 6));
+    FR_CHECK(chunk->computed && chunk->values.empty());
+    FR_CHECK(chunk->count == 6 && chunk->sum == 11.5);
+    FR_CHECK(chunk->min == -1 && chunk->max == 7.5);
+    double distinct[] = { -1, 0, 3, 7.5 };
+    FR_CHECK(chunk->distinct == std::vector<double>(distinct, distinct + 4));
+
+    DataGridSelectionChunkPtr empty = createChunk(std::vector<double>());
+    FR_CHECK(empty->computed && empty->count == 0);
+    FR_CHECK(empty->distinct.empty());
+}
+
+static void testMerge()
+{
+    // the values of chunk i are i .. i + 9, so neighbouring chunks overlap;
+    // an odd number of chunks leaves one unpaired in the merge rounds
+    for (int chunks = 1; chunks <= 9; ++chunks)
+    {
+        DataGridAggregates aggregates;
+        double sum = 0;
+        for (int i = 0; i < chunks; ++i)
+        {
+            std::vector<double> values;
+            for (int j = 0; j < 10; ++j)
+            {
+                values.push_back(i + j);
+                sum += i + j;
+            }
+            aggregates.add(createChunk(values));
+        }
+        FR_CHECK(aggregates.getCount() == unsigned(10 * chunks));
+        FR_CHECK(aggregates.getSum() == sum);
+        FR_CHECK(aggregates.getMin() == 0);
+        FR_CHECK(aggregates.getMax() == chunks + 8);
+        FR_CHECK(aggregates.countDistinct() == size_t(chunks + 9));
+    }
+}
+
+static void testEmptyChunks()
+{
+    // empty chunks (only NULLs selected) don't affect minimum and maximum
+    DataGridAggregates aggregates;
+    FR_CHECK(aggregates.getCount() == 0 && aggregates.countDistinct() == 0);
+    aggregates.add(createChunk(std::vector<double>()));
+    aggregates.add(createChunk(std::vector<double>(3, 5.0)));
+    aggregates.add(createChunk(std::vector<double>()));
+    aggregates.add(createChunk(std::vector<double>(2, -2.0)));
+    aggregates.add(createChunk(std::vector<double>()));
+    FR_CHECK(aggregates.getCount() == 5);
+    FR_CHECK(aggregates.getSum() == 11);
+    FR_CHECK(aggregates.getMin() == -2 && aggregates.getMax() == 5);
+    FR_CHECK(aggregates.countDistinct() == 2);
+
+    // negative values only, the minimum and maximum aren't 0
+    DataGridAggregates negative;
+    negative.add(createChunk(std::vector<double>(1, -3.0)));
+    negative.add(createChunk(std::vector<double>(1, -4.0)));
+    FR_CHECK(negative.getMin() == -4 && negative.getMax() == -3);
+}
+
+int main()
+{
+    FR_RUN_TEST(testChunk);
+    FR_RUN_TEST(testMerge);
+    FR_RUN_TEST(testEmptyChunks);
+    return 0;
+}
@@ -0,0 +1,254 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for DataGridColumnStore
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/FRError.h"
+#include "gui/controls/DataGridRowBuffer.h"
+#include "Test.h"
+
+static std::string getBytes(const DataGridColumnStore& store, unsigned row,
+    unsigned col)
+{
+    const char* data;
+    unsigned length;
+    if (!store.getBytes(row, col, data, length))
+        return "<none>";
+    return std::string(data, length);
+}
+
+static void setBytes(DataGridColumnStore& store, unsigned row, unsigned col,
+    const std::string& value)
+{
+    store.setBytes(row, col, value.data(), value.size());
+}
+
+// fills a store with an int, a double and a string column
+static void fillStore(DataGridColumnStore& store, unsigned rows)
+{
+    store.addColumn(sizeof(int));
+    store.addColumn(sizeof(double));
+    store.addColumn(0);
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        unsigned row = store.appendRow();
+        FR_CHECK(row == i);
+        // every third row stays NULL
+        if (i % 3 == 2)
+            continue;
+        store.setValue(row, 0, int(i));
+        store.setValue(row, 1, i / 4.0);
+        setBytes(store, row, 2, "row " + std::to_string(i));
+        for (unsigned col = 0; col < 3; ++col)
+            store.setFieldNull(row, col, false);
+    }
+}
+
+static void testValues()
+{
+    DataGridColumnStore store;
+    fillStore(store, 1000);
+    FR_CHECK(store.getColumnCount() == 3);
+    FR_CHECK(store.getRowCount() == 1000);
+    for (unsigned row = 0; row < 1000; ++row)
+    {
+        FR_CHECK(store.isFieldNull(row, 0) == (row % 3 == 2));
+        if (row % 3 == 2)
+        {
+            FR_CHECK(getBytes(store, row, 2) == "<none>");
+            continue;
+        }
+        int i;
+        double d;
+        FR_CHECK(store.getValue(row, 0, i) && i == int(row));
+        FR_CHECK(store.getValue(row, 1, d) && d == row / 4.0);
+        FR_CHECK(getBytes(store, row, 2) == "row " + std::to_string(row));
+    }
+
+    // values of the wrong size or outside of the store aren't returned
+    int64_t i64;
+    FR_CHECK(!store.getValue(0, 0, i64));
+    int i;
+    FR_CHECK(!store.getValue(0, 3, i));
+    FR_CHECK(!store.getValue(1000, 0, i));
+    FR_CHECK(!store.isFieldNull(1000, 0));
+}
+
+static void testLargeBytes()
+{
+    // values larger than a quarter arena block get a block of their own,
+    // they must not disturb the small values stored around them
+    DataGridColumnStore store;
+    store.addColumn(0);
+    std::string large(200 * 1024, 'x');
+    for (unsigned row = 0; row < 3; ++row)
+        store.appendRow();
+    setBytes(store, 0, 0, "small");
+    setBytes(store, 1, 0, large);
+    setBytes(store, 2, 0, "");
+    FR_CHECK(getBytes(store, 0, 0) == "small");
+    FR_CHECK(getBytes(store, 1, 0) == large);
+    FR_CHECK(getBytes(store, 2, 0) == "");
+    FR_CHECK(store.getMemoryUsage() >= large.size());
+}
+
+static void testFlags()
+{
+    DataGridColumnStore store;
+    store.addColumn(0);
+    store.addColumn(0);
+    unsigned row = store.appendRow();
+    // new rows have all fields NULL and no flags set
+    FR_CHECK(store.isFieldNull(row, 0) && store.isFieldNull(row, 1));
+    FR_CHECK(!store.isFieldNA(row, 0) && !store.isLoaded(row, 0));
+    FR_CHECK(!store.isRowInserted(row) && !store.isRowModified(row));
+    FR_CHECK(!store.isRowDeleted(row) && !store.isRowDeletableIsSet(row));
+
+    store.setFieldNA(row, 1, true);
+    store.setLoaded(row, 0, true);
+    FR_CHECK(!store.isFieldNA(row, 0) && store.isFieldNA(row, 1));
+    FR_CHECK(store.isLoaded(row, 0) && !store.isLoaded(row, 1));
+
+    store.setRowInserted(row, true);
+    store.setRowDeleted(row, true);
+    store.setRowDeletable(row, false);
+    FR_CHECK(store.isRowInserted(row) && !store.isRowModified(row));
+    FR_CHECK(store.isRowDeleted(row));
+    FR_CHECK(store.isRowDeletableIsSet(row) && !store.isRowDeletable(row));
+    store.setRowDeletable(row, true);
+    FR_CHECK(store.isRowDeletable(row));
+    store.invalidateRowDeletable(row);
+    FR_CHECK(!store.isRowDeletableIsSet(row) && !store.isRowDeletable(row));
+    FR_CHECK(store.isRowInserted(row) && store.isRowDeleted(row));
+
+    unsigned changes = store.getChangeCount();
+    store.setRowModified(row, true);
+    FR_CHECK(store.getChangeCount() != changes);
+}
+
+static void testRemoveLastRow()
+{
+    DataGridColumnStore store;
+    fillStore(store, 10);
+    store.setFieldNA(9, 2, true);
+    store.removeLastRow();
+    FR_CHECK(store.getRowCount() == 9);
+    FR_CHECK(!store.isFieldNA(9, 2));
+
+    // the appended row must not show data of the removed one
+    unsigned row = store.appendRow();
+    FR_CHECK(row == 9);
+    int i;
+    FR_CHECK(!store.getValue(row, 0, i));
+    FR_CHECK(getBytes(store, row, 2) == "<none>");
+    FR_CHECK(store.isFieldNull(row, 0) && !store.isFieldNA(row, 2));
+    FR_CHECK(getBytes(store, 7, 2) == "row 7");
+
+    DataGridColumnStore empty;
+    empty.removeLastRow();
+    FR_CHECK(empty.getRowCount() == 0);
+}
+
+static void testCopyRow()
+{
+    DataGridColumnStore source;
+    fillStore(source, 3);
+    source.setRowModified(0, true);
+    source.setLoaded(0, 2, true);
+
+    // columns are added to the destination as needed
+    DataGridColumnStore dest;
+    dest.appendRow();
+    dest.appendRow();
+    dest.copyRow(source, 0, 1);
+    FR_CHECK(dest.getColumnCount() == 3);
+    int i;
+    double d;
+    FR_CHECK(dest.getValue(1, 0, i) && i == 0);
+    FR_CHECK(dest.getValue(1, 1, d) && d == 0.0);
+    FR_CHECK(getBytes(dest, 1, 2) == "row 0");
+    FR_CHECK(!dest.isFieldNull(1, 0) && dest.isLoaded(1, 2));
+    FR_CHECK(dest.isRowModified(1));
+    FR_CHECK(dest.isFieldNull(0, 0));
+
+    // copying a NULL row over a row with data clears it
+    dest.copyRow(source, 2, 1);
+    FR_CHECK(dest.isFieldNull(1, 2) && !dest.isLoaded(1, 2));
+    FR_CHECK(getBytes(dest, 1, 2) == "<none>");
+    FR_CHECK(!dest.isRowModified(1));
+}
+
+static void testSaveAndLoad()
+{
+    DataGridColumnStore store;
+    fillStore(store, 5000);
+    store.setFieldNA(10, 1, true);
+    store.setLoaded(20, 2, true);
+    store.setRowDeleted(30, true);
+
+    std::vector<char> data;
+    store.saveData(data);
+    store.releaseData();
+    FR_CHECK(store.getRowCount() == 0);
+    FR_CHECK(store.getColumnCount() == 3);
+
+    store.loadData(&data[0], data.size());
+    FR_CHECK(store.getRowCount() == 5000);
+    for (unsigned row = 0; row < 5000; ++row)
+    {
+        FR_CHECK(store.isFieldNull(row, 2) == (row % 3 == 2));
+        if (row % 3 == 2)
+            continue;
+        int i;
+        FR_CHECK(store.getValue(row, 0, i) && i == int(row));
+        FR_CHECK(getBytes(store, row, 2) == "row " + std::to_string(row));
+    }
+    FR_CHECK(store.isFieldNA(10, 1) && !store.isFieldNA(10, 0));
+    FR_CHECK(store.isLoaded(20, 2) && store.isRowDeleted(30));
+
+    // the data of a store with other columns is rejected
+    DataGridColumnStore other;
+    other.addColumn(0);
+    FR_CHECK_THROWS(other.loadData(&data[0], data.size()), FRError);
+}
+
+int main()
+{
+    FR_RUN_TEST(testValues);
+    FR_RUN_TEST(testLargeBytes);
+    FR_RUN_TEST(testFlags);
+    FR_RUN_TEST(testRemoveLastRow);
+    FR_RUN_TEST(testCopyRow);
+    FR_RUN_TEST(testSaveAndLoad);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for DataGridFetchQueue
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <thread>
+
+#include "gui/controls/DataGridFetchQueue.h"
+#include "gui/controls/DataGridRowBuffer.h"
+#include "Test.h"
+
+// returns a store with a single row holding the number
+static DataGridColumnStore* createRows(int number)
+{
+    DataGridColumnStore* rows = new DataGridColumnStore();
+    rows->addColumn(sizeof(int));
+    rows->setValue(rows->appendRow(), 0, number);
+    return rows;
+}
+
+static int getNumber(DataGridColumnStore* rows)
+{
+    int number = -1;
+    FR_CHECK(rows->getValue(0, 0, number));
+    delete rows;
+    return number;
+}
+
+static void testFullAndEmpty()
+{
+    DataGridFetchQueue queue;
+    FR_CHECK(!queue.canPop());
+    FR_CHECK(queue.pop() == 0);
+
+    int pushed = 0;
+    while (pushed < 100)
+    {
+        DataGridColumnStore* rows = createRows(pushed);
+        if (!queue.push(rows))
+        {
+            delete rows;
+            break;
+        }
+        ++pushed;
+    }
+    FR_CHECK(pushed == 16);
+    FR_CHECK(queue.canPop());
+
+    // a popped entry makes room for exactly one more
+    FR_CHECK(getNumber(queue.pop()) == 0);
+    DataGridColumnStore* rows = createRows(16);
+    FR_CHECK(queue.push(rows));
+    rows = createRows(17);
+    FR_CHECK(!queue.push(rows));
+    delete rows;
+
+    for (int i = 1; i <= 16; ++i)
+        FR_CHECK(getNumber(queue.pop()) == i);
+    FR_CHECK(!queue.canPop());
+    FR_CHECK(queue.pop() == 0);
+}
+
+static void testWrapAround()
+{
+    // head and tail wrap around the ring many times
+    DataGridFetchQueue queue;
+    int next = 0;
+    for (int i = 0; i < 3; ++i)
+        FR_CHECK(queue.push(createRows(i)));
+    for (int i = 3; i < 2000; ++i)
+    {
+        FR_CHECK(queue.push(createRows(i)));
+        FR_CHECK(getNumber(queue.pop()) == next++);
+    }
+    while (queue.canPop())
+        FR_CHECK(getNumber(queue.pop()) == next++);
+    FR_CHECK(next == 2000);
+}
+
+static void testDestructorDeletesRows()
+{
+    // rows left in the queue are owned by it, leak checkers report them
+    // if they aren't deleted
+    DataGridFetchQueue queue;
+    for (int i = 0; i < 5; ++i)
+        FR_CHECK(queue.push(createRows(i)));
+}
+
+static void testTwoThreads()
+{
+    // all blocks pushed by the producer arrive in order at the consumer
+    const int count = 20000;
+    DataGridFetchQueue queue;
+    std::thread producer([&queue]()
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            DataGridColumnStore* rows = createRows(i);
+            while (!queue.push(rows))
+                std::this_thread::yield();
+        }
+    });
+
+    int next = 0;
+    while (next < count)
+    {
+        DataGridColumnStore* rows = queue.pop();
+        if (rows)
+            FR_CHECK(getNumber(rows) == next++);
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    FR_CHECK(!queue.canPop());
+}
+
+int main()
+{
+    FR_RUN_TEST(testFullAndEmpty);
+    FR_RUN_TEST(testWrapAround);
+    FR_RUN_TEST(testDestructorDeletesRows);
+    FR_RUN_TEST(testTwoThreads);
+    return 0;
+}
@@ -0,0 +1,189 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for grouping the data grid rows
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <string>
+#include <vector>
+
+#include "gui/controls/DataGridGroups.h"
+#include "Test.h"
+
+// adds a row with one aggregated value, NULL if null is set
+static void addRow(DataGridGroupInput& input, const std::string& group,
+    const std::string& pivot, unsigned position, double value,
+    bool null = false)
+{
+    input.keyOffsets.push_back(input.keys.size());
+    input.keys.insert(input.keys.end(), group.begin(), group.end());
+    input.pivotOffsets.push_back(input.keys.size());
+    input.keys.insert(input.keys.end(), pivot.begin(), pivot.end());
+    input.storeRows.push_back(unsigned(input.storeRows.size()));
+    input.positions.push_back(position);
+    input.values.push_back(value);
+    input.nulls.push_back(null ? 1 : 0);
+}
+
+static void finishInput(DataGridGroupInput& input)
+{
+    input.keyOffsets.push_back(input.keys.size());
+    input.keys.push_back(0);
+}
+
+static void testGroups()
+{
+    DataGridGroupInput input;
+    input.aggregateCount = 1;
+    addRow(input, "b", "", 3, 10);
+    addRow(input, "a", "", 1, 2);
+    addRow(input, "b", "", 0, -5);
+    addRow(input, "a", "", 2, 0, true);
+    addRow(input, "c", "", 4, 0, true);
+    finishInput(input);
+
+    DataGridGroups groups;
+    groups.compute(input, 1);
+    const std::vector<DataGridGroups::Group>& result = groups.getGroups();
+    FR_CHECK(result.size() == 3);
+    // "b" is shown first because of its row at position 0
+    FR_CHECK(result[0].row == 2 && result[0].position == 0);
+    FR_CHECK(result[0].rowCount == 2);
+    FR_CHECK(result[0].aggregates[0].count == 2);
+    FR_CHECK(result[0].aggregates[0].sum == 5);
+    FR_CHECK(result[0].aggregates[0].min == -5);
+    FR_CHECK(result[0].aggregates[0].max == 10);
+    // NULL values are counted as rows, but not aggregated
+    FR_CHECK(result[1].row == 1 && result[1].rowCount == 2);
+    FR_CHECK(result[1].aggregates[0].count == 1);
+    FR_CHECK(result[1].aggregates[0].sum == 2);
+    FR_CHECK(result[2].row == 4 && result[2].rowCount == 1);
+    FR_CHECK(result[2].aggregates[0].count == 0);
+
+    // without a pivot column every group is a result row
+    FR_CHECK(groups.getResultRows().size() == 3);
+    FR_CHECK(groups.getResultRows()[0] == 2);
+    FR_CHECK(groups.getPivotRows().size() == 1);
+    for (size_t i = 0; i < result.size(); ++i)
+        FR_CHECK(result[i].resultRow == i && result[i].pivot == 0);
+}
+
+static void testPivot()
+{
+    DataGridGroupInput input;
+    input.aggregateCount = 1;
+    addRow(input, "x", "2", 0, 1);
+    addRow(input, "y", "1", 1, 2);
+    addRow(input, "x", "1", 2, 3);
+    addRow(input, "y", "2", 3, 4);
+    addRow(input, "x", "2", 4, 5);
+    finishInput(input);
+
+    DataGridGroups groups;
+    groups.compute(input, 1);
+    const std::vector<DataGridGroups::Group>& result = groups.getGroups();
+    FR_CHECK(result.size() == 4);
+    // result rows and pivot values are numbered in the order first shown
+    FR_CHECK(groups.getResultRows().size() == 2);
+    FR_CHECK(groups.getResultRows()[0] == 0);
+    FR_CHECK(groups.getResultRows()[1] == 1);
+    FR_CHECK(groups.getPivotRows().size() == 2);
+    FR_CHECK(groups.getPivotRows()[0] == 0);
+    FR_CHECK(groups.getPivotRows()[1] == 1);
+    // x/2, y/1, x/1, y/2
+    FR_CHECK(result[0].resultRow == 0 && result[0].pivot == 0);
+    FR_CHECK(result[0].aggregates[0].sum == 6);
+    FR_CHECK(result[1].resultRow == 1 && result[1].pivot == 1);
+    FR_CHECK(result[2].resultRow == 0 && result[2].pivot == 1);
+    FR_CHECK(result[3].resultRow == 1 && result[3].pivot == 0);
+    FR_CHECK(result[3].aggregates[0].sum == 4);
+}
+
+static void testParallel()
+{
+    // enough rows to split them between 4 threads, the positions are
+    // reversed so the first shown row of a group is its last input row
+    const unsigned rows = 4 * 64 * 1024 + 7;
+    DataGridGroupInput input;
+    input.aggregateCount = 1;
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        std::string key(1, char('a' + i % 13));
+        addRow(input, key, std::string(1, char('0' + i % 3)), rows - i,
+            double(i % 100), i % 11 == 0);
+    }
+    finishInput(input);
+
+    DataGridGroups serial, parallel;
+    serial.compute(input, 1);
+    parallel.compute(input, 4);
+    const std::vector<DataGridGroups::Group>& left = serial.getGroups();
+    const std::vector<DataGridGroups::Group>& right = parallel.getGroups();
+    FR_CHECK(left.size() == 39 && right.size() == 39);
+    unsigned rowCount = 0;
+    for (size_t i = 0; i < left.size() && i < right.size(); ++i)
+    {
+        FR_CHECK(left[i].row == right[i].row);
+        FR_CHECK(left[i].row >= rows - 39);
+        FR_CHECK(left[i].rowCount == right[i].rowCount);
+        FR_CHECK(left[i].resultRow == right[i].resultRow);
+        FR_CHECK(left[i].pivot == right[i].pivot);
+        const DataGridGroups::Aggregate& a = left[i].aggregates[0];
+        const DataGridGroups::Aggregate& b = right[i].aggregates[0];
+        FR_CHECK(a.count == b.count && a.sum == b.sum);
+        FR_CHECK(a.min == b.min && a.max == b.max);
+        rowCount += left[i].rowCount;
+    }
+    FR_CHECK(rowCount == rows);
+    FR_CHECK(serial.getResultRows() == parallel.getResultRows());
+    FR_CHECK(serial.getPivotRows() == parallel.getPivotRows());
+    FR_CHECK(parallel.getResultRows().size() == 13);
+    FR_CHECK(parallel.getPivotRows().size() == 3);
+}
+
+static void testEmpty()
+{
+    DataGridGroupInput input;
+    input.aggregateCount = 2;
+    finishInput(input);
+
+    DataGridGroups groups;
+    groups.compute(input, 4);
+    FR_CHECK(groups.getGroups().empty());
+    FR_CHECK(groups.getResultRows().empty());
+    FR_CHECK(groups.getPivotRows().empty());
+}
+
+int main()
+{
+    FR_RUN_TEST(testGroups);
+    FR_RUN_TEST(testPivot);
+    FR_RUN_TEST(testParallel);
+    FR_RUN_TEST(testEmpty);
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for DataGridPagedStore
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <string>
+#include <vector>
+
+#include "gui/controls/DataGridRowBuffer.h"
+#include "Test.h"
+
+// must match the page size used by DataGridPagedStore
+static const unsigned pageRows = 4096;
+
+static std::string rowText(unsigned row)
+{
+    return "row " + std::to_string(row);
+}
+
+static void appendRows(DataGridPagedStore& store, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+    {
+        DataGridRowBuffer buffer(&store, store.appendRow());
+        buffer.setBytes(0, rowText(i).data(), rowText(i).size());
+        buffer.setValue(1, int64_t(i));
+        buffer.setFieldNull(0, false);
+        buffer.setFieldNull(1, false);
+    }
+}
+
+static void checkRow(DataGridPagedStore& store, unsigned row)
+{
+    DataGridRowBuffer buffer(&store, row);
+    const char* data;
+    unsigned length;
+    FR_CHECK(buffer.getBytes(0, data, length));
+    FR_CHECK(std::string(data, length) == rowText(row));
+    int64_t value;
+    FR_CHECK(buffer.getValue(1, value) && value == int64_t(row));
+    FR_CHECK(!buffer.isFieldNull(1));
+}
+
+static void testSpillRoundTrip()
+{
+    // with the smallest memory limit all pages but a few are written to
+    // the temporary file, and read back when they are used again
+    DataGridPagedStore store;
+    store.addColumn(0);
+    store.addColumn(sizeof(int64_t));
+    store.setMemoryLimit(1);
+    const unsigned rows = 20 * pageRows + 17;
+    appendRows(store, rows);
+    FR_CHECK(store.getRowCount() == rows);
+    FR_CHECK(store.getPageCount() == 21);
+
+    unsigned pageRow;
+    DataGridColumnStore* first = store.getPage(0, pageRow);
+    FR_CHECK(first->getRowCount() == pageRows);
+    for (unsigned row = pageRows; row < rows; row += pageRows)
+        checkRow(store, row);
+    // the first page was released meanwhile
+    FR_CHECK(first->getRowCount() == 0);
+
+    for (unsigned row = 0; row < rows; row += 333)
+        checkRow(store, row);
+    checkRow(store, rows - 1);
+
+    // changes of a page are written again when it is released
+    {
+        DataGridRowBuffer buffer(&store, 5);
+        buffer.setValue(1, int64_t(-5));
+    }
+    for (unsigned row = pageRows; row < rows; row += pageRows)
+        checkRow(store, row);
+    DataGridRowBuffer buffer(&store, 5);
+    int64_t value;
+    FR_CHECK(buffer.getValue(1, value) && value == -5);
+}
+
+static void testPinnedPage()
+{
+    DataGridPagedStore store;
+    store.addColumn(0);
+    store.addColumn(sizeof(int64_t));
+    store.setMemoryLimit(1);
+    appendRows(store, 20 * pageRows);
+
+    unsigned pageRow;
+    DataGridColumnStore* pinned = store.pinPage(pageRows + 3, pageRow);
+    FR_CHECK(pageRow == 3);
+    for (unsigned row = 2 * pageRows; row < 20 * pageRows; row += pageRows)
+        checkRow(store, row);
+    // the pinned page stays in memory and the pointer stays valid
+    FR_CHECK(pinned->getRowCount() == pageRows);
+    const char* data;
+    unsigned length;
+    FR_CHECK(pinned->getBytes(3, 0, data, length));
+    FR_CHECK(std::string(data, length) == rowText(pageRows + 3));
+    store.unpinPage(pageRows + 3);
+
+    for (unsigned row = 2 * pageRows; row < 20 * pageRows; row += pageRows)
+        checkRow(store, row);
+    FR_CHECK(pinned->getRowCount() == 0);
+    checkRow(store, pageRows + 3);
+}
+
+static void testScanGroup()
+{
+    // the pages of a scan stay in memory together, also when other pages
+    // are pinned meanwhile
+    DataGridPagedStore store;
+    store.addColumn(0);
+    store.addColumn(sizeof(int64_t));
+    store.setMemoryLimit(1);
+    appendRows(store, 20 * pageRows);
+
+    unsigned pageRow;
+    for (unsigned i = 0; i < 3; ++i)
+        store.pinPage(i * pageRows, pageRow);
+    std::vector<DataGridColumnStore*> scan;
+    for (unsigned index = 3; index < store.getPageCount(); ++index)
+    {
+        unsigned firstRow;
+        scan.push_back(store.getPageByIndex(index, firstRow));
+        FR_CHECK(firstRow == index * pageRows);
+        if (scan.size() > store.getScanPageCount())
+            scan.erase(scan.begin());
+        for (size_t i = 0; i < scan.size(); ++i)
+            FR_CHECK(scan[i]->getRowCount() == pageRows);
+    }
+    for (unsigned i = 0; i < 3; ++i)
+        store.unpinPage(i * pageRows);
+}
+
+static void testMissingRows()
+{
+    DataGridPagedStore store;
+    store.addColumn(0);
+    store.addColumn(sizeof(int64_t));
+    appendRows(store, 10);
+    store.setRowCount(3 * pageRows);
+    FR_CHECK(store.getRowCount() == 3 * pageRows);
+    FR_CHECK(store.getPageCount() == 3);
+    FR_CHECK(!store.isRowMissing(9) && store.isRowMissing(10));
+    FR_CHECK(store.isRowMissing(3 * pageRows - 1));
+    FR_CHECK(!store.isRowMissing(3 * pageRows));
+
+    // missing rows are NULL when they are accessed
+    FR_CHECK(store.isFieldNull(2 * pageRows, 0));
+
+    unsigned row;
+    FR_CHECK(store.findMissingRow(0, row) && row == 10);
+    store.setRowPresent(10);
+    FR_CHECK(store.findMissingRow(0, row) && row == 11);
+    FR_CHECK(store.findMissingRow(pageRows + 5, row) && row == pageRows + 5);
+
+    // the pages without missing rows are skipped
+    for (unsigned i = 11; i < 2 * pageRows; ++i)
+        store.setRowPresent(i);
+    FR_CHECK(store.findMissingRow(0, row) && row == 2 * pageRows);
+    for (unsigned i = 2 * pageRows; i < 3 * pageRows; ++i)
+        store.setRowPresent(i);
+    FR_CHECK(!store.findMissingRow(0, row));
+}
+
+static void testRemoveLastRow()
+{
+    DataGridPagedStore store;
+    store.addColumn(0);
+    store.addColumn(sizeof(int64_t));
+    appendRows(store, pageRows + 1);
+    FR_CHECK(store.getPageCount() == 2);
+
+    // removing the only row of the last page removes the page
+    store.removeLastRow();
+    FR_CHECK(store.getRowCount() == pageRows);
+    FR_CHECK(store.getPageCount() == 1);
+    checkRow(store, pageRows - 1);
+
+    store.setRowCount(pageRows + 2);
+    FR_CHECK(store.isRowMissing(pageRows + 1));
+    store.removeLastRow();
+    store.removeLastRow();
+    FR_CHECK(store.getPageCount() == 1);
+    unsigned row;
+    FR_CHECK(!store.findMissingRow(0, row));
+
+    DataGridPagedStore empty;
+    empty.removeLastRow();
+    FR_CHECK(empty.getRowCount() == 0);
+}
+
+int main()
+{
+    FR_RUN_TEST(testSpillRoundTrip);
+    FR_RUN_TEST(testPinnedPage);
+    FR_RUN_TEST(testScanGroup);
+    FR_RUN_TEST(testMissingRows);
+    FR_RUN_TEST(testRemoveLastRow);
+    return 0;
+}
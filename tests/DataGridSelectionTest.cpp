@@ -0,0 +1,145 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for the ranges of the data grid selection
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <vector>
+
+#include "gui/controls/DataGridSelection.h"
+#include "Test.h"
+
+static void testMerge()
+{
+    DataGridSelection selection(100, 2);
+    // overlapping, adjacent, contained and separate ranges, unsorted
+    selection.addRange(0, 20, 30);
+    selection.addRange(0, 5, 10);
+    selection.addRange(0, 11, 12);
+    selection.addRange(0, 25, 28);
+    selection.addRange(0, 28, 35);
+    selection.addRange(0, 50, 50);
+    selection.finish();
+
+    const DataGridSelection::RowRanges& ranges = selection.getColumnRanges(0);
+    FR_CHECK(ranges.size() == 3);
+    FR_CHECK(ranges[0] == std::make_pair(5, 12));
+    FR_CHECK(ranges[1] == std::make_pair(20, 35));
+    FR_CHECK(ranges[2] == std::make_pair(50, 50));
+    FR_CHECK(selection.getColumnRanges(1).empty());
+    FR_CHECK(selection.getCellCount() == 8 + 16 + 1);
+
+    FR_CHECK(!selection.isSelected(4, 0));
+    FR_CHECK(selection.isSelected(5, 0) && selection.isSelected(12, 0));
+    FR_CHECK(!selection.isSelected(13, 0) && !selection.isSelected(19, 0));
+    FR_CHECK(selection.isSelected(35, 0) && !selection.isSelected(36, 0));
+    FR_CHECK(selection.isSelected(50, 0) && !selection.isSelected(51, 0));
+    FR_CHECK(!selection.isSelected(5, 1));
+    FR_CHECK(!selection.isSelected(5, -1) && !selection.isSelected(5, 2));
+
+    // finishing again after adding more ranges doesn't count cells twice
+    selection.addRange(0, 13, 19);
+    selection.finish();
+    FR_CHECK(selection.getColumnRanges(0).size() == 2);
+    FR_CHECK(selection.getCellCount() == 31 + 1);
+    FR_CHECK(selection.getRowSpans().size() == 2);
+}
+
+static void testClipping()
+{
+    DataGridSelection selection(10, 3);
+    selection.addRange(0, -5, 2);
+    selection.addRange(1, 8, 20);
+    selection.addRange(2, 10, 12);
+    selection.addRange(3, 0, 9);
+    selection.addRange(-1, 0, 9);
+    selection.addRange(1, 5, 4);
+    selection.finish();
+
+    FR_CHECK(selection.getColumnRanges(0).size() == 1);
+    FR_CHECK(selection.getColumnRanges(0)[0] == std::make_pair(0, 2));
+    FR_CHECK(selection.getColumnRanges(1).size() == 1);
+    FR_CHECK(selection.getColumnRanges(1)[0] == std::make_pair(8, 9));
+    FR_CHECK(selection.getColumnRanges(2).empty());
+    FR_CHECK(selection.getCellCount() == 5);
+    FR_CHECK(!selection.isEmpty() && !selection.isAllSelected());
+}
+
+static void testRowSpans()
+{
+    // column 0: rows 0-9, column 1: rows 5-14, column 2: row 20
+    DataGridSelection selection(30, 3);
+    selection.addRange(0, 0, 9);
+    selection.addRange(1, 5, 14);
+    selection.addRange(2, 20, 20);
+    selection.finish();
+
+    const std::vector<DataGridSelection::RowSpan>& spans =
+        selection.getRowSpans();
+    FR_CHECK(spans.size() == 4);
+    if (spans.size() != 4)
+        return;
+    FR_CHECK(spans[0].firstRow == 0 && spans[0].lastRow == 4);
+    FR_CHECK(spans[0].columns == std::vector<int>(1, 0));
+    FR_CHECK(spans[1].firstRow == 5 && spans[1].lastRow == 9);
+    FR_CHECK(spans[1].columns.size() == 2);
+    FR_CHECK(spans[1].columns[0] == 0 && spans[1].columns[1] == 1);
+    FR_CHECK(spans[2].firstRow == 10 && spans[2].lastRow == 14);
+    FR_CHECK(spans[2].columns == std::vector<int>(1, 1));
+    // the unselected rows 15-19 have no span
+    FR_CHECK(spans[3].firstRow == 20 && spans[3].lastRow == 20);
+    FR_CHECK(spans[3].columns == std::vector<int>(1, 2));
+}
+
+static void testAllSelected()
+{
+    DataGridSelection selection(500000, 40);
+    FR_CHECK(selection.isEmpty() && !selection.isAllSelected());
+    selection.addRows(0, 249999);
+    selection.addRows(250000, 499999);
+    selection.finish();
+    FR_CHECK(selection.getCellCount() == size_t(500000) * 40);
+    FR_CHECK(selection.isAllSelected());
+    FR_CHECK(selection.isSelected(499999, 39));
+    FR_CHECK(selection.getRowSpans().size() == 1);
+    FR_CHECK(selection.getRowSpans()[0].columns.size() == 40);
+
+    DataGridSelection empty(0, 0);
+    empty.finish();
+    FR_CHECK(empty.isEmpty() && !empty.isAllSelected());
+    FR_CHECK(empty.getRowSpans().empty());
+}
+
+int main()
+{
+    FR_RUN_TEST(testMerge);
+    FR_RUN_TEST(testClipping);
+    FR_RUN_TEST(testRowSpans);
+    FR_RUN_TEST(testAllSelected);
+    return 0;
+}
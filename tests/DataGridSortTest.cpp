@@ -0,0 +1,132 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for sorting the rows of the data grid
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gui/controls/DataGridSort.h"
+#include "Test.h"
+
+typedef RowSortKey<int> IntKey;
+
+// keys with few distinct values, in a shuffled previous order
+static std::vector<IntKey> createKeys(unsigned count, int values)
+{
+    std::vector<unsigned> positions(count);
+    for (unsigned i = 0; i < count; ++i)
+        positions[i] = i;
+    srand(count);
+    for (unsigned i = count - 1; i > 0; --i)
+        std::swap(positions[i], positions[rand() % (i + 1)]);
+
+    std::vector<IntKey> keys(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        keys[i].value = rand() % values;
+        keys[i].row = i;
+        keys[i].position = positions[i];
+    }
+    return keys;
+}
+
+// rows with equal values must keep their previous order, both when
+// sorting ascending and descending
+static void checkSorted(const std::vector<IntKey>& keys, bool ascending)
+{
+    std::vector<bool> seen(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        FR_CHECK(!seen[keys[i].row]);
+        seen[keys[i].row] = true;
+        if (i == 0)
+            continue;
+        const IntKey& prev = keys[i - 1];
+        if (prev.value == keys[i].value)
+            FR_CHECK(prev.position < keys[i].position);
+        else
+            FR_CHECK((prev.value < keys[i].value) == ascending);
+    }
+}
+
+static void testStable()
+{
+    std::vector<IntKey> keys = createKeys(1000, 10);
+    parallelSort(keys, RowSortKeyLess<int>(true), 1);
+    checkSorted(keys, true);
+    parallelSort(keys, RowSortKeyLess<int>(false), 1);
+    checkSorted(keys, false);
+}
+
+static void testStableParallel()
+{
+    // enough keys for 4 threads and an odd number of parts to merge
+    const unsigned count = 3 * 32 * 1024 + 123;
+    for (size_t threads = 2; threads <= 4; ++threads)
+    {
+        std::vector<IntKey> keys = createKeys(count, 50);
+        parallelSort(keys, RowSortKeyLess<int>(true), threads);
+        checkSorted(keys, true);
+        keys = createKeys(count, 50);
+        parallelSort(keys, RowSortKeyLess<int>(false), threads);
+        checkSorted(keys, false);
+    }
+}
+
+static void testBytes()
+{
+    const char* values[] = { "abc", "ab", "b", "", "abc", "ab", "a\xff" };
+    const unsigned count = sizeof(values) / sizeof(values[0]);
+    std::string bytes;
+    std::vector<RowSortKey<BytesSortValue> > keys(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        keys[i].value.offset = bytes.size();
+        keys[i].value.length = strlen(values[i]);
+        keys[i].row = i;
+        // the previous order is the reverse of the rows
+        keys[i].position = count - i;
+        bytes += values[i];
+    }
+
+    // shorter strings come first, bytes compare unsigned
+    parallelSort(keys, BytesSortKeyLess(bytes.data(), true));
+    const unsigned ascending[] = { 3, 5, 1, 4, 0, 6, 2 };
+    for (unsigned i = 0; i < count; ++i)
+        FR_CHECK(keys[i].row == ascending[i]);
+
+    parallelSort(keys, BytesSortKeyLess(bytes.data(), false));
+    const unsigned descending[] = { 2, 6, 4, 0, 5, 1, 3 };
+    for (unsigned i = 0; i < count; ++i)
+        FR_CHECK(keys[i].row == descending[i]);
+}
+
+int main()
+{
+    FR_RUN_TEST(testStable);
+    FR_RUN_TEST(testStableParallel);
+    FR_RUN_TEST(testBytes);
+    return 0;
+}
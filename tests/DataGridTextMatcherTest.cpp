@@ -0,0 +1,129 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for DataGridTextMatcher
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <cstring>
+#include <string>
+
+#include "gui/controls/DataGridTextMatcher.h"
+#include "Test.h"
+
+static bool contains(const char* text, const char* pattern)
+{
+    DataGridTextMatcher matcher;
+    matcher.setString(pattern, strlen(pattern));
+    // a copy without terminating zero, so that reading past the end of the
+    // text is found by memory checkers
+    std::string data(text);
+    char* buffer = new char[data.size() + 1];
+    memcpy(buffer, data.data(), data.size());
+    bool result = matcher.contains(buffer, data.size());
+    delete[] buffer;
+    return result;
+}
+
+static void testCaseFolding()
+{
+    FR_CHECK(contains("FlameRobin", "robin"));
+    FR_CHECK(contains("FlameRobin", "FLAME"));
+    FR_CHECK(contains("flamerobin", "ameR"));
+    FR_CHECK(!contains("FlameRobin", "robins"));
+    // only ASCII letters are folded
+    FR_CHECK(contains("a\xc4\xb0z", "\xc4\xb0"));
+    FR_CHECK(!contains("a\xc4\xb0z", "\xe4\xb0"));
+    FR_CHECK(!contains("[]", "{}"));
+}
+
+static void testAnchor()
+{
+    // the anchor is the first byte that isn't a letter, if the pattern
+    // starts with a letter; the match must still start at the pattern
+    FR_CHECK(contains("order_id", "r_i"));
+    FR_CHECK(contains("ab1 ab2 AB3", "ab3"));
+    FR_CHECK(!contains("ab1 ab2 AB3", "ab4"));
+    FR_CHECK(contains("x1 y1", "y1"));
+    FR_CHECK(contains("1a 1b", "1b"));
+    // candidates for the anchor in upper and lower case are interleaved
+    FR_CHECK(contains("aXbxcXdx", "dx"));
+    FR_CHECK(contains("aXbxcXdX", "dx"));
+}
+
+static void testBounds()
+{
+    FR_CHECK(contains("abc", "abc"));
+    FR_CHECK(contains("abc", "a"));
+    FR_CHECK(contains("abc", "c"));
+    FR_CHECK(contains("abc-", "c-"));
+    FR_CHECK(contains("-abc", "-a"));
+    FR_CHECK(!contains("abc", "abcd"));
+    FR_CHECK(!contains("ab", "b-"));
+    FR_CHECK(!contains("", "a"));
+    // the empty pattern is found everywhere
+    FR_CHECK(contains("", ""));
+    FR_CHECK(contains("abc", ""));
+
+    // the matcher can be reused for another pattern
+    DataGridTextMatcher matcher;
+    matcher.setString("x-y", 3);
+    FR_CHECK(matcher.contains("ax-yb", 5));
+    matcher.setString("ab", 2);
+    FR_CHECK(!matcher.contains("ax-yb", 5));
+    FR_CHECK(matcher.contains("xAB", 3));
+}
+
+static int compare(const char* a, const char* b)
+{
+    int res = DataGridTextMatcher::compare(a, strlen(a), b, strlen(b));
+    return res < 0 ? -1 : (res > 0 ? 1 : 0);
+}
+
+static void testCompare()
+{
+    FR_CHECK(compare("abc", "abc") == 0);
+    FR_CHECK(compare("abc", "abd") == -1);
+    FR_CHECK(compare("b", "abc") == 1);
+    // trailing spaces don't matter
+    FR_CHECK(compare("abc", "abc  ") == 0);
+    FR_CHECK(compare("abc  ", "abc") == 0);
+    // bytes below the space sort before the padding
+    FR_CHECK(compare("abc\t", "abc") == -1);
+    FR_CHECK(compare("abc", "abc\t") == 1);
+    FR_CHECK(compare("abcd", "abc") == 1);
+    FR_CHECK(compare("", "  ") == 0);
+}
+
+int main()
+{
+    FR_RUN_TEST(testCaseFolding);
+    FR_RUN_TEST(testAnchor);
+    FR_RUN_TEST(testBounds);
+    FR_RUN_TEST(testCompare);
+    return 0;
+}
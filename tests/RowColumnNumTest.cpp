@@ -0,0 +1,122 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for the column name lookup of IBPP rows
+
+#include <cstring>
+#include <string>
+
+#include "_ibpp.h"
+
+#include "Test.h"
+
+using namespace ibpp_internals;
+
+static void describe(RowImpl& row, int col, const char* name,
+    const char* alias)
+{
+    XSQLVAR* var = &(row.Self()->sqlvar[col - 1]);
+    var->sqltype = SQL_LONG | 1;
+    var->sqllen = 4;
+    var->sqlname_length = int16_t(strlen(name));
+    memcpy(var->sqlname, name, var->sqlname_length);
+    var->aliasname_length = int16_t(strlen(alias));
+    memcpy(var->aliasname, alias, var->aliasname_length);
+}
+
+static void testNamesAndAliases()
+{
+    RowImpl row(3, 4, 0, 0);
+    row.Self()->sqld = 4;
+    describe(row, 1, "ID", "ID");
+    describe(row, 2, "NAME", "FIRST");
+    describe(row, 3, "", "TOTAL");
+    describe(row, 4, "NAME", "SECOND");
+    row.AllocVariables();
+
+    // names are looked up case-insensitively
+    FR_CHECK(row.ColumnNum("ID") == 1);
+    FR_CHECK(row.ColumnNum("id") == 1);
+    FR_CHECK(row.ColumnNum("Total") == 3);
+    // the first column with a name wins
+    FR_CHECK(row.ColumnNum("name") == 2);
+    // aliases are used when no column has the name
+    FR_CHECK(row.ColumnNum("FIRST") == 2);
+    FR_CHECK(row.ColumnNum("second") == 4);
+
+    FR_CHECK_THROWS(row.ColumnNum("MISSING"), IBPP::LogicException);
+    FR_CHECK_THROWS(row.ColumnNum(""), IBPP::LogicException);
+
+    // the name takes precedence over an alias of an earlier column
+    RowImpl other(3, 2, 0, 0);
+    other.Self()->sqld = 2;
+    describe(other, 1, "A", "B");
+    describe(other, 2, "B", "C");
+    other.AllocVariables();
+    FR_CHECK(other.ColumnNum("B") == 2);
+    FR_CHECK(other.ColumnNum("C") == 2);
+}
+
+static void testLongNames()
+{
+    // the lookup is limited to the length of the names in the descriptor
+    std::string name(sizeof(XSQLVAR::sqlname), 'X');
+    RowImpl row(3, 1, 0, 0);
+    row.Self()->sqld = 1;
+    describe(row, 1, name.c_str(), "");
+    row.AllocVariables();
+    FR_CHECK(row.ColumnNum(name) == 1);
+    FR_CHECK(row.ColumnNum(name + "YZ") == 1);
+    FR_CHECK_THROWS(row.ColumnNum(name.substr(1)), IBPP::LogicException);
+}
+
+static void testReindex()
+{
+    RowImpl row(3, 2, 0, 0);
+    row.Self()->sqld = 2;
+    describe(row, 1, "A", "");
+    describe(row, 2, "B", "");
+    row.AllocVariables();
+    FR_CHECK(row.ColumnNum("B") == 2);
+
+    // copies of a row keep the index
+    RowImpl copied(row);
+    FR_CHECK(copied.ColumnNum("B") == 2);
+
+    // describing the columns again invalidates the index
+    describe(row, 1, "B", "");
+    describe(row, 2, "C", "");
+    row.AllocVariables();
+    FR_CHECK(row.ColumnNum("B") == 1);
+    FR_CHECK(row.ColumnNum("C") == 2);
+    FR_CHECK_THROWS(row.ColumnNum("A"), IBPP::LogicException);
+    FR_CHECK(copied.ColumnNum("A") == 1);
+}
+
+int main()
+{
+    FR_RUN_TEST(testNamesAndAliases);
+    FR_RUN_TEST(testLongNames);
+    FR_RUN_TEST(testReindex);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+// unit tests for StatementCache
+
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <string>
+
+#include "_ibpp.h"
+
+#include "engine/StatementCache.h"
+#include "Test.h"
+
+using namespace ibpp_internals;
+
+// returns unprepared statements, so that no server is needed
+class TestStatementCache: public StatementCache
+{
+private:
+    DatabaseImpl* databaseM;
+protected:
+    virtual IBPP::Statement prepareStatement(
+        const IBPP::Transaction& transaction, const std::string& sql)
+    {
+        ++preparedM;
+        lastSqlM = sql;
+        return new StatementImpl(databaseM,
+            dynamic_cast<TransactionImpl*>(transaction.intf()));
+    }
+public:
+    unsigned preparedM;
+    std::string lastSqlM;
+
+    TestStatementCache(DatabaseImpl* database, unsigned maxSize)
+        : StatementCache(IBPP::Database(database), maxSize),
+            databaseM(database), preparedM(0)
+    {
+    }
+};
+
+static IBPP::Transaction createTransaction(DatabaseImpl* database)
+{
+    return new TransactionImpl(database, IBPP::amWrite,
+        IBPP::ilConcurrency, IBPP::lrWait, IBPP::TFF(0));
+}
+
+static void testHitsAndEvictions()
+{
+    DatabaseImpl* database = new DatabaseImpl("", "test.fdb", "", "", "",
+        "", "");
+    IBPP::Database keep(database);
+    IBPP::Transaction tr = createTransaction(database);
+    TestStatementCache cache(database, 2);
+
+    IBPP::Statement a = cache.getStatement(tr, "select 1");
+    FR_CHECK(cache.getMisses() == 1 && cache.getHits() == 0);
+    FR_CHECK(cache.getStatement(tr, "select 1") == a);
+    FR_CHECK(cache.getHits() == 1 && cache.preparedM == 1);
+
+    IBPP::Statement b = cache.getStatement(tr, "select 2");
+    FR_CHECK(b != a && cache.getSize() == 2);
+    // using "select 1" makes "select 2" the least recently used one
+    cache.getStatement(tr, "select 1");
+    cache.getStatement(tr, "select 3");
+    FR_CHECK(cache.getSize() == 2 && cache.getEvictions() == 1);
+    FR_CHECK(cache.getStatement(tr, "select 1") == a);
+    cache.getStatement(tr, "select 2");
+    FR_CHECK(cache.lastSqlM == "select 2" && cache.preparedM == 4);
+    FR_CHECK(cache.getEvictions() == 2);
+
+    // statements are cached per transaction
+    IBPP::Transaction other = createTransaction(database);
+    cache.getStatement(other, "select 2");
+    FR_CHECK(cache.preparedM == 5);
+}
+
+static void testMaximumSize()
+{
+    DatabaseImpl* database = new DatabaseImpl("", "test.fdb", "", "", "",
+        "", "");
+    IBPP::Database keep(database);
+    IBPP::Transaction tr = createTransaction(database);
+    TestStatementCache cache(database, 0);
+    // no limit
+    for (int i = 0; i < 100; ++i)
+        cache.getStatement(tr, "select " + std::to_string(i));
+    FR_CHECK(cache.getSize() == 100 && cache.getEvictions() == 0);
+
+    cache.setMaximumSize(10);
+    FR_CHECK(cache.getMaximumSize() == 10);
+    FR_CHECK(cache.getSize() == 10 && cache.getEvictions() == 90);
+    // the most recently used statements are kept
+    unsigned prepared = cache.preparedM;
+    for (int i = 90; i < 100; ++i)
+        cache.getStatement(tr, "select " + std::to_string(i));
+    FR_CHECK(cache.preparedM == prepared);
+    cache.getStatement(tr, "select 0");
+    FR_CHECK(cache.preparedM == prepared + 1);
+}
+
+static void testRelease()
+{
+    DatabaseImpl* database = new DatabaseImpl("", "test.fdb", "", "", "",
+        "", "");
+    IBPP::Database keep(database);
+    IBPP::Transaction tr1 = createTransaction(database);
+    IBPP::Transaction tr2 = createTransaction(database);
+    TestStatementCache cache(database, 10);
+    cache.getStatement(tr1, "select 1");
+    cache.getStatement(tr2, "select 1");
+    cache.getStatement(tr1, "select 2");
+
+    cache.releaseStatements(tr1);
+    FR_CHECK(cache.getSize() == 1);
+    cache.getStatement(tr2, "select 1");
+    FR_CHECK(cache.preparedM == 3);
+    cache.getStatement(tr1, "select 1");
+    FR_CHECK(cache.preparedM == 4);
+
+    cache.clear();
+    FR_CHECK(cache.getSize() == 0);
+    cache.getStatement(tr2, "select 1");
+    FR_CHECK(cache.preparedM == 5);
+}
+
+int main()
+{
+    FR_RUN_TEST(testHitsAndEvictions);
+    FR_RUN_TEST(testMaximumSize);
+    FR_RUN_TEST(testRelease);
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+  Copyright (c) 2004-2016 The FlameRobin Development Team
+
+  Permission is hereby granted, free of charge, to any person obtaining
+  a copy of this software and associated documentation files (the
+  "Software"), to deal in the Software without restriction, including
+  without limitation the rights to use, copy, modify, merge, publish,
+  distribute, sublicense, and/or sell copies of the Software, and to
+  permit persons to whom the Software is furnished to do so, subject to
+  the following conditions:
+
+  The above copyright notice and this permission notice shall be included
+  in all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+  CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+  TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+  SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef FR_TESTS_TEST_H
+#define FR_TESTS_TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// the unit tests are plain programs: a failed check reports its location
+// and ends the program with a non-zero exit code, so that "make check"
+// stops at the first failing test
+inline void testFailed(const char* file, int line, const char* what)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    exit(1);
+}
+
+#define FR_CHECK(condition) \
+    do { \
+        if (!(condition)) \
+            testFailed(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define FR_CHECK_THROWS(expression, exceptionType) \
+    do { \
+        bool thrown = false; \
+        try \
+        { \
+            expression; \
+        } \
+        catch (exceptionType&) \
+        { \
+            thrown = true; \
+        } \
+        if (!thrown) \
+            testFailed(__FILE__, __LINE__, #expression " throws"); \
+    } while (0)
+
+#define FR_RUN_TEST(function) \
+    do { \
+        function(); \
+        printf("%s: ok\n", #function); \
+    } while (0)
+
+#endif